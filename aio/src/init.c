@@ -2,7 +2,6 @@
 
 #include <linux/types.h>
 #include <linux/export.h>
-#include <linux/percpu.h>
 #include "../../booter/src/booter.h"
 
 int
@@ -13,5 +12,3 @@ cl_aio_init(void)
     return 0;
 }
 EXPORT_SYMBOL(cl_aio_init);
-
-DEFINE_PER_CPU(int, eventfd_wake_count);
@@ -1,10 +1,6 @@
 #include <linux/types.h>
 #include "../../booter/src/booter.h"
 
-CL_MINE(eventfd_ctx_fdget)
-CL_MINE(eventfd_ctx_put)
-CL_MINE(eventfd_signal)
 CL_MINE(ioprio_check_cap)
 CL_MINE(migrate_page_copy)
 CL_MINE(migrate_page_move_mapping)
-CL_MINE(vfs_fsync)
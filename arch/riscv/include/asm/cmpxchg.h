@@ -7,16 +7,47 @@
 #define _ASM_RISCV_CMPXCHG_H
 
 #include <linux/bug.h>
+#include <linux/bits.h>
 
 #include <asm/barrier.h>
 #include <asm/fence.h>
 
+/*
+ * There is no sub-word AMO in the base A extension, so a 16-bit exchange
+ * is done as an LR/SC loop on the naturally aligned word containing it.
+ * The queued spinlock relies on this for its xchg_tail() fast path.
+ */
+#define __xchg16_relaxed(r, p, n)					\
+({									\
+	u32 *__ptr32b = (u32 *)((ulong)(p) & ~0x3);			\
+	ulong __s = ((ulong)(p) & 0x2) * BITS_PER_BYTE;			\
+	ulong __mask = GENMASK(15, 0) << __s;				\
+	ulong __newx = ((ulong)(n) & GENMASK(15, 0)) << __s;		\
+	ulong __retx;							\
+	ulong __rc;							\
+									\
+	__asm__ __volatile__ (						\
+		"0:	lr.w %0, %2\n"					\
+		"	and  %1, %0, %z4\n"				\
+		"	or   %1, %1, %z3\n"				\
+		"	sc.w %1, %1, %2\n"				\
+		"	bnez %1, 0b\n"					\
+		: "=&r" (__retx), "=&r" (__rc), "+A" (*__ptr32b)	\
+		: "rJ" (__newx), "rJ" (~__mask)				\
+		: "memory");						\
+									\
+	r = (__typeof__(r))((__retx & __mask) >> __s);			\
+})
+
 #define __xchg_relaxed(ptr, new, size)					\
 ({									\
 	__typeof__(ptr) __ptr = (ptr);					\
 	__typeof__(new) __new = (new);					\
 	__typeof__(*(ptr)) __ret;					\
 	switch (size) {							\
+	case 2:								\
+		__xchg16_relaxed(__ret, __ptr, __new);			\
+		break;							\
 	case 4:								\
 		__asm__ __volatile__ (					\
 			"	amoswap.w %0, %2, %1\n"			\
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef _ASM_RISCV_PERCPU_H
+#define _ASM_RISCV_PERCPU_H
+
+#include <asm-generic/percpu.h>
+
+#ifndef __ASSEMBLY__
+
+/*
+ * this_cpu_cmpxchg_double() for a pointer paired with a transaction id
+ * that only ever moves forward, as in SLUB's kmem_cache_cpu.  RV64 has no
+ * double-word LR/SC, and the generic version masks interrupts around the
+ * compare and store.  __this_cpu_cmpxchg_tid() in entry.S instead
+ * restarts on interrupt, like an rseq critical section.
+ */
+int __this_cpu_cmpxchg_tid(void *pcp, void *tid, unsigned long oval,
+			   unsigned long otid, unsigned long nval,
+			   unsigned long ntid);
+
+#define this_cpu_cmpxchg_double_tid(pcp, tid, oval, otid, nval, ntid)	\
+({									\
+	int __ret;							\
+									\
+	BUILD_BUG_ON(sizeof(pcp) != 8 || sizeof(tid) != 8);		\
+	preempt_disable_notrace();					\
+	__ret = __this_cpu_cmpxchg_tid(raw_cpu_ptr(&(pcp)),		\
+				       raw_cpu_ptr(&(tid)),		\
+				       (unsigned long)(oval),		\
+				       (unsigned long)(otid),		\
+				       (unsigned long)(nval),		\
+				       (unsigned long)(ntid));		\
+	preempt_enable_notrace();					\
+	__ret;								\
+})
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* _ASM_RISCV_PERCPU_H */
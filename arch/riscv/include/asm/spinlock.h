@@ -11,6 +11,16 @@
 #include <asm/current.h>
 #include <asm/fence.h>
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+/*
+ * Queued spinlocks: a 32-bit word holding locked/pending bytes plus an
+ * MCS tail, see spinlock/src/qspinlock.c.  Waiters beyond the first spin
+ * on their own per-CPU node, so handoff is FIFO and does not bounce the
+ * lock word between harts.
+ */
+#define _Q_PENDING_LOOPS	(1 << 9)
+#include <asm/qspinlock.h>
+#else
 /*
  * Simple spin lock operations.  These provide no fairness guarantees.
  */
@@ -48,9 +58,14 @@ static inline void arch_spin_lock(arch_spinlock_t *lock)
 			break;
 	}
 }
+#endif /* CONFIG_QUEUED_SPINLOCKS */
 
 /***********************************************************/
 
+#ifdef CONFIG_QUEUED_RWLOCKS
+#include <asm/qrwlock.h>
+#else
+
 static inline void arch_read_lock(arch_rwlock_t *lock)
 {
 	int tmp;
@@ -131,5 +146,6 @@ static inline void arch_write_unlock(arch_rwlock_t *lock)
 {
 	smp_store_release(&lock->lock, 0);
 }
+#endif /* CONFIG_QUEUED_RWLOCKS */
 
 #endif /* _ASM_RISCV_SPINLOCK_H */
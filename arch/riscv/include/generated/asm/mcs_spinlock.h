@@ -0,0 +1 @@
+#include <asm-generic/mcs_spinlock.h>
@@ -1 +0,0 @@
-#include <asm-generic/percpu.h>
@@ -475,6 +475,7 @@ int __sync_blockdev(struct block_device *bdev, int wait)
 		return filemap_flush(bdev->bd_inode->i_mapping);
 	return filemap_write_and_wait(bdev->bd_inode->i_mapping);
 }
+EXPORT_SYMBOL(__sync_blockdev);
 
 /*
  * Write out and wait upon all the dirty data associated with a block
@@ -2103,43 +2104,44 @@ int __invalidate_device(struct block_device *bdev, bool kill_dirty)
 	return res;
 }
 
-//void iterate_bdevs(void (*func)(struct block_device *, void *), void *arg)
-//{
-//	struct inode *inode, *old_inode = NULL;
-//
-//	spin_lock(&blockdev_superblock->s_inode_list_lock);
-//	list_for_each_entry(inode, &blockdev_superblock->s_inodes, i_sb_list) {
-//		struct address_space *mapping = inode->i_mapping;
-//		struct block_device *bdev;
-//
-//		spin_lock(&inode->i_lock);
-//		if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW) ||
-//		    mapping->nrpages == 0) {
-//			spin_unlock(&inode->i_lock);
-//			continue;
-//		}
-//		__iget(inode);
-//		spin_unlock(&inode->i_lock);
-//		spin_unlock(&blockdev_superblock->s_inode_list_lock);
-//		/*
-//		 * We hold a reference to 'inode' so it couldn't have been
-//		 * removed from s_inodes list while we dropped the
-//		 * s_inode_list_lock  We cannot iput the inode now as we can
-//		 * be holding the last reference and we cannot iput it under
-//		 * s_inode_list_lock. So we keep the reference and iput it
-//		 * later.
-//		 */
-//		iput(old_inode);
-//		old_inode = inode;
-//		bdev = I_BDEV(inode);
-//
-//		mutex_lock(&bdev->bd_mutex);
-//		if (bdev->bd_openers)
-//			func(bdev, arg);
-//		mutex_unlock(&bdev->bd_mutex);
-//
-//		spin_lock(&blockdev_superblock->s_inode_list_lock);
-//	}
-//	spin_unlock(&blockdev_superblock->s_inode_list_lock);
-//	iput(old_inode);
-//}
+void iterate_bdevs(void (*func)(struct block_device *, void *), void *arg)
+{
+	struct inode *inode, *old_inode = NULL;
+
+	spin_lock(&blockdev_superblock->s_inode_list_lock);
+	list_for_each_entry(inode, &blockdev_superblock->s_inodes, i_sb_list) {
+		struct address_space *mapping = inode->i_mapping;
+		struct block_device *bdev;
+
+		spin_lock(&inode->i_lock);
+		if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW) ||
+		    mapping->nrpages == 0) {
+			spin_unlock(&inode->i_lock);
+			continue;
+		}
+		__iget(inode);
+		spin_unlock(&inode->i_lock);
+		spin_unlock(&blockdev_superblock->s_inode_list_lock);
+		/*
+		 * We hold a reference to 'inode' so it couldn't have been
+		 * removed from s_inodes list while we dropped the
+		 * s_inode_list_lock  We cannot iput the inode now as we can
+		 * be holding the last reference and we cannot iput it under
+		 * s_inode_list_lock. So we keep the reference and iput it
+		 * later.
+		 */
+		iput(old_inode);
+		old_inode = inode;
+		bdev = I_BDEV(inode);
+
+		mutex_lock(&bdev->bd_mutex);
+		if (bdev->bd_openers)
+			func(bdev, arg);
+		mutex_unlock(&bdev->bd_mutex);
+
+		spin_lock(&blockdev_superblock->s_inode_list_lock);
+	}
+	spin_unlock(&blockdev_superblock->s_inode_list_lock);
+	iput(old_inode);
+}
+EXPORT_SYMBOL(iterate_bdevs);
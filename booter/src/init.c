@@ -483,12 +483,6 @@ __weak struct file_system_type *get_filesystem(struct file_system_type *fs)
 }
 EXPORT_SYMBOL(get_filesystem);
 
-int sync_filesystem(struct super_block *sb)
-{
-    booter_panic("No impl in 'booter'.");
-}
-EXPORT_SYMBOL(sync_filesystem);
-
 __weak void path_get(const struct path *path)
 {
     booter_panic("No impl in 'booter'.");
@@ -2011,14 +2005,6 @@ __weak int sock_register(const struct net_proto_family *ops)
 }
 EXPORT_SYMBOL(sock_register);
 
-ssize_t generic_file_splice_read(struct file *in, loff_t *ppos,
-                 struct pipe_inode_info *pipe, size_t len,
-                 unsigned int flags)
-{
-    booter_panic("No impl 'slub'.");
-}
-EXPORT_SYMBOL(generic_file_splice_read);
-
 __weak void __init files_maxfiles_init(void)
 {
     booter_panic("No impl 'slub'.");
@@ -2489,12 +2475,6 @@ __weak int sb_set_blocksize(struct super_block *sb, int size)
 }
 EXPORT_SYMBOL(sb_set_blocksize);
 
-int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
-{
-    booter_panic("No impl!\n");
-}
-EXPORT_SYMBOL(vfs_fsync_range);
-
 __weak int fsync_bdev(struct block_device *bdev)
 {
     booter_panic("No impl!\n");
@@ -2671,14 +2651,6 @@ __weak int elv_register_queue(struct request_queue *q, bool uevent)
 }
 EXPORT_SYMBOL(elv_register_queue);
 
-ssize_t
-iter_file_splice_write(struct pipe_inode_info *pipe, struct file *out,
-              loff_t *ppos, size_t len, unsigned int flags)
-{
-    booter_panic("No impl.");
-}
-EXPORT_SYMBOL(iter_file_splice_write);
-
 __weak int __mnt_want_write_file(struct file *file)
 {
     booter_panic("No impl.");
@@ -2778,6 +2750,12 @@ void mlock_vma_page(struct page *page)
 }
 EXPORT_SYMBOL_GPL(mlock_vma_page);
 
+__weak void clear_page_mlock(struct page *page)
+{
+    booter_panic("No impl.");
+}
+EXPORT_SYMBOL(clear_page_mlock);
+
 __weak long populate_vma_page_range(struct vm_area_struct *vma,
 		unsigned long start, unsigned long end, int *locked)
 {
@@ -2791,13 +2769,6 @@ __weak int __mm_populate(unsigned long start, unsigned long len, int ignore_erro
 }
 EXPORT_SYMBOL(__mm_populate);
 
-void migration_entry_wait(struct mm_struct *mm, pmd_t *pmd,
-                unsigned long address)
-{
-    booter_panic("No impl.");
-}
-EXPORT_SYMBOL(migration_entry_wait);
-
 __weak struct vm_area_struct *find_vma(struct mm_struct *mm, unsigned long addr)
 {
     booter_panic("No impl.");
@@ -2891,12 +2862,6 @@ __weak ssize_t simple_xattr_list(struct inode *inode, struct simple_xattrs *xatt
 }
 EXPORT_SYMBOL(simple_xattr_list);
 
-void plist_add(struct plist_node *node, struct plist_head *head)
-{
-    booter_panic("No impl!\n");
-}
-EXPORT_SYMBOL(plist_add);
-
 __weak void sigqueue_free(struct sigqueue *q)
 {
     booter_panic("No impl!\n");
@@ -3328,13 +3293,6 @@ __weak enum siginfo_layout siginfo_layout(unsigned sig, int si_code)
 }
 EXPORT_SYMBOL_GPL(siginfo_layout);
 
-int anon_inode_getfd(const char *name, const struct file_operations *fops,
-             void *priv, int flags)
-{
-    booter_panic("No impl!\n");
-}
-EXPORT_SYMBOL_GPL(anon_inode_getfd);
-
 __weak int fcntl_getlease(struct file *filp)
 {
     booter_panic("No impl!\n");
@@ -4914,10 +4872,6 @@ EXPORT_SYMBOL(dev_get_by_name_rcu);
 DEFINE_PER_CPU_ALIGNED(struct softnet_data, softnet_data);
 EXPORT_PER_CPU_SYMBOL(softnet_data);
 
-struct pipe_buf_operations;
-const struct pipe_buf_operations nosteal_pipe_buf_ops;
-EXPORT_SYMBOL(nosteal_pipe_buf_ops);
-
 __weak int __zerocopy_sg_from_iter(struct sock *sk, struct sk_buff *skb,
 			    struct iov_iter *from, size_t length)
 {
@@ -4988,13 +4942,6 @@ __weak int __init netdev_kobject_init(void)
 }
 EXPORT_SYMBOL(netdev_kobject_init);
 
-ssize_t generic_splice_sendpage(struct pipe_inode_info *pipe, struct file *out,
-                loff_t *ppos, size_t len, unsigned int flags)
-{
-    booter_panic("No impl.");
-}
-EXPORT_SYMBOL(generic_splice_sendpage);
-
 __weak int netdev_get_name(struct net *net, char *name, int ifindex)
 {
     booter_panic("No impl.");
@@ -5019,25 +4966,12 @@ __weak int reuseport_detach_prog(struct sock *sk)
 }
 EXPORT_SYMBOL(reuseport_detach_prog);
 
-int poll_select_set_timeout(struct timespec64 *to, time64_t sec, long nsec)
-{
-    booter_panic("No impl.");
-}
-EXPORT_SYMBOL(poll_select_set_timeout);
-
 __weak int dev_ifconf(struct net *net, struct ifconf *ifc, int size)
 {
     booter_panic("No impl.");
 }
 EXPORT_SYMBOL(dev_ifconf);
 
-ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
-               struct splice_pipe_desc *spd)
-{
-    booter_panic("No impl.");
-}
-EXPORT_SYMBOL(splice_to_pipe);
-
 __weak int dev_ioctl(struct net *net, unsigned int cmd, struct ifreq *ifr, bool *need_copyout)
 {
     booter_panic("No impl.");
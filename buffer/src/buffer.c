@@ -609,6 +609,7 @@ void __set_page_dirty(struct page *page, struct address_space *mapping,
 		account_page_dirtied(page, mapping);
 		__xa_set_mark(&mapping->i_pages, page_index(page),
 				PAGECACHE_TAG_DIRTY);
+		mapping_dirty_range_add(mapping, page_index(page));
 	}
 	xa_unlock_irqrestore(&mapping->i_pages, flags);
 }
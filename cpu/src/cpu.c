@@ -813,6 +813,7 @@ void __init cpuhp_threads_init(void)
 	BUG_ON(smpboot_register_percpu_thread(&cpuhp_threads));
 	kthread_unpark(this_cpu_read(cpuhp_state.thread));
 }
+EXPORT_SYMBOL(cpuhp_threads_init);
 
 #ifdef CONFIG_HOTPLUG_CPU
 /**
@@ -1162,6 +1163,7 @@ void notify_cpu_starting(unsigned int cpu)
 		WARN_ON_ONCE(ret);
 	}
 }
+EXPORT_SYMBOL(notify_cpu_starting);
 
 /*
  * Called from the idle task. Wake up the controlling task which brings the
@@ -1185,6 +1187,7 @@ void cpuhp_online_idle(enum cpuhp_state state)
 	st->state = CPUHP_AP_ONLINE_IDLE;
 	complete_ap_thread(st, true);
 }
+EXPORT_SYMBOL(cpuhp_online_idle);
 
 /* Requires cpu_add_remove_lock to be held */
 static int _cpu_up(unsigned int cpu, int tasks_frozen, enum cpuhp_state target)
@@ -1339,6 +1342,7 @@ void bringup_nonboot_cpus(unsigned int setup_max_cpus)
 			cpu_up(cpu, CPUHP_ONLINE);
 	}
 }
+EXPORT_SYMBOL(bringup_nonboot_cpus);
 
 #ifdef CONFIG_PM_SLEEP_SMP
 static cpumask_var_t frozen_cpus;
@@ -2482,6 +2486,7 @@ void set_cpu_online(unsigned int cpu, bool online)
 			atomic_dec(&__num_online_cpus);
 	}
 }
+EXPORT_SYMBOL(set_cpu_online);
 
 /*
  * Activate the first processor.
@@ -1578,18 +1578,20 @@ struct kobject *sysfs_dev_char_kobj;
 struct kobject *sysfs_dev_block_kobj;
 EXPORT_SYMBOL(sysfs_dev_block_kobj);
 
-//static DEFINE_MUTEX(device_hotplug_lock);
-//
-//void lock_device_hotplug(void)
-//{
-//	mutex_lock(&device_hotplug_lock);
-//}
-//
-//void unlock_device_hotplug(void)
-//{
-//	mutex_unlock(&device_hotplug_lock);
-//}
-//
+static DEFINE_MUTEX(device_hotplug_lock);
+
+void lock_device_hotplug(void)
+{
+	mutex_lock(&device_hotplug_lock);
+}
+EXPORT_SYMBOL(lock_device_hotplug);
+
+void unlock_device_hotplug(void)
+{
+	mutex_unlock(&device_hotplug_lock);
+}
+EXPORT_SYMBOL(unlock_device_hotplug);
+
 //int lock_device_hotplug_sysfs(void)
 //{
 //	if (mutex_trylock(&device_hotplug_lock))
@@ -3395,37 +3397,38 @@ int __init devices_init(void)
 //	return ret;
 //}
 //
-///**
-// * device_online - Put the device back online after successful device_offline().
-// * @dev: Device to be put back online.
-// *
-// * If device_offline() has been successfully executed for @dev, but the device
-// * has not been removed subsequently, execute its bus type's .online() callback
-// * to indicate that the device can be used again.
-// *
-// * Call under device_hotplug_lock.
-// */
-//int device_online(struct device *dev)
-//{
-//	int ret = 0;
-//
-//	device_lock(dev);
-//	if (device_supports_offline(dev)) {
-//		if (dev->offline) {
-//			ret = dev->bus->online(dev);
-//			if (!ret) {
-//				kobject_uevent(&dev->kobj, KOBJ_ONLINE);
-//				dev->offline = false;
-//			}
-//		} else {
-//			ret = 1;
-//		}
-//	}
-//	device_unlock(dev);
-//
-//	return ret;
-//}
-//
+/**
+ * device_online - Put the device back online after successful device_offline().
+ * @dev: Device to be put back online.
+ *
+ * If device_offline() has been successfully executed for @dev, but the device
+ * has not been removed subsequently, execute its bus type's .online() callback
+ * to indicate that the device can be used again.
+ *
+ * Call under device_hotplug_lock.
+ */
+int device_online(struct device *dev)
+{
+	int ret = 0;
+
+	device_lock(dev);
+	if (device_supports_offline(dev)) {
+		if (dev->offline) {
+			ret = dev->bus->online(dev);
+			if (!ret) {
+				kobject_uevent(&dev->kobj, KOBJ_ONLINE);
+				dev->offline = false;
+			}
+		} else {
+			ret = 1;
+		}
+	}
+	device_unlock(dev);
+
+	return ret;
+}
+EXPORT_SYMBOL(device_online);
+
 //struct root_device {
 //	struct device dev;
 //	struct module *owner;
@@ -47,16 +47,6 @@ void __init driver_init(void)
 }
 EXPORT_SYMBOL(driver_init);
 
-void unlock_device_hotplug(void)
-{
-    booter_panic("No impl 'driver_base'.");
-}
-
-int device_online(struct device *dev)
-{
-    booter_panic("No impl 'driver_base'.");
-}
-
 int device_offline(struct device *dev)
 {
     booter_panic("No impl 'driver_base'.");
@@ -1,4 +0,0 @@
-#include <linux/types.h>
-#include "../../booter/src/booter.h"
-
-CL_MINE(splice_from_pipe)
@@ -3,5 +3,4 @@
 
 CL_MINE(exit_oom_victim)
 CL_MINE(exit_ptrace)
-CL_MINE(free_pipe_info)
 CL_MINE(__ptrace_unlink)
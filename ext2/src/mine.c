@@ -1,6 +1,5 @@
 #include <linux/types.h>
 #include "../../booter/src/booter.h"
 
-CL_MINE(__blockdev_direct_IO)
 CL_MINE(buffer_migrate_page)
 CL_MINE(d_instantiate_new)
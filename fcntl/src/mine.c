@@ -1,5 +0,0 @@
-#include <linux/types.h>
-#include "../../booter/src/booter.h"
-
-CL_MINE(memfd_fcntl)
-CL_MINE(pipe_fcntl)
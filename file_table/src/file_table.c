@@ -240,16 +240,17 @@ struct file *alloc_file_pseudo(struct inode *inode, struct vfsmount *mnt,
 }
 EXPORT_SYMBOL(alloc_file_pseudo);
 
-//struct file *alloc_file_clone(struct file *base, int flags,
-//				const struct file_operations *fops)
-//{
-//	struct file *f = alloc_file(&base->f_path, flags, fops);
-//	if (!IS_ERR(f)) {
-//		path_get(&f->f_path);
-//		f->f_mapping = base->f_mapping;
-//	}
-//	return f;
-//}
+struct file *alloc_file_clone(struct file *base, int flags,
+				const struct file_operations *fops)
+{
+	struct file *f = alloc_file(&base->f_path, flags, fops);
+	if (!IS_ERR(f)) {
+		path_get(&f->f_path);
+		f->f_mapping = base->f_mapping;
+	}
+	return f;
+}
+EXPORT_SYMBOL(alloc_file_clone);
 
 /* the real guts of fput() - releasing the last reference to file
  */
@@ -18,8 +18,4 @@ void dissolve_on_fput(struct vfsmount *mnt)
 {
     booter_panic("No impl in 'workqueue'.");
 }
-void eventpoll_release_file(struct file *file)
-{
-    booter_panic("No impl in 'workqueue'.");
-}
 
@@ -425,6 +425,7 @@ int __filemap_fdatawrite_range(struct address_space *mapping, loff_t start,
 	wbc_detach_inode(&wbc);
 	return ret;
 }
+EXPORT_SYMBOL(__filemap_fdatawrite_range);
 
 static inline int __filemap_fdatawrite(struct address_space *mapping,
 	int sync_mode)
@@ -1380,6 +1381,7 @@ void put_and_wait_on_page_locked(struct page *page)
 	q = page_waitqueue(page);
 	wait_on_page_bit_common(q, page, PG_locked, TASK_UNINTERRUPTIBLE, DROP);
 }
+EXPORT_SYMBOL(put_and_wait_on_page_locked);
 
 /**
  * add_page_wait_queue - Add an arbitrary waiter to a page's wait queue
@@ -3366,6 +3368,7 @@ void dio_warn_stale_pagecache(struct file *filp)
 			current->comm);
 	}
 }
+EXPORT_SYMBOL(dio_warn_stale_pagecache);
 
 ssize_t
 generic_file_direct_write(struct kiocb *iocb, struct iov_iter *from)
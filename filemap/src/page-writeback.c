@@ -2034,6 +2034,7 @@ void laptop_sync_completion(void)
 
 	rcu_read_unlock();
 }
+EXPORT_SYMBOL(laptop_sync_completion);
 #endif
 
 /*
@@ -2485,6 +2486,7 @@ int __set_page_dirty_nobuffers(struct page *page)
 		account_page_dirtied(page, mapping);
 		__xa_set_mark(&mapping->i_pages, page_index(page),
 				   PAGECACHE_TAG_DIRTY);
+		mapping_dirty_range_add(mapping, page_index(page));
 		xa_unlock_irqrestore(&mapping->i_pages, flags);
 		unlock_page_memcg(page);
 
@@ -2746,6 +2748,7 @@ int test_clear_page_writeback(struct page *page)
 		if (mapping->host && !mapping_tagged(mapping,
 						     PAGECACHE_TAG_WRITEBACK))
 			sb_clear_inode_writeback(mapping->host);
+		mapping_dirty_range_clean(mapping);
 
 		xa_unlock_irqrestore(&mapping->i_pages, flags);
 	} else {
@@ -1,6 +1,5 @@
 #include <linux/types.h>
 #include "../../booter/src/booter.h"
 
-CL_MINE(anon_inode_getfile)
 CL_MINE(current_is_single_threaded)
 CL_MINE(__ptrace_link)
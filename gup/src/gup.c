@@ -176,6 +176,7 @@ bool __must_check try_grab_page(struct page *page, unsigned int flags)
 
 	return true;
 }
+EXPORT_SYMBOL(try_grab_page);
 
 #ifdef CONFIG_DEV_PAGEMAP_OPS
 static bool __unpin_devmap_managed_user_page(struct page *page)
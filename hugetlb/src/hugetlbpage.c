@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * RISC-V hugetlb page table helpers - linux/arch/riscv/mm/hugetlbpage.c
+ *
+ * Sv39 maps a huge page with a leaf entry at the PMD level.  The generic
+ * huge_pte_alloc()/huge_pte_offset() in hugetlb.c do the walking; all that
+ * is left for the arch is telling a leaf apart from a table pointer.
+ */
+
+#include <linux/hugetlb.h>
+#include <linux/err.h>
+
+int pud_huge(pud_t pud)
+{
+	return pud_leaf(pud);
+}
+EXPORT_SYMBOL(pud_huge);
+
+int pmd_huge(pmd_t pmd)
+{
+	return pmd_leaf(pmd);
+}
+EXPORT_SYMBOL(pmd_huge);
+
+/*
+ * Only the PMD size is offered.  PUD sized pages would need a gigantic
+ * page allocator, which this tree does not carry.
+ */
+bool __init arch_hugetlb_valid_size(unsigned long size)
+{
+	return size == HPAGE_SIZE;
+}
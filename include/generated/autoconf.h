@@ -38,6 +38,8 @@
 #define CONFIG_BLK_DEV_LOOP_MIN_COUNT 8
 #define CONFIG_ARCH_FLATMEM_ENABLE 1
 #define CONFIG_GENERIC_SMP_IDLE_THREAD 1
+#define CONFIG_SMP 1
+#define CONFIG_NR_CPUS 8
 #define CONFIG_NET_VENDOR_QUALCOMM 1
 #define CONFIG_NET_VENDOR_EZCHIP 1
 #define CONFIG_DEFAULT_SECURITY_DAC 1
@@ -259,7 +261,6 @@
 #define CONFIG_SERIAL_OF_PLATFORM 1
 #define CONFIG_CONSOLE_LOGLEVEL_QUIET 4
 #define CONFIG_GENERIC_CALIBRATE_DELAY 1
-#define CONFIG_BROKEN_ON_SMP 1
 #define CONFIG_TMPFS 1
 #define CONFIG_NET_VENDOR_NETERION 1
 #define CONFIG_USB_OHCI_HCD_PLATFORM 1
@@ -298,6 +299,8 @@
 #define CONFIG_SRCU 1
 #define CONFIG_NFS_FS 1
 #define CONFIG_MEMBARRIER 1
+#define CONFIG_RSEQ 1
+#define CONFIG_HAVE_RSEQ 1
 #define CONFIG_LZ4_DECOMPRESS 1
 #define CONFIG_FONT_SUPPORT 1
 #define CONFIG_ADVISE_SYSCALLS 1
@@ -313,8 +316,9 @@
 #define CONFIG_EFI_PARTITION 1
 #define CONFIG_GOLDFISH 1
 #define CONFIG_LOG_BUF_SHIFT 17
+#define CONFIG_LOG_CPU_MAX_BUF_SHIFT 12
 #define CONFIG_HAVE_FUTEX_CMPXCHG 1
-#define CONFIG_TINY_SRCU 1
+#define CONFIG_TREE_SRCU 1
 #define CONFIG_WLAN_VENDOR_ATH 1
 #define CONFIG_EXTRA_FIRMWARE ""
 #define CONFIG_NET_VENDOR_8390 1
@@ -343,6 +347,7 @@
 #define CONFIG_DEBUG_VM_PGTABLE 1
 #define CONFIG_GENERIC_PCI_IOMAP 1
 #define CONFIG_SLUB 1
+#define CONFIG_SLUB_CPU_PARTIAL 1
 #define CONFIG_XZ_DEC_BCJ 1
 #define CONFIG_I2C 1
 #define CONFIG_DEBUG_VM 1
@@ -373,6 +378,10 @@
 #define CONFIG_MOUSE_PS2_ALPS 1
 #define CONFIG_MEMORY_BALLOON 1
 #define CONFIG_UNINLINE_SPIN_UNLOCK 1
+#define CONFIG_ARCH_USE_QUEUED_SPINLOCKS 1
+#define CONFIG_ARCH_USE_QUEUED_RWLOCKS 1
+#define CONFIG_QUEUED_SPINLOCKS 1
+#define CONFIG_QUEUED_RWLOCKS 1
 #define CONFIG_SERIAL_EARLYCON_RISCV_SBI 1
 #define CONFIG_ARCH_WANT_GENERAL_HUGETLB 1
 #define CONFIG_SATA_PMP 1
@@ -454,7 +463,7 @@
 #define CONFIG_PANIC_TIMEOUT 0
 #define CONFIG_NET_VENDOR_XILINX 1
 #define CONFIG_DECOMPRESS_LZ4 1
-#define CONFIG_PREEMPT_NONE 1
+#define CONFIG_PREEMPT_VOLUNTARY 1
 #define CONFIG_NET_VENDOR_CADENCE 1
 #define CONFIG_TTY 1
 #define CONFIG_NET_VENDOR_I825XX 1
@@ -477,6 +486,8 @@
 #define CONFIG_CMODEL_MEDANY 1
 #define CONFIG_SYMBOLIC_ERRNAME 1
 #define CONFIG_SCHED_DEBUG 1
+#define CONFIG_SCHED_INFO 1
+#define CONFIG_SCHEDSTATS 1
 #define CONFIG_NET_VENDOR_BROCADE 1
 #define CONFIG_DEFAULT_MMAP_MIN_ADDR 4096
 #define CONFIG_CMDLINE ""
@@ -614,13 +625,25 @@
 #define CONFIG_IP_MULTICAST 1
 #define CONFIG_NET_VENDOR_CISCO 1
 #define CONFIG_TICK_ONESHOT 1
-#define CONFIG_TINY_RCU 1
+#define CONFIG_TREE_RCU 1
+#define CONFIG_RCU_FANOUT 64
+#define CONFIG_RCU_FANOUT_LEAF 16
+#define CONFIG_RCU_STALL_COMMON 1
+#define CONFIG_RCU_NEED_SEGCBLIST 1
+#define CONFIG_RCU_CPU_STALL_TIMEOUT 21
 #define CONFIG_HW_RANDOM 1
 #define CONFIG_HAVE_FUNCTION_GRAPH_TRACER 1
 #define CONFIG_OF_MDIO 1
 #define CONFIG_ARCH_HAS_MMIOWB 1
 #define CONFIG_BASE_SMALL 0
 #define CONFIG_COMPACTION 1
+#define CONFIG_HAVE_ARCH_TRANSPARENT_HUGEPAGE 1
+#define CONFIG_TRANSPARENT_HUGEPAGE 1
+#define CONFIG_TRANSPARENT_HUGEPAGE_ALWAYS 1
+#define CONFIG_HUGETLBFS 1
+#define CONFIG_HUGETLB_PAGE 1
+#define CONFIG_LRU_GEN 1
+#define CONFIG_XARRAY_MULTI 1
 #define CONFIG_NFS_V2 1
 #define CONFIG_PROC_FS 1
 #define CONFIG_GENERIC_BUG_RELATIVE_POINTERS 1
@@ -446,6 +446,10 @@ int pagecache_write_end(struct file *, struct address_space *mapping,
  * @nrpages: Number of page entries, protected by the i_pages lock.
  * @nrexceptional: Shadow or DAX entries, protected by the i_pages lock.
  * @writeback_index: Writeback starts here.
+ * @dirty_start: First index dirtied or under writeback since the mapping
+ *   was last clean, protected by the i_pages lock.
+ * @dirty_end: Last such index; the range is empty while it is below
+ *   @dirty_start.
  * @a_ops: Methods.
  * @flags: Error bits and flags (AS_*).
  * @wb_err: The most recent error which has occurred.
@@ -467,6 +471,8 @@ struct address_space {
 	unsigned long		nrpages;
 	unsigned long		nrexceptional;
 	pgoff_t			writeback_index;
+	pgoff_t			dirty_start;
+	pgoff_t			dirty_end;
 	const struct address_space_operations *a_ops;
 	unsigned long		flags;
 	errseq_t		wb_err;
@@ -493,6 +499,36 @@ static inline bool mapping_tagged(struct address_space *mapping, xa_mark_t tag)
 	return xa_marked(&mapping->i_pages, tag);
 }
 
+/*
+ * Track the extent of pages that have been dirtied since the mapping was
+ * last clean, so data integrity sync can skip walking the rest of a large
+ * file.  All of these must be called with the i_pages lock held.
+ */
+static inline void mapping_dirty_range_reset(struct address_space *mapping)
+{
+	mapping->dirty_start = ULONG_MAX;
+	mapping->dirty_end = 0;
+}
+
+static inline void mapping_dirty_range_add(struct address_space *mapping,
+					   pgoff_t index)
+{
+	if (index < mapping->dirty_start)
+		mapping->dirty_start = index;
+	if (index > mapping->dirty_end)
+		mapping->dirty_end = index;
+}
+
+/*
+ * Forget the dirty extent once no page is left dirty or under writeback.
+ */
+static inline void mapping_dirty_range_clean(struct address_space *mapping)
+{
+	if (!mapping_tagged(mapping, PAGECACHE_TAG_DIRTY) &&
+	    !mapping_tagged(mapping, PAGECACHE_TAG_WRITEBACK))
+		mapping_dirty_range_reset(mapping);
+}
+
 static inline void i_mmap_lock_write(struct address_space *mapping)
 {
 	down_write(&mapping->i_mmap_rwsem);
@@ -266,6 +266,89 @@ static inline bool is_active_lru(enum lru_list lru)
 	return (lru == LRU_ACTIVE_ANON || lru == LRU_ACTIVE_FILE);
 }
 
+#define ANON_AND_FILE 2
+
+/*
+ * Evictable pages are divided into multiple generations when the multi-gen
+ * LRU is enabled.  The youngest and the oldest generation numbers, max_seq
+ * and min_seq, are monotonically increasing and form a sliding window of
+ * [MIN_NR_GENS, MAX_NR_GENS] generations.  An offset within MAX_NR_GENS,
+ * i.e. gen, indexes the list of the corresponding generation.  The gen
+ * counter in page->flags stores gen+1 while a page is on one of
+ * lrugen->lists[], and 0 otherwise.
+ *
+ * A page is added to the youngest generation on faulting.  The aging has to
+ * see the accessed bit at least twice before the page is handed over to the
+ * eviction, hence MIN_NR_GENS.  These two youngest generations are reported
+ * as active in /proc/vmstat and /proc/meminfo, the rest as inactive.
+ *
+ * Each generation is further divided into tiers.  A page accessed N times
+ * through file descriptors is in tier order_base_2(N); the first two tiers
+ * are encoded with PG_referenced and PG_workingset, the rest use the refs
+ * counter in page->flags.  Refaults per tier feed back into the eviction,
+ * which protects the tiers that refault more than the first one.
+ */
+#define MIN_NR_GENS		2U
+#define MAX_NR_GENS		4U
+#define MAX_NR_TIERS		4U
+
+struct lruvec;
+
+#ifdef CONFIG_LRU_GEN
+
+enum {
+	LRU_GEN_ANON,
+	LRU_GEN_FILE,
+};
+
+#define MIN_LRU_BATCH		BITS_PER_LONG
+#define MAX_LRU_BATCH		(MIN_LRU_BATCH * 64)
+
+/* cleared along with the refs counter when a page changes generation */
+#define LRU_REFS_FLAGS		(BIT(PG_referenced) | BIT(PG_workingset))
+
+/* only the stats of the oldest generation are kept */
+#define NR_HIST_GENS		1U
+
+/*
+ * max_seq is shared by anon and file pages as they are aged on an equal
+ * footing.  min_seq[] is kept per type so clean file pages can still be
+ * evicted when swap is not available and anon min_seq falls behind.
+ */
+struct lru_gen_struct {
+	/* the aging increments the youngest generation number */
+	unsigned long max_seq;
+	/* the eviction increments the oldest generation numbers */
+	unsigned long min_seq[ANON_AND_FILE];
+	/* the birth time of each generation in jiffies */
+	unsigned long timestamps[MAX_NR_GENS];
+	/* the multi-gen LRU lists, lazily sorted on eviction */
+	struct list_head lists[MAX_NR_GENS][ANON_AND_FILE][MAX_NR_ZONES];
+	/* the multi-gen LRU sizes, eventually consistent */
+	long nr_pages[MAX_NR_GENS][ANON_AND_FILE][MAX_NR_ZONES];
+	/* the exponential moving average of refaulted */
+	unsigned long avg_refaulted[ANON_AND_FILE][MAX_NR_TIERS];
+	/* the exponential moving average of evicted+protected */
+	unsigned long avg_total[ANON_AND_FILE][MAX_NR_TIERS];
+	/* the first tier doesn't need protection, hence the minus one */
+	unsigned long protected[NR_HIST_GENS][ANON_AND_FILE][MAX_NR_TIERS - 1];
+	/* can be modified without holding the LRU lock */
+	atomic_long_t evicted[NR_HIST_GENS][ANON_AND_FILE][MAX_NR_TIERS];
+	atomic_long_t refaulted[NR_HIST_GENS][ANON_AND_FILE][MAX_NR_TIERS];
+	/* whether the multi-gen LRU is enabled */
+	bool enabled;
+};
+
+void lru_gen_init_lruvec(struct lruvec *lruvec);
+
+#else /* !CONFIG_LRU_GEN */
+
+static inline void lru_gen_init_lruvec(struct lruvec *lruvec)
+{
+}
+
+#endif /* CONFIG_LRU_GEN */
+
 enum lruvec_flags {
 	LRUVEC_CONGESTED,		/* lruvec has many dirty pages
 					 * backed by a congested BDI
@@ -290,6 +373,10 @@ struct lruvec {
 #ifdef CONFIG_MEMCG
 	struct pglist_data *pgdat;
 #endif
+#ifdef CONFIG_LRU_GEN
+	/* evictable pages divided into generations */
+	struct lru_gen_struct		lrugen;
+#endif
 };
 
 /* Isolate unmapped pages */
@@ -314,13 +401,27 @@ enum zone_watermarks {
 #define high_wmark_pages(z) (z->_watermark[WMARK_HIGH] + z->watermark_boost)
 #define wmark_pages(z, i) (z->_watermark[i] + z->watermark_boost)
 
+/*
+ * The pcp lists hold pages of every order up to PAGE_ALLOC_COSTLY_ORDER, one
+ * list per (order, migratetype) pair.  While a page sits on its way from the
+ * pcp lists back to the buddy allocator, its order is packed into the low
+ * NR_PCP_ORDER_WIDTH bits of the pcppage migratetype.
+ */
+#define NR_PCP_LISTS (MIGRATE_PCPTYPES * (PAGE_ALLOC_COSTLY_ORDER + 1))
+#define NR_PCP_ORDER_WIDTH 8
+#define NR_PCP_ORDER_MASK ((1<<NR_PCP_ORDER_WIDTH) - 1)
+
 struct per_cpu_pages {
-	int count;		/* number of pages in the list */
+	int count;		/* number of base pages in the lists */
 	int high;		/* high watermark, emptying needed */
 	int batch;		/* chunk size for buddy add/remove */
+	short free_factor;	/* batch scaling factor during free */
+
+	unsigned long hit;	/* allocations served from the lists */
+	unsigned long miss;	/* allocations that had to refill */
 
-	/* Lists of pages, one per migrate type stored on the pcp-lists */
-	struct list_head lists[MIGRATE_PCPTYPES];
+	/* Lists of pages, one per order and migrate type */
+	struct list_head lists[NR_PCP_LISTS];
 };
 
 struct per_cpu_pageset {
@@ -23,6 +23,10 @@ typedef struct raw_spinlock {
 	unsigned int magic, owner_cpu;
 	void *owner;
 #endif
+#ifdef CONFIG_DEBUG_SPINLOCK_STAT
+	struct spin_stat_class *stat_class;
+	u64 stat_acquired;
+#endif
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map dep_map;
 #endif
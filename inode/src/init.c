@@ -14,5 +14,4 @@ cl_inode_init(void)
 }
 EXPORT_SYMBOL(cl_inode_init);
 
-const struct file_operations pipefifo_fops;
 int sysctl_vfs_cache_pressure __read_mostly = 100;
@@ -704,6 +704,7 @@ void iterate_supers(void (*f)(struct super_block *, void *), void *arg)
 		__put_super(p);
 	spin_unlock(&sb_lock);
 }
+EXPORT_SYMBOL(iterate_supers);
 
 /**
  *	iterate_supers_type - call function for superblocks of given type
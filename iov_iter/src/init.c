@@ -2,8 +2,6 @@
 
 #include <linux/types.h>
 #include <linux/export.h>
-#include <linux/fs.h>
-#include <linux/pipe_fs_i.h>
 #include "../../booter/src/booter.h"
 
 int
@@ -14,6 +12,3 @@ cl_iov_iter_init(void)
     return 0;
 }
 EXPORT_SYMBOL(cl_iov_iter_init);
-
-const struct pipe_buf_operations page_cache_pipe_buf_ops;
-const struct pipe_buf_operations default_pipe_buf_ops;
@@ -1,4 +0,0 @@
-#include <linux/types.h>
-#include "../../booter/src/booter.h"
-
-CL_MINE(alloc_file_clone)
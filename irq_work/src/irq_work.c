@@ -111,6 +111,7 @@ bool irq_work_queue_on(struct irq_work *work, int cpu)
 	return true;
 #endif /* CONFIG_SMP */
 }
+EXPORT_SYMBOL_GPL(irq_work_queue_on);
 
 
 bool irq_work_needs_cpu(void)
@@ -154,6 +155,7 @@ void irq_work_single(void *arg)
 	flags &= ~IRQ_WORK_PENDING;
 	(void)atomic_cmpxchg(&work->flags, flags, flags & ~IRQ_WORK_BUSY);
 }
+EXPORT_SYMBOL(irq_work_single);
 
 static void irq_work_run_list(struct llist_head *list)
 {
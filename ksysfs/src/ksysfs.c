@@ -148,6 +148,7 @@ KERNEL_ATTR_RO(fscaps);
 
 #ifndef CONFIG_TINY_RCU
 int rcu_expedited;
+EXPORT_SYMBOL_GPL(rcu_expedited);
 static ssize_t rcu_expedited_show(struct kobject *kobj,
 				  struct kobj_attribute *attr, char *buf)
 {
@@ -165,6 +166,7 @@ static ssize_t rcu_expedited_store(struct kobject *kobj,
 KERNEL_ATTR_RW(rcu_expedited);
 
 int rcu_normal;
+EXPORT_SYMBOL_GPL(rcu_normal);
 static ssize_t rcu_normal_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
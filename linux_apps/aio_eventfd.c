@@ -0,0 +1,105 @@
+/*
+ * eventfd + AIO test: submit a read with IOCB_FLAG_RESFD pointing at an
+ * eventfd, wait for the eventfd to become readable and check that it
+ * counted exactly one completion before reaping the event.
+ *
+ * Usage: aio_eventfd [path]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+
+#define BUF_SIZE	4096
+
+static char wbuf[BUF_SIZE];
+static char rbuf[BUF_SIZE];
+
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : "/aio_eventfd.dat";
+	aio_context_t ctx = 0;
+	struct iocb cb, *cbs[1] = { &cb };
+	struct io_event ev;
+	struct pollfd pfd;
+	uint64_t count;
+	int fd, efd, ret;
+
+	memset(wbuf, 'e', BUF_SIZE);
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		exit(EXIT_FAILURE);
+	}
+	if (write(fd, wbuf, BUF_SIZE) != BUF_SIZE) {
+		perror("write");
+		exit(EXIT_FAILURE);
+	}
+
+	efd = eventfd(0, EFD_NONBLOCK);
+	if (efd < 0) {
+		perror("eventfd");
+		exit(EXIT_FAILURE);
+	}
+	if (syscall(__NR_io_setup, 1, &ctx) < 0) {
+		perror("io_setup");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&cb, 0, sizeof(cb));
+	cb.aio_lio_opcode = IOCB_CMD_PREAD;
+	cb.aio_fildes = fd;
+	cb.aio_buf = (unsigned long)rbuf;
+	cb.aio_nbytes = BUF_SIZE;
+	cb.aio_offset = 0;
+	cb.aio_flags = IOCB_FLAG_RESFD;
+	cb.aio_resfd = efd;
+	cb.aio_data = 0x1234;
+
+	if (syscall(__NR_io_submit, ctx, 1, cbs) != 1) {
+		perror("io_submit");
+		exit(EXIT_FAILURE);
+	}
+
+	pfd.fd = efd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, 5000);
+	if (ret != 1 || !(pfd.revents & POLLIN)) {
+		fprintf(stderr, "eventfd not signalled (poll %d)\n", ret);
+		exit(EXIT_FAILURE);
+	}
+	if (read(efd, &count, sizeof(count)) != sizeof(count)) {
+		perror("read eventfd");
+		exit(EXIT_FAILURE);
+	}
+	if (count != 1) {
+		fprintf(stderr, "eventfd count %llu, expected 1\n",
+			(unsigned long long)count);
+		exit(EXIT_FAILURE);
+	}
+
+	if (syscall(__NR_io_getevents, ctx, 1, 1, &ev, NULL) != 1) {
+		perror("io_getevents");
+		exit(EXIT_FAILURE);
+	}
+	if (ev.data != 0x1234 || ev.res != BUF_SIZE ||
+	    memcmp(rbuf, wbuf, BUF_SIZE) != 0) {
+		fprintf(stderr, "bad completion: data %llx res %lld\n",
+			(unsigned long long)ev.data, (long long)ev.res);
+		exit(EXIT_FAILURE);
+	}
+
+	syscall(__NR_io_destroy, ctx);
+	close(efd);
+	close(fd);
+	unlink(path);
+	printf("aio_eventfd: completion signalled through eventfd\n");
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * hugepages pool test: check that the pool reserved by "hugepages=" on
+ * the kernel command line shows up in /sys/kernel/mm/hugepages, then map
+ * and touch one huge page and check that free_hugepages drops by one
+ * and comes back after munmap().
+ *
+ * Usage: hugepages
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HPAGE_SIZE	(2UL * 1024 * 1024)
+#define HSTATE_DIR	"/sys/kernel/mm/hugepages/hugepages-2048kB/"
+
+static long read_attr(const char *name)
+{
+	char path[128];
+	FILE *f;
+	long val;
+
+	snprintf(path, sizeof(path), HSTATE_DIR "%s", name);
+	f = fopen(path, "r");
+	if (!f || fscanf(f, "%ld", &val) != 1) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	fclose(f);
+	return val;
+}
+
+int main(void)
+{
+	long nr, free_before, free_mapped, free_after;
+	char *p;
+
+	nr = read_attr("nr_hugepages");
+	free_before = read_attr("free_hugepages");
+	if (nr <= 0 || free_before <= 0) {
+		fprintf(stderr, "no huge pages in the pool (nr %ld free %ld), boot with hugepages=N\n",
+			nr, free_before);
+		exit(EXIT_FAILURE);
+	}
+
+	p = mmap(NULL, HPAGE_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap MAP_HUGETLB");
+		exit(EXIT_FAILURE);
+	}
+	memset(p, 'h', HPAGE_SIZE);
+	if (p[HPAGE_SIZE - 1] != 'h') {
+		fprintf(stderr, "huge page contents lost\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free_mapped = read_attr("free_hugepages");
+	munmap(p, HPAGE_SIZE);
+	free_after = read_attr("free_hugepages");
+	if (free_mapped != free_before - 1 || free_after != free_before) {
+		fprintf(stderr, "free_hugepages %ld -> %ld -> %ld\n",
+			free_before, free_mapped, free_after);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("hugepages: pool of %ld pages, one mapped and released\n", nr);
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * memfd sealing test: create a sealable memfd, check that F_SEAL_WRITE is
+ * refused while a shared writable mapping exists, then seal it and check
+ * that write() and writable shared mmap() fail while reads still work.
+ *
+ * Usage: memfd_seal
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define DATA_SIZE	4096
+
+static char wbuf[DATA_SIZE];
+static char rbuf[DATA_SIZE];
+
+int main(void)
+{
+	void *p;
+	int fd, seals;
+
+	memset(wbuf, 's', DATA_SIZE);
+	fd = memfd_create("memfd_seal", MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		perror("memfd_create");
+		exit(EXIT_FAILURE);
+	}
+	if (write(fd, wbuf, DATA_SIZE) != DATA_SIZE) {
+		perror("write");
+		exit(EXIT_FAILURE);
+	}
+
+	p = mmap(NULL, DATA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE) == 0 || errno != EBUSY) {
+		fprintf(stderr, "F_SEAL_WRITE with a writable mapping not refused with EBUSY\n");
+		exit(EXIT_FAILURE);
+	}
+	munmap(p, DATA_SIZE);
+
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE) < 0) {
+		perror("F_ADD_SEALS");
+		exit(EXIT_FAILURE);
+	}
+	seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_WRITE)) {
+		fprintf(stderr, "F_GET_SEALS returned %x\n", seals);
+		exit(EXIT_FAILURE);
+	}
+
+	if (pwrite(fd, wbuf, 1, 0) >= 0 || errno != EPERM) {
+		fprintf(stderr, "write to a sealed memfd not refused with EPERM\n");
+		exit(EXIT_FAILURE);
+	}
+	p = mmap(NULL, DATA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p != MAP_FAILED || errno != EPERM) {
+		fprintf(stderr, "writable mmap of a sealed memfd not refused with EPERM\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pread(fd, rbuf, DATA_SIZE, 0) != DATA_SIZE ||
+	    memcmp(rbuf, wbuf, DATA_SIZE) != 0) {
+		fprintf(stderr, "read from a sealed memfd failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	close(fd);
+	printf("memfd_seal: F_SEAL_WRITE refuses write() and writable mmap()\n");
+	return 0;
+}
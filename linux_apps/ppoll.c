@@ -0,0 +1,75 @@
+/*
+ * ppoll timeout test: ppoll() on an empty pipe must return 0 once the
+ * timeout has passed, not earlier and not much later, and must return
+ * the fd as soon as data is written to it.
+ *
+ * Usage: ppoll [timeout_ms]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+
+static long elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1000 +
+	       (b->tv_nsec - a->tv_nsec) / 1000000;
+}
+
+int main(int argc, char *argv[])
+{
+	long timeout_ms = argc > 1 ? atol(argv[1]) : 200;
+	struct timespec ts, start, end;
+	struct pollfd pfd;
+	sigset_t mask;
+	int pipefd[2], ret;
+	long ms;
+
+	if (pipe(pipefd) < 0) {
+		perror("pipe");
+		exit(EXIT_FAILURE);
+	}
+	pfd.fd = pipefd[0];
+	pfd.events = POLLIN;
+	sigemptyset(&mask);
+
+	ts.tv_sec = timeout_ms / 1000;
+	ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = ppoll(&pfd, 1, &ts, &mask);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ms = elapsed_ms(&start, &end);
+
+	if (ret != 0) {
+		fprintf(stderr, "ppoll on empty pipe returned %d\n", ret);
+		exit(EXIT_FAILURE);
+	}
+	if (ms < timeout_ms || ms > timeout_ms + 1000) {
+		fprintf(stderr, "ppoll timed out after %ld ms, asked for %ld ms\n",
+			ms, timeout_ms);
+		exit(EXIT_FAILURE);
+	}
+
+	if (write(pipefd[1], "x", 1) != 1) {
+		perror("write");
+		exit(EXIT_FAILURE);
+	}
+	ts.tv_sec = 10;
+	ts.tv_nsec = 0;
+	ret = ppoll(&pfd, 1, &ts, &mask);
+	if (ret != 1 || !(pfd.revents & POLLIN)) {
+		fprintf(stderr, "ppoll on ready pipe returned %d revents %x\n",
+			ret, pfd.revents);
+		exit(EXIT_FAILURE);
+	}
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+	printf("ppoll: timed out after %ld ms (asked for %ld ms)\n",
+	       ms, timeout_ms);
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Load-balance microbenchmark: fork N CPU-bound spinners, wait for all of
+ * them and report the makespan together with how often the scheduler
+ * migrated them (se.nr_migrations from /proc/self/sched).
+ *
+ * Usage: spinners [nr_spinners] [loops]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LINELEN 256
+
+static long nr_migrations(void)
+{
+	char line[LINELEN];
+	FILE *f;
+	long val = -1;
+
+	f = fopen("/proc/self/sched", "r");
+	if (f == NULL)
+		return -1;
+
+	while (fgets(line, LINELEN, f) != NULL) {
+		if (strstr(line, "se.nr_migrations") == NULL)
+			continue;
+		if (sscanf(line, "%*[^:]: %ld", &val) != 1)
+			val = -1;
+		break;
+	}
+
+	fclose(f);
+	return val;
+}
+
+static void spin(unsigned long loops)
+{
+	volatile unsigned long sink = 0;
+	unsigned long i;
+
+	for (i = 0; i < loops; i++)
+		sink += i;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	int nr = argc > 1 ? atoi(argv[1]) : 4;
+	unsigned long loops = argc > 2 ? strtoul(argv[2], NULL, 0) : 200000000UL;
+	long migrations, total = 0;
+	int pfd[2];
+	double start;
+	int i;
+
+	if (nr <= 0 || pipe(pfd) < 0) {
+		printf("usage: %s [nr_spinners] [loops]\n", argv[0]);
+		return 1;
+	}
+
+	start = now();
+
+	for (i = 0; i < nr; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			printf("fork failed\n");
+			return 1;
+		}
+		if (pid == 0) {
+			close(pfd[0]);
+			spin(loops);
+			migrations = nr_migrations();
+			write(pfd[1], &migrations, sizeof(migrations));
+			_exit(0);
+		}
+	}
+
+	close(pfd[1]);
+	for (i = 0; i < nr; i++) {
+		if (read(pfd[0], &migrations, sizeof(migrations)) !=
+		    sizeof(migrations))
+			break;
+		if (migrations < 0) {
+			total = -1;
+			continue;
+		}
+		if (total >= 0)
+			total += migrations;
+	}
+	while (wait(NULL) > 0)
+		;
+
+	printf("spinners: %d x %lu loops, makespan %.3f s, migrations %ld\n",
+	       nr, loops, now() - start, total);
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * timerfd overrun test: arm a periodic timerfd, leave it unread for a
+ * number of periods and check that one read() returns the number of
+ * expirations that elapsed in between, and that the read resets it.
+ *
+ * Usage: timerfd [period_ms] [periods]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+static long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int main(int argc, char *argv[])
+{
+	long period_ms = argc > 1 ? atol(argv[1]) : 10;
+	long periods = argc > 2 ? atol(argv[2]) : 10;
+	struct itimerspec its;
+	long long start, elapsed;
+	uint64_t count, expected;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (fd < 0) {
+		perror("timerfd_create");
+		exit(EXIT_FAILURE);
+	}
+
+	its.it_value.tv_sec = period_ms / 1000;
+	its.it_value.tv_nsec = (period_ms % 1000) * 1000000;
+	its.it_interval = its.it_value;
+	start = now_ms();
+	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+		perror("timerfd_settime");
+		exit(EXIT_FAILURE);
+	}
+
+	usleep(periods * period_ms * 1000 + period_ms * 1000 / 2);
+	if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+		perror("read timerfd");
+		exit(EXIT_FAILURE);
+	}
+	elapsed = now_ms() - start;
+	expected = elapsed / period_ms;
+
+	/* elapsed is sampled after the read, allow one period each way */
+	if (count < (uint64_t)periods || count + 1 < expected ||
+	    count > expected + 1) {
+		fprintf(stderr, "timerfd: %llu expirations in %lld ms, expected %llu\n",
+			(unsigned long long)count, elapsed,
+			(unsigned long long)expected);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("timerfd: %llu expirations in %lld ms at %ld ms period\n",
+	       (unsigned long long)count, elapsed, period_ms);
+
+	/*
+	 * The read consumed the count: right after it, at most the one
+	 * period that may have just expired is pending.
+	 */
+	if (read(fd, &count, sizeof(count)) == sizeof(count) ? count > 1 :
+	    errno != EAGAIN) {
+		fprintf(stderr, "timerfd: expiration count not reset by read\n");
+		exit(EXIT_FAILURE);
+	}
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <linux/types.h>
+#include <linux/export.h>
+#include "../../booter/src/booter.h"
+
+int
+cl_mincore_init(void)
+{
+    sbi_puts("module[mincore]: init begin ...\n");
+    sbi_puts("module[mincore]: init end!\n");
+    return 0;
+}
+EXPORT_SYMBOL(cl_mincore_init);
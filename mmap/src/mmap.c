@@ -2101,6 +2101,7 @@ unsigned long vm_unmapped_area(struct vm_unmapped_area_info *info)
 	trace_vm_unmapped_area(addr, info);
 	return addr;
 }
+EXPORT_SYMBOL(vm_unmapped_area);
 
 #ifndef arch_get_mmap_end
 #define arch_get_mmap_end(addr)	(TASK_SIZE)
@@ -2310,6 +2311,7 @@ find_vma_prev(struct mm_struct *mm, unsigned long addr,
 	}
 	return vma;
 }
+EXPORT_SYMBOL(find_vma_prev);
 
 /*
  * Verify that the stack growth is acceptable and
@@ -2748,6 +2750,7 @@ int __split_vma(struct mm_struct *mm, struct vm_area_struct *vma,
 	vm_area_free(new);
 	return err;
 }
+EXPORT_SYMBOL(__split_vma);
 
 /*
  * Split a vma into two pieces at address 'addr', a new vma is allocated
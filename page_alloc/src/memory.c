@@ -177,6 +177,7 @@ void sync_mm_rss(struct mm_struct *mm)
 	}
 	current->rss_stat.events = 0;
 }
+EXPORT_SYMBOL(sync_mm_rss);
 
 static void add_mm_counter_fast(struct mm_struct *mm, int member, int val)
 {
@@ -689,6 +690,7 @@ struct page *vm_normal_page_pmd(struct vm_area_struct *vma, unsigned long addr,
 out:
 	return pfn_to_page(pfn);
 }
+EXPORT_SYMBOL(vm_normal_page_pmd);
 #endif
 
 /*
@@ -3455,6 +3457,7 @@ out_release:
 	}
 	return ret;
 }
+EXPORT_SYMBOL(do_swap_page);
 
 /*
  * We enter with non-exclusive mmap_lock (to exclude vma changes,
@@ -4408,6 +4411,27 @@ unlock:
 	return 0;
 }
 
+#ifdef CONFIG_LRU_GEN
+static void lru_gen_enter_fault(struct vm_area_struct *vma)
+{
+	/* the LRU algorithm doesn't apply to sequential or random reads */
+	current->in_lru_fault = !(vma->vm_flags & (VM_SEQ_READ | VM_RAND_READ));
+}
+
+static void lru_gen_exit_fault(void)
+{
+	current->in_lru_fault = false;
+}
+#else
+static void lru_gen_enter_fault(struct vm_area_struct *vma)
+{
+}
+
+static void lru_gen_exit_fault(void)
+{
+}
+#endif /* CONFIG_LRU_GEN */
+
 /*
  * By the time we get here, we already hold the mm semaphore
  *
@@ -4595,11 +4619,15 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 	if (flags & FAULT_FLAG_USER)
 		mem_cgroup_enter_user_fault();
 
+	lru_gen_enter_fault(vma);
+
 	if (unlikely(is_vm_hugetlb_page(vma)))
 		ret = hugetlb_fault(vma->vm_mm, vma, address, flags);
 	else
 		ret = __handle_mm_fault(vma, address, flags);
 
+	lru_gen_exit_fault();
+
 	if (flags & FAULT_FLAG_USER) {
 		mem_cgroup_exit_user_fault();
 		/*
@@ -5116,6 +5144,7 @@ void clear_huge_page(struct page *page,
 
 	process_huge_page(addr_hint, pages_per_huge_page, clear_subpage, page);
 }
+EXPORT_SYMBOL(clear_huge_page);
 
 static void copy_user_gigantic_page(struct page *dst, struct page *src,
 				    unsigned long addr,
@@ -5170,6 +5199,7 @@ void copy_user_huge_page(struct page *dst, struct page *src,
 
 	process_huge_page(addr_hint, pages_per_huge_page, copy_subpage, &arg);
 }
+EXPORT_SYMBOL(copy_user_huge_page);
 
 long copy_huge_page_from_user(struct page *dst_page,
 				const void __user *usr_src,
@@ -5224,9 +5254,11 @@ bool ptlock_alloc(struct page *page)
 	page->ptl = ptl;
 	return true;
 }
+EXPORT_SYMBOL(ptlock_alloc);
 
 void ptlock_free(struct page *page)
 {
 	kmem_cache_free(page_ptl_cachep, page->ptl);
 }
+EXPORT_SYMBOL(ptlock_free);
 #endif
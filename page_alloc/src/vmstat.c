@@ -167,787 +167,788 @@ void vm_events_fold_cpu(int cpu)
 //EXPORT_SYMBOL(vm_numa_stat);
 //EXPORT_SYMBOL(vm_node_stat);
 
-//#ifdef CONFIG_SMP
-//
-//int calculate_pressure_threshold(struct zone *zone)
-//{
-//	int threshold;
-//	int watermark_distance;
-//
-//	/*
-//	 * As vmstats are not up to date, there is drift between the estimated
-//	 * and real values. For high thresholds and a high number of CPUs, it
-//	 * is possible for the min watermark to be breached while the estimated
-//	 * value looks fine. The pressure threshold is a reduced value such
-//	 * that even the maximum amount of drift will not accidentally breach
-//	 * the min watermark
-//	 */
-//	watermark_distance = low_wmark_pages(zone) - min_wmark_pages(zone);
-//	threshold = max(1, (int)(watermark_distance / num_online_cpus()));
-//
-//	/*
-//	 * Maximum threshold is 125
-//	 */
-//	threshold = min(125, threshold);
-//
-//	return threshold;
-//}
-//
-//int calculate_normal_threshold(struct zone *zone)
-//{
-//	int threshold;
-//	int mem;	/* memory in 128 MB units */
-//
-//	/*
-//	 * The threshold scales with the number of processors and the amount
-//	 * of memory per zone. More memory means that we can defer updates for
-//	 * longer, more processors could lead to more contention.
-// 	 * fls() is used to have a cheap way of logarithmic scaling.
-//	 *
-//	 * Some sample thresholds:
-//	 *
-//	 * Threshold	Processors	(fls)	Zonesize	fls(mem+1)
-//	 * ------------------------------------------------------------------
-//	 * 8		1		1	0.9-1 GB	4
-//	 * 16		2		2	0.9-1 GB	4
-//	 * 20 		2		2	1-2 GB		5
-//	 * 24		2		2	2-4 GB		6
-//	 * 28		2		2	4-8 GB		7
-//	 * 32		2		2	8-16 GB		8
-//	 * 4		2		2	<128M		1
-//	 * 30		4		3	2-4 GB		5
-//	 * 48		4		3	8-16 GB		8
-//	 * 32		8		4	1-2 GB		4
-//	 * 32		8		4	0.9-1GB		4
-//	 * 10		16		5	<128M		1
-//	 * 40		16		5	900M		4
-//	 * 70		64		7	2-4 GB		5
-//	 * 84		64		7	4-8 GB		6
-//	 * 108		512		9	4-8 GB		6
-//	 * 125		1024		10	8-16 GB		8
-//	 * 125		1024		10	16-32 GB	9
-//	 */
-//
-//	mem = zone_managed_pages(zone) >> (27 - PAGE_SHIFT);
-//
-//	threshold = 2 * fls(num_online_cpus()) * (1 + fls(mem));
-//
-//	/*
-//	 * Maximum threshold is 125
-//	 */
-//	threshold = min(125, threshold);
-//
-//	return threshold;
-//}
-//
-///*
-// * Refresh the thresholds for each zone.
-// */
-//void refresh_zone_stat_thresholds(void)
-//{
-//	struct pglist_data *pgdat;
-//	struct zone *zone;
-//	int cpu;
-//	int threshold;
-//
-//	/* Zero current pgdat thresholds */
-//	for_each_online_pgdat(pgdat) {
-//		for_each_online_cpu(cpu) {
-//			per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold = 0;
-//		}
-//	}
-//
-//	for_each_populated_zone(zone) {
-//		struct pglist_data *pgdat = zone->zone_pgdat;
-//		unsigned long max_drift, tolerate_drift;
-//
-//		threshold = calculate_normal_threshold(zone);
-//
-//		for_each_online_cpu(cpu) {
-//			int pgdat_threshold;
-//
-//			per_cpu_ptr(zone->pageset, cpu)->stat_threshold
-//							= threshold;
-//
-//			/* Base nodestat threshold on the largest populated zone. */
-//			pgdat_threshold = per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold;
-//			per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold
-//				= max(threshold, pgdat_threshold);
-//		}
-//
-//		/*
-//		 * Only set percpu_drift_mark if there is a danger that
-//		 * NR_FREE_PAGES reports the low watermark is ok when in fact
-//		 * the min watermark could be breached by an allocation
-//		 */
-//		tolerate_drift = low_wmark_pages(zone) - min_wmark_pages(zone);
-//		max_drift = num_online_cpus() * threshold;
-//		if (max_drift > tolerate_drift)
-//			zone->percpu_drift_mark = high_wmark_pages(zone) +
-//					max_drift;
-//	}
-//}
-//
-//void set_pgdat_percpu_threshold(pg_data_t *pgdat,
-//				int (*calculate_pressure)(struct zone *))
-//{
-//	struct zone *zone;
-//	int cpu;
-//	int threshold;
-//	int i;
-//
-//	for (i = 0; i < pgdat->nr_zones; i++) {
-//		zone = &pgdat->node_zones[i];
-//		if (!zone->percpu_drift_mark)
-//			continue;
-//
-//		threshold = (*calculate_pressure)(zone);
-//		for_each_online_cpu(cpu)
-//			per_cpu_ptr(zone->pageset, cpu)->stat_threshold
-//							= threshold;
-//	}
-//}
-//
-///*
-// * For use when we know that interrupts are disabled,
-// * or when we know that preemption is disabled and that
-// * particular counter cannot be updated from interrupt context.
-// */
-//void __mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
-//			   long delta)
-//{
-//	struct per_cpu_pageset __percpu *pcp = zone->pageset;
-//	s8 __percpu *p = pcp->vm_stat_diff + item;
-//	long x;
-//	long t;
-//
-//	x = delta + __this_cpu_read(*p);
-//
-//	t = __this_cpu_read(pcp->stat_threshold);
-//
-//	if (unlikely(x > t || x < -t)) {
-//		zone_page_state_add(x, zone, item);
-//		x = 0;
-//	}
-//	__this_cpu_write(*p, x);
-//}
-//EXPORT_SYMBOL(__mod_zone_page_state);
-//
-//void __mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
-//				long delta)
-//{
-//	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
-//	s8 __percpu *p = pcp->vm_node_stat_diff + item;
-//	long x;
-//	long t;
-//
-//	if (vmstat_item_in_bytes(item)) {
-//		VM_WARN_ON_ONCE(delta & (PAGE_SIZE - 1));
-//		delta >>= PAGE_SHIFT;
-//	}
-//
-//	x = delta + __this_cpu_read(*p);
-//
-//	t = __this_cpu_read(pcp->stat_threshold);
-//
-//	if (unlikely(x > t || x < -t)) {
-//		node_page_state_add(x, pgdat, item);
-//		x = 0;
-//	}
-//	__this_cpu_write(*p, x);
-//}
-//EXPORT_SYMBOL(__mod_node_page_state);
-//
-///*
-// * Optimized increment and decrement functions.
-// *
-// * These are only for a single page and therefore can take a struct page *
-// * argument instead of struct zone *. This allows the inclusion of the code
-// * generated for page_zone(page) into the optimized functions.
-// *
-// * No overflow check is necessary and therefore the differential can be
-// * incremented or decremented in place which may allow the compilers to
-// * generate better code.
-// * The increment or decrement is known and therefore one boundary check can
-// * be omitted.
-// *
-// * NOTE: These functions are very performance sensitive. Change only
-// * with care.
-// *
-// * Some processors have inc/dec instructions that are atomic vs an interrupt.
-// * However, the code must first determine the differential location in a zone
-// * based on the processor number and then inc/dec the counter. There is no
-// * guarantee without disabling preemption that the processor will not change
-// * in between and therefore the atomicity vs. interrupt cannot be exploited
-// * in a useful way here.
-// */
-//void __inc_zone_state(struct zone *zone, enum zone_stat_item item)
-//{
-//	struct per_cpu_pageset __percpu *pcp = zone->pageset;
-//	s8 __percpu *p = pcp->vm_stat_diff + item;
-//	s8 v, t;
-//
-//	v = __this_cpu_inc_return(*p);
-//	t = __this_cpu_read(pcp->stat_threshold);
-//	if (unlikely(v > t)) {
-//		s8 overstep = t >> 1;
-//
-//		zone_page_state_add(v + overstep, zone, item);
-//		__this_cpu_write(*p, -overstep);
-//	}
-//}
-//
-//void __inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
-//{
-//	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
-//	s8 __percpu *p = pcp->vm_node_stat_diff + item;
-//	s8 v, t;
-//
-//	VM_WARN_ON_ONCE(vmstat_item_in_bytes(item));
-//
-//	v = __this_cpu_inc_return(*p);
-//	t = __this_cpu_read(pcp->stat_threshold);
-//	if (unlikely(v > t)) {
-//		s8 overstep = t >> 1;
-//
-//		node_page_state_add(v + overstep, pgdat, item);
-//		__this_cpu_write(*p, -overstep);
-//	}
-//}
-//
-//void __inc_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	__inc_zone_state(page_zone(page), item);
-//}
-//EXPORT_SYMBOL(__inc_zone_page_state);
-//
-//void __inc_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	__inc_node_state(page_pgdat(page), item);
-//}
-//EXPORT_SYMBOL(__inc_node_page_state);
-//
-//void __dec_zone_state(struct zone *zone, enum zone_stat_item item)
-//{
-//	struct per_cpu_pageset __percpu *pcp = zone->pageset;
-//	s8 __percpu *p = pcp->vm_stat_diff + item;
-//	s8 v, t;
-//
-//	v = __this_cpu_dec_return(*p);
-//	t = __this_cpu_read(pcp->stat_threshold);
-//	if (unlikely(v < - t)) {
-//		s8 overstep = t >> 1;
-//
-//		zone_page_state_add(v - overstep, zone, item);
-//		__this_cpu_write(*p, overstep);
-//	}
-//}
-//
-//void __dec_node_state(struct pglist_data *pgdat, enum node_stat_item item)
-//{
-//	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
-//	s8 __percpu *p = pcp->vm_node_stat_diff + item;
-//	s8 v, t;
-//
-//	VM_WARN_ON_ONCE(vmstat_item_in_bytes(item));
-//
-//	v = __this_cpu_dec_return(*p);
-//	t = __this_cpu_read(pcp->stat_threshold);
-//	if (unlikely(v < - t)) {
-//		s8 overstep = t >> 1;
-//
-//		node_page_state_add(v - overstep, pgdat, item);
-//		__this_cpu_write(*p, overstep);
-//	}
-//}
-//
-//void __dec_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	__dec_zone_state(page_zone(page), item);
-//}
-//EXPORT_SYMBOL(__dec_zone_page_state);
-//
-//void __dec_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	__dec_node_state(page_pgdat(page), item);
-//}
-//EXPORT_SYMBOL(__dec_node_page_state);
-//
-//#ifdef CONFIG_HAVE_CMPXCHG_LOCAL
-///*
-// * If we have cmpxchg_local support then we do not need to incur the overhead
-// * that comes with local_irq_save/restore if we use this_cpu_cmpxchg.
-// *
-// * mod_state() modifies the zone counter state through atomic per cpu
-// * operations.
-// *
-// * Overstep mode specifies how overstep should handled:
-// *     0       No overstepping
-// *     1       Overstepping half of threshold
-// *     -1      Overstepping minus half of threshold
-//*/
-//static inline void mod_zone_state(struct zone *zone,
-//       enum zone_stat_item item, long delta, int overstep_mode)
-//{
-//	struct per_cpu_pageset __percpu *pcp = zone->pageset;
-//	s8 __percpu *p = pcp->vm_stat_diff + item;
-//	long o, n, t, z;
-//
-//	do {
-//		z = 0;  /* overflow to zone counters */
-//
-//		/*
-//		 * The fetching of the stat_threshold is racy. We may apply
-//		 * a counter threshold to the wrong the cpu if we get
-//		 * rescheduled while executing here. However, the next
-//		 * counter update will apply the threshold again and
-//		 * therefore bring the counter under the threshold again.
-//		 *
-//		 * Most of the time the thresholds are the same anyways
-//		 * for all cpus in a zone.
-//		 */
-//		t = this_cpu_read(pcp->stat_threshold);
-//
-//		o = this_cpu_read(*p);
-//		n = delta + o;
-//
-//		if (n > t || n < -t) {
-//			int os = overstep_mode * (t >> 1) ;
-//
-//			/* Overflow must be added to zone counters */
-//			z = n + os;
-//			n = -os;
-//		}
-//	} while (this_cpu_cmpxchg(*p, o, n) != o);
-//
-//	if (z)
-//		zone_page_state_add(z, zone, item);
-//}
-//
-//void mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
-//			 long delta)
-//{
-//	mod_zone_state(zone, item, delta, 0);
-//}
-//EXPORT_SYMBOL(mod_zone_page_state);
-//
-//void inc_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	mod_zone_state(page_zone(page), item, 1, 1);
-//}
-//EXPORT_SYMBOL(inc_zone_page_state);
-//
-//void dec_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	mod_zone_state(page_zone(page), item, -1, -1);
-//}
-//EXPORT_SYMBOL(dec_zone_page_state);
-//
-//static inline void mod_node_state(struct pglist_data *pgdat,
-//       enum node_stat_item item, int delta, int overstep_mode)
-//{
-//	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
-//	s8 __percpu *p = pcp->vm_node_stat_diff + item;
-//	long o, n, t, z;
-//
-//	if (vmstat_item_in_bytes(item)) {
-//		VM_WARN_ON_ONCE(delta & (PAGE_SIZE - 1));
-//		delta >>= PAGE_SHIFT;
-//	}
-//
-//	do {
-//		z = 0;  /* overflow to node counters */
-//
-//		/*
-//		 * The fetching of the stat_threshold is racy. We may apply
-//		 * a counter threshold to the wrong the cpu if we get
-//		 * rescheduled while executing here. However, the next
-//		 * counter update will apply the threshold again and
-//		 * therefore bring the counter under the threshold again.
-//		 *
-//		 * Most of the time the thresholds are the same anyways
-//		 * for all cpus in a node.
-//		 */
-//		t = this_cpu_read(pcp->stat_threshold);
-//
-//		o = this_cpu_read(*p);
-//		n = delta + o;
-//
-//		if (n > t || n < -t) {
-//			int os = overstep_mode * (t >> 1) ;
-//
-//			/* Overflow must be added to node counters */
-//			z = n + os;
-//			n = -os;
-//		}
-//	} while (this_cpu_cmpxchg(*p, o, n) != o);
-//
-//	if (z)
-//		node_page_state_add(z, pgdat, item);
-//}
-//
-//void mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
-//					long delta)
-//{
-//	mod_node_state(pgdat, item, delta, 0);
-//}
-//EXPORT_SYMBOL(mod_node_page_state);
-//
-//void inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
-//{
-//	mod_node_state(pgdat, item, 1, 1);
-//}
-//
-//void inc_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	mod_node_state(page_pgdat(page), item, 1, 1);
-//}
-//EXPORT_SYMBOL(inc_node_page_state);
-//
-//void dec_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	mod_node_state(page_pgdat(page), item, -1, -1);
-//}
-//EXPORT_SYMBOL(dec_node_page_state);
-//#else
-///*
-// * Use interrupt disable to serialize counter updates
-// */
-//void mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
-//			 long delta)
-//{
-//	unsigned long flags;
-//
-//	local_irq_save(flags);
-//	__mod_zone_page_state(zone, item, delta);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(mod_zone_page_state);
-//
-//void inc_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	unsigned long flags;
-//	struct zone *zone;
-//
-//	zone = page_zone(page);
-//	local_irq_save(flags);
-//	__inc_zone_state(zone, item);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(inc_zone_page_state);
-//
-//void dec_zone_page_state(struct page *page, enum zone_stat_item item)
-//{
-//	unsigned long flags;
-//
-//	local_irq_save(flags);
-//	__dec_zone_page_state(page, item);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(dec_zone_page_state);
-//
-//void inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
-//{
-//	unsigned long flags;
-//
-//	local_irq_save(flags);
-//	__inc_node_state(pgdat, item);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(inc_node_state);
-//
-//void mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
-//					long delta)
-//{
-//	unsigned long flags;
-//
-//	local_irq_save(flags);
-//	__mod_node_page_state(pgdat, item, delta);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(mod_node_page_state);
-//
-//void inc_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	unsigned long flags;
-//	struct pglist_data *pgdat;
-//
-//	pgdat = page_pgdat(page);
-//	local_irq_save(flags);
-//	__inc_node_state(pgdat, item);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(inc_node_page_state);
-//
-//void dec_node_page_state(struct page *page, enum node_stat_item item)
-//{
-//	unsigned long flags;
-//
-//	local_irq_save(flags);
-//	__dec_node_page_state(page, item);
-//	local_irq_restore(flags);
-//}
-//EXPORT_SYMBOL(dec_node_page_state);
-//#endif
-//
-///*
-// * Fold a differential into the global counters.
-// * Returns the number of counters updated.
-// */
-//#ifdef CONFIG_NUMA
-//static int fold_diff(int *zone_diff, int *numa_diff, int *node_diff)
-//{
-//	int i;
-//	int changes = 0;
-//
-//	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
-//		if (zone_diff[i]) {
-//			atomic_long_add(zone_diff[i], &vm_zone_stat[i]);
-//			changes++;
-//	}
-//
-//	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
-//		if (numa_diff[i]) {
-//			atomic_long_add(numa_diff[i], &vm_numa_stat[i]);
-//			changes++;
-//	}
-//
-//	for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
-//		if (node_diff[i]) {
-//			atomic_long_add(node_diff[i], &vm_node_stat[i]);
-//			changes++;
-//	}
-//	return changes;
-//}
-//#else
-//static int fold_diff(int *zone_diff, int *node_diff)
-//{
-//	int i;
-//	int changes = 0;
-//
-//	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
-//		if (zone_diff[i]) {
-//			atomic_long_add(zone_diff[i], &vm_zone_stat[i]);
-//			changes++;
-//	}
-//
-//	for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
-//		if (node_diff[i]) {
-//			atomic_long_add(node_diff[i], &vm_node_stat[i]);
-//			changes++;
-//	}
-//	return changes;
-//}
-//#endif /* CONFIG_NUMA */
-//
-///*
-// * Update the zone counters for the current cpu.
-// *
-// * Note that refresh_cpu_vm_stats strives to only access
-// * node local memory. The per cpu pagesets on remote zones are placed
-// * in the memory local to the processor using that pageset. So the
-// * loop over all zones will access a series of cachelines local to
-// * the processor.
-// *
-// * The call to zone_page_state_add updates the cachelines with the
-// * statistics in the remote zone struct as well as the global cachelines
-// * with the global counters. These could cause remote node cache line
-// * bouncing and will have to be only done when necessary.
-// *
-// * The function returns the number of global counters updated.
-// */
-//static int refresh_cpu_vm_stats(bool do_pagesets)
-//{
-//	struct pglist_data *pgdat;
-//	struct zone *zone;
-//	int i;
-//	int global_zone_diff[NR_VM_ZONE_STAT_ITEMS] = { 0, };
-//#ifdef CONFIG_NUMA
-//	int global_numa_diff[NR_VM_NUMA_STAT_ITEMS] = { 0, };
-//#endif
-//	int global_node_diff[NR_VM_NODE_STAT_ITEMS] = { 0, };
-//	int changes = 0;
-//
-//	for_each_populated_zone(zone) {
-//		struct per_cpu_pageset __percpu *p = zone->pageset;
-//
-//		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
-//			int v;
-//
-//			v = this_cpu_xchg(p->vm_stat_diff[i], 0);
-//			if (v) {
-//
-//				atomic_long_add(v, &zone->vm_stat[i]);
-//				global_zone_diff[i] += v;
-//#ifdef CONFIG_NUMA
-//				/* 3 seconds idle till flush */
-//				__this_cpu_write(p->expire, 3);
-//#endif
-//			}
-//		}
-//#ifdef CONFIG_NUMA
-//		for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++) {
-//			int v;
-//
-//			v = this_cpu_xchg(p->vm_numa_stat_diff[i], 0);
-//			if (v) {
-//
-//				atomic_long_add(v, &zone->vm_numa_stat[i]);
-//				global_numa_diff[i] += v;
-//				__this_cpu_write(p->expire, 3);
-//			}
-//		}
-//
-//		if (do_pagesets) {
-//			cond_resched();
-//			/*
-//			 * Deal with draining the remote pageset of this
-//			 * processor
-//			 *
-//			 * Check if there are pages remaining in this pageset
-//			 * if not then there is nothing to expire.
-//			 */
-//			if (!__this_cpu_read(p->expire) ||
-//			       !__this_cpu_read(p->pcp.count))
-//				continue;
-//
-//			/*
-//			 * We never drain zones local to this processor.
-//			 */
-//			if (zone_to_nid(zone) == numa_node_id()) {
-//				__this_cpu_write(p->expire, 0);
-//				continue;
-//			}
-//
-//			if (__this_cpu_dec_return(p->expire))
-//				continue;
-//
-//			if (__this_cpu_read(p->pcp.count)) {
-//				drain_zone_pages(zone, this_cpu_ptr(&p->pcp));
-//				changes++;
-//			}
-//		}
-//#endif
-//	}
-//
-//	for_each_online_pgdat(pgdat) {
-//		struct per_cpu_nodestat __percpu *p = pgdat->per_cpu_nodestats;
-//
-//		for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++) {
-//			int v;
-//
-//			v = this_cpu_xchg(p->vm_node_stat_diff[i], 0);
-//			if (v) {
-//				atomic_long_add(v, &pgdat->vm_stat[i]);
-//				global_node_diff[i] += v;
-//			}
-//		}
-//	}
-//
-//#ifdef CONFIG_NUMA
-//	changes += fold_diff(global_zone_diff, global_numa_diff,
-//			     global_node_diff);
-//#else
-//	changes += fold_diff(global_zone_diff, global_node_diff);
-//#endif
-//	return changes;
-//}
-//
-///*
-// * Fold the data for an offline cpu into the global array.
-// * There cannot be any access by the offline cpu and therefore
-// * synchronization is simplified.
-// */
-//void cpu_vm_stats_fold(int cpu)
-//{
-//	struct pglist_data *pgdat;
-//	struct zone *zone;
-//	int i;
-//	int global_zone_diff[NR_VM_ZONE_STAT_ITEMS] = { 0, };
-//#ifdef CONFIG_NUMA
-//	int global_numa_diff[NR_VM_NUMA_STAT_ITEMS] = { 0, };
-//#endif
-//	int global_node_diff[NR_VM_NODE_STAT_ITEMS] = { 0, };
-//
-//	for_each_populated_zone(zone) {
-//		struct per_cpu_pageset *p;
-//
-//		p = per_cpu_ptr(zone->pageset, cpu);
-//
-//		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
-//			if (p->vm_stat_diff[i]) {
-//				int v;
-//
-//				v = p->vm_stat_diff[i];
-//				p->vm_stat_diff[i] = 0;
-//				atomic_long_add(v, &zone->vm_stat[i]);
-//				global_zone_diff[i] += v;
-//			}
-//
-//#ifdef CONFIG_NUMA
-//		for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
-//			if (p->vm_numa_stat_diff[i]) {
-//				int v;
-//
-//				v = p->vm_numa_stat_diff[i];
-//				p->vm_numa_stat_diff[i] = 0;
-//				atomic_long_add(v, &zone->vm_numa_stat[i]);
-//				global_numa_diff[i] += v;
-//			}
-//#endif
-//	}
-//
-//	for_each_online_pgdat(pgdat) {
-//		struct per_cpu_nodestat *p;
-//
-//		p = per_cpu_ptr(pgdat->per_cpu_nodestats, cpu);
-//
-//		for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
-//			if (p->vm_node_stat_diff[i]) {
-//				int v;
-//
-//				v = p->vm_node_stat_diff[i];
-//				p->vm_node_stat_diff[i] = 0;
-//				atomic_long_add(v, &pgdat->vm_stat[i]);
-//				global_node_diff[i] += v;
-//			}
-//	}
-//
-//#ifdef CONFIG_NUMA
-//	fold_diff(global_zone_diff, global_numa_diff, global_node_diff);
-//#else
-//	fold_diff(global_zone_diff, global_node_diff);
-//#endif
-//}
-//
-///*
-// * this is only called if !populated_zone(zone), which implies no other users of
-// * pset->vm_stat_diff[] exsist.
-// */
-//void drain_zonestat(struct zone *zone, struct per_cpu_pageset *pset)
-//{
-//	int i;
-//
-//	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
-//		if (pset->vm_stat_diff[i]) {
-//			int v = pset->vm_stat_diff[i];
-//			pset->vm_stat_diff[i] = 0;
-//			atomic_long_add(v, &zone->vm_stat[i]);
-//			atomic_long_add(v, &vm_zone_stat[i]);
-//		}
-//
-//#ifdef CONFIG_NUMA
-//	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
-//		if (pset->vm_numa_stat_diff[i]) {
-//			int v = pset->vm_numa_stat_diff[i];
-//
-//			pset->vm_numa_stat_diff[i] = 0;
-//			atomic_long_add(v, &zone->vm_numa_stat[i]);
-//			atomic_long_add(v, &vm_numa_stat[i]);
-//		}
-//#endif
-//}
-//#endif
+#ifdef CONFIG_SMP
+
+int calculate_pressure_threshold(struct zone *zone)
+{
+	int threshold;
+	int watermark_distance;
+
+	/*
+	 * As vmstats are not up to date, there is drift between the estimated
+	 * and real values. For high thresholds and a high number of CPUs, it
+	 * is possible for the min watermark to be breached while the estimated
+	 * value looks fine. The pressure threshold is a reduced value such
+	 * that even the maximum amount of drift will not accidentally breach
+	 * the min watermark
+	 */
+	watermark_distance = low_wmark_pages(zone) - min_wmark_pages(zone);
+	threshold = max(1, (int)(watermark_distance / num_online_cpus()));
+
+	/*
+	 * Maximum threshold is 125
+	 */
+	threshold = min(125, threshold);
+
+	return threshold;
+}
+
+int calculate_normal_threshold(struct zone *zone)
+{
+	int threshold;
+	int mem;	/* memory in 128 MB units */
+
+	/*
+	 * The threshold scales with the number of processors and the amount
+	 * of memory per zone. More memory means that we can defer updates for
+	 * longer, more processors could lead to more contention.
+ 	 * fls() is used to have a cheap way of logarithmic scaling.
+	 *
+	 * Some sample thresholds:
+	 *
+	 * Threshold	Processors	(fls)	Zonesize	fls(mem+1)
+	 * ------------------------------------------------------------------
+	 * 8		1		1	0.9-1 GB	4
+	 * 16		2		2	0.9-1 GB	4
+	 * 20 		2		2	1-2 GB		5
+	 * 24		2		2	2-4 GB		6
+	 * 28		2		2	4-8 GB		7
+	 * 32		2		2	8-16 GB		8
+	 * 4		2		2	<128M		1
+	 * 30		4		3	2-4 GB		5
+	 * 48		4		3	8-16 GB		8
+	 * 32		8		4	1-2 GB		4
+	 * 32		8		4	0.9-1GB		4
+	 * 10		16		5	<128M		1
+	 * 40		16		5	900M		4
+	 * 70		64		7	2-4 GB		5
+	 * 84		64		7	4-8 GB		6
+	 * 108		512		9	4-8 GB		6
+	 * 125		1024		10	8-16 GB		8
+	 * 125		1024		10	16-32 GB	9
+	 */
+
+	mem = zone_managed_pages(zone) >> (27 - PAGE_SHIFT);
+
+	threshold = 2 * fls(num_online_cpus()) * (1 + fls(mem));
+
+	/*
+	 * Maximum threshold is 125
+	 */
+	threshold = min(125, threshold);
+
+	return threshold;
+}
+
+/*
+ * Refresh the thresholds for each zone.
+ */
+void refresh_zone_stat_thresholds(void)
+{
+	struct pglist_data *pgdat;
+	struct zone *zone;
+	int cpu;
+	int threshold;
+
+	/* Zero current pgdat thresholds */
+	for_each_online_pgdat(pgdat) {
+		for_each_online_cpu(cpu) {
+			per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold = 0;
+		}
+	}
+
+	for_each_populated_zone(zone) {
+		struct pglist_data *pgdat = zone->zone_pgdat;
+		unsigned long max_drift, tolerate_drift;
+
+		threshold = calculate_normal_threshold(zone);
+
+		for_each_online_cpu(cpu) {
+			int pgdat_threshold;
+
+			per_cpu_ptr(zone->pageset, cpu)->stat_threshold
+							= threshold;
+
+			/* Base nodestat threshold on the largest populated zone. */
+			pgdat_threshold = per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold;
+			per_cpu_ptr(pgdat->per_cpu_nodestats, cpu)->stat_threshold
+				= max(threshold, pgdat_threshold);
+		}
+
+		/*
+		 * Only set percpu_drift_mark if there is a danger that
+		 * NR_FREE_PAGES reports the low watermark is ok when in fact
+		 * the min watermark could be breached by an allocation
+		 */
+		tolerate_drift = low_wmark_pages(zone) - min_wmark_pages(zone);
+		max_drift = num_online_cpus() * threshold;
+		if (max_drift > tolerate_drift)
+			zone->percpu_drift_mark = high_wmark_pages(zone) +
+					max_drift;
+	}
+}
+
+void set_pgdat_percpu_threshold(pg_data_t *pgdat,
+				int (*calculate_pressure)(struct zone *))
+{
+	struct zone *zone;
+	int cpu;
+	int threshold;
+	int i;
+
+	for (i = 0; i < pgdat->nr_zones; i++) {
+		zone = &pgdat->node_zones[i];
+		if (!zone->percpu_drift_mark)
+			continue;
+
+		threshold = (*calculate_pressure)(zone);
+		for_each_online_cpu(cpu)
+			per_cpu_ptr(zone->pageset, cpu)->stat_threshold
+							= threshold;
+	}
+}
+EXPORT_SYMBOL(set_pgdat_percpu_threshold);
+
+/*
+ * For use when we know that interrupts are disabled,
+ * or when we know that preemption is disabled and that
+ * particular counter cannot be updated from interrupt context.
+ */
+void __mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
+			   long delta)
+{
+	struct per_cpu_pageset __percpu *pcp = zone->pageset;
+	s8 __percpu *p = pcp->vm_stat_diff + item;
+	long x;
+	long t;
+
+	x = delta + __this_cpu_read(*p);
+
+	t = __this_cpu_read(pcp->stat_threshold);
+
+	if (unlikely(x > t || x < -t)) {
+		zone_page_state_add(x, zone, item);
+		x = 0;
+	}
+	__this_cpu_write(*p, x);
+}
+EXPORT_SYMBOL(__mod_zone_page_state);
+
+void __mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
+				long delta)
+{
+	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
+	s8 __percpu *p = pcp->vm_node_stat_diff + item;
+	long x;
+	long t;
+
+	if (vmstat_item_in_bytes(item)) {
+		VM_WARN_ON_ONCE(delta & (PAGE_SIZE - 1));
+		delta >>= PAGE_SHIFT;
+	}
+
+	x = delta + __this_cpu_read(*p);
+
+	t = __this_cpu_read(pcp->stat_threshold);
+
+	if (unlikely(x > t || x < -t)) {
+		node_page_state_add(x, pgdat, item);
+		x = 0;
+	}
+	__this_cpu_write(*p, x);
+}
+EXPORT_SYMBOL(__mod_node_page_state);
+
+/*
+ * Optimized increment and decrement functions.
+ *
+ * These are only for a single page and therefore can take a struct page *
+ * argument instead of struct zone *. This allows the inclusion of the code
+ * generated for page_zone(page) into the optimized functions.
+ *
+ * No overflow check is necessary and therefore the differential can be
+ * incremented or decremented in place which may allow the compilers to
+ * generate better code.
+ * The increment or decrement is known and therefore one boundary check can
+ * be omitted.
+ *
+ * NOTE: These functions are very performance sensitive. Change only
+ * with care.
+ *
+ * Some processors have inc/dec instructions that are atomic vs an interrupt.
+ * However, the code must first determine the differential location in a zone
+ * based on the processor number and then inc/dec the counter. There is no
+ * guarantee without disabling preemption that the processor will not change
+ * in between and therefore the atomicity vs. interrupt cannot be exploited
+ * in a useful way here.
+ */
+void __inc_zone_state(struct zone *zone, enum zone_stat_item item)
+{
+	struct per_cpu_pageset __percpu *pcp = zone->pageset;
+	s8 __percpu *p = pcp->vm_stat_diff + item;
+	s8 v, t;
+
+	v = __this_cpu_inc_return(*p);
+	t = __this_cpu_read(pcp->stat_threshold);
+	if (unlikely(v > t)) {
+		s8 overstep = t >> 1;
+
+		zone_page_state_add(v + overstep, zone, item);
+		__this_cpu_write(*p, -overstep);
+	}
+}
+
+void __inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
+{
+	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
+	s8 __percpu *p = pcp->vm_node_stat_diff + item;
+	s8 v, t;
+
+	VM_WARN_ON_ONCE(vmstat_item_in_bytes(item));
+
+	v = __this_cpu_inc_return(*p);
+	t = __this_cpu_read(pcp->stat_threshold);
+	if (unlikely(v > t)) {
+		s8 overstep = t >> 1;
+
+		node_page_state_add(v + overstep, pgdat, item);
+		__this_cpu_write(*p, -overstep);
+	}
+}
+
+void __inc_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	__inc_zone_state(page_zone(page), item);
+}
+EXPORT_SYMBOL(__inc_zone_page_state);
+
+void __inc_node_page_state(struct page *page, enum node_stat_item item)
+{
+	__inc_node_state(page_pgdat(page), item);
+}
+EXPORT_SYMBOL(__inc_node_page_state);
+
+void __dec_zone_state(struct zone *zone, enum zone_stat_item item)
+{
+	struct per_cpu_pageset __percpu *pcp = zone->pageset;
+	s8 __percpu *p = pcp->vm_stat_diff + item;
+	s8 v, t;
+
+	v = __this_cpu_dec_return(*p);
+	t = __this_cpu_read(pcp->stat_threshold);
+	if (unlikely(v < - t)) {
+		s8 overstep = t >> 1;
+
+		zone_page_state_add(v - overstep, zone, item);
+		__this_cpu_write(*p, overstep);
+	}
+}
+
+void __dec_node_state(struct pglist_data *pgdat, enum node_stat_item item)
+{
+	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
+	s8 __percpu *p = pcp->vm_node_stat_diff + item;
+	s8 v, t;
+
+	VM_WARN_ON_ONCE(vmstat_item_in_bytes(item));
+
+	v = __this_cpu_dec_return(*p);
+	t = __this_cpu_read(pcp->stat_threshold);
+	if (unlikely(v < - t)) {
+		s8 overstep = t >> 1;
+
+		node_page_state_add(v - overstep, pgdat, item);
+		__this_cpu_write(*p, overstep);
+	}
+}
+
+void __dec_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	__dec_zone_state(page_zone(page), item);
+}
+EXPORT_SYMBOL(__dec_zone_page_state);
+
+void __dec_node_page_state(struct page *page, enum node_stat_item item)
+{
+	__dec_node_state(page_pgdat(page), item);
+}
+EXPORT_SYMBOL(__dec_node_page_state);
+
+#ifdef CONFIG_HAVE_CMPXCHG_LOCAL
+/*
+ * If we have cmpxchg_local support then we do not need to incur the overhead
+ * that comes with local_irq_save/restore if we use this_cpu_cmpxchg.
+ *
+ * mod_state() modifies the zone counter state through atomic per cpu
+ * operations.
+ *
+ * Overstep mode specifies how overstep should handled:
+ *     0       No overstepping
+ *     1       Overstepping half of threshold
+ *     -1      Overstepping minus half of threshold
+*/
+static inline void mod_zone_state(struct zone *zone,
+       enum zone_stat_item item, long delta, int overstep_mode)
+{
+	struct per_cpu_pageset __percpu *pcp = zone->pageset;
+	s8 __percpu *p = pcp->vm_stat_diff + item;
+	long o, n, t, z;
+
+	do {
+		z = 0;  /* overflow to zone counters */
+
+		/*
+		 * The fetching of the stat_threshold is racy. We may apply
+		 * a counter threshold to the wrong the cpu if we get
+		 * rescheduled while executing here. However, the next
+		 * counter update will apply the threshold again and
+		 * therefore bring the counter under the threshold again.
+		 *
+		 * Most of the time the thresholds are the same anyways
+		 * for all cpus in a zone.
+		 */
+		t = this_cpu_read(pcp->stat_threshold);
+
+		o = this_cpu_read(*p);
+		n = delta + o;
+
+		if (n > t || n < -t) {
+			int os = overstep_mode * (t >> 1) ;
+
+			/* Overflow must be added to zone counters */
+			z = n + os;
+			n = -os;
+		}
+	} while (this_cpu_cmpxchg(*p, o, n) != o);
+
+	if (z)
+		zone_page_state_add(z, zone, item);
+}
+
+void mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
+			 long delta)
+{
+	mod_zone_state(zone, item, delta, 0);
+}
+EXPORT_SYMBOL(mod_zone_page_state);
+
+void inc_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	mod_zone_state(page_zone(page), item, 1, 1);
+}
+EXPORT_SYMBOL(inc_zone_page_state);
+
+void dec_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	mod_zone_state(page_zone(page), item, -1, -1);
+}
+EXPORT_SYMBOL(dec_zone_page_state);
+
+static inline void mod_node_state(struct pglist_data *pgdat,
+       enum node_stat_item item, int delta, int overstep_mode)
+{
+	struct per_cpu_nodestat __percpu *pcp = pgdat->per_cpu_nodestats;
+	s8 __percpu *p = pcp->vm_node_stat_diff + item;
+	long o, n, t, z;
+
+	if (vmstat_item_in_bytes(item)) {
+		VM_WARN_ON_ONCE(delta & (PAGE_SIZE - 1));
+		delta >>= PAGE_SHIFT;
+	}
+
+	do {
+		z = 0;  /* overflow to node counters */
+
+		/*
+		 * The fetching of the stat_threshold is racy. We may apply
+		 * a counter threshold to the wrong the cpu if we get
+		 * rescheduled while executing here. However, the next
+		 * counter update will apply the threshold again and
+		 * therefore bring the counter under the threshold again.
+		 *
+		 * Most of the time the thresholds are the same anyways
+		 * for all cpus in a node.
+		 */
+		t = this_cpu_read(pcp->stat_threshold);
+
+		o = this_cpu_read(*p);
+		n = delta + o;
+
+		if (n > t || n < -t) {
+			int os = overstep_mode * (t >> 1) ;
+
+			/* Overflow must be added to node counters */
+			z = n + os;
+			n = -os;
+		}
+	} while (this_cpu_cmpxchg(*p, o, n) != o);
+
+	if (z)
+		node_page_state_add(z, pgdat, item);
+}
+
+void mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
+					long delta)
+{
+	mod_node_state(pgdat, item, delta, 0);
+}
+EXPORT_SYMBOL(mod_node_page_state);
+
+void inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
+{
+	mod_node_state(pgdat, item, 1, 1);
+}
+
+void inc_node_page_state(struct page *page, enum node_stat_item item)
+{
+	mod_node_state(page_pgdat(page), item, 1, 1);
+}
+EXPORT_SYMBOL(inc_node_page_state);
+
+void dec_node_page_state(struct page *page, enum node_stat_item item)
+{
+	mod_node_state(page_pgdat(page), item, -1, -1);
+}
+EXPORT_SYMBOL(dec_node_page_state);
+#else
+/*
+ * Use interrupt disable to serialize counter updates
+ */
+void mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
+			 long delta)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__mod_zone_page_state(zone, item, delta);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(mod_zone_page_state);
+
+void inc_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	unsigned long flags;
+	struct zone *zone;
+
+	zone = page_zone(page);
+	local_irq_save(flags);
+	__inc_zone_state(zone, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(inc_zone_page_state);
+
+void dec_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__dec_zone_page_state(page, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(dec_zone_page_state);
+
+void inc_node_state(struct pglist_data *pgdat, enum node_stat_item item)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__inc_node_state(pgdat, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(inc_node_state);
+
+void mod_node_page_state(struct pglist_data *pgdat, enum node_stat_item item,
+					long delta)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__mod_node_page_state(pgdat, item, delta);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(mod_node_page_state);
+
+void inc_node_page_state(struct page *page, enum node_stat_item item)
+{
+	unsigned long flags;
+	struct pglist_data *pgdat;
+
+	pgdat = page_pgdat(page);
+	local_irq_save(flags);
+	__inc_node_state(pgdat, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(inc_node_page_state);
+
+void dec_node_page_state(struct page *page, enum node_stat_item item)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__dec_node_page_state(page, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(dec_node_page_state);
+#endif
+
+/*
+ * Fold a differential into the global counters.
+ * Returns the number of counters updated.
+ */
+#ifdef CONFIG_NUMA
+static int fold_diff(int *zone_diff, int *numa_diff, int *node_diff)
+{
+	int i;
+	int changes = 0;
+
+	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+		if (zone_diff[i]) {
+			atomic_long_add(zone_diff[i], &vm_zone_stat[i]);
+			changes++;
+	}
+
+	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
+		if (numa_diff[i]) {
+			atomic_long_add(numa_diff[i], &vm_numa_stat[i]);
+			changes++;
+	}
+
+	for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
+		if (node_diff[i]) {
+			atomic_long_add(node_diff[i], &vm_node_stat[i]);
+			changes++;
+	}
+	return changes;
+}
+#else
+static int fold_diff(int *zone_diff, int *node_diff)
+{
+	int i;
+	int changes = 0;
+
+	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+		if (zone_diff[i]) {
+			atomic_long_add(zone_diff[i], &vm_zone_stat[i]);
+			changes++;
+	}
+
+	for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
+		if (node_diff[i]) {
+			atomic_long_add(node_diff[i], &vm_node_stat[i]);
+			changes++;
+	}
+	return changes;
+}
+#endif /* CONFIG_NUMA */
+
+/*
+ * Update the zone counters for the current cpu.
+ *
+ * Note that refresh_cpu_vm_stats strives to only access
+ * node local memory. The per cpu pagesets on remote zones are placed
+ * in the memory local to the processor using that pageset. So the
+ * loop over all zones will access a series of cachelines local to
+ * the processor.
+ *
+ * The call to zone_page_state_add updates the cachelines with the
+ * statistics in the remote zone struct as well as the global cachelines
+ * with the global counters. These could cause remote node cache line
+ * bouncing and will have to be only done when necessary.
+ *
+ * The function returns the number of global counters updated.
+ */
+static int refresh_cpu_vm_stats(bool do_pagesets)
+{
+	struct pglist_data *pgdat;
+	struct zone *zone;
+	int i;
+	int global_zone_diff[NR_VM_ZONE_STAT_ITEMS] = { 0, };
+#ifdef CONFIG_NUMA
+	int global_numa_diff[NR_VM_NUMA_STAT_ITEMS] = { 0, };
+#endif
+	int global_node_diff[NR_VM_NODE_STAT_ITEMS] = { 0, };
+	int changes = 0;
+
+	for_each_populated_zone(zone) {
+		struct per_cpu_pageset __percpu *p = zone->pageset;
+
+		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
+			int v;
+
+			v = this_cpu_xchg(p->vm_stat_diff[i], 0);
+			if (v) {
+
+				atomic_long_add(v, &zone->vm_stat[i]);
+				global_zone_diff[i] += v;
+#ifdef CONFIG_NUMA
+				/* 3 seconds idle till flush */
+				__this_cpu_write(p->expire, 3);
+#endif
+			}
+		}
+#ifdef CONFIG_NUMA
+		for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++) {
+			int v;
+
+			v = this_cpu_xchg(p->vm_numa_stat_diff[i], 0);
+			if (v) {
+
+				atomic_long_add(v, &zone->vm_numa_stat[i]);
+				global_numa_diff[i] += v;
+				__this_cpu_write(p->expire, 3);
+			}
+		}
+
+		if (do_pagesets) {
+			cond_resched();
+			/*
+			 * Deal with draining the remote pageset of this
+			 * processor
+			 *
+			 * Check if there are pages remaining in this pageset
+			 * if not then there is nothing to expire.
+			 */
+			if (!__this_cpu_read(p->expire) ||
+			       !__this_cpu_read(p->pcp.count))
+				continue;
+
+			/*
+			 * We never drain zones local to this processor.
+			 */
+			if (zone_to_nid(zone) == numa_node_id()) {
+				__this_cpu_write(p->expire, 0);
+				continue;
+			}
+
+			if (__this_cpu_dec_return(p->expire))
+				continue;
+
+			if (__this_cpu_read(p->pcp.count)) {
+				drain_zone_pages(zone, this_cpu_ptr(&p->pcp));
+				changes++;
+			}
+		}
+#endif
+	}
+
+	for_each_online_pgdat(pgdat) {
+		struct per_cpu_nodestat __percpu *p = pgdat->per_cpu_nodestats;
+
+		for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++) {
+			int v;
+
+			v = this_cpu_xchg(p->vm_node_stat_diff[i], 0);
+			if (v) {
+				atomic_long_add(v, &pgdat->vm_stat[i]);
+				global_node_diff[i] += v;
+			}
+		}
+	}
+
+#ifdef CONFIG_NUMA
+	changes += fold_diff(global_zone_diff, global_numa_diff,
+			     global_node_diff);
+#else
+	changes += fold_diff(global_zone_diff, global_node_diff);
+#endif
+	return changes;
+}
+
+/*
+ * Fold the data for an offline cpu into the global array.
+ * There cannot be any access by the offline cpu and therefore
+ * synchronization is simplified.
+ */
+void cpu_vm_stats_fold(int cpu)
+{
+	struct pglist_data *pgdat;
+	struct zone *zone;
+	int i;
+	int global_zone_diff[NR_VM_ZONE_STAT_ITEMS] = { 0, };
+#ifdef CONFIG_NUMA
+	int global_numa_diff[NR_VM_NUMA_STAT_ITEMS] = { 0, };
+#endif
+	int global_node_diff[NR_VM_NODE_STAT_ITEMS] = { 0, };
+
+	for_each_populated_zone(zone) {
+		struct per_cpu_pageset *p;
+
+		p = per_cpu_ptr(zone->pageset, cpu);
+
+		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+			if (p->vm_stat_diff[i]) {
+				int v;
+
+				v = p->vm_stat_diff[i];
+				p->vm_stat_diff[i] = 0;
+				atomic_long_add(v, &zone->vm_stat[i]);
+				global_zone_diff[i] += v;
+			}
+
+#ifdef CONFIG_NUMA
+		for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
+			if (p->vm_numa_stat_diff[i]) {
+				int v;
+
+				v = p->vm_numa_stat_diff[i];
+				p->vm_numa_stat_diff[i] = 0;
+				atomic_long_add(v, &zone->vm_numa_stat[i]);
+				global_numa_diff[i] += v;
+			}
+#endif
+	}
+
+	for_each_online_pgdat(pgdat) {
+		struct per_cpu_nodestat *p;
+
+		p = per_cpu_ptr(pgdat->per_cpu_nodestats, cpu);
+
+		for (i = 0; i < NR_VM_NODE_STAT_ITEMS; i++)
+			if (p->vm_node_stat_diff[i]) {
+				int v;
+
+				v = p->vm_node_stat_diff[i];
+				p->vm_node_stat_diff[i] = 0;
+				atomic_long_add(v, &pgdat->vm_stat[i]);
+				global_node_diff[i] += v;
+			}
+	}
+
+#ifdef CONFIG_NUMA
+	fold_diff(global_zone_diff, global_numa_diff, global_node_diff);
+#else
+	fold_diff(global_zone_diff, global_node_diff);
+#endif
+}
+
+/*
+ * this is only called if !populated_zone(zone), which implies no other users of
+ * pset->vm_stat_diff[] exsist.
+ */
+void drain_zonestat(struct zone *zone, struct per_cpu_pageset *pset)
+{
+	int i;
+
+	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+		if (pset->vm_stat_diff[i]) {
+			int v = pset->vm_stat_diff[i];
+			pset->vm_stat_diff[i] = 0;
+			atomic_long_add(v, &zone->vm_stat[i]);
+			atomic_long_add(v, &vm_zone_stat[i]);
+		}
+
+#ifdef CONFIG_NUMA
+	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++)
+		if (pset->vm_numa_stat_diff[i]) {
+			int v = pset->vm_numa_stat_diff[i];
+
+			pset->vm_numa_stat_diff[i] = 0;
+			atomic_long_add(v, &zone->vm_numa_stat[i]);
+			atomic_long_add(v, &vm_numa_stat[i]);
+		}
+#endif
+}
+#endif
 //
 //#ifdef CONFIG_NUMA
 //void __inc_numa_state(struct zone *zone,
@@ -1675,11 +1676,15 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              batch: %i"
+			   "\n              hit:   %lu"
+			   "\n              miss:  %lu",
 			   i,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
-			   pageset->pcp.batch);
+			   pageset->pcp.batch,
+			   pageset->pcp.hit,
+			   pageset->pcp.miss);
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -1801,223 +1806,225 @@ static const struct seq_operations vmstat_op = {
 };
 #endif /* CONFIG_PROC_FS */
 //
-//#ifdef CONFIG_SMP
-//static DEFINE_PER_CPU(struct delayed_work, vmstat_work);
-//int sysctl_stat_interval __read_mostly = HZ;
-//
-//#ifdef CONFIG_PROC_FS
-//static void refresh_vm_stats(struct work_struct *work)
-//{
-//	refresh_cpu_vm_stats(true);
-//}
-//
-//int vmstat_refresh(struct ctl_table *table, int write,
-//		   void *buffer, size_t *lenp, loff_t *ppos)
-//{
-//	long val;
-//	int err;
-//	int i;
-//
-//	/*
-//	 * The regular update, every sysctl_stat_interval, may come later
-//	 * than expected: leaving a significant amount in per_cpu buckets.
-//	 * This is particularly misleading when checking a quantity of HUGE
-//	 * pages, immediately after running a test.  /proc/sys/vm/stat_refresh,
-//	 * which can equally be echo'ed to or cat'ted from (by root),
-//	 * can be used to update the stats just before reading them.
-//	 *
-//	 * Oh, and since global_zone_page_state() etc. are so careful to hide
-//	 * transiently negative values, report an error here if any of
-//	 * the stats is negative, so we know to go looking for imbalance.
-//	 */
-//	err = schedule_on_each_cpu(refresh_vm_stats);
-//	if (err)
-//		return err;
-//	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
-//		val = atomic_long_read(&vm_zone_stat[i]);
-//		if (val < 0) {
-//			pr_warn("%s: %s %ld\n",
-//				__func__, zone_stat_name(i), val);
-//			err = -EINVAL;
-//		}
-//	}
-//#ifdef CONFIG_NUMA
-//	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++) {
-//		val = atomic_long_read(&vm_numa_stat[i]);
-//		if (val < 0) {
-//			pr_warn("%s: %s %ld\n",
-//				__func__, numa_stat_name(i), val);
-//			err = -EINVAL;
-//		}
-//	}
-//#endif
-//	if (err)
-//		return err;
-//	if (write)
-//		*ppos += *lenp;
-//	else
-//		*lenp = 0;
-//	return 0;
-//}
-//#endif /* CONFIG_PROC_FS */
-//
-//static void vmstat_update(struct work_struct *w)
-//{
-//	if (refresh_cpu_vm_stats(true)) {
-//		/*
-//		 * Counters were updated so we expect more updates
-//		 * to occur in the future. Keep on running the
-//		 * update worker thread.
-//		 */
-//		queue_delayed_work_on(smp_processor_id(), mm_percpu_wq,
-//				this_cpu_ptr(&vmstat_work),
-//				round_jiffies_relative(sysctl_stat_interval));
-//	}
-//}
-//
-///*
-// * Switch off vmstat processing and then fold all the remaining differentials
-// * until the diffs stay at zero. The function is used by NOHZ and can only be
-// * invoked when tick processing is not active.
-// */
-///*
-// * Check if the diffs for a certain cpu indicate that
-// * an update is needed.
-// */
-//static bool need_update(int cpu)
-//{
-//	struct zone *zone;
-//
-//	for_each_populated_zone(zone) {
-//		struct per_cpu_pageset *p = per_cpu_ptr(zone->pageset, cpu);
-//
-//		BUILD_BUG_ON(sizeof(p->vm_stat_diff[0]) != 1);
-//#ifdef CONFIG_NUMA
-//		BUILD_BUG_ON(sizeof(p->vm_numa_stat_diff[0]) != 2);
-//#endif
-//
-//		/*
-//		 * The fast way of checking if there are any vmstat diffs.
-//		 */
-//		if (memchr_inv(p->vm_stat_diff, 0, NR_VM_ZONE_STAT_ITEMS *
-//			       sizeof(p->vm_stat_diff[0])))
-//			return true;
-//#ifdef CONFIG_NUMA
-//		if (memchr_inv(p->vm_numa_stat_diff, 0, NR_VM_NUMA_STAT_ITEMS *
-//			       sizeof(p->vm_numa_stat_diff[0])))
-//			return true;
-//#endif
-//	}
-//	return false;
-//}
-//
-///*
-// * Switch off vmstat processing and then fold all the remaining differentials
-// * until the diffs stay at zero. The function is used by NOHZ and can only be
-// * invoked when tick processing is not active.
-// */
-//void quiet_vmstat(void)
-//{
-//	if (system_state != SYSTEM_RUNNING)
-//		return;
-//
-//	if (!delayed_work_pending(this_cpu_ptr(&vmstat_work)))
-//		return;
-//
-//	if (!need_update(smp_processor_id()))
-//		return;
-//
-//	/*
-//	 * Just refresh counters and do not care about the pending delayed
-//	 * vmstat_update. It doesn't fire that often to matter and canceling
-//	 * it would be too expensive from this path.
-//	 * vmstat_shepherd will take care about that for us.
-//	 */
-//	refresh_cpu_vm_stats(false);
-//}
-//
-///*
-// * Shepherd worker thread that checks the
-// * differentials of processors that have their worker
-// * threads for vm statistics updates disabled because of
-// * inactivity.
-// */
-//static void vmstat_shepherd(struct work_struct *w);
-//
-//static DECLARE_DEFERRABLE_WORK(shepherd, vmstat_shepherd);
-//
-//static void vmstat_shepherd(struct work_struct *w)
-//{
-//	int cpu;
-//
-//	get_online_cpus();
-//	/* Check processors whose vmstat worker threads have been disabled */
-//	for_each_online_cpu(cpu) {
-//		struct delayed_work *dw = &per_cpu(vmstat_work, cpu);
-//
-//		if (!delayed_work_pending(dw) && need_update(cpu))
-//			queue_delayed_work_on(cpu, mm_percpu_wq, dw, 0);
-//	}
-//	put_online_cpus();
-//
-//	schedule_delayed_work(&shepherd,
-//		round_jiffies_relative(sysctl_stat_interval));
-//}
-//
-//static void __init start_shepherd_timer(void)
-//{
-//	int cpu;
-//
-//	for_each_possible_cpu(cpu)
-//		INIT_DEFERRABLE_WORK(per_cpu_ptr(&vmstat_work, cpu),
-//			vmstat_update);
-//
-//	schedule_delayed_work(&shepherd,
-//		round_jiffies_relative(sysctl_stat_interval));
-//}
-//
-//static void __init init_cpu_node_state(void)
-//{
-//	int node;
-//
-//	for_each_online_node(node) {
-//		if (cpumask_weight(cpumask_of_node(node)) > 0)
-//			node_set_state(node, N_CPU);
-//	}
-//}
-//
-//static int vmstat_cpu_online(unsigned int cpu)
-//{
-//	refresh_zone_stat_thresholds();
-//	node_set_state(cpu_to_node(cpu), N_CPU);
-//	return 0;
-//}
-//
-//static int vmstat_cpu_down_prep(unsigned int cpu)
-//{
-//	cancel_delayed_work_sync(&per_cpu(vmstat_work, cpu));
-//	return 0;
-//}
-//
-//static int vmstat_cpu_dead(unsigned int cpu)
-//{
-//	const struct cpumask *node_cpus;
-//	int node;
-//
-//	node = cpu_to_node(cpu);
-//
-//	refresh_zone_stat_thresholds();
-//	node_cpus = cpumask_of_node(node);
-//	if (cpumask_weight(node_cpus) > 0)
-//		return 0;
-//
-//	node_clear_state(node, N_CPU);
-//	return 0;
-//}
-//
-//#endif
+#ifdef CONFIG_SMP
+static DEFINE_PER_CPU(struct delayed_work, vmstat_work);
+int sysctl_stat_interval __read_mostly = HZ;
+
+#ifdef CONFIG_PROC_FS
+static void refresh_vm_stats(struct work_struct *work)
+{
+	refresh_cpu_vm_stats(true);
+}
+
+int vmstat_refresh(struct ctl_table *table, int write,
+		   void *buffer, size_t *lenp, loff_t *ppos)
+{
+	long val;
+	int err;
+	int i;
+
+	/*
+	 * The regular update, every sysctl_stat_interval, may come later
+	 * than expected: leaving a significant amount in per_cpu buckets.
+	 * This is particularly misleading when checking a quantity of HUGE
+	 * pages, immediately after running a test.  /proc/sys/vm/stat_refresh,
+	 * which can equally be echo'ed to or cat'ted from (by root),
+	 * can be used to update the stats just before reading them.
+	 *
+	 * Oh, and since global_zone_page_state() etc. are so careful to hide
+	 * transiently negative values, report an error here if any of
+	 * the stats is negative, so we know to go looking for imbalance.
+	 */
+	err = schedule_on_each_cpu(refresh_vm_stats);
+	if (err)
+		return err;
+	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
+		val = atomic_long_read(&vm_zone_stat[i]);
+		if (val < 0) {
+			pr_warn("%s: %s %ld\n",
+				__func__, zone_stat_name(i), val);
+			err = -EINVAL;
+		}
+	}
+#ifdef CONFIG_NUMA
+	for (i = 0; i < NR_VM_NUMA_STAT_ITEMS; i++) {
+		val = atomic_long_read(&vm_numa_stat[i]);
+		if (val < 0) {
+			pr_warn("%s: %s %ld\n",
+				__func__, numa_stat_name(i), val);
+			err = -EINVAL;
+		}
+	}
+#endif
+	if (err)
+		return err;
+	if (write)
+		*ppos += *lenp;
+	else
+		*lenp = 0;
+	return 0;
+}
+#endif /* CONFIG_PROC_FS */
+
+static void vmstat_update(struct work_struct *w)
+{
+	if (refresh_cpu_vm_stats(true)) {
+		/*
+		 * Counters were updated so we expect more updates
+		 * to occur in the future. Keep on running the
+		 * update worker thread.
+		 */
+		queue_delayed_work_on(smp_processor_id(), mm_percpu_wq,
+				this_cpu_ptr(&vmstat_work),
+				round_jiffies_relative(sysctl_stat_interval));
+	}
+}
+
+/*
+ * Switch off vmstat processing and then fold all the remaining differentials
+ * until the diffs stay at zero. The function is used by NOHZ and can only be
+ * invoked when tick processing is not active.
+ */
+/*
+ * Check if the diffs for a certain cpu indicate that
+ * an update is needed.
+ */
+static bool need_update(int cpu)
+{
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		struct per_cpu_pageset *p = per_cpu_ptr(zone->pageset, cpu);
+
+		BUILD_BUG_ON(sizeof(p->vm_stat_diff[0]) != 1);
+#ifdef CONFIG_NUMA
+		BUILD_BUG_ON(sizeof(p->vm_numa_stat_diff[0]) != 2);
+#endif
+
+		/*
+		 * The fast way of checking if there are any vmstat diffs.
+		 */
+		if (memchr_inv(p->vm_stat_diff, 0, NR_VM_ZONE_STAT_ITEMS *
+			       sizeof(p->vm_stat_diff[0])))
+			return true;
+#ifdef CONFIG_NUMA
+		if (memchr_inv(p->vm_numa_stat_diff, 0, NR_VM_NUMA_STAT_ITEMS *
+			       sizeof(p->vm_numa_stat_diff[0])))
+			return true;
+#endif
+	}
+	return false;
+}
+
+/*
+ * Switch off vmstat processing and then fold all the remaining differentials
+ * until the diffs stay at zero. The function is used by NOHZ and can only be
+ * invoked when tick processing is not active.
+ */
+void quiet_vmstat(void)
+{
+	if (system_state != SYSTEM_RUNNING)
+		return;
+
+	if (!delayed_work_pending(this_cpu_ptr(&vmstat_work)))
+		return;
+
+	if (!need_update(smp_processor_id()))
+		return;
+
+	/*
+	 * Just refresh counters and do not care about the pending delayed
+	 * vmstat_update. It doesn't fire that often to matter and canceling
+	 * it would be too expensive from this path.
+	 * vmstat_shepherd will take care about that for us.
+	 */
+	refresh_cpu_vm_stats(false);
+}
+EXPORT_SYMBOL(quiet_vmstat);
+
+/*
+ * Shepherd worker thread that checks the
+ * differentials of processors that have their worker
+ * threads for vm statistics updates disabled because of
+ * inactivity.
+ */
+static void vmstat_shepherd(struct work_struct *w);
+
+static DECLARE_DEFERRABLE_WORK(shepherd, vmstat_shepherd);
+
+static void vmstat_shepherd(struct work_struct *w)
+{
+	int cpu;
+
+	get_online_cpus();
+	/* Check processors whose vmstat worker threads have been disabled */
+	for_each_online_cpu(cpu) {
+		struct delayed_work *dw = &per_cpu(vmstat_work, cpu);
+
+		if (!delayed_work_pending(dw) && need_update(cpu))
+			queue_delayed_work_on(cpu, mm_percpu_wq, dw, 0);
+	}
+	put_online_cpus();
+
+	schedule_delayed_work(&shepherd,
+		round_jiffies_relative(sysctl_stat_interval));
+}
+
+static void __init start_shepherd_timer(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		INIT_DEFERRABLE_WORK(per_cpu_ptr(&vmstat_work, cpu),
+			vmstat_update);
+
+	schedule_delayed_work(&shepherd,
+		round_jiffies_relative(sysctl_stat_interval));
+}
+
+static void __init init_cpu_node_state(void)
+{
+	int node;
+
+	for_each_online_node(node) {
+		if (cpumask_weight(cpumask_of_node(node)) > 0)
+			node_set_state(node, N_CPU);
+	}
+}
+
+static int vmstat_cpu_online(unsigned int cpu)
+{
+	refresh_zone_stat_thresholds();
+	node_set_state(cpu_to_node(cpu), N_CPU);
+	return 0;
+}
+
+static int vmstat_cpu_down_prep(unsigned int cpu)
+{
+	cancel_delayed_work_sync(&per_cpu(vmstat_work, cpu));
+	return 0;
+}
+
+static int vmstat_cpu_dead(unsigned int cpu)
+{
+	const struct cpumask *node_cpus;
+	int node;
+
+	node = cpu_to_node(cpu);
+
+	refresh_zone_stat_thresholds();
+	node_cpus = cpumask_of_node(node);
+	if (cpumask_weight(node_cpus) > 0)
+		return 0;
+
+	node_clear_state(node, N_CPU);
+	return 0;
+}
+
+#endif
 
 struct workqueue_struct *mm_percpu_wq;
+EXPORT_SYMBOL(mm_percpu_wq);
 
 void __init init_mm_internals(void)
 {
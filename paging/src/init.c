@@ -148,7 +148,7 @@ __weak void drain_local_pages(struct zone *zone)
 }
 EXPORT_SYMBOL(drain_local_pages);
 
-__weak void free_unref_page(struct page *page)
+__weak void free_unref_page(struct page *page, unsigned int order)
 {
     booter_panic("No impl.");
 }
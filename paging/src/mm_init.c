@@ -146,6 +146,7 @@ EXPORT_SYMBOL_GPL(mm_kobj);
 
 #ifdef CONFIG_SMP
 s32 vm_committed_as_batch = 32;
+EXPORT_SYMBOL(vm_committed_as_batch);
 
 void mm_compute_batch(int overcommit_policy)
 {
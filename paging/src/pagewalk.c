@@ -430,6 +430,7 @@ int walk_page_range(struct mm_struct *mm, unsigned long start,
 	} while (start = next, start < end);
 	return err;
 }
+EXPORT_SYMBOL(walk_page_range);
 
 /*
  * Similar to walk_page_range() but can walk any page tables even if they are
@@ -129,6 +129,7 @@ int pmdp_clear_flush_young(struct vm_area_struct *vma,
 		flush_pmd_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
 	return young;
 }
+EXPORT_SYMBOL(pmdp_clear_flush_young);
 #endif
 
 #ifndef __HAVE_ARCH_PMDP_HUGE_CLEAR_FLUSH
@@ -143,6 +144,7 @@ pmd_t pmdp_huge_clear_flush(struct vm_area_struct *vma, unsigned long address,
 	flush_pmd_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
 	return pmd;
 }
+EXPORT_SYMBOL(pmdp_huge_clear_flush);
 
 #ifdef CONFIG_HAVE_ARCH_TRANSPARENT_HUGEPAGE_PUD
 pud_t pudp_huge_clear_flush(struct vm_area_struct *vma, unsigned long address,
@@ -172,6 +174,7 @@ void pgtable_trans_huge_deposit(struct mm_struct *mm, pmd_t *pmdp,
 		list_add(&pgtable->lru, &pmd_huge_pte(mm, pmdp)->lru);
 	pmd_huge_pte(mm, pmdp) = pgtable;
 }
+EXPORT_SYMBOL(pgtable_trans_huge_deposit);
 #endif
 
 #ifndef __HAVE_ARCH_PGTABLE_WITHDRAW
@@ -190,6 +193,7 @@ pgtable_t pgtable_trans_huge_withdraw(struct mm_struct *mm, pmd_t *pmdp)
 		list_del(&pgtable->lru);
 	return pgtable;
 }
+EXPORT_SYMBOL(pgtable_trans_huge_withdraw);
 #endif
 
 #ifndef __HAVE_ARCH_PMDP_INVALIDATE
@@ -200,6 +204,7 @@ pmd_t pmdp_invalidate(struct vm_area_struct *vma, unsigned long address,
 	flush_pmd_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
 	return old;
 }
+EXPORT_SYMBOL(pmdp_invalidate);
 #endif
 
 #ifndef pmdp_collapse_flush
@@ -220,5 +225,6 @@ pmd_t pmdp_collapse_flush(struct vm_area_struct *vma, unsigned long address,
 	flush_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
 	return pmd;
 }
+EXPORT_SYMBOL(pmdp_collapse_flush);
 #endif
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
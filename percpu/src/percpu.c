@@ -2597,505 +2597,505 @@ void __init pcpu_setup_first_chunk(const struct pcpu_alloc_info *ai,
 }
 
 #ifdef CONFIG_SMP
-//
-//const char * const pcpu_fc_names[PCPU_FC_NR] __initconst = {
-//	[PCPU_FC_AUTO]	= "auto",
-//	[PCPU_FC_EMBED]	= "embed",
-//	[PCPU_FC_PAGE]	= "page",
-//};
-//
-//enum pcpu_fc pcpu_chosen_fc __initdata = PCPU_FC_AUTO;
-//
-//static int __init percpu_alloc_setup(char *str)
-//{
-//	if (!str)
-//		return -EINVAL;
-//
-//	if (0)
-//		/* nada */;
-//#ifdef CONFIG_NEED_PER_CPU_EMBED_FIRST_CHUNK
-//	else if (!strcmp(str, "embed"))
-//		pcpu_chosen_fc = PCPU_FC_EMBED;
-//#endif
-//#ifdef CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK
-//	else if (!strcmp(str, "page"))
-//		pcpu_chosen_fc = PCPU_FC_PAGE;
-//#endif
-//	else
-//		pr_warn("unknown allocator %s specified\n", str);
-//
-//	return 0;
-//}
-//early_param("percpu_alloc", percpu_alloc_setup);
-//
-///*
-// * pcpu_embed_first_chunk() is used by the generic percpu setup.
-// * Build it if needed by the arch config or the generic setup is going
-// * to be used.
-// */
-//#if defined(CONFIG_NEED_PER_CPU_EMBED_FIRST_CHUNK) || \
-//	!defined(CONFIG_HAVE_SETUP_PER_CPU_AREA)
-//#define BUILD_EMBED_FIRST_CHUNK
-//#endif
-//
-///* build pcpu_page_first_chunk() iff needed by the arch config */
-//#if defined(CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK)
-//#define BUILD_PAGE_FIRST_CHUNK
-//#endif
-//
-///* pcpu_build_alloc_info() is used by both embed and page first chunk */
-//#if defined(BUILD_EMBED_FIRST_CHUNK) || defined(BUILD_PAGE_FIRST_CHUNK)
-///**
-// * pcpu_build_alloc_info - build alloc_info considering distances between CPUs
-// * @reserved_size: the size of reserved percpu area in bytes
-// * @dyn_size: minimum free size for dynamic allocation in bytes
-// * @atom_size: allocation atom size
-// * @cpu_distance_fn: callback to determine distance between cpus, optional
-// *
-// * This function determines grouping of units, their mappings to cpus
-// * and other parameters considering needed percpu size, allocation
-// * atom size and distances between CPUs.
-// *
-// * Groups are always multiples of atom size and CPUs which are of
-// * LOCAL_DISTANCE both ways are grouped together and share space for
-// * units in the same group.  The returned configuration is guaranteed
-// * to have CPUs on different nodes on different groups and >=75% usage
-// * of allocated virtual address space.
-// *
-// * RETURNS:
-// * On success, pointer to the new allocation_info is returned.  On
-// * failure, ERR_PTR value is returned.
-// */
-//static struct pcpu_alloc_info * __init pcpu_build_alloc_info(
-//				size_t reserved_size, size_t dyn_size,
-//				size_t atom_size,
-//				pcpu_fc_cpu_distance_fn_t cpu_distance_fn)
-//{
-//	static int group_map[NR_CPUS] __initdata;
-//	static int group_cnt[NR_CPUS] __initdata;
-//	const size_t static_size = __per_cpu_end - __per_cpu_start;
-//	int nr_groups = 1, nr_units = 0;
-//	size_t size_sum, min_unit_size, alloc_size;
-//	int upa, max_upa, best_upa;	/* units_per_alloc */
-//	int last_allocs, group, unit;
-//	unsigned int cpu, tcpu;
-//	struct pcpu_alloc_info *ai;
-//	unsigned int *cpu_map;
-//
-//	/* this function may be called multiple times */
-//	memset(group_map, 0, sizeof(group_map));
-//	memset(group_cnt, 0, sizeof(group_cnt));
-//
-//	/* calculate size_sum and ensure dyn_size is enough for early alloc */
-//	size_sum = PFN_ALIGN(static_size + reserved_size +
-//			    max_t(size_t, dyn_size, PERCPU_DYNAMIC_EARLY_SIZE));
-//	dyn_size = size_sum - static_size - reserved_size;
-//
-//	/*
-//	 * Determine min_unit_size, alloc_size and max_upa such that
-//	 * alloc_size is multiple of atom_size and is the smallest
-//	 * which can accommodate 4k aligned segments which are equal to
-//	 * or larger than min_unit_size.
-//	 */
-//	min_unit_size = max_t(size_t, size_sum, PCPU_MIN_UNIT_SIZE);
-//
-//	/* determine the maximum # of units that can fit in an allocation */
-//	alloc_size = roundup(min_unit_size, atom_size);
-//	upa = alloc_size / min_unit_size;
-//	while (alloc_size % upa || (offset_in_page(alloc_size / upa)))
-//		upa--;
-//	max_upa = upa;
-//
-//	/* group cpus according to their proximity */
-//	for_each_possible_cpu(cpu) {
-//		group = 0;
-//	next_group:
-//		for_each_possible_cpu(tcpu) {
-//			if (cpu == tcpu)
-//				break;
-//			if (group_map[tcpu] == group && cpu_distance_fn &&
-//			    (cpu_distance_fn(cpu, tcpu) > LOCAL_DISTANCE ||
-//			     cpu_distance_fn(tcpu, cpu) > LOCAL_DISTANCE)) {
-//				group++;
-//				nr_groups = max(nr_groups, group + 1);
-//				goto next_group;
-//			}
-//		}
-//		group_map[cpu] = group;
-//		group_cnt[group]++;
-//	}
-//
-//	/*
-//	 * Wasted space is caused by a ratio imbalance of upa to group_cnt.
-//	 * Expand the unit_size until we use >= 75% of the units allocated.
-//	 * Related to atom_size, which could be much larger than the unit_size.
-//	 */
-//	last_allocs = INT_MAX;
-//	for (upa = max_upa; upa; upa--) {
-//		int allocs = 0, wasted = 0;
-//
-//		if (alloc_size % upa || (offset_in_page(alloc_size / upa)))
-//			continue;
-//
-//		for (group = 0; group < nr_groups; group++) {
-//			int this_allocs = DIV_ROUND_UP(group_cnt[group], upa);
-//			allocs += this_allocs;
-//			wasted += this_allocs * upa - group_cnt[group];
-//		}
-//
-//		/*
-//		 * Don't accept if wastage is over 1/3.  The
-//		 * greater-than comparison ensures upa==1 always
-//		 * passes the following check.
-//		 */
-//		if (wasted > num_possible_cpus() / 3)
-//			continue;
-//
-//		/* and then don't consume more memory */
-//		if (allocs > last_allocs)
-//			break;
-//		last_allocs = allocs;
-//		best_upa = upa;
-//	}
-//	upa = best_upa;
-//
-//	/* allocate and fill alloc_info */
-//	for (group = 0; group < nr_groups; group++)
-//		nr_units += roundup(group_cnt[group], upa);
-//
-//	ai = pcpu_alloc_alloc_info(nr_groups, nr_units);
-//	if (!ai)
-//		return ERR_PTR(-ENOMEM);
-//	cpu_map = ai->groups[0].cpu_map;
-//
-//	for (group = 0; group < nr_groups; group++) {
-//		ai->groups[group].cpu_map = cpu_map;
-//		cpu_map += roundup(group_cnt[group], upa);
-//	}
-//
-//	ai->static_size = static_size;
-//	ai->reserved_size = reserved_size;
-//	ai->dyn_size = dyn_size;
-//	ai->unit_size = alloc_size / upa;
-//	ai->atom_size = atom_size;
-//	ai->alloc_size = alloc_size;
-//
-//	for (group = 0, unit = 0; group < nr_groups; group++) {
-//		struct pcpu_group_info *gi = &ai->groups[group];
-//
-//		/*
-//		 * Initialize base_offset as if all groups are located
-//		 * back-to-back.  The caller should update this to
-//		 * reflect actual allocation.
-//		 */
-//		gi->base_offset = unit * ai->unit_size;
-//
-//		for_each_possible_cpu(cpu)
-//			if (group_map[cpu] == group)
-//				gi->cpu_map[gi->nr_units++] = cpu;
-//		gi->nr_units = roundup(gi->nr_units, upa);
-//		unit += gi->nr_units;
-//	}
-//	BUG_ON(unit != nr_units);
-//
-//	return ai;
-//}
-//#endif /* BUILD_EMBED_FIRST_CHUNK || BUILD_PAGE_FIRST_CHUNK */
-//
-//#if defined(BUILD_EMBED_FIRST_CHUNK)
-///**
-// * pcpu_embed_first_chunk - embed the first percpu chunk into bootmem
-// * @reserved_size: the size of reserved percpu area in bytes
-// * @dyn_size: minimum free size for dynamic allocation in bytes
-// * @atom_size: allocation atom size
-// * @cpu_distance_fn: callback to determine distance between cpus, optional
-// * @alloc_fn: function to allocate percpu page
-// * @free_fn: function to free percpu page
-// *
-// * This is a helper to ease setting up embedded first percpu chunk and
-// * can be called where pcpu_setup_first_chunk() is expected.
-// *
-// * If this function is used to setup the first chunk, it is allocated
-// * by calling @alloc_fn and used as-is without being mapped into
-// * vmalloc area.  Allocations are always whole multiples of @atom_size
-// * aligned to @atom_size.
-// *
-// * This enables the first chunk to piggy back on the linear physical
-// * mapping which often uses larger page size.  Please note that this
-// * can result in very sparse cpu->unit mapping on NUMA machines thus
-// * requiring large vmalloc address space.  Don't use this allocator if
-// * vmalloc space is not orders of magnitude larger than distances
-// * between node memory addresses (ie. 32bit NUMA machines).
-// *
-// * @dyn_size specifies the minimum dynamic area size.
-// *
-// * If the needed size is smaller than the minimum or specified unit
-// * size, the leftover is returned using @free_fn.
-// *
-// * RETURNS:
-// * 0 on success, -errno on failure.
-// */
-//int __init pcpu_embed_first_chunk(size_t reserved_size, size_t dyn_size,
-//				  size_t atom_size,
-//				  pcpu_fc_cpu_distance_fn_t cpu_distance_fn,
-//				  pcpu_fc_alloc_fn_t alloc_fn,
-//				  pcpu_fc_free_fn_t free_fn)
-//{
-//	void *base = (void *)ULONG_MAX;
-//	void **areas = NULL;
-//	struct pcpu_alloc_info *ai;
-//	size_t size_sum, areas_size;
-//	unsigned long max_distance;
-//	int group, i, highest_group, rc = 0;
-//
-//	ai = pcpu_build_alloc_info(reserved_size, dyn_size, atom_size,
-//				   cpu_distance_fn);
-//	if (IS_ERR(ai))
-//		return PTR_ERR(ai);
-//
-//	size_sum = ai->static_size + ai->reserved_size + ai->dyn_size;
-//	areas_size = PFN_ALIGN(ai->nr_groups * sizeof(void *));
-//
-//	areas = memblock_alloc(areas_size, SMP_CACHE_BYTES);
-//	if (!areas) {
-//		rc = -ENOMEM;
-//		goto out_free;
-//	}
-//
-//	/* allocate, copy and determine base address & max_distance */
-//	highest_group = 0;
-//	for (group = 0; group < ai->nr_groups; group++) {
-//		struct pcpu_group_info *gi = &ai->groups[group];
-//		unsigned int cpu = NR_CPUS;
-//		void *ptr;
-//
-//		for (i = 0; i < gi->nr_units && cpu == NR_CPUS; i++)
-//			cpu = gi->cpu_map[i];
-//		BUG_ON(cpu == NR_CPUS);
-//
-//		/* allocate space for the whole group */
-//		ptr = alloc_fn(cpu, gi->nr_units * ai->unit_size, atom_size);
-//		if (!ptr) {
-//			rc = -ENOMEM;
-//			goto out_free_areas;
-//		}
-//		/* kmemleak tracks the percpu allocations separately */
-//		kmemleak_free(ptr);
-//		areas[group] = ptr;
-//
-//		base = min(ptr, base);
-//		if (ptr > areas[highest_group])
-//			highest_group = group;
-//	}
-//	max_distance = areas[highest_group] - base;
-//	max_distance += ai->unit_size * ai->groups[highest_group].nr_units;
-//
-//	/* warn if maximum distance is further than 75% of vmalloc space */
-//	if (max_distance > VMALLOC_TOTAL * 3 / 4) {
-//		pr_warn("max_distance=0x%lx too large for vmalloc space 0x%lx\n",
-//				max_distance, VMALLOC_TOTAL);
-//#ifdef CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK
-//		/* and fail if we have fallback */
-//		rc = -EINVAL;
-//		goto out_free_areas;
-//#endif
-//	}
-//
-//	/*
-//	 * Copy data and free unused parts.  This should happen after all
-//	 * allocations are complete; otherwise, we may end up with
-//	 * overlapping groups.
-//	 */
-//	for (group = 0; group < ai->nr_groups; group++) {
-//		struct pcpu_group_info *gi = &ai->groups[group];
-//		void *ptr = areas[group];
-//
-//		for (i = 0; i < gi->nr_units; i++, ptr += ai->unit_size) {
-//			if (gi->cpu_map[i] == NR_CPUS) {
-//				/* unused unit, free whole */
-//				free_fn(ptr, ai->unit_size);
-//				continue;
-//			}
-//			/* copy and return the unused part */
-//			memcpy(ptr, __per_cpu_load, ai->static_size);
-//			free_fn(ptr + size_sum, ai->unit_size - size_sum);
-//		}
-//	}
-//
-//	/* base address is now known, determine group base offsets */
-//	for (group = 0; group < ai->nr_groups; group++) {
-//		ai->groups[group].base_offset = areas[group] - base;
-//	}
-//
-//	pr_info("Embedded %zu pages/cpu s%zu r%zu d%zu u%zu\n",
-//		PFN_DOWN(size_sum), ai->static_size, ai->reserved_size,
-//		ai->dyn_size, ai->unit_size);
-//
-//	pcpu_setup_first_chunk(ai, base);
-//	goto out_free;
-//
-//out_free_areas:
-//	for (group = 0; group < ai->nr_groups; group++)
-//		if (areas[group])
-//			free_fn(areas[group],
-//				ai->groups[group].nr_units * ai->unit_size);
-//out_free:
-//	pcpu_free_alloc_info(ai);
-//	if (areas)
-//		memblock_free_early(__pa(areas), areas_size);
-//	return rc;
-//}
-//#endif /* BUILD_EMBED_FIRST_CHUNK */
-//
-//#ifdef BUILD_PAGE_FIRST_CHUNK
-///**
-// * pcpu_page_first_chunk - map the first chunk using PAGE_SIZE pages
-// * @reserved_size: the size of reserved percpu area in bytes
-// * @alloc_fn: function to allocate percpu page, always called with PAGE_SIZE
-// * @free_fn: function to free percpu page, always called with PAGE_SIZE
-// * @populate_pte_fn: function to populate pte
-// *
-// * This is a helper to ease setting up page-remapped first percpu
-// * chunk and can be called where pcpu_setup_first_chunk() is expected.
-// *
-// * This is the basic allocator.  Static percpu area is allocated
-// * page-by-page into vmalloc area.
-// *
-// * RETURNS:
-// * 0 on success, -errno on failure.
-// */
-//int __init pcpu_page_first_chunk(size_t reserved_size,
-//				 pcpu_fc_alloc_fn_t alloc_fn,
-//				 pcpu_fc_free_fn_t free_fn,
-//				 pcpu_fc_populate_pte_fn_t populate_pte_fn)
-//{
-//	static struct vm_struct vm;
-//	struct pcpu_alloc_info *ai;
-//	char psize_str[16];
-//	int unit_pages;
-//	size_t pages_size;
-//	struct page **pages;
-//	int unit, i, j, rc = 0;
-//	int upa;
-//	int nr_g0_units;
-//
-//	snprintf(psize_str, sizeof(psize_str), "%luK", PAGE_SIZE >> 10);
-//
-//	ai = pcpu_build_alloc_info(reserved_size, 0, PAGE_SIZE, NULL);
-//	if (IS_ERR(ai))
-//		return PTR_ERR(ai);
-//	BUG_ON(ai->nr_groups != 1);
-//	upa = ai->alloc_size/ai->unit_size;
-//	nr_g0_units = roundup(num_possible_cpus(), upa);
-//	if (WARN_ON(ai->groups[0].nr_units != nr_g0_units)) {
-//		pcpu_free_alloc_info(ai);
-//		return -EINVAL;
-//	}
-//
-//	unit_pages = ai->unit_size >> PAGE_SHIFT;
-//
-//	/* unaligned allocations can't be freed, round up to page size */
-//	pages_size = PFN_ALIGN(unit_pages * num_possible_cpus() *
-//			       sizeof(pages[0]));
-//	pages = memblock_alloc(pages_size, SMP_CACHE_BYTES);
-//	if (!pages)
-//		panic("%s: Failed to allocate %zu bytes\n", __func__,
-//		      pages_size);
-//
-//	/* allocate pages */
-//	j = 0;
-//	for (unit = 0; unit < num_possible_cpus(); unit++) {
-//		unsigned int cpu = ai->groups[0].cpu_map[unit];
-//		for (i = 0; i < unit_pages; i++) {
-//			void *ptr;
-//
-//			ptr = alloc_fn(cpu, PAGE_SIZE, PAGE_SIZE);
-//			if (!ptr) {
-//				pr_warn("failed to allocate %s page for cpu%u\n",
-//						psize_str, cpu);
-//				goto enomem;
-//			}
-//			/* kmemleak tracks the percpu allocations separately */
-//			kmemleak_free(ptr);
-//			pages[j++] = virt_to_page(ptr);
-//		}
-//	}
-//
-//	/* allocate vm area, map the pages and copy static data */
-//	vm.flags = VM_ALLOC;
-//	vm.size = num_possible_cpus() * ai->unit_size;
-//	vm_area_register_early(&vm, PAGE_SIZE);
-//
-//	for (unit = 0; unit < num_possible_cpus(); unit++) {
-//		unsigned long unit_addr =
-//			(unsigned long)vm.addr + unit * ai->unit_size;
-//
-//		for (i = 0; i < unit_pages; i++)
-//			populate_pte_fn(unit_addr + (i << PAGE_SHIFT));
-//
-//		/* pte already populated, the following shouldn't fail */
-//		rc = __pcpu_map_pages(unit_addr, &pages[unit * unit_pages],
-//				      unit_pages);
-//		if (rc < 0)
-//			panic("failed to map percpu area, err=%d\n", rc);
-//
-//		/*
-//		 * FIXME: Archs with virtual cache should flush local
-//		 * cache for the linear mapping here - something
-//		 * equivalent to flush_cache_vmap() on the local cpu.
-//		 * flush_cache_vmap() can't be used as most supporting
-//		 * data structures are not set up yet.
-//		 */
-//
-//		/* copy static data */
-//		memcpy((void *)unit_addr, __per_cpu_load, ai->static_size);
-//	}
-//
-//	/* we're ready, commit */
-//	pr_info("%d %s pages/cpu s%zu r%zu d%zu\n",
-//		unit_pages, psize_str, ai->static_size,
-//		ai->reserved_size, ai->dyn_size);
-//
-//	pcpu_setup_first_chunk(ai, vm.addr);
-//	goto out_free_ar;
-//
-//enomem:
-//	while (--j >= 0)
-//		free_fn(page_address(pages[j]), PAGE_SIZE);
-//	rc = -ENOMEM;
-//out_free_ar:
-//	memblock_free_early(__pa(pages), pages_size);
-//	pcpu_free_alloc_info(ai);
-//	return rc;
-//}
-//#endif /* BUILD_PAGE_FIRST_CHUNK */
-//
+
+const char * const pcpu_fc_names[PCPU_FC_NR] __initconst = {
+	[PCPU_FC_AUTO]	= "auto",
+	[PCPU_FC_EMBED]	= "embed",
+	[PCPU_FC_PAGE]	= "page",
+};
+
+enum pcpu_fc pcpu_chosen_fc __initdata = PCPU_FC_AUTO;
+
+static int __init percpu_alloc_setup(char *str)
+{
+	if (!str)
+		return -EINVAL;
+
+	if (0)
+		/* nada */;
+#ifdef CONFIG_NEED_PER_CPU_EMBED_FIRST_CHUNK
+	else if (!strcmp(str, "embed"))
+		pcpu_chosen_fc = PCPU_FC_EMBED;
+#endif
+#ifdef CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK
+	else if (!strcmp(str, "page"))
+		pcpu_chosen_fc = PCPU_FC_PAGE;
+#endif
+	else
+		pr_warn("unknown allocator %s specified\n", str);
+
+	return 0;
+}
+early_param("percpu_alloc", percpu_alloc_setup);
+
+/*
+ * pcpu_embed_first_chunk() is used by the generic percpu setup.
+ * Build it if needed by the arch config or the generic setup is going
+ * to be used.
+ */
+#if defined(CONFIG_NEED_PER_CPU_EMBED_FIRST_CHUNK) || \
+	!defined(CONFIG_HAVE_SETUP_PER_CPU_AREA)
+#define BUILD_EMBED_FIRST_CHUNK
+#endif
+
+/* build pcpu_page_first_chunk() iff needed by the arch config */
+#if defined(CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK)
+#define BUILD_PAGE_FIRST_CHUNK
+#endif
+
+/* pcpu_build_alloc_info() is used by both embed and page first chunk */
+#if defined(BUILD_EMBED_FIRST_CHUNK) || defined(BUILD_PAGE_FIRST_CHUNK)
+/**
+ * pcpu_build_alloc_info - build alloc_info considering distances between CPUs
+ * @reserved_size: the size of reserved percpu area in bytes
+ * @dyn_size: minimum free size for dynamic allocation in bytes
+ * @atom_size: allocation atom size
+ * @cpu_distance_fn: callback to determine distance between cpus, optional
+ *
+ * This function determines grouping of units, their mappings to cpus
+ * and other parameters considering needed percpu size, allocation
+ * atom size and distances between CPUs.
+ *
+ * Groups are always multiples of atom size and CPUs which are of
+ * LOCAL_DISTANCE both ways are grouped together and share space for
+ * units in the same group.  The returned configuration is guaranteed
+ * to have CPUs on different nodes on different groups and >=75% usage
+ * of allocated virtual address space.
+ *
+ * RETURNS:
+ * On success, pointer to the new allocation_info is returned.  On
+ * failure, ERR_PTR value is returned.
+ */
+static struct pcpu_alloc_info * __init pcpu_build_alloc_info(
+				size_t reserved_size, size_t dyn_size,
+				size_t atom_size,
+				pcpu_fc_cpu_distance_fn_t cpu_distance_fn)
+{
+	static int group_map[NR_CPUS] __initdata;
+	static int group_cnt[NR_CPUS] __initdata;
+	const size_t static_size = __per_cpu_end - __per_cpu_start;
+	int nr_groups = 1, nr_units = 0;
+	size_t size_sum, min_unit_size, alloc_size;
+	int upa, max_upa, best_upa;	/* units_per_alloc */
+	int last_allocs, group, unit;
+	unsigned int cpu, tcpu;
+	struct pcpu_alloc_info *ai;
+	unsigned int *cpu_map;
+
+	/* this function may be called multiple times */
+	memset(group_map, 0, sizeof(group_map));
+	memset(group_cnt, 0, sizeof(group_cnt));
+
+	/* calculate size_sum and ensure dyn_size is enough for early alloc */
+	size_sum = PFN_ALIGN(static_size + reserved_size +
+			    max_t(size_t, dyn_size, PERCPU_DYNAMIC_EARLY_SIZE));
+	dyn_size = size_sum - static_size - reserved_size;
+
+	/*
+	 * Determine min_unit_size, alloc_size and max_upa such that
+	 * alloc_size is multiple of atom_size and is the smallest
+	 * which can accommodate 4k aligned segments which are equal to
+	 * or larger than min_unit_size.
+	 */
+	min_unit_size = max_t(size_t, size_sum, PCPU_MIN_UNIT_SIZE);
+
+	/* determine the maximum # of units that can fit in an allocation */
+	alloc_size = roundup(min_unit_size, atom_size);
+	upa = alloc_size / min_unit_size;
+	while (alloc_size % upa || (offset_in_page(alloc_size / upa)))
+		upa--;
+	max_upa = upa;
+
+	/* group cpus according to their proximity */
+	for_each_possible_cpu(cpu) {
+		group = 0;
+	next_group:
+		for_each_possible_cpu(tcpu) {
+			if (cpu == tcpu)
+				break;
+			if (group_map[tcpu] == group && cpu_distance_fn &&
+			    (cpu_distance_fn(cpu, tcpu) > LOCAL_DISTANCE ||
+			     cpu_distance_fn(tcpu, cpu) > LOCAL_DISTANCE)) {
+				group++;
+				nr_groups = max(nr_groups, group + 1);
+				goto next_group;
+			}
+		}
+		group_map[cpu] = group;
+		group_cnt[group]++;
+	}
+
+	/*
+	 * Wasted space is caused by a ratio imbalance of upa to group_cnt.
+	 * Expand the unit_size until we use >= 75% of the units allocated.
+	 * Related to atom_size, which could be much larger than the unit_size.
+	 */
+	last_allocs = INT_MAX;
+	for (upa = max_upa; upa; upa--) {
+		int allocs = 0, wasted = 0;
+
+		if (alloc_size % upa || (offset_in_page(alloc_size / upa)))
+			continue;
+
+		for (group = 0; group < nr_groups; group++) {
+			int this_allocs = DIV_ROUND_UP(group_cnt[group], upa);
+			allocs += this_allocs;
+			wasted += this_allocs * upa - group_cnt[group];
+		}
+
+		/*
+		 * Don't accept if wastage is over 1/3.  The
+		 * greater-than comparison ensures upa==1 always
+		 * passes the following check.
+		 */
+		if (wasted > num_possible_cpus() / 3)
+			continue;
+
+		/* and then don't consume more memory */
+		if (allocs > last_allocs)
+			break;
+		last_allocs = allocs;
+		best_upa = upa;
+	}
+	upa = best_upa;
+
+	/* allocate and fill alloc_info */
+	for (group = 0; group < nr_groups; group++)
+		nr_units += roundup(group_cnt[group], upa);
+
+	ai = pcpu_alloc_alloc_info(nr_groups, nr_units);
+	if (!ai)
+		return ERR_PTR(-ENOMEM);
+	cpu_map = ai->groups[0].cpu_map;
+
+	for (group = 0; group < nr_groups; group++) {
+		ai->groups[group].cpu_map = cpu_map;
+		cpu_map += roundup(group_cnt[group], upa);
+	}
+
+	ai->static_size = static_size;
+	ai->reserved_size = reserved_size;
+	ai->dyn_size = dyn_size;
+	ai->unit_size = alloc_size / upa;
+	ai->atom_size = atom_size;
+	ai->alloc_size = alloc_size;
+
+	for (group = 0, unit = 0; group < nr_groups; group++) {
+		struct pcpu_group_info *gi = &ai->groups[group];
+
+		/*
+		 * Initialize base_offset as if all groups are located
+		 * back-to-back.  The caller should update this to
+		 * reflect actual allocation.
+		 */
+		gi->base_offset = unit * ai->unit_size;
+
+		for_each_possible_cpu(cpu)
+			if (group_map[cpu] == group)
+				gi->cpu_map[gi->nr_units++] = cpu;
+		gi->nr_units = roundup(gi->nr_units, upa);
+		unit += gi->nr_units;
+	}
+	BUG_ON(unit != nr_units);
+
+	return ai;
+}
+#endif /* BUILD_EMBED_FIRST_CHUNK || BUILD_PAGE_FIRST_CHUNK */
+
+#if defined(BUILD_EMBED_FIRST_CHUNK)
+/**
+ * pcpu_embed_first_chunk - embed the first percpu chunk into bootmem
+ * @reserved_size: the size of reserved percpu area in bytes
+ * @dyn_size: minimum free size for dynamic allocation in bytes
+ * @atom_size: allocation atom size
+ * @cpu_distance_fn: callback to determine distance between cpus, optional
+ * @alloc_fn: function to allocate percpu page
+ * @free_fn: function to free percpu page
+ *
+ * This is a helper to ease setting up embedded first percpu chunk and
+ * can be called where pcpu_setup_first_chunk() is expected.
+ *
+ * If this function is used to setup the first chunk, it is allocated
+ * by calling @alloc_fn and used as-is without being mapped into
+ * vmalloc area.  Allocations are always whole multiples of @atom_size
+ * aligned to @atom_size.
+ *
+ * This enables the first chunk to piggy back on the linear physical
+ * mapping which often uses larger page size.  Please note that this
+ * can result in very sparse cpu->unit mapping on NUMA machines thus
+ * requiring large vmalloc address space.  Don't use this allocator if
+ * vmalloc space is not orders of magnitude larger than distances
+ * between node memory addresses (ie. 32bit NUMA machines).
+ *
+ * @dyn_size specifies the minimum dynamic area size.
+ *
+ * If the needed size is smaller than the minimum or specified unit
+ * size, the leftover is returned using @free_fn.
+ *
+ * RETURNS:
+ * 0 on success, -errno on failure.
+ */
+int __init pcpu_embed_first_chunk(size_t reserved_size, size_t dyn_size,
+				  size_t atom_size,
+				  pcpu_fc_cpu_distance_fn_t cpu_distance_fn,
+				  pcpu_fc_alloc_fn_t alloc_fn,
+				  pcpu_fc_free_fn_t free_fn)
+{
+	void *base = (void *)ULONG_MAX;
+	void **areas = NULL;
+	struct pcpu_alloc_info *ai;
+	size_t size_sum, areas_size;
+	unsigned long max_distance;
+	int group, i, highest_group, rc = 0;
+
+	ai = pcpu_build_alloc_info(reserved_size, dyn_size, atom_size,
+				   cpu_distance_fn);
+	if (IS_ERR(ai))
+		return PTR_ERR(ai);
+
+	size_sum = ai->static_size + ai->reserved_size + ai->dyn_size;
+	areas_size = PFN_ALIGN(ai->nr_groups * sizeof(void *));
+
+	areas = memblock_alloc(areas_size, SMP_CACHE_BYTES);
+	if (!areas) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
+	/* allocate, copy and determine base address & max_distance */
+	highest_group = 0;
+	for (group = 0; group < ai->nr_groups; group++) {
+		struct pcpu_group_info *gi = &ai->groups[group];
+		unsigned int cpu = NR_CPUS;
+		void *ptr;
+
+		for (i = 0; i < gi->nr_units && cpu == NR_CPUS; i++)
+			cpu = gi->cpu_map[i];
+		BUG_ON(cpu == NR_CPUS);
+
+		/* allocate space for the whole group */
+		ptr = alloc_fn(cpu, gi->nr_units * ai->unit_size, atom_size);
+		if (!ptr) {
+			rc = -ENOMEM;
+			goto out_free_areas;
+		}
+		/* kmemleak tracks the percpu allocations separately */
+		kmemleak_free(ptr);
+		areas[group] = ptr;
+
+		base = min(ptr, base);
+		if (ptr > areas[highest_group])
+			highest_group = group;
+	}
+	max_distance = areas[highest_group] - base;
+	max_distance += ai->unit_size * ai->groups[highest_group].nr_units;
+
+	/* warn if maximum distance is further than 75% of vmalloc space */
+	if (max_distance > VMALLOC_TOTAL * 3 / 4) {
+		pr_warn("max_distance=0x%lx too large for vmalloc space 0x%lx\n",
+				max_distance, VMALLOC_TOTAL);
+#ifdef CONFIG_NEED_PER_CPU_PAGE_FIRST_CHUNK
+		/* and fail if we have fallback */
+		rc = -EINVAL;
+		goto out_free_areas;
+#endif
+	}
+
+	/*
+	 * Copy data and free unused parts.  This should happen after all
+	 * allocations are complete; otherwise, we may end up with
+	 * overlapping groups.
+	 */
+	for (group = 0; group < ai->nr_groups; group++) {
+		struct pcpu_group_info *gi = &ai->groups[group];
+		void *ptr = areas[group];
+
+		for (i = 0; i < gi->nr_units; i++, ptr += ai->unit_size) {
+			if (gi->cpu_map[i] == NR_CPUS) {
+				/* unused unit, free whole */
+				free_fn(ptr, ai->unit_size);
+				continue;
+			}
+			/* copy and return the unused part */
+			memcpy(ptr, __per_cpu_load, ai->static_size);
+			free_fn(ptr + size_sum, ai->unit_size - size_sum);
+		}
+	}
+
+	/* base address is now known, determine group base offsets */
+	for (group = 0; group < ai->nr_groups; group++) {
+		ai->groups[group].base_offset = areas[group] - base;
+	}
+
+	pr_info("Embedded %zu pages/cpu s%zu r%zu d%zu u%zu\n",
+		PFN_DOWN(size_sum), ai->static_size, ai->reserved_size,
+		ai->dyn_size, ai->unit_size);
+
+	pcpu_setup_first_chunk(ai, base);
+	goto out_free;
+
+out_free_areas:
+	for (group = 0; group < ai->nr_groups; group++)
+		if (areas[group])
+			free_fn(areas[group],
+				ai->groups[group].nr_units * ai->unit_size);
+out_free:
+	pcpu_free_alloc_info(ai);
+	if (areas)
+		memblock_free_early(__pa(areas), areas_size);
+	return rc;
+}
+#endif /* BUILD_EMBED_FIRST_CHUNK */
+
+#ifdef BUILD_PAGE_FIRST_CHUNK
+/**
+ * pcpu_page_first_chunk - map the first chunk using PAGE_SIZE pages
+ * @reserved_size: the size of reserved percpu area in bytes
+ * @alloc_fn: function to allocate percpu page, always called with PAGE_SIZE
+ * @free_fn: function to free percpu page, always called with PAGE_SIZE
+ * @populate_pte_fn: function to populate pte
+ *
+ * This is a helper to ease setting up page-remapped first percpu
+ * chunk and can be called where pcpu_setup_first_chunk() is expected.
+ *
+ * This is the basic allocator.  Static percpu area is allocated
+ * page-by-page into vmalloc area.
+ *
+ * RETURNS:
+ * 0 on success, -errno on failure.
+ */
+int __init pcpu_page_first_chunk(size_t reserved_size,
+				 pcpu_fc_alloc_fn_t alloc_fn,
+				 pcpu_fc_free_fn_t free_fn,
+				 pcpu_fc_populate_pte_fn_t populate_pte_fn)
+{
+	static struct vm_struct vm;
+	struct pcpu_alloc_info *ai;
+	char psize_str[16];
+	int unit_pages;
+	size_t pages_size;
+	struct page **pages;
+	int unit, i, j, rc = 0;
+	int upa;
+	int nr_g0_units;
+
+	snprintf(psize_str, sizeof(psize_str), "%luK", PAGE_SIZE >> 10);
+
+	ai = pcpu_build_alloc_info(reserved_size, 0, PAGE_SIZE, NULL);
+	if (IS_ERR(ai))
+		return PTR_ERR(ai);
+	BUG_ON(ai->nr_groups != 1);
+	upa = ai->alloc_size/ai->unit_size;
+	nr_g0_units = roundup(num_possible_cpus(), upa);
+	if (WARN_ON(ai->groups[0].nr_units != nr_g0_units)) {
+		pcpu_free_alloc_info(ai);
+		return -EINVAL;
+	}
+
+	unit_pages = ai->unit_size >> PAGE_SHIFT;
+
+	/* unaligned allocations can't be freed, round up to page size */
+	pages_size = PFN_ALIGN(unit_pages * num_possible_cpus() *
+			       sizeof(pages[0]));
+	pages = memblock_alloc(pages_size, SMP_CACHE_BYTES);
+	if (!pages)
+		panic("%s: Failed to allocate %zu bytes\n", __func__,
+		      pages_size);
+
+	/* allocate pages */
+	j = 0;
+	for (unit = 0; unit < num_possible_cpus(); unit++) {
+		unsigned int cpu = ai->groups[0].cpu_map[unit];
+		for (i = 0; i < unit_pages; i++) {
+			void *ptr;
+
+			ptr = alloc_fn(cpu, PAGE_SIZE, PAGE_SIZE);
+			if (!ptr) {
+				pr_warn("failed to allocate %s page for cpu%u\n",
+						psize_str, cpu);
+				goto enomem;
+			}
+			/* kmemleak tracks the percpu allocations separately */
+			kmemleak_free(ptr);
+			pages[j++] = virt_to_page(ptr);
+		}
+	}
+
+	/* allocate vm area, map the pages and copy static data */
+	vm.flags = VM_ALLOC;
+	vm.size = num_possible_cpus() * ai->unit_size;
+	vm_area_register_early(&vm, PAGE_SIZE);
+
+	for (unit = 0; unit < num_possible_cpus(); unit++) {
+		unsigned long unit_addr =
+			(unsigned long)vm.addr + unit * ai->unit_size;
+
+		for (i = 0; i < unit_pages; i++)
+			populate_pte_fn(unit_addr + (i << PAGE_SHIFT));
+
+		/* pte already populated, the following shouldn't fail */
+		rc = __pcpu_map_pages(unit_addr, &pages[unit * unit_pages],
+				      unit_pages);
+		if (rc < 0)
+			panic("failed to map percpu area, err=%d\n", rc);
+
+		/*
+		 * FIXME: Archs with virtual cache should flush local
+		 * cache for the linear mapping here - something
+		 * equivalent to flush_cache_vmap() on the local cpu.
+		 * flush_cache_vmap() can't be used as most supporting
+		 * data structures are not set up yet.
+		 */
+
+		/* copy static data */
+		memcpy((void *)unit_addr, __per_cpu_load, ai->static_size);
+	}
+
+	/* we're ready, commit */
+	pr_info("%d %s pages/cpu s%zu r%zu d%zu\n",
+		unit_pages, psize_str, ai->static_size,
+		ai->reserved_size, ai->dyn_size);
+
+	pcpu_setup_first_chunk(ai, vm.addr);
+	goto out_free_ar;
+
+enomem:
+	while (--j >= 0)
+		free_fn(page_address(pages[j]), PAGE_SIZE);
+	rc = -ENOMEM;
+out_free_ar:
+	memblock_free_early(__pa(pages), pages_size);
+	pcpu_free_alloc_info(ai);
+	return rc;
+}
+#endif /* BUILD_PAGE_FIRST_CHUNK */
+
 #ifndef	CONFIG_HAVE_SETUP_PER_CPU_AREA
-///*
-// * Generic SMP percpu area setup.
-// *
-// * The embedding helper is used because its behavior closely resembles
-// * the original non-dynamic generic percpu area setup.  This is
-// * important because many archs have addressing restrictions and might
-// * fail if the percpu area is located far away from the previous
-// * location.  As an added bonus, in non-NUMA cases, embedding is
-// * generally a good idea TLB-wise because percpu area can piggy back
-// * on the physical linear memory mapping which uses large page
-// * mappings on applicable archs.
-// */
-//unsigned long __per_cpu_offset[NR_CPUS] __read_mostly;
-//EXPORT_SYMBOL(__per_cpu_offset);
-//
-//static void * __init pcpu_dfl_fc_alloc(unsigned int cpu, size_t size,
-//				       size_t align)
-//{
-//	return  memblock_alloc_from(size, align, __pa(MAX_DMA_ADDRESS));
-//}
-//
-//static void __init pcpu_dfl_fc_free(void *ptr, size_t size)
-//{
-//	memblock_free_early(__pa(ptr), size);
-//}
+/*
+ * Generic SMP percpu area setup.
+ *
+ * The embedding helper is used because its behavior closely resembles
+ * the original non-dynamic generic percpu area setup.  This is
+ * important because many archs have addressing restrictions and might
+ * fail if the percpu area is located far away from the previous
+ * location.  As an added bonus, in non-NUMA cases, embedding is
+ * generally a good idea TLB-wise because percpu area can piggy back
+ * on the physical linear memory mapping which uses large page
+ * mappings on applicable archs.
+ */
+unsigned long __per_cpu_offset[NR_CPUS] __read_mostly;
+EXPORT_SYMBOL(__per_cpu_offset);
+
+static void * __init pcpu_dfl_fc_alloc(unsigned int cpu, size_t size,
+				       size_t align)
+{
+	return  memblock_alloc_from(size, align, __pa(MAX_DMA_ADDRESS));
+}
+
+static void __init pcpu_dfl_fc_free(void *ptr, size_t size)
+{
+	memblock_free_early(__pa(ptr), size);
+}
 
 void __init setup_per_cpu_areas(void)
 {
@@ -3117,6 +3117,7 @@ void __init setup_per_cpu_areas(void)
 	for_each_possible_cpu(cpu)
 		__per_cpu_offset[cpu] = delta + pcpu_unit_offsets[cpu];
 }
+EXPORT_SYMBOL(setup_per_cpu_areas);
 #endif	/* CONFIG_HAVE_SETUP_PER_CPU_AREA */
 
 #else	/* CONFIG_SMP */
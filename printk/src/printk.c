@@ -1097,20 +1097,20 @@ EXPORT_SYMBOL(kmsg_fops);
 /* requested log_buf_len from kernel cmdline */
 static unsigned long __initdata new_log_buf_len;
 
-///* we practice scaling the ring buffer by powers of 2 */
-//static void __init log_buf_len_update(u64 size)
-//{
-//	if (size > (u64)LOG_BUF_LEN_MAX) {
-//		size = (u64)LOG_BUF_LEN_MAX;
-//		pr_err("log_buf over 2G is not supported.\n");
-//	}
-//
-//	if (size)
-//		size = roundup_pow_of_two(size);
-//	if (size > log_buf_len)
-//		new_log_buf_len = (unsigned long)size;
-//}
-//
+/* we practice scaling the ring buffer by powers of 2 */
+static void __init log_buf_len_update(u64 size)
+{
+	if (size > (u64)LOG_BUF_LEN_MAX) {
+		size = (u64)LOG_BUF_LEN_MAX;
+		pr_err("log_buf over 2G is not supported.\n");
+	}
+
+	if (size)
+		size = roundup_pow_of_two(size);
+	if (size > log_buf_len)
+		new_log_buf_len = (unsigned long)size;
+}
+
 ///* save requested log_buf_len since it's too early to process it */
 //static int __init log_buf_len_setup(char *str)
 //{
@@ -11,7 +11,7 @@
  *	   Paul E. McKenney <paulmck@linux.ibm.com>
  */
 
-#include "../locking/rtmutex_common.h"
+#include "../kernel/locking/rtmutex_common.h"
 
 #ifdef CONFIG_RCU_NOCB_CPU
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
@@ -723,6 +723,7 @@ void exit_rcu(void)
 	__rcu_read_unlock();
 	rcu_preempt_deferred_qs(current);
 }
+EXPORT_SYMBOL_GPL(exit_rcu);
 
 /*
  * Dump the blocked-tasks state, but limit the list dump to the
@@ -914,6 +915,7 @@ static void rcu_flavor_sched_clock_irq(int user)
 void exit_rcu(void)
 {
 }
+EXPORT_SYMBOL_GPL(exit_rcu);
 
 /*
  * Dump the guaranteed-empty blocked-tasks state.  Trust but verify.
@@ -1230,6 +1232,7 @@ int rcu_needs_cpu(u64 basemono, u64 *nextevt)
 	return !rcu_segcblist_empty(&this_cpu_ptr(&rcu_data)->cblist) &&
 	       !rcu_segcblist_is_offloaded(&this_cpu_ptr(&rcu_data)->cblist);
 }
+EXPORT_SYMBOL_GPL(rcu_needs_cpu);
 
 /*
  * Because we do not have RCU_FAST_NO_HZ, don't bother cleaning up
@@ -1342,6 +1345,7 @@ int rcu_needs_cpu(u64 basemono, u64 *nextevt)
 	*nextevt = basemono + dj * TICK_NSEC;
 	return 0;
 }
+EXPORT_SYMBOL_GPL(rcu_needs_cpu);
 
 /*
  * Prepare a CPU for idle from an RCU perspective.  The first major task is to
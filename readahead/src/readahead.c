@@ -178,6 +178,7 @@ void page_cache_readahead_unbounded(struct address_space *mapping,
 		unsigned long lookahead_size)
 {
 	LIST_HEAD(page_pool);
+	LIST_HEAD(spare_pages);
 	gfp_t gfp_mask = readahead_gfp_mask(mapping);
 	struct readahead_control rac = {
 		.mapping = mapping,
@@ -219,9 +220,16 @@ void page_cache_readahead_unbounded(struct address_space *mapping,
 			continue;
 		}
 
-		page = __page_cache_alloc(gfp_mask);
-		if (!page)
+		/*
+		 * Pull the rest of the window out of the page allocator in one
+		 * go; pages that turn out to be cached already are handed back
+		 * below.
+		 */
+		if (list_empty(&spare_pages) &&
+		    !alloc_pages_bulk_list(gfp_mask, nr_to_read - i, &spare_pages))
 			break;
+		page = lru_to_page(&spare_pages);
+		list_del(&page->lru);
 		if (mapping->a_ops->readpages) {
 			page->index = index + i;
 			list_add(&page->lru, &page_pool);
@@ -242,6 +250,7 @@ void page_cache_readahead_unbounded(struct address_space *mapping,
 	 * will then handle the error.
 	 */
 	read_pages(&rac, &page_pool, false);
+	put_pages_list(&spare_pages);
 	memalloc_nofs_restore(nofs);
 }
 EXPORT_SYMBOL_GPL(page_cache_readahead_unbounded);
@@ -306,6 +315,7 @@ void force_page_cache_readahead(struct address_space *mapping,
 		nr_to_read -= this_chunk;
 	}
 }
+EXPORT_SYMBOL(force_page_cache_readahead);
 
 /*
  * Set the initial window size, round to next power of 2 and square
@@ -75,6 +75,7 @@ void flush_icache_mm(struct mm_struct *mm, bool local)
 
 	preempt_enable();
 }
+EXPORT_SYMBOL(flush_icache_mm);
 
 #endif /* CONFIG_SMP */
 
@@ -1,6 +1,4 @@
 #include <linux/types.h>
 #include "../../booter/src/booter.h"
 
-CL_MINE(clear_page_mlock)
 CL_MINE(page_anon_vma)
-CL_MINE(page_vma_mapped_walk)
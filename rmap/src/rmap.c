@@ -512,6 +512,7 @@ out:
 
 	return anon_vma;
 }
+EXPORT_SYMBOL(page_get_anon_vma);
 
 /*
  * Similar to page_get_anon_vma() except it locks the anon_vma.
@@ -756,6 +757,7 @@ pmd_t *mm_find_pmd(struct mm_struct *mm, unsigned long address)
 out:
 	return pmd;
 }
+EXPORT_SYMBOL(mm_find_pmd);
 
 struct page_referenced_arg {
 	int mapcount;
@@ -1030,6 +1032,7 @@ void page_move_anon_rmap(struct page *page, struct vm_area_struct *vma)
 	 */
 	WRITE_ONCE(page->mapping, (struct address_space *) anon_vma);
 }
+EXPORT_SYMBOL(page_move_anon_rmap);
 
 /**
  * __page_set_anon_rmap - set up new anonymous rmap
@@ -1104,6 +1107,7 @@ void page_add_anon_rmap(struct page *page,
 {
 	do_page_add_anon_rmap(page, vma, address, compound ? RMAP_COMPOUND : 0);
 }
+EXPORT_SYMBOL(page_add_anon_rmap);
 
 /*
  * Special version of the above for do_swap_page, which often runs
@@ -1815,6 +1819,7 @@ void __put_anon_vma(struct anon_vma *anon_vma)
 	if (root != anon_vma && atomic_dec_and_test(&root->refcount))
 		anon_vma_free(root);
 }
+EXPORT_SYMBOL(__put_anon_vma);
 
 static struct anon_vma *rmap_walk_anon_lock(struct page *page,
 					struct rmap_walk_control *rwc)
@@ -1955,6 +1960,7 @@ void rmap_walk(struct page *page, struct rmap_walk_control *rwc)
 	else
 		rmap_walk_file(page, rwc, false);
 }
+EXPORT_SYMBOL(rmap_walk);
 
 /* Like rmap_walk, but caller holds relevant rmap lock */
 void rmap_walk_locked(struct page *page, struct rmap_walk_control *rwc)
@@ -1966,6 +1972,7 @@ void rmap_walk_locked(struct page *page, struct rmap_walk_control *rwc)
 	else
 		rmap_walk_file(page, rwc, true);
 }
+EXPORT_SYMBOL(rmap_walk_locked);
 
 #ifdef CONFIG_HUGETLB_PAGE
 /*
@@ -1986,6 +1993,7 @@ void hugepage_add_anon_rmap(struct page *page,
 	if (first)
 		__page_set_anon_rmap(page, vma, address, 0);
 }
+EXPORT_SYMBOL(hugepage_add_anon_rmap);
 
 void hugepage_add_new_anon_rmap(struct page *page,
 			struct vm_area_struct *vma, unsigned long address)
@@ -1997,4 +2005,5 @@ void hugepage_add_new_anon_rmap(struct page *page,
 
 	__page_set_anon_rmap(page, vma, address, 1);
 }
+EXPORT_SYMBOL(hugepage_add_new_anon_rmap);
 #endif /* CONFIG_HUGETLB_PAGE */
@@ -59,11 +59,11 @@ const_debug unsigned int sysctl_sched_features =
 #undef SCHED_FEAT
 #endif
 
-///*
-// * Number of tasks to iterate in a single balance run.
-// * Limited because this is done with IRQs disabled.
-// */
-//const_debug unsigned int sysctl_sched_nr_migrate = 32;
+/*
+ * Number of tasks to iterate in a single balance run.
+ * Limited because this is done with IRQs disabled.
+ */
+const_debug unsigned int sysctl_sched_nr_migrate = 32;
 
 /*
  * period over which we measure -rt task CPU usage in us.
@@ -319,14 +319,14 @@ void update_rq_clock(struct rq *rq)
 	update_rq_clock_task(rq, delta);
 }
 
-//static inline void
-//rq_csd_init(struct rq *rq, call_single_data_t *csd, smp_call_func_t func)
-//{
-//	csd->flags = 0;
-//	csd->func = func;
-//	csd->info = rq;
-//}
-//
+static inline void
+rq_csd_init(struct rq *rq, call_single_data_t *csd, smp_call_func_t func)
+{
+	csd->flags = 0;
+	csd->func = func;
+	csd->info = rq;
+}
+
 #ifdef CONFIG_SCHED_HRTICK
 /*
  * Use HR-timers to deliver accurate preemption points.
@@ -358,13 +358,13 @@ static enum hrtimer_restart hrtick(struct hrtimer *timer)
 }
 
 #ifdef CONFIG_SMP
-//
-//static void __hrtick_restart(struct rq *rq)
-//{
-//	struct hrtimer *timer = &rq->hrtick_timer;
-//
-//	hrtimer_start_expires(timer, HRTIMER_MODE_ABS_PINNED_HARD);
-//}
+
+static void __hrtick_restart(struct rq *rq)
+{
+	struct hrtimer *timer = &rq->hrtick_timer;
+
+	hrtimer_start_expires(timer, HRTIMER_MODE_ABS_PINNED_HARD);
+}
 
 /*
  * called from hardirq (IPI) context
@@ -379,32 +379,32 @@ static void __hrtick_start(void *arg)
 	rq_unlock(rq, &rf);
 }
 
-///*
-// * Called to set the hrtick timer state.
-// *
-// * called with rq->lock held and irqs disabled
-// */
-//void hrtick_start(struct rq *rq, u64 delay)
-//{
-//	struct hrtimer *timer = &rq->hrtick_timer;
-//	ktime_t time;
-//	s64 delta;
-//
-//	/*
-//	 * Don't schedule slices shorter than 10000ns, that just
-//	 * doesn't make sense and can cause timer DoS.
-//	 */
-//	delta = max_t(s64, delay, 10000LL);
-//	time = ktime_add_ns(timer->base->get_time(), delta);
-//
-//	hrtimer_set_expires(timer, time);
-//
-//	if (rq == this_rq())
-//		__hrtick_restart(rq);
-//	else
-//		smp_call_function_single_async(cpu_of(rq), &rq->hrtick_csd);
-//}
-//
+/*
+ * Called to set the hrtick timer state.
+ *
+ * called with rq->lock held and irqs disabled
+ */
+void hrtick_start(struct rq *rq, u64 delay)
+{
+	struct hrtimer *timer = &rq->hrtick_timer;
+	ktime_t time;
+	s64 delta;
+
+	/*
+	 * Don't schedule slices shorter than 10000ns, that just
+	 * doesn't make sense and can cause timer DoS.
+	 */
+	delta = max_t(s64, delay, 10000LL);
+	time = ktime_add_ns(timer->base->get_time(), delta);
+
+	hrtimer_set_expires(timer, time);
+
+	if (rq == this_rq())
+		__hrtick_restart(rq);
+	else
+		smp_call_function_single_async(cpu_of(rq), &rq->hrtick_csd);
+}
+
 #else
 /*
  * Called to set the hrtick timer state.
@@ -472,30 +472,30 @@ static bool set_nr_and_not_polling(struct task_struct *p)
 	return !(fetch_or(&ti->flags, _TIF_NEED_RESCHED) & _TIF_POLLING_NRFLAG);
 }
 
-///*
-// * Atomically set TIF_NEED_RESCHED if TIF_POLLING_NRFLAG is set.
-// *
-// * If this returns true, then the idle task promises to call
-// * sched_ttwu_pending() and reschedule soon.
-// */
-//static bool set_nr_if_polling(struct task_struct *p)
-//{
-//	struct thread_info *ti = task_thread_info(p);
-//	typeof(ti->flags) old, val = READ_ONCE(ti->flags);
-//
-//	for (;;) {
-//		if (!(val & _TIF_POLLING_NRFLAG))
-//			return false;
-//		if (val & _TIF_NEED_RESCHED)
-//			return true;
-//		old = cmpxchg(&ti->flags, val, val | _TIF_NEED_RESCHED);
-//		if (old == val)
-//			break;
-//		val = old;
-//	}
-//	return true;
-//}
-//
+/*
+ * Atomically set TIF_NEED_RESCHED if TIF_POLLING_NRFLAG is set.
+ *
+ * If this returns true, then the idle task promises to call
+ * sched_ttwu_pending() and reschedule soon.
+ */
+static bool set_nr_if_polling(struct task_struct *p)
+{
+	struct thread_info *ti = task_thread_info(p);
+	typeof(ti->flags) old, val = READ_ONCE(ti->flags);
+
+	for (;;) {
+		if (!(val & _TIF_POLLING_NRFLAG))
+			return false;
+		if (val & _TIF_NEED_RESCHED)
+			return true;
+		old = cmpxchg(&ti->flags, val, val | _TIF_NEED_RESCHED);
+		if (old == val)
+			break;
+		val = old;
+	}
+	return true;
+}
+
 #else
 static bool set_nr_and_not_polling(struct task_struct *p)
 {
@@ -642,120 +642,122 @@ void resched_cpu(int cpu)
 
 #ifdef CONFIG_SMP
 #ifdef CONFIG_NO_HZ_COMMON
-///*
-// * In the semi idle case, use the nearest busy CPU for migrating timers
-// * from an idle CPU.  This is good for power-savings.
-// *
-// * We don't do similar optimization for completely idle system, as
-// * selecting an idle CPU will add more delays to the timers than intended
-// * (as that CPU's timer base may not be uptodate wrt jiffies etc).
-// */
-//int get_nohz_timer_target(void)
-//{
-//	int i, cpu = smp_processor_id(), default_cpu = -1;
-//	struct sched_domain *sd;
-//
-//	if (housekeeping_cpu(cpu, HK_FLAG_TIMER)) {
-//		if (!idle_cpu(cpu))
-//			return cpu;
-//		default_cpu = cpu;
-//	}
-//
-//	rcu_read_lock();
-//	for_each_domain(cpu, sd) {
-//		for_each_cpu_and(i, sched_domain_span(sd),
-//			housekeeping_cpumask(HK_FLAG_TIMER)) {
-//			if (cpu == i)
-//				continue;
-//
-//			if (!idle_cpu(i)) {
-//				cpu = i;
-//				goto unlock;
-//			}
-//		}
-//	}
-//
-//	if (default_cpu == -1)
-//		default_cpu = housekeeping_any_cpu(HK_FLAG_TIMER);
-//	cpu = default_cpu;
-//unlock:
-//	rcu_read_unlock();
-//	return cpu;
-//}
-//
-///*
-// * When add_timer_on() enqueues a timer into the timer wheel of an
-// * idle CPU then this timer might expire before the next timer event
-// * which is scheduled to wake up that CPU. In case of a completely
-// * idle system the next event might even be infinite time into the
-// * future. wake_up_idle_cpu() ensures that the CPU is woken up and
-// * leaves the inner idle loop so the newly added timer is taken into
-// * account when the CPU goes back to idle and evaluates the timer
-// * wheel for the next timer event.
-// */
-//static void wake_up_idle_cpu(int cpu)
-//{
-//	struct rq *rq = cpu_rq(cpu);
-//
-//	if (cpu == smp_processor_id())
-//		return;
-//
-//	if (set_nr_and_not_polling(rq->idle))
-//		smp_send_reschedule(cpu);
-//	else
-//		trace_sched_wake_idle_without_ipi(cpu);
-//}
-//
-//static bool wake_up_full_nohz_cpu(int cpu)
-//{
-//	/*
-//	 * We just need the target to call irq_exit() and re-evaluate
-//	 * the next tick. The nohz full kick at least implies that.
-//	 * If needed we can still optimize that later with an
-//	 * empty IRQ.
-//	 */
-//	if (cpu_is_offline(cpu))
-//		return true;  /* Don't try to wake offline CPUs. */
-//	if (tick_nohz_full_cpu(cpu)) {
-//		if (cpu != smp_processor_id() ||
-//		    tick_nohz_tick_stopped())
-//			tick_nohz_full_kick_cpu(cpu);
-//		return true;
-//	}
-//
-//	return false;
-//}
-//
-///*
-// * Wake up the specified CPU.  If the CPU is going offline, it is the
-// * caller's responsibility to deal with the lost wakeup, for example,
-// * by hooking into the CPU_DEAD notifier like timers and hrtimers do.
-// */
-//void wake_up_nohz_cpu(int cpu)
-//{
-//	if (!wake_up_full_nohz_cpu(cpu))
-//		wake_up_idle_cpu(cpu);
-//}
-//
-//static void nohz_csd_func(void *info)
-//{
-//	struct rq *rq = info;
-//	int cpu = cpu_of(rq);
-//	unsigned int flags;
-//
-//	/*
-//	 * Release the rq::nohz_csd.
-//	 */
-//	flags = atomic_fetch_andnot(NOHZ_KICK_MASK, nohz_flags(cpu));
-//	WARN_ON(!(flags & NOHZ_KICK_MASK));
-//
-//	rq->idle_balance = idle_cpu(cpu);
-//	if (rq->idle_balance && !need_resched()) {
-//		rq->nohz_idle_balance = flags;
-//		raise_softirq_irqoff(SCHED_SOFTIRQ);
-//	}
-//}
-//
+/*
+ * In the semi idle case, use the nearest busy CPU for migrating timers
+ * from an idle CPU.  This is good for power-savings.
+ *
+ * We don't do similar optimization for completely idle system, as
+ * selecting an idle CPU will add more delays to the timers than intended
+ * (as that CPU's timer base may not be uptodate wrt jiffies etc).
+ */
+int get_nohz_timer_target(void)
+{
+	int i, cpu = smp_processor_id(), default_cpu = -1;
+	struct sched_domain *sd;
+
+	if (housekeeping_cpu(cpu, HK_FLAG_TIMER)) {
+		if (!idle_cpu(cpu))
+			return cpu;
+		default_cpu = cpu;
+	}
+
+	rcu_read_lock();
+	for_each_domain(cpu, sd) {
+		for_each_cpu_and(i, sched_domain_span(sd),
+			housekeeping_cpumask(HK_FLAG_TIMER)) {
+			if (cpu == i)
+				continue;
+
+			if (!idle_cpu(i)) {
+				cpu = i;
+				goto unlock;
+			}
+		}
+	}
+
+	if (default_cpu == -1)
+		default_cpu = housekeeping_any_cpu(HK_FLAG_TIMER);
+	cpu = default_cpu;
+unlock:
+	rcu_read_unlock();
+	return cpu;
+}
+EXPORT_SYMBOL(get_nohz_timer_target);
+
+/*
+ * When add_timer_on() enqueues a timer into the timer wheel of an
+ * idle CPU then this timer might expire before the next timer event
+ * which is scheduled to wake up that CPU. In case of a completely
+ * idle system the next event might even be infinite time into the
+ * future. wake_up_idle_cpu() ensures that the CPU is woken up and
+ * leaves the inner idle loop so the newly added timer is taken into
+ * account when the CPU goes back to idle and evaluates the timer
+ * wheel for the next timer event.
+ */
+static void wake_up_idle_cpu(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (cpu == smp_processor_id())
+		return;
+
+	if (set_nr_and_not_polling(rq->idle))
+		smp_send_reschedule(cpu);
+	else
+		trace_sched_wake_idle_without_ipi(cpu);
+}
+
+static bool wake_up_full_nohz_cpu(int cpu)
+{
+	/*
+	 * We just need the target to call irq_exit() and re-evaluate
+	 * the next tick. The nohz full kick at least implies that.
+	 * If needed we can still optimize that later with an
+	 * empty IRQ.
+	 */
+	if (cpu_is_offline(cpu))
+		return true;  /* Don't try to wake offline CPUs. */
+	if (tick_nohz_full_cpu(cpu)) {
+		if (cpu != smp_processor_id() ||
+		    tick_nohz_tick_stopped())
+			tick_nohz_full_kick_cpu(cpu);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Wake up the specified CPU.  If the CPU is going offline, it is the
+ * caller's responsibility to deal with the lost wakeup, for example,
+ * by hooking into the CPU_DEAD notifier like timers and hrtimers do.
+ */
+void wake_up_nohz_cpu(int cpu)
+{
+	if (!wake_up_full_nohz_cpu(cpu))
+		wake_up_idle_cpu(cpu);
+}
+EXPORT_SYMBOL(wake_up_nohz_cpu);
+
+static void nohz_csd_func(void *info)
+{
+	struct rq *rq = info;
+	int cpu = cpu_of(rq);
+	unsigned int flags;
+
+	/*
+	 * Release the rq::nohz_csd.
+	 */
+	flags = atomic_fetch_andnot(NOHZ_KICK_MASK, nohz_flags(cpu));
+	WARN_ON(!(flags & NOHZ_KICK_MASK));
+
+	rq->idle_balance = idle_cpu(cpu);
+	if (rq->idle_balance && !need_resched()) {
+		rq->nohz_idle_balance = flags;
+		raise_softirq_irqoff(SCHED_SOFTIRQ);
+	}
+}
+
 #endif /* CONFIG_NO_HZ_COMMON */
 //
 #ifdef CONFIG_NO_HZ_FULL
@@ -1698,4417 +1700,4427 @@ void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags)
 		rq_clock_skip_update(rq);
 }
 
-//#ifdef CONFIG_SMP
-//
-///*
-// * Per-CPU kthreads are allowed to run on !active && online CPUs, see
-// * __set_cpus_allowed_ptr() and select_fallback_rq().
-// */
-//static inline bool is_cpu_allowed(struct task_struct *p, int cpu)
-//{
-//	if (!cpumask_test_cpu(cpu, p->cpus_ptr))
-//		return false;
-//
-//	if (is_per_cpu_kthread(p))
-//		return cpu_online(cpu);
-//
-//	return cpu_active(cpu);
-//}
-//
-///*
-// * This is how migration works:
-// *
-// * 1) we invoke migration_cpu_stop() on the target CPU using
-// *    stop_one_cpu().
-// * 2) stopper starts to run (implicitly forcing the migrated thread
-// *    off the CPU)
-// * 3) it checks whether the migrated task is still in the wrong runqueue.
-// * 4) if it's in the wrong runqueue then the migration thread removes
-// *    it and puts it into the right queue.
-// * 5) stopper completes and stop_one_cpu() returns and the migration
-// *    is done.
-// */
-//
-///*
-// * move_queued_task - move a queued task to new rq.
-// *
-// * Returns (locked) new rq. Old rq's lock is released.
-// */
-//static struct rq *move_queued_task(struct rq *rq, struct rq_flags *rf,
-//				   struct task_struct *p, int new_cpu)
-//{
-//	lockdep_assert_held(&rq->lock);
-//
-//	deactivate_task(rq, p, DEQUEUE_NOCLOCK);
-//	set_task_cpu(p, new_cpu);
-//	rq_unlock(rq, rf);
-//
-//	rq = cpu_rq(new_cpu);
-//
-//	rq_lock(rq, rf);
-//	BUG_ON(task_cpu(p) != new_cpu);
-//	activate_task(rq, p, 0);
-//	check_preempt_curr(rq, p, 0);
-//
-//	return rq;
-//}
-//
-//struct migration_arg {
-//	struct task_struct *task;
-//	int dest_cpu;
-//};
-//
-///*
-// * Move (not current) task off this CPU, onto the destination CPU. We're doing
-// * this because either it can't run here any more (set_cpus_allowed()
-// * away from this CPU, or CPU going down), or because we're
-// * attempting to rebalance this task on exec (sched_exec).
-// *
-// * So we race with normal scheduler movements, but that's OK, as long
-// * as the task is no longer on this CPU.
-// */
-//static struct rq *__migrate_task(struct rq *rq, struct rq_flags *rf,
-//				 struct task_struct *p, int dest_cpu)
-//{
-//	/* Affinity changed (again). */
-//	if (!is_cpu_allowed(p, dest_cpu))
-//		return rq;
-//
-//	update_rq_clock(rq);
-//	rq = move_queued_task(rq, rf, p, dest_cpu);
-//
-//	return rq;
-//}
-//
-///*
-// * migration_cpu_stop - this will be executed by a highprio stopper thread
-// * and performs thread migration by bumping thread off CPU then
-// * 'pushing' onto another runqueue.
-// */
-//static int migration_cpu_stop(void *data)
-//{
-//	struct migration_arg *arg = data;
-//	struct task_struct *p = arg->task;
-//	struct rq *rq = this_rq();
-//	struct rq_flags rf;
-//
-//	/*
-//	 * The original target CPU might have gone down and we might
-//	 * be on another CPU but it doesn't matter.
-//	 */
-//	local_irq_disable();
-//	/*
-//	 * We need to explicitly wake pending tasks before running
-//	 * __migrate_task() such that we will not miss enforcing cpus_ptr
-//	 * during wakeups, see set_cpus_allowed_ptr()'s TASK_WAKING test.
-//	 */
-//	flush_smp_call_function_from_idle();
-//
-//	raw_spin_lock(&p->pi_lock);
-//	rq_lock(rq, &rf);
-//	/*
-//	 * If task_rq(p) != rq, it cannot be migrated here, because we're
-//	 * holding rq->lock, if p->on_rq == 0 it cannot get enqueued because
-//	 * we're holding p->pi_lock.
-//	 */
-//	if (task_rq(p) == rq) {
-//		if (task_on_rq_queued(p))
-//			rq = __migrate_task(rq, &rf, p, arg->dest_cpu);
-//		else
-//			p->wake_cpu = arg->dest_cpu;
-//	}
-//	rq_unlock(rq, &rf);
-//	raw_spin_unlock(&p->pi_lock);
-//
-//	local_irq_enable();
-//	return 0;
-//}
-//
-///*
-// * sched_class::set_cpus_allowed must do the below, but is not required to
-// * actually call this function.
-// */
-//void set_cpus_allowed_common(struct task_struct *p, const struct cpumask *new_mask)
-//{
-//	cpumask_copy(&p->cpus_mask, new_mask);
-//	p->nr_cpus_allowed = cpumask_weight(new_mask);
-//}
-//
-//void do_set_cpus_allowed(struct task_struct *p, const struct cpumask *new_mask)
-//{
-//	struct rq *rq = task_rq(p);
-//	bool queued, running;
-//
-//	lockdep_assert_held(&p->pi_lock);
-//
-//	queued = task_on_rq_queued(p);
-//	running = task_current(rq, p);
-//
-//	if (queued) {
-//		/*
-//		 * Because __kthread_bind() calls this on blocked tasks without
-//		 * holding rq->lock.
-//		 */
-//		lockdep_assert_held(&rq->lock);
-//		dequeue_task(rq, p, DEQUEUE_SAVE | DEQUEUE_NOCLOCK);
-//	}
-//	if (running)
-//		put_prev_task(rq, p);
-//
-//	p->sched_class->set_cpus_allowed(p, new_mask);
-//
-//	if (queued)
-//		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
-//	if (running)
-//		set_next_task(rq, p);
-//}
-//
-///*
-// * Change a given task's CPU affinity. Migrate the thread to a
-// * proper CPU and schedule it away if the CPU it's executing on
-// * is removed from the allowed bitmask.
-// *
-// * NOTE: the caller must have a valid reference to the task, the
-// * task must not exit() & deallocate itself prematurely. The
-// * call is not atomic; no spinlocks may be held.
-// */
-//static int __set_cpus_allowed_ptr(struct task_struct *p,
-//				  const struct cpumask *new_mask, bool check)
-//{
-//	const struct cpumask *cpu_valid_mask = cpu_active_mask;
-//	unsigned int dest_cpu;
-//	struct rq_flags rf;
-//	struct rq *rq;
-//	int ret = 0;
-//
-//	rq = task_rq_lock(p, &rf);
-//	update_rq_clock(rq);
-//
-//	if (p->flags & PF_KTHREAD) {
-//		/*
-//		 * Kernel threads are allowed on online && !active CPUs
-//		 */
-//		cpu_valid_mask = cpu_online_mask;
-//	}
-//
-//	/*
-//	 * Must re-check here, to close a race against __kthread_bind(),
-//	 * sched_setaffinity() is not guaranteed to observe the flag.
-//	 */
-//	if (check && (p->flags & PF_NO_SETAFFINITY)) {
-//		ret = -EINVAL;
-//		goto out;
-//	}
-//
-//	if (cpumask_equal(&p->cpus_mask, new_mask))
-//		goto out;
-//
-//	/*
-//	 * Picking a ~random cpu helps in cases where we are changing affinity
-//	 * for groups of tasks (ie. cpuset), so that load balancing is not
-//	 * immediately required to distribute the tasks within their new mask.
-//	 */
-//	dest_cpu = cpumask_any_and_distribute(cpu_valid_mask, new_mask);
-//	if (dest_cpu >= nr_cpu_ids) {
-//		ret = -EINVAL;
-//		goto out;
-//	}
-//
-//	do_set_cpus_allowed(p, new_mask);
-//
-//	if (p->flags & PF_KTHREAD) {
-//		/*
-//		 * For kernel threads that do indeed end up on online &&
-//		 * !active we want to ensure they are strict per-CPU threads.
-//		 */
-//		WARN_ON(cpumask_intersects(new_mask, cpu_online_mask) &&
-//			!cpumask_intersects(new_mask, cpu_active_mask) &&
-//			p->nr_cpus_allowed != 1);
-//	}
-//
-//	/* Can the task run on the task's current CPU? If so, we're done */
-//	if (cpumask_test_cpu(task_cpu(p), new_mask))
-//		goto out;
-//
-//	if (task_running(rq, p) || p->state == TASK_WAKING) {
-//		struct migration_arg arg = { p, dest_cpu };
-//		/* Need help from migration thread: drop lock and wait. */
-//		task_rq_unlock(rq, p, &rf);
-//		stop_one_cpu(cpu_of(rq), migration_cpu_stop, &arg);
-//		return 0;
-//	} else if (task_on_rq_queued(p)) {
-//		/*
-//		 * OK, since we're going to drop the lock immediately
-//		 * afterwards anyway.
-//		 */
-//		rq = move_queued_task(rq, &rf, p, dest_cpu);
-//	}
-//out:
-//	task_rq_unlock(rq, p, &rf);
-//
-//	return ret;
-//}
-//
-//int set_cpus_allowed_ptr(struct task_struct *p, const struct cpumask *new_mask)
-//{
-//	return __set_cpus_allowed_ptr(p, new_mask, false);
-//}
-//EXPORT_SYMBOL_GPL(set_cpus_allowed_ptr);
-//
-//void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
-//{
-//#ifdef CONFIG_SCHED_DEBUG
-//	/*
-//	 * We should never call set_task_cpu() on a blocked task,
-//	 * ttwu() will sort out the placement.
-//	 */
-//	WARN_ON_ONCE(p->state != TASK_RUNNING && p->state != TASK_WAKING &&
-//			!p->on_rq);
-//
-//	/*
-//	 * Migrating fair class task must have p->on_rq = TASK_ON_RQ_MIGRATING,
-//	 * because schedstat_wait_{start,end} rebase migrating task's wait_start
-//	 * time relying on p->on_rq.
-//	 */
-//	WARN_ON_ONCE(p->state == TASK_RUNNING &&
-//		     p->sched_class == &fair_sched_class &&
-//		     (p->on_rq && !task_on_rq_migrating(p)));
-//
-//#ifdef CONFIG_LOCKDEP
-//	/*
-//	 * The caller should hold either p->pi_lock or rq->lock, when changing
-//	 * a task's CPU. ->pi_lock for waking tasks, rq->lock for runnable tasks.
-//	 *
-//	 * sched_move_task() holds both and thus holding either pins the cgroup,
-//	 * see task_group().
-//	 *
-//	 * Furthermore, all task_rq users should acquire both locks, see
-//	 * task_rq_lock().
-//	 */
-//	WARN_ON_ONCE(debug_locks && !(lockdep_is_held(&p->pi_lock) ||
-//				      lockdep_is_held(&task_rq(p)->lock)));
-//#endif
-//	/*
-//	 * Clearly, migrating tasks to offline CPUs is a fairly daft thing.
-//	 */
-//	WARN_ON_ONCE(!cpu_online(new_cpu));
-//#endif
-//
-//	trace_sched_migrate_task(p, new_cpu);
-//
-//	if (task_cpu(p) != new_cpu) {
-//		if (p->sched_class->migrate_task_rq)
-//			p->sched_class->migrate_task_rq(p, new_cpu);
-//		p->se.nr_migrations++;
-//		rseq_migrate(p);
-//		perf_event_task_migrate(p);
-//	}
-//
-//	__set_task_cpu(p, new_cpu);
-//}
-//
-//#ifdef CONFIG_NUMA_BALANCING
-//static void __migrate_swap_task(struct task_struct *p, int cpu)
-//{
-//	if (task_on_rq_queued(p)) {
-//		struct rq *src_rq, *dst_rq;
-//		struct rq_flags srf, drf;
-//
-//		src_rq = task_rq(p);
-//		dst_rq = cpu_rq(cpu);
-//
-//		rq_pin_lock(src_rq, &srf);
-//		rq_pin_lock(dst_rq, &drf);
-//
-//		deactivate_task(src_rq, p, 0);
-//		set_task_cpu(p, cpu);
-//		activate_task(dst_rq, p, 0);
-//		check_preempt_curr(dst_rq, p, 0);
-//
-//		rq_unpin_lock(dst_rq, &drf);
-//		rq_unpin_lock(src_rq, &srf);
-//
-//	} else {
-//		/*
-//		 * Task isn't running anymore; make it appear like we migrated
-//		 * it before it went to sleep. This means on wakeup we make the
-//		 * previous CPU our target instead of where it really is.
-//		 */
-//		p->wake_cpu = cpu;
-//	}
-//}
-//
-//struct migration_swap_arg {
-//	struct task_struct *src_task, *dst_task;
-//	int src_cpu, dst_cpu;
-//};
-//
-//static int migrate_swap_stop(void *data)
-//{
-//	struct migration_swap_arg *arg = data;
-//	struct rq *src_rq, *dst_rq;
-//	int ret = -EAGAIN;
-//
-//	if (!cpu_active(arg->src_cpu) || !cpu_active(arg->dst_cpu))
-//		return -EAGAIN;
-//
-//	src_rq = cpu_rq(arg->src_cpu);
-//	dst_rq = cpu_rq(arg->dst_cpu);
-//
-//	double_raw_lock(&arg->src_task->pi_lock,
-//			&arg->dst_task->pi_lock);
-//	double_rq_lock(src_rq, dst_rq);
-//
-//	if (task_cpu(arg->dst_task) != arg->dst_cpu)
-//		goto unlock;
-//
-//	if (task_cpu(arg->src_task) != arg->src_cpu)
-//		goto unlock;
-//
-//	if (!cpumask_test_cpu(arg->dst_cpu, arg->src_task->cpus_ptr))
-//		goto unlock;
-//
-//	if (!cpumask_test_cpu(arg->src_cpu, arg->dst_task->cpus_ptr))
-//		goto unlock;
-//
-//	__migrate_swap_task(arg->src_task, arg->dst_cpu);
-//	__migrate_swap_task(arg->dst_task, arg->src_cpu);
-//
-//	ret = 0;
-//
-//unlock:
-//	double_rq_unlock(src_rq, dst_rq);
-//	raw_spin_unlock(&arg->dst_task->pi_lock);
-//	raw_spin_unlock(&arg->src_task->pi_lock);
-//
-//	return ret;
-//}
-//
-///*
-// * Cross migrate two tasks
-// */
-//int migrate_swap(struct task_struct *cur, struct task_struct *p,
-//		int target_cpu, int curr_cpu)
-//{
-//	struct migration_swap_arg arg;
-//	int ret = -EINVAL;
-//
-//	arg = (struct migration_swap_arg){
-//		.src_task = cur,
-//		.src_cpu = curr_cpu,
-//		.dst_task = p,
-//		.dst_cpu = target_cpu,
-//	};
-//
-//	if (arg.src_cpu == arg.dst_cpu)
-//		goto out;
-//
-//	/*
-//	 * These three tests are all lockless; this is OK since all of them
-//	 * will be re-checked with proper locks held further down the line.
-//	 */
-//	if (!cpu_active(arg.src_cpu) || !cpu_active(arg.dst_cpu))
-//		goto out;
-//
-//	if (!cpumask_test_cpu(arg.dst_cpu, arg.src_task->cpus_ptr))
-//		goto out;
-//
-//	if (!cpumask_test_cpu(arg.src_cpu, arg.dst_task->cpus_ptr))
-//		goto out;
-//
-//	trace_sched_swap_numa(cur, arg.src_cpu, p, arg.dst_cpu);
-//	ret = stop_two_cpus(arg.dst_cpu, arg.src_cpu, migrate_swap_stop, &arg);
-//
-//out:
-//	return ret;
-//}
-//#endif /* CONFIG_NUMA_BALANCING */
-//
-///*
-// * wait_task_inactive - wait for a thread to unschedule.
-// *
-// * If @match_state is nonzero, it's the @p->state value just checked and
-// * not expected to change.  If it changes, i.e. @p might have woken up,
-// * then return zero.  When we succeed in waiting for @p to be off its CPU,
-// * we return a positive number (its total switch count).  If a second call
-// * a short while later returns the same number, the caller can be sure that
-// * @p has remained unscheduled the whole time.
-// *
-// * The caller must ensure that the task *will* unschedule sometime soon,
-// * else this function might spin for a *long* time. This function can't
-// * be called with interrupts off, or it may introduce deadlock with
-// * smp_call_function() if an IPI is sent by the same process we are
-// * waiting to become inactive.
-// */
-//unsigned long wait_task_inactive(struct task_struct *p, long match_state)
-//{
-//	int running, queued;
-//	struct rq_flags rf;
-//	unsigned long ncsw;
-//	struct rq *rq;
-//
-//	for (;;) {
-//		/*
-//		 * We do the initial early heuristics without holding
-//		 * any task-queue locks at all. We'll only try to get
-//		 * the runqueue lock when things look like they will
-//		 * work out!
-//		 */
-//		rq = task_rq(p);
-//
-//		/*
-//		 * If the task is actively running on another CPU
-//		 * still, just relax and busy-wait without holding
-//		 * any locks.
-//		 *
-//		 * NOTE! Since we don't hold any locks, it's not
-//		 * even sure that "rq" stays as the right runqueue!
-//		 * But we don't care, since "task_running()" will
-//		 * return false if the runqueue has changed and p
-//		 * is actually now running somewhere else!
-//		 */
-//		while (task_running(rq, p)) {
-//			if (match_state && unlikely(p->state != match_state))
-//				return 0;
-//			cpu_relax();
-//		}
-//
-//		/*
-//		 * Ok, time to look more closely! We need the rq
-//		 * lock now, to be *sure*. If we're wrong, we'll
-//		 * just go back and repeat.
-//		 */
-//		rq = task_rq_lock(p, &rf);
-//		trace_sched_wait_task(p);
-//		running = task_running(rq, p);
-//		queued = task_on_rq_queued(p);
-//		ncsw = 0;
-//		if (!match_state || p->state == match_state)
-//			ncsw = p->nvcsw | LONG_MIN; /* sets MSB */
-//		task_rq_unlock(rq, p, &rf);
-//
-//		/*
-//		 * If it changed from the expected state, bail out now.
-//		 */
-//		if (unlikely(!ncsw))
-//			break;
-//
-//		/*
-//		 * Was it really running after all now that we
-//		 * checked with the proper locks actually held?
-//		 *
-//		 * Oops. Go back and try again..
-//		 */
-//		if (unlikely(running)) {
-//			cpu_relax();
-//			continue;
-//		}
-//
-//		/*
-//		 * It's not enough that it's not actively running,
-//		 * it must be off the runqueue _entirely_, and not
-//		 * preempted!
-//		 *
-//		 * So if it was still runnable (but just not actively
-//		 * running right now), it's preempted, and we should
-//		 * yield - it could be a while.
-//		 */
-//		if (unlikely(queued)) {
-//			ktime_t to = NSEC_PER_SEC / HZ;
-//
-//			set_current_state(TASK_UNINTERRUPTIBLE);
-//			schedule_hrtimeout(&to, HRTIMER_MODE_REL);
-//			continue;
-//		}
-//
-//		/*
-//		 * Ahh, all good. It wasn't running, and it wasn't
-//		 * runnable, which means that it will never become
-//		 * running in the future either. We're all done!
-//		 */
-//		break;
-//	}
-//
-//	return ncsw;
-//}
-//
-///***
-// * kick_process - kick a running thread to enter/exit the kernel
-// * @p: the to-be-kicked thread
-// *
-// * Cause a process which is running on another CPU to enter
-// * kernel-mode, without any delay. (to get signals handled.)
-// *
-// * NOTE: this function doesn't have to take the runqueue lock,
-// * because all it wants to ensure is that the remote task enters
-// * the kernel. If the IPI races and the task has been migrated
-// * to another CPU then no harm is done and the purpose has been
-// * achieved as well.
-// */
-//void kick_process(struct task_struct *p)
-//{
-//	int cpu;
-//
-//	preempt_disable();
-//	cpu = task_cpu(p);
-//	if ((cpu != smp_processor_id()) && task_curr(p))
-//		smp_send_reschedule(cpu);
-//	preempt_enable();
-//}
-//EXPORT_SYMBOL_GPL(kick_process);
-//
-///*
-// * ->cpus_ptr is protected by both rq->lock and p->pi_lock
-// *
-// * A few notes on cpu_active vs cpu_online:
-// *
-// *  - cpu_active must be a subset of cpu_online
-// *
-// *  - on CPU-up we allow per-CPU kthreads on the online && !active CPU,
-// *    see __set_cpus_allowed_ptr(). At this point the newly online
-// *    CPU isn't yet part of the sched domains, and balancing will not
-// *    see it.
-// *
-// *  - on CPU-down we clear cpu_active() to mask the sched domains and
-// *    avoid the load balancer to place new tasks on the to be removed
-// *    CPU. Existing tasks will remain running there and will be taken
-// *    off.
-// *
-// * This means that fallback selection must not select !active CPUs.
-// * And can assume that any active CPU must be online. Conversely
-// * select_task_rq() below may allow selection of !active CPUs in order
-// * to satisfy the above rules.
-// */
-//static int select_fallback_rq(int cpu, struct task_struct *p)
-//{
-//	int nid = cpu_to_node(cpu);
-//	const struct cpumask *nodemask = NULL;
-//	enum { cpuset, possible, fail } state = cpuset;
-//	int dest_cpu;
-//
-//	/*
-//	 * If the node that the CPU is on has been offlined, cpu_to_node()
-//	 * will return -1. There is no CPU on the node, and we should
-//	 * select the CPU on the other node.
-//	 */
-//	if (nid != -1) {
-//		nodemask = cpumask_of_node(nid);
-//
-//		/* Look for allowed, online CPU in same node. */
-//		for_each_cpu(dest_cpu, nodemask) {
-//			if (!cpu_active(dest_cpu))
-//				continue;
-//			if (cpumask_test_cpu(dest_cpu, p->cpus_ptr))
-//				return dest_cpu;
-//		}
-//	}
-//
-//	for (;;) {
-//		/* Any allowed, online CPU? */
-//		for_each_cpu(dest_cpu, p->cpus_ptr) {
-//			if (!is_cpu_allowed(p, dest_cpu))
-//				continue;
-//
-//			goto out;
-//		}
-//
-//		/* No more Mr. Nice Guy. */
-//		switch (state) {
-//		case cpuset:
-//			if (IS_ENABLED(CONFIG_CPUSETS)) {
-//				cpuset_cpus_allowed_fallback(p);
-//				state = possible;
-//				break;
-//			}
-//			fallthrough;
-//		case possible:
-//			do_set_cpus_allowed(p, cpu_possible_mask);
-//			state = fail;
-//			break;
-//
-//		case fail:
-//			BUG();
-//			break;
-//		}
-//	}
-//
-//out:
-//	if (state != cpuset) {
-//		/*
-//		 * Don't tell them about moving exiting tasks or
-//		 * kernel threads (both mm NULL), since they never
-//		 * leave kernel.
-//		 */
-//		if (p->mm && printk_ratelimit()) {
-//			printk_deferred("process %d (%s) no longer affine to cpu%d\n",
-//					task_pid_nr(p), p->comm, cpu);
-//		}
-//	}
-//
-//	return dest_cpu;
-//}
-//
-///*
-// * The caller (fork, wakeup) owns p->pi_lock, ->cpus_ptr is stable.
-// */
-//static inline
-//int select_task_rq(struct task_struct *p, int cpu, int sd_flags, int wake_flags)
-//{
-//	lockdep_assert_held(&p->pi_lock);
-//
-//	if (p->nr_cpus_allowed > 1)
-//		cpu = p->sched_class->select_task_rq(p, cpu, sd_flags, wake_flags);
-//	else
-//		cpu = cpumask_any(p->cpus_ptr);
-//
-//	/*
-//	 * In order not to call set_task_cpu() on a blocking task we need
-//	 * to rely on ttwu() to place the task on a valid ->cpus_ptr
-//	 * CPU.
-//	 *
-//	 * Since this is common to all placement strategies, this lives here.
-//	 *
-//	 * [ this allows ->select_task() to simply return task_cpu(p) and
-//	 *   not worry about this generic constraint ]
-//	 */
-//	if (unlikely(!is_cpu_allowed(p, cpu)))
-//		cpu = select_fallback_rq(task_cpu(p), p);
-//
-//	return cpu;
-//}
-//
-//void sched_set_stop_task(int cpu, struct task_struct *stop)
-//{
-//	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
-//	struct task_struct *old_stop = cpu_rq(cpu)->stop;
-//
-//	if (stop) {
-//		/*
-//		 * Make it appear like a SCHED_FIFO task, its something
-//		 * userspace knows about and won't get confused about.
-//		 *
-//		 * Also, it will make PI more or less work without too
-//		 * much confusion -- but then, stop work should not
-//		 * rely on PI working anyway.
-//		 */
-//		sched_setscheduler_nocheck(stop, SCHED_FIFO, &param);
-//
-//		stop->sched_class = &stop_sched_class;
-//	}
-//
-//	cpu_rq(cpu)->stop = stop;
-//
-//	if (old_stop) {
-//		/*
-//		 * Reset it back to a normal scheduling class so that
-//		 * it can die in pieces.
-//		 */
-//		old_stop->sched_class = &rt_sched_class;
-//	}
-//}
-//
-//#else
-//
-//static inline int __set_cpus_allowed_ptr(struct task_struct *p,
-//					 const struct cpumask *new_mask, bool check)
-//{
-//	return set_cpus_allowed_ptr(p, new_mask);
-//}
-//
-//#endif /* CONFIG_SMP */
+#ifdef CONFIG_SMP
 
-static void
-ttwu_stat(struct task_struct *p, int cpu, int wake_flags)
+/*
+ * Per-CPU kthreads are allowed to run on !active && online CPUs, see
+ * __set_cpus_allowed_ptr() and select_fallback_rq().
+ */
+static inline bool is_cpu_allowed(struct task_struct *p, int cpu)
 {
-	struct rq *rq;
+	if (!cpumask_test_cpu(cpu, p->cpus_ptr))
+		return false;
 
-	if (!schedstat_enabled())
-		return;
+	if (is_per_cpu_kthread(p))
+		return cpu_online(cpu);
 
-	rq = this_rq();
+	return cpu_active(cpu);
+}
 
-#ifdef CONFIG_SMP
-	if (cpu == rq->cpu) {
-		__schedstat_inc(rq->ttwu_local);
-		__schedstat_inc(p->se.statistics.nr_wakeups_local);
-	} else {
-		struct sched_domain *sd;
+/*
+ * This is how migration works:
+ *
+ * 1) we invoke migration_cpu_stop() on the target CPU using
+ *    stop_one_cpu().
+ * 2) stopper starts to run (implicitly forcing the migrated thread
+ *    off the CPU)
+ * 3) it checks whether the migrated task is still in the wrong runqueue.
+ * 4) if it's in the wrong runqueue then the migration thread removes
+ *    it and puts it into the right queue.
+ * 5) stopper completes and stop_one_cpu() returns and the migration
+ *    is done.
+ */
 
-		__schedstat_inc(p->se.statistics.nr_wakeups_remote);
-		rcu_read_lock();
-		for_each_domain(rq->cpu, sd) {
-			if (cpumask_test_cpu(cpu, sched_domain_span(sd))) {
-				__schedstat_inc(sd->ttwu_wake_remote);
-				break;
-			}
-		}
-		rcu_read_unlock();
-	}
+/*
+ * move_queued_task - move a queued task to new rq.
+ *
+ * Returns (locked) new rq. Old rq's lock is released.
+ */
+static struct rq *move_queued_task(struct rq *rq, struct rq_flags *rf,
+				   struct task_struct *p, int new_cpu)
+{
+	lockdep_assert_held(&rq->lock);
 
-	if (wake_flags & WF_MIGRATED)
-		__schedstat_inc(p->se.statistics.nr_wakeups_migrate);
-#endif /* CONFIG_SMP */
+	deactivate_task(rq, p, DEQUEUE_NOCLOCK);
+	set_task_cpu(p, new_cpu);
+	rq_unlock(rq, rf);
 
-	__schedstat_inc(rq->ttwu_count);
-	__schedstat_inc(p->se.statistics.nr_wakeups);
+	rq = cpu_rq(new_cpu);
 
-	if (wake_flags & WF_SYNC)
-		__schedstat_inc(p->se.statistics.nr_wakeups_sync);
+	rq_lock(rq, rf);
+	BUG_ON(task_cpu(p) != new_cpu);
+	activate_task(rq, p, 0);
+	check_preempt_curr(rq, p, 0);
+
+	return rq;
 }
 
+struct migration_arg {
+	struct task_struct *task;
+	int dest_cpu;
+};
+
 /*
- * Mark the task runnable and perform wakeup-preemption.
+ * Move (not current) task off this CPU, onto the destination CPU. We're doing
+ * this because either it can't run here any more (set_cpus_allowed()
+ * away from this CPU, or CPU going down), or because we're
+ * attempting to rebalance this task on exec (sched_exec).
+ *
+ * So we race with normal scheduler movements, but that's OK, as long
+ * as the task is no longer on this CPU.
  */
-static void ttwu_do_wakeup(struct rq *rq, struct task_struct *p, int wake_flags,
-			   struct rq_flags *rf)
+static struct rq *__migrate_task(struct rq *rq, struct rq_flags *rf,
+				 struct task_struct *p, int dest_cpu)
 {
-	check_preempt_curr(rq, p, wake_flags);
-	p->state = TASK_RUNNING;
-	trace_sched_wakeup(p);
+	/* Affinity changed (again). */
+	if (!is_cpu_allowed(p, dest_cpu))
+		return rq;
 
-#ifdef CONFIG_SMP
-	if (p->sched_class->task_woken) {
-		/*
-		 * Our task @p is fully woken up and running; so its safe to
-		 * drop the rq->lock, hereafter rq is only used for statistics.
-		 */
-		rq_unpin_lock(rq, rf);
-		p->sched_class->task_woken(rq, p);
-		rq_repin_lock(rq, rf);
-	}
+	update_rq_clock(rq);
+	rq = move_queued_task(rq, rf, p, dest_cpu);
 
-	if (rq->idle_stamp) {
-		u64 delta = rq_clock(rq) - rq->idle_stamp;
-		u64 max = 2*rq->max_idle_balance_cost;
+	return rq;
+}
 
-		update_avg(&rq->avg_idle, delta);
+/*
+ * migration_cpu_stop - this will be executed by a highprio stopper thread
+ * and performs thread migration by bumping thread off CPU then
+ * 'pushing' onto another runqueue.
+ */
+static int migration_cpu_stop(void *data)
+{
+	struct migration_arg *arg = data;
+	struct task_struct *p = arg->task;
+	struct rq *rq = this_rq();
+	struct rq_flags rf;
 
-		if (rq->avg_idle > max)
-			rq->avg_idle = max;
+	/*
+	 * The original target CPU might have gone down and we might
+	 * be on another CPU but it doesn't matter.
+	 */
+	local_irq_disable();
+	/*
+	 * We need to explicitly wake pending tasks before running
+	 * __migrate_task() such that we will not miss enforcing cpus_ptr
+	 * during wakeups, see set_cpus_allowed_ptr()'s TASK_WAKING test.
+	 */
+	flush_smp_call_function_from_idle();
 
-		rq->idle_stamp = 0;
+	raw_spin_lock(&p->pi_lock);
+	rq_lock(rq, &rf);
+	/*
+	 * If task_rq(p) != rq, it cannot be migrated here, because we're
+	 * holding rq->lock, if p->on_rq == 0 it cannot get enqueued because
+	 * we're holding p->pi_lock.
+	 */
+	if (task_rq(p) == rq) {
+		if (task_on_rq_queued(p))
+			rq = __migrate_task(rq, &rf, p, arg->dest_cpu);
+		else
+			p->wake_cpu = arg->dest_cpu;
 	}
-#endif
+	rq_unlock(rq, &rf);
+	raw_spin_unlock(&p->pi_lock);
+
+	local_irq_enable();
+	return 0;
 }
 
-static void
-ttwu_do_activate(struct rq *rq, struct task_struct *p, int wake_flags,
-		 struct rq_flags *rf)
+/*
+ * sched_class::set_cpus_allowed must do the below, but is not required to
+ * actually call this function.
+ */
+void set_cpus_allowed_common(struct task_struct *p, const struct cpumask *new_mask)
 {
-	int en_flags = ENQUEUE_WAKEUP | ENQUEUE_NOCLOCK;
+	cpumask_copy(&p->cpus_mask, new_mask);
+	p->nr_cpus_allowed = cpumask_weight(new_mask);
+}
 
-	lockdep_assert_held(&rq->lock);
+void do_set_cpus_allowed(struct task_struct *p, const struct cpumask *new_mask)
+{
+	struct rq *rq = task_rq(p);
+	bool queued, running;
 
-	if (p->sched_contributes_to_load)
-		rq->nr_uninterruptible--;
+	lockdep_assert_held(&p->pi_lock);
 
-#ifdef CONFIG_SMP
-	if (wake_flags & WF_MIGRATED)
-		en_flags |= ENQUEUE_MIGRATED;
-#endif
+	queued = task_on_rq_queued(p);
+	running = task_current(rq, p);
 
-	activate_task(rq, p, en_flags);
-	ttwu_do_wakeup(rq, p, wake_flags, rf);
+	if (queued) {
+		/*
+		 * Because __kthread_bind() calls this on blocked tasks without
+		 * holding rq->lock.
+		 */
+		lockdep_assert_held(&rq->lock);
+		dequeue_task(rq, p, DEQUEUE_SAVE | DEQUEUE_NOCLOCK);
+	}
+	if (running)
+		put_prev_task(rq, p);
+
+	p->sched_class->set_cpus_allowed(p, new_mask);
+
+	if (queued)
+		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
+	if (running)
+		set_next_task(rq, p);
 }
+EXPORT_SYMBOL(do_set_cpus_allowed);
 
 /*
- * Consider @p being inside a wait loop:
- *
- *   for (;;) {
- *      set_current_state(TASK_UNINTERRUPTIBLE);
- *
- *      if (CONDITION)
- *         break;
- *
- *      schedule();
- *   }
- *   __set_current_state(TASK_RUNNING);
- *
- * between set_current_state() and schedule(). In this case @p is still
- * runnable, so all that needs doing is change p->state back to TASK_RUNNING in
- * an atomic manner.
- *
- * By taking task_rq(p)->lock we serialize against schedule(), if @p->on_rq
- * then schedule() must still happen and p->state can be changed to
- * TASK_RUNNING. Otherwise we lost the race, schedule() has happened, and we
- * need to do a full wakeup with enqueue.
+ * Change a given task's CPU affinity. Migrate the thread to a
+ * proper CPU and schedule it away if the CPU it's executing on
+ * is removed from the allowed bitmask.
  *
- * Returns: %true when the wakeup is done,
- *          %false otherwise.
+ * NOTE: the caller must have a valid reference to the task, the
+ * task must not exit() & deallocate itself prematurely. The
+ * call is not atomic; no spinlocks may be held.
  */
-static int ttwu_runnable(struct task_struct *p, int wake_flags)
+static int __set_cpus_allowed_ptr(struct task_struct *p,
+				  const struct cpumask *new_mask, bool check)
 {
+	const struct cpumask *cpu_valid_mask = cpu_active_mask;
+	unsigned int dest_cpu;
 	struct rq_flags rf;
 	struct rq *rq;
 	int ret = 0;
 
-	rq = __task_rq_lock(p, &rf);
-	if (task_on_rq_queued(p)) {
-		/* check_preempt_curr() may use rq clock */
-		update_rq_clock(rq);
-		ttwu_do_wakeup(rq, p, wake_flags, &rf);
-		ret = 1;
-	}
-	__task_rq_unlock(rq, &rf);
+	rq = task_rq_lock(p, &rf);
+	update_rq_clock(rq);
 
-	return ret;
-}
+	if (p->flags & PF_KTHREAD) {
+		/*
+		 * Kernel threads are allowed on online && !active CPUs
+		 */
+		cpu_valid_mask = cpu_online_mask;
+	}
 
-#ifdef CONFIG_SMP
-//void sched_ttwu_pending(void *arg)
-//{
-//	struct llist_node *llist = arg;
-//	struct rq *rq = this_rq();
-//	struct task_struct *p, *t;
-//	struct rq_flags rf;
-//
-//	if (!llist)
-//		return;
-//
-//	/*
-//	 * rq::ttwu_pending racy indication of out-standing wakeups.
-//	 * Races such that false-negatives are possible, since they
-//	 * are shorter lived that false-positives would be.
-//	 */
-//	WRITE_ONCE(rq->ttwu_pending, 0);
-//
-//	rq_lock_irqsave(rq, &rf);
-//	update_rq_clock(rq);
-//
-//	llist_for_each_entry_safe(p, t, llist, wake_entry.llist) {
-//		if (WARN_ON_ONCE(p->on_cpu))
-//			smp_cond_load_acquire(&p->on_cpu, !VAL);
-//
-//		if (WARN_ON_ONCE(task_cpu(p) != cpu_of(rq)))
-//			set_task_cpu(p, cpu_of(rq));
-//
-//		ttwu_do_activate(rq, p, p->sched_remote_wakeup ? WF_MIGRATED : 0, &rf);
-//	}
-//
-//	rq_unlock_irqrestore(rq, &rf);
-//}
-//
-//void send_call_function_single_ipi(int cpu)
-//{
-//	struct rq *rq = cpu_rq(cpu);
-//
-//	if (!set_nr_if_polling(rq->idle))
-//		arch_send_call_function_single_ipi(cpu);
-//	else
-//		trace_sched_wake_idle_without_ipi(cpu);
-//}
+	/*
+	 * Must re-check here, to close a race against __kthread_bind(),
+	 * sched_setaffinity() is not guaranteed to observe the flag.
+	 */
+	if (check && (p->flags & PF_NO_SETAFFINITY)) {
+		ret = -EINVAL;
+		goto out;
+	}
 
-/*
- * Queue a task on the target CPUs wake_list and wake the CPU via IPI if
- * necessary. The wakee CPU on receipt of the IPI will queue the task
- * via sched_ttwu_wakeup() for activation so the wakee incurs the cost
- * of the wakeup instead of the waker.
- */
-static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
-{
-	struct rq *rq = cpu_rq(cpu);
+	if (cpumask_equal(&p->cpus_mask, new_mask))
+		goto out;
 
-	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
+	/*
+	 * Picking a ~random cpu helps in cases where we are changing affinity
+	 * for groups of tasks (ie. cpuset), so that load balancing is not
+	 * immediately required to distribute the tasks within their new mask.
+	 */
+	dest_cpu = cpumask_any_and_distribute(cpu_valid_mask, new_mask);
+	if (dest_cpu >= nr_cpu_ids) {
+		ret = -EINVAL;
+		goto out;
+	}
 
-	WRITE_ONCE(rq->ttwu_pending, 1);
-	__smp_call_single_queue(cpu, &p->wake_entry.llist);
-}
+	do_set_cpus_allowed(p, new_mask);
 
-//void wake_up_if_idle(int cpu)
-//{
-//	struct rq *rq = cpu_rq(cpu);
-//	struct rq_flags rf;
-//
-//	rcu_read_lock();
-//
-//	if (!is_idle_task(rcu_dereference(rq->curr)))
-//		goto out;
-//
-//	if (set_nr_if_polling(rq->idle)) {
-//		trace_sched_wake_idle_without_ipi(cpu);
-//	} else {
-//		rq_lock_irqsave(rq, &rf);
-//		if (is_idle_task(rq->curr))
-//			smp_send_reschedule(cpu);
-//		/* Else CPU is not idle, do nothing here: */
-//		rq_unlock_irqrestore(rq, &rf);
-//	}
-//
-//out:
-//	rcu_read_unlock();
-//}
-//
-//bool cpus_share_cache(int this_cpu, int that_cpu)
-//{
-//	return per_cpu(sd_llc_id, this_cpu) == per_cpu(sd_llc_id, that_cpu);
-//}
-//
-//static inline bool ttwu_queue_cond(int cpu, int wake_flags)
-//{
-//	/*
-//	 * If the CPU does not share cache, then queue the task on the
-//	 * remote rqs wakelist to avoid accessing remote data.
-//	 */
-//	if (!cpus_share_cache(smp_processor_id(), cpu))
-//		return true;
-//
-//	/*
-//	 * If the task is descheduling and the only running task on the
-//	 * CPU then use the wakelist to offload the task activation to
-//	 * the soon-to-be-idle CPU as the current CPU is likely busy.
-//	 * nr_running is checked to avoid unnecessary task stacking.
-//	 */
-//	if ((wake_flags & WF_ON_CPU) && cpu_rq(cpu)->nr_running <= 1)
-//		return true;
-//
-//	return false;
-//}
+	if (p->flags & PF_KTHREAD) {
+		/*
+		 * For kernel threads that do indeed end up on online &&
+		 * !active we want to ensure they are strict per-CPU threads.
+		 */
+		WARN_ON(cpumask_intersects(new_mask, cpu_online_mask) &&
+			!cpumask_intersects(new_mask, cpu_active_mask) &&
+			p->nr_cpus_allowed != 1);
+	}
 
-static bool ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
-{
-	if (sched_feat(TTWU_QUEUE) && ttwu_queue_cond(cpu, wake_flags)) {
-		if (WARN_ON_ONCE(cpu == smp_processor_id()))
-			return false;
+	/* Can the task run on the task's current CPU? If so, we're done */
+	if (cpumask_test_cpu(task_cpu(p), new_mask))
+		goto out;
 
-		sched_clock_cpu(cpu); /* Sync clocks across CPUs */
-		__ttwu_queue_wakelist(p, cpu, wake_flags);
-		return true;
+	if (task_running(rq, p) || p->state == TASK_WAKING) {
+		struct migration_arg arg = { p, dest_cpu };
+		/* Need help from migration thread: drop lock and wait. */
+		task_rq_unlock(rq, p, &rf);
+		stop_one_cpu(cpu_of(rq), migration_cpu_stop, &arg);
+		return 0;
+	} else if (task_on_rq_queued(p)) {
+		/*
+		 * OK, since we're going to drop the lock immediately
+		 * afterwards anyway.
+		 */
+		rq = move_queued_task(rq, &rf, p, dest_cpu);
 	}
+out:
+	task_rq_unlock(rq, p, &rf);
 
-	return false;
+	return ret;
 }
 
-#else /* !CONFIG_SMP */
-
-static inline bool ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
+int set_cpus_allowed_ptr(struct task_struct *p, const struct cpumask *new_mask)
 {
-	return false;
+	return __set_cpus_allowed_ptr(p, new_mask, false);
 }
+EXPORT_SYMBOL_GPL(set_cpus_allowed_ptr);
 
-#endif /* CONFIG_SMP */
-
-static void ttwu_queue(struct task_struct *p, int cpu, int wake_flags)
+void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 {
-	struct rq *rq = cpu_rq(cpu);
-	struct rq_flags rf;
-
-	if (ttwu_queue_wakelist(p, cpu, wake_flags))
-		return;
+#ifdef CONFIG_SCHED_DEBUG
+	/*
+	 * We should never call set_task_cpu() on a blocked task,
+	 * ttwu() will sort out the placement.
+	 */
+	WARN_ON_ONCE(p->state != TASK_RUNNING && p->state != TASK_WAKING &&
+			!p->on_rq);
 
-	rq_lock(rq, &rf);
-	update_rq_clock(rq);
-	ttwu_do_activate(rq, p, wake_flags, &rf);
-	rq_unlock(rq, &rf);
-}
+	/*
+	 * Migrating fair class task must have p->on_rq = TASK_ON_RQ_MIGRATING,
+	 * because schedstat_wait_{start,end} rebase migrating task's wait_start
+	 * time relying on p->on_rq.
+	 */
+	WARN_ON_ONCE(p->state == TASK_RUNNING &&
+		     p->sched_class == &fair_sched_class &&
+		     (p->on_rq && !task_on_rq_migrating(p)));
 
-///*
-// * Notes on Program-Order guarantees on SMP systems.
-// *
-// *  MIGRATION
-// *
-// * The basic program-order guarantee on SMP systems is that when a task [t]
-// * migrates, all its activity on its old CPU [c0] happens-before any subsequent
-// * execution on its new CPU [c1].
-// *
-// * For migration (of runnable tasks) this is provided by the following means:
-// *
-// *  A) UNLOCK of the rq(c0)->lock scheduling out task t
-// *  B) migration for t is required to synchronize *both* rq(c0)->lock and
-// *     rq(c1)->lock (if not at the same time, then in that order).
-// *  C) LOCK of the rq(c1)->lock scheduling in task
-// *
-// * Release/acquire chaining guarantees that B happens after A and C after B.
-// * Note: the CPU doing B need not be c0 or c1
-// *
-// * Example:
-// *
-// *   CPU0            CPU1            CPU2
-// *
-// *   LOCK rq(0)->lock
-// *   sched-out X
-// *   sched-in Y
-// *   UNLOCK rq(0)->lock
-// *
-// *                                   LOCK rq(0)->lock // orders against CPU0
-// *                                   dequeue X
-// *                                   UNLOCK rq(0)->lock
-// *
-// *                                   LOCK rq(1)->lock
-// *                                   enqueue X
-// *                                   UNLOCK rq(1)->lock
-// *
-// *                   LOCK rq(1)->lock // orders against CPU2
-// *                   sched-out Z
-// *                   sched-in X
-// *                   UNLOCK rq(1)->lock
-// *
-// *
-// *  BLOCKING -- aka. SLEEP + WAKEUP
-// *
-// * For blocking we (obviously) need to provide the same guarantee as for
-// * migration. However the means are completely different as there is no lock
-// * chain to provide order. Instead we do:
-// *
-// *   1) smp_store_release(X->on_cpu, 0)   -- finish_task()
-// *   2) smp_cond_load_acquire(!X->on_cpu) -- try_to_wake_up()
-// *
-// * Example:
-// *
-// *   CPU0 (schedule)  CPU1 (try_to_wake_up) CPU2 (schedule)
-// *
-// *   LOCK rq(0)->lock LOCK X->pi_lock
-// *   dequeue X
-// *   sched-out X
-// *   smp_store_release(X->on_cpu, 0);
-// *
-// *                    smp_cond_load_acquire(&X->on_cpu, !VAL);
-// *                    X->state = WAKING
-// *                    set_task_cpu(X,2)
-// *
-// *                    LOCK rq(2)->lock
-// *                    enqueue X
-// *                    X->state = RUNNING
-// *                    UNLOCK rq(2)->lock
-// *
-// *                                          LOCK rq(2)->lock // orders against CPU1
-// *                                          sched-out Z
-// *                                          sched-in X
-// *                                          UNLOCK rq(2)->lock
-// *
-// *                    UNLOCK X->pi_lock
-// *   UNLOCK rq(0)->lock
-// *
-// *
-// * However, for wakeups there is a second guarantee we must provide, namely we
-// * must ensure that CONDITION=1 done by the caller can not be reordered with
-// * accesses to the task state; see try_to_wake_up() and set_current_state().
-// */
+#ifdef CONFIG_LOCKDEP
+	/*
+	 * The caller should hold either p->pi_lock or rq->lock, when changing
+	 * a task's CPU. ->pi_lock for waking tasks, rq->lock for runnable tasks.
+	 *
+	 * sched_move_task() holds both and thus holding either pins the cgroup,
+	 * see task_group().
+	 *
+	 * Furthermore, all task_rq users should acquire both locks, see
+	 * task_rq_lock().
+	 */
+	WARN_ON_ONCE(debug_locks && !(lockdep_is_held(&p->pi_lock) ||
+				      lockdep_is_held(&task_rq(p)->lock)));
+#endif
+	/*
+	 * Clearly, migrating tasks to offline CPUs is a fairly daft thing.
+	 */
+	WARN_ON_ONCE(!cpu_online(new_cpu));
+#endif
 
-/**
- * try_to_wake_up - wake up a thread
- * @p: the thread to be awakened
- * @state: the mask of task states that can be woken
- * @wake_flags: wake modifier flags (WF_*)
- *
- * Conceptually does:
- *
- *   If (@state & @p->state) @p->state = TASK_RUNNING.
- *
- * If the task was not queued/runnable, also place it back on a runqueue.
- *
- * This function is atomic against schedule() which would dequeue the task.
- *
- * It issues a full memory barrier before accessing @p->state, see the comment
- * with set_current_state().
- *
- * Uses p->pi_lock to serialize against concurrent wake-ups.
- *
- * Relies on p->pi_lock stabilizing:
- *  - p->sched_class
- *  - p->cpus_ptr
- *  - p->sched_task_group
- * in order to do migration, see its use of select_task_rq()/set_task_cpu().
- *
- * Tries really hard to only take one task_rq(p)->lock for performance.
- * Takes rq->lock in:
- *  - ttwu_runnable()    -- old rq, unavoidable, see comment there;
- *  - ttwu_queue()       -- new rq, for enqueue of the task;
- *  - psi_ttwu_dequeue() -- much sadness :-( accounting will kill us.
- *
- * As a consequence we race really badly with just about everything. See the
- * many memory barriers and their comments for details.
- *
- * Return: %true if @p->state changes (an actual wakeup was done),
- *	   %false otherwise.
- */
-static int
-try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
+	trace_sched_migrate_task(p, new_cpu);
+
+	if (task_cpu(p) != new_cpu) {
+		if (p->sched_class->migrate_task_rq)
+			p->sched_class->migrate_task_rq(p, new_cpu);
+		p->se.nr_migrations++;
+		rseq_migrate(p);
+		perf_event_task_migrate(p);
+	}
+
+	__set_task_cpu(p, new_cpu);
+}
+
+#ifdef CONFIG_NUMA_BALANCING
+static void __migrate_swap_task(struct task_struct *p, int cpu)
 {
-	unsigned long flags;
-	int cpu, success = 0;
+	if (task_on_rq_queued(p)) {
+		struct rq *src_rq, *dst_rq;
+		struct rq_flags srf, drf;
 
-	preempt_disable();
-	if (p == current) {
+		src_rq = task_rq(p);
+		dst_rq = cpu_rq(cpu);
+
+		rq_pin_lock(src_rq, &srf);
+		rq_pin_lock(dst_rq, &drf);
+
+		deactivate_task(src_rq, p, 0);
+		set_task_cpu(p, cpu);
+		activate_task(dst_rq, p, 0);
+		check_preempt_curr(dst_rq, p, 0);
+
+		rq_unpin_lock(dst_rq, &drf);
+		rq_unpin_lock(src_rq, &srf);
+
+	} else {
 		/*
-		 * We're waking current, this means 'p->on_rq' and 'task_cpu(p)
-		 * == smp_processor_id()'. Together this means we can special
-		 * case the whole 'p->on_rq && ttwu_runnable()' case below
-		 * without taking any locks.
-		 *
-		 * In particular:
-		 *  - we rely on Program-Order guarantees for all the ordering,
-		 *  - we're serialized against set_special_state() by virtue of
-		 *    it disabling IRQs (this allows not taking ->pi_lock).
+		 * Task isn't running anymore; make it appear like we migrated
+		 * it before it went to sleep. This means on wakeup we make the
+		 * previous CPU our target instead of where it really is.
 		 */
-		if (!(p->state & state))
-			goto out;
-
-		success = 1;
-		trace_sched_waking(p);
-		p->state = TASK_RUNNING;
-		trace_sched_wakeup(p);
-		goto out;
+		p->wake_cpu = cpu;
 	}
+}
 
-	/*
-	 * If we are going to wake up a thread waiting for CONDITION we
-	 * need to ensure that CONDITION=1 done by the caller can not be
-	 * reordered with p->state check below. This pairs with smp_store_mb()
-	 * in set_current_state() that the waiting thread does.
-	 */
-	raw_spin_lock_irqsave(&p->pi_lock, flags);
-	smp_mb__after_spinlock();
-	if (!(p->state & state))
+struct migration_swap_arg {
+	struct task_struct *src_task, *dst_task;
+	int src_cpu, dst_cpu;
+};
+
+static int migrate_swap_stop(void *data)
+{
+	struct migration_swap_arg *arg = data;
+	struct rq *src_rq, *dst_rq;
+	int ret = -EAGAIN;
+
+	if (!cpu_active(arg->src_cpu) || !cpu_active(arg->dst_cpu))
+		return -EAGAIN;
+
+	src_rq = cpu_rq(arg->src_cpu);
+	dst_rq = cpu_rq(arg->dst_cpu);
+
+	double_raw_lock(&arg->src_task->pi_lock,
+			&arg->dst_task->pi_lock);
+	double_rq_lock(src_rq, dst_rq);
+
+	if (task_cpu(arg->dst_task) != arg->dst_cpu)
 		goto unlock;
 
-	trace_sched_waking(p);
+	if (task_cpu(arg->src_task) != arg->src_cpu)
+		goto unlock;
 
-	/* We're going to change ->state: */
-	success = 1;
+	if (!cpumask_test_cpu(arg->dst_cpu, arg->src_task->cpus_ptr))
+		goto unlock;
 
-	/*
-	 * Ensure we load p->on_rq _after_ p->state, otherwise it would
-	 * be possible to, falsely, observe p->on_rq == 0 and get stuck
-	 * in smp_cond_load_acquire() below.
-	 *
-	 * sched_ttwu_pending()			try_to_wake_up()
-	 *   STORE p->on_rq = 1			  LOAD p->state
-	 *   UNLOCK rq->lock
-	 *
-	 * __schedule() (switch to task 'p')
-	 *   LOCK rq->lock			  smp_rmb();
-	 *   smp_mb__after_spinlock();
-	 *   UNLOCK rq->lock
-	 *
-	 * [task p]
-	 *   STORE p->state = UNINTERRUPTIBLE	  LOAD p->on_rq
-	 *
-	 * Pairs with the LOCK+smp_mb__after_spinlock() on rq->lock in
-	 * __schedule().  See the comment for smp_mb__after_spinlock().
-	 *
-	 * A similar smb_rmb() lives in try_invoke_on_locked_down_task().
-	 */
-	smp_rmb();
-	if (READ_ONCE(p->on_rq) && ttwu_runnable(p, wake_flags))
+	if (!cpumask_test_cpu(arg->src_cpu, arg->dst_task->cpus_ptr))
 		goto unlock;
 
-	if (p->in_iowait) {
-		delayacct_blkio_end(p);
-		atomic_dec(&task_rq(p)->nr_iowait);
-	}
+	__migrate_swap_task(arg->src_task, arg->dst_cpu);
+	__migrate_swap_task(arg->dst_task, arg->src_cpu);
 
-#ifdef CONFIG_SMP
-	/*
-	 * Ensure we load p->on_cpu _after_ p->on_rq, otherwise it would be
-	 * possible to, falsely, observe p->on_cpu == 0.
-	 *
-	 * One must be running (->on_cpu == 1) in order to remove oneself
-	 * from the runqueue.
-	 *
-	 * __schedule() (switch to task 'p')	try_to_wake_up()
-	 *   STORE p->on_cpu = 1		  LOAD p->on_rq
-	 *   UNLOCK rq->lock
-	 *
-	 * __schedule() (put 'p' to sleep)
-	 *   LOCK rq->lock			  smp_rmb();
-	 *   smp_mb__after_spinlock();
-	 *   STORE p->on_rq = 0			  LOAD p->on_cpu
-	 *
-	 * Pairs with the LOCK+smp_mb__after_spinlock() on rq->lock in
-	 * __schedule().  See the comment for smp_mb__after_spinlock().
-	 *
-	 * Form a control-dep-acquire with p->on_rq == 0 above, to ensure
-	 * schedule()'s deactivate_task() has 'happened' and p will no longer
-	 * care about it's own p->state. See the comment in __schedule().
-	 */
-	smp_acquire__after_ctrl_dep();
+	ret = 0;
+
+unlock:
+	double_rq_unlock(src_rq, dst_rq);
+	raw_spin_unlock(&arg->dst_task->pi_lock);
+	raw_spin_unlock(&arg->src_task->pi_lock);
+
+	return ret;
+}
+
+/*
+ * Cross migrate two tasks
+ */
+int migrate_swap(struct task_struct *cur, struct task_struct *p,
+		int target_cpu, int curr_cpu)
+{
+	struct migration_swap_arg arg;
+	int ret = -EINVAL;
+
+	arg = (struct migration_swap_arg){
+		.src_task = cur,
+		.src_cpu = curr_cpu,
+		.dst_task = p,
+		.dst_cpu = target_cpu,
+	};
+
+	if (arg.src_cpu == arg.dst_cpu)
+		goto out;
 
 	/*
-	 * We're doing the wakeup (@success == 1), they did a dequeue (p->on_rq
-	 * == 0), which means we need to do an enqueue, change p->state to
-	 * TASK_WAKING such that we can unlock p->pi_lock before doing the
-	 * enqueue, such as ttwu_queue_wakelist().
+	 * These three tests are all lockless; this is OK since all of them
+	 * will be re-checked with proper locks held further down the line.
 	 */
-	p->state = TASK_WAKING;
+	if (!cpu_active(arg.src_cpu) || !cpu_active(arg.dst_cpu))
+		goto out;
 
-	/*
-	 * If the owning (remote) CPU is still in the middle of schedule() with
-	 * this task as prev, considering queueing p on the remote CPUs wake_list
-	 * which potentially sends an IPI instead of spinning on p->on_cpu to
-	 * let the waker make forward progress. This is safe because IRQs are
-	 * disabled and the IPI will deliver after on_cpu is cleared.
-	 *
-	 * Ensure we load task_cpu(p) after p->on_cpu:
-	 *
-	 * set_task_cpu(p, cpu);
-	 *   STORE p->cpu = @cpu
-	 * __schedule() (switch to task 'p')
-	 *   LOCK rq->lock
-	 *   smp_mb__after_spin_lock()		smp_cond_load_acquire(&p->on_cpu)
-	 *   STORE p->on_cpu = 1		LOAD p->cpu
-	 *
-	 * to ensure we observe the correct CPU on which the task is currently
-	 * scheduling.
-	 */
-	if (smp_load_acquire(&p->on_cpu) &&
-	    ttwu_queue_wakelist(p, task_cpu(p), wake_flags | WF_ON_CPU))
-		goto unlock;
+	if (!cpumask_test_cpu(arg.dst_cpu, arg.src_task->cpus_ptr))
+		goto out;
 
-	/*
-	 * If the owning (remote) CPU is still in the middle of schedule() with
-	 * this task as prev, wait until its done referencing the task.
-	 *
-	 * Pairs with the smp_store_release() in finish_task().
-	 *
-	 * This ensures that tasks getting woken will be fully ordered against
-	 * their previous state and preserve Program Order.
-	 */
-	smp_cond_load_acquire(&p->on_cpu, !VAL);
+	if (!cpumask_test_cpu(arg.src_cpu, arg.dst_task->cpus_ptr))
+		goto out;
 
-	cpu = select_task_rq(p, p->wake_cpu, SD_BALANCE_WAKE, wake_flags);
-	if (task_cpu(p) != cpu) {
-		wake_flags |= WF_MIGRATED;
-		psi_ttwu_dequeue(p);
-		set_task_cpu(p, cpu);
-	}
-#else
-	cpu = task_cpu(p);
-#endif /* CONFIG_SMP */
+	trace_sched_swap_numa(cur, arg.src_cpu, p, arg.dst_cpu);
+	ret = stop_two_cpus(arg.dst_cpu, arg.src_cpu, migrate_swap_stop, &arg);
 
-	ttwu_queue(p, cpu, wake_flags);
-unlock:
-	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
 out:
-	if (success)
-		ttwu_stat(p, task_cpu(p), wake_flags);
-	preempt_enable();
-
-	return success;
+	return ret;
 }
+#endif /* CONFIG_NUMA_BALANCING */
 
-///**
-// * try_invoke_on_locked_down_task - Invoke a function on task in fixed state
-// * @p: Process for which the function is to be invoked.
-// * @func: Function to invoke.
-// * @arg: Argument to function.
-// *
-// * If the specified task can be quickly locked into a definite state
-// * (either sleeping or on a given runqueue), arrange to keep it in that
-// * state while invoking @func(@arg).  This function can use ->on_rq and
-// * task_curr() to work out what the state is, if required.  Given that
-// * @func can be invoked with a runqueue lock held, it had better be quite
-// * lightweight.
-// *
-// * Returns:
-// *	@false if the task slipped out from under the locks.
-// *	@true if the task was locked onto a runqueue or is sleeping.
-// *		However, @func can override this by returning @false.
-// */
-//bool try_invoke_on_locked_down_task(struct task_struct *p, bool (*func)(struct task_struct *t, void *arg), void *arg)
-//{
-//	bool ret = false;
-//	struct rq_flags rf;
-//	struct rq *rq;
-//
-//	lockdep_assert_irqs_enabled();
-//	raw_spin_lock_irq(&p->pi_lock);
-//	if (p->on_rq) {
-//		rq = __task_rq_lock(p, &rf);
-//		if (task_rq(p) == rq)
-//			ret = func(p, arg);
-//		rq_unlock(rq, &rf);
-//	} else {
-//		switch (p->state) {
-//		case TASK_RUNNING:
-//		case TASK_WAKING:
-//			break;
-//		default:
-//			smp_rmb(); // See smp_rmb() comment in try_to_wake_up().
-//			if (!p->on_rq)
-//				ret = func(p, arg);
-//		}
-//	}
-//	raw_spin_unlock_irq(&p->pi_lock);
-//	return ret;
-//}
-
-/**
- * wake_up_process - Wake up a specific process
- * @p: The process to be woken up.
- *
- * Attempt to wake up the nominated process and move it to the set of runnable
- * processes.
+/*
+ * wait_task_inactive - wait for a thread to unschedule.
  *
- * Return: 1 if the process was woken up, 0 if it was already running.
+ * If @match_state is nonzero, it's the @p->state value just checked and
+ * not expected to change.  If it changes, i.e. @p might have woken up,
+ * then return zero.  When we succeed in waiting for @p to be off its CPU,
+ * we return a positive number (its total switch count).  If a second call
+ * a short while later returns the same number, the caller can be sure that
+ * @p has remained unscheduled the whole time.
  *
- * This function executes a full memory barrier before accessing the task state.
+ * The caller must ensure that the task *will* unschedule sometime soon,
+ * else this function might spin for a *long* time. This function can't
+ * be called with interrupts off, or it may introduce deadlock with
+ * smp_call_function() if an IPI is sent by the same process we are
+ * waiting to become inactive.
  */
-int wake_up_process(struct task_struct *p)
+unsigned long wait_task_inactive(struct task_struct *p, long match_state)
 {
-	return try_to_wake_up(p, TASK_NORMAL, 0);
+	int running, queued;
+	struct rq_flags rf;
+	unsigned long ncsw;
+	struct rq *rq;
+
+	for (;;) {
+		/*
+		 * We do the initial early heuristics without holding
+		 * any task-queue locks at all. We'll only try to get
+		 * the runqueue lock when things look like they will
+		 * work out!
+		 */
+		rq = task_rq(p);
+
+		/*
+		 * If the task is actively running on another CPU
+		 * still, just relax and busy-wait without holding
+		 * any locks.
+		 *
+		 * NOTE! Since we don't hold any locks, it's not
+		 * even sure that "rq" stays as the right runqueue!
+		 * But we don't care, since "task_running()" will
+		 * return false if the runqueue has changed and p
+		 * is actually now running somewhere else!
+		 */
+		while (task_running(rq, p)) {
+			if (match_state && unlikely(p->state != match_state))
+				return 0;
+			cpu_relax();
+		}
+
+		/*
+		 * Ok, time to look more closely! We need the rq
+		 * lock now, to be *sure*. If we're wrong, we'll
+		 * just go back and repeat.
+		 */
+		rq = task_rq_lock(p, &rf);
+		trace_sched_wait_task(p);
+		running = task_running(rq, p);
+		queued = task_on_rq_queued(p);
+		ncsw = 0;
+		if (!match_state || p->state == match_state)
+			ncsw = p->nvcsw | LONG_MIN; /* sets MSB */
+		task_rq_unlock(rq, p, &rf);
+
+		/*
+		 * If it changed from the expected state, bail out now.
+		 */
+		if (unlikely(!ncsw))
+			break;
+
+		/*
+		 * Was it really running after all now that we
+		 * checked with the proper locks actually held?
+		 *
+		 * Oops. Go back and try again..
+		 */
+		if (unlikely(running)) {
+			cpu_relax();
+			continue;
+		}
+
+		/*
+		 * It's not enough that it's not actively running,
+		 * it must be off the runqueue _entirely_, and not
+		 * preempted!
+		 *
+		 * So if it was still runnable (but just not actively
+		 * running right now), it's preempted, and we should
+		 * yield - it could be a while.
+		 */
+		if (unlikely(queued)) {
+			ktime_t to = NSEC_PER_SEC / HZ;
+
+			set_current_state(TASK_UNINTERRUPTIBLE);
+			schedule_hrtimeout(&to, HRTIMER_MODE_REL);
+			continue;
+		}
+
+		/*
+		 * Ahh, all good. It wasn't running, and it wasn't
+		 * runnable, which means that it will never become
+		 * running in the future either. We're all done!
+		 */
+		break;
+	}
+
+	return ncsw;
 }
+EXPORT_SYMBOL(wait_task_inactive);
 
-int wake_up_state(struct task_struct *p, unsigned int state)
+/***
+ * kick_process - kick a running thread to enter/exit the kernel
+ * @p: the to-be-kicked thread
+ *
+ * Cause a process which is running on another CPU to enter
+ * kernel-mode, without any delay. (to get signals handled.)
+ *
+ * NOTE: this function doesn't have to take the runqueue lock,
+ * because all it wants to ensure is that the remote task enters
+ * the kernel. If the IPI races and the task has been migrated
+ * to another CPU then no harm is done and the purpose has been
+ * achieved as well.
+ */
+void kick_process(struct task_struct *p)
 {
-	return try_to_wake_up(p, state, 0);
+	int cpu;
+
+	preempt_disable();
+	cpu = task_cpu(p);
+	if ((cpu != smp_processor_id()) && task_curr(p))
+		smp_send_reschedule(cpu);
+	preempt_enable();
 }
+EXPORT_SYMBOL_GPL(kick_process);
 
 /*
- * Perform scheduler related setup for a newly forked process p.
- * p is forked by current.
+ * ->cpus_ptr is protected by both rq->lock and p->pi_lock
  *
- * __sched_fork() is basic setup used by init_idle() too:
+ * A few notes on cpu_active vs cpu_online:
+ *
+ *  - cpu_active must be a subset of cpu_online
+ *
+ *  - on CPU-up we allow per-CPU kthreads on the online && !active CPU,
+ *    see __set_cpus_allowed_ptr(). At this point the newly online
+ *    CPU isn't yet part of the sched domains, and balancing will not
+ *    see it.
+ *
+ *  - on CPU-down we clear cpu_active() to mask the sched domains and
+ *    avoid the load balancer to place new tasks on the to be removed
+ *    CPU. Existing tasks will remain running there and will be taken
+ *    off.
+ *
+ * This means that fallback selection must not select !active CPUs.
+ * And can assume that any active CPU must be online. Conversely
+ * select_task_rq() below may allow selection of !active CPUs in order
+ * to satisfy the above rules.
  */
-static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
+static int select_fallback_rq(int cpu, struct task_struct *p)
 {
-	p->on_rq			= 0;
+	int nid = cpu_to_node(cpu);
+	const struct cpumask *nodemask = NULL;
+	enum { cpuset, possible, fail } state = cpuset;
+	int dest_cpu;
 
-	p->se.on_rq			= 0;
-	p->se.exec_start		= 0;
-	p->se.sum_exec_runtime		= 0;
-	p->se.prev_sum_exec_runtime	= 0;
-	p->se.nr_migrations		= 0;
-	p->se.vruntime			= 0;
-	INIT_LIST_HEAD(&p->se.group_node);
+	/*
+	 * If the node that the CPU is on has been offlined, cpu_to_node()
+	 * will return -1. There is no CPU on the node, and we should
+	 * select the CPU on the other node.
+	 */
+	if (nid != -1) {
+		nodemask = cpumask_of_node(nid);
+
+		/* Look for allowed, online CPU in same node. */
+		for_each_cpu(dest_cpu, nodemask) {
+			if (!cpu_active(dest_cpu))
+				continue;
+			if (cpumask_test_cpu(dest_cpu, p->cpus_ptr))
+				return dest_cpu;
+		}
+	}
 
-#ifdef CONFIG_FAIR_GROUP_SCHED
-	p->se.cfs_rq			= NULL;
-#endif
+	for (;;) {
+		/* Any allowed, online CPU? */
+		for_each_cpu(dest_cpu, p->cpus_ptr) {
+			if (!is_cpu_allowed(p, dest_cpu))
+				continue;
 
-#ifdef CONFIG_SCHEDSTATS
-	/* Even if schedstat is disabled, there should not be garbage */
-	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
-#endif
+			goto out;
+		}
 
-	RB_CLEAR_NODE(&p->dl.rb_node);
-	init_dl_task_timer(&p->dl);
-	init_dl_inactive_task_timer(&p->dl);
-	__dl_clear_params(p);
+		/* No more Mr. Nice Guy. */
+		switch (state) {
+		case cpuset:
+			if (IS_ENABLED(CONFIG_CPUSETS)) {
+				cpuset_cpus_allowed_fallback(p);
+				state = possible;
+				break;
+			}
+			fallthrough;
+		case possible:
+			do_set_cpus_allowed(p, cpu_possible_mask);
+			state = fail;
+			break;
 
-	INIT_LIST_HEAD(&p->rt.run_list);
-	p->rt.timeout		= 0;
-	p->rt.time_slice	= sched_rr_timeslice;
-	p->rt.on_rq		= 0;
-	p->rt.on_list		= 0;
+		case fail:
+			BUG();
+			break;
+		}
+	}
 
-#ifdef CONFIG_PREEMPT_NOTIFIERS
-	INIT_HLIST_HEAD(&p->preempt_notifiers);
-#endif
+out:
+	if (state != cpuset) {
+		/*
+		 * Don't tell them about moving exiting tasks or
+		 * kernel threads (both mm NULL), since they never
+		 * leave kernel.
+		 */
+		if (p->mm && printk_ratelimit()) {
+			printk_deferred("process %d (%s) no longer affine to cpu%d\n",
+					task_pid_nr(p), p->comm, cpu);
+		}
+	}
 
-#ifdef CONFIG_COMPACTION
-	p->capture_control = NULL;
-#endif
-	init_numa_balancing(clone_flags, p);
-#ifdef CONFIG_SMP
-	p->wake_entry.u_flags = CSD_TYPE_TTWU;
-#endif
+	return dest_cpu;
 }
 
-DEFINE_STATIC_KEY_FALSE(sched_numa_balancing);
+/*
+ * The caller (fork, wakeup) owns p->pi_lock, ->cpus_ptr is stable.
+ */
+static inline
+int select_task_rq(struct task_struct *p, int cpu, int sd_flags, int wake_flags)
+{
+	lockdep_assert_held(&p->pi_lock);
 
-//#ifdef CONFIG_NUMA_BALANCING
-//
-//void set_numabalancing_state(bool enabled)
-//{
-//	if (enabled)
-//		static_branch_enable(&sched_numa_balancing);
-//	else
-//		static_branch_disable(&sched_numa_balancing);
-//}
-//
-//#ifdef CONFIG_PROC_SYSCTL
-//int sysctl_numa_balancing(struct ctl_table *table, int write,
-//			  void *buffer, size_t *lenp, loff_t *ppos)
-//{
-//	struct ctl_table t;
-//	int err;
-//	int state = static_branch_likely(&sched_numa_balancing);
-//
-//	if (write && !capable(CAP_SYS_ADMIN))
-//		return -EPERM;
-//
-//	t = *table;
-//	t.data = &state;
-//	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
-//	if (err < 0)
-//		return err;
-//	if (write)
-//		set_numabalancing_state(state);
-//	return err;
-//}
-//#endif
-//#endif
-//
-#ifdef CONFIG_SCHEDSTATS
-//
-//DEFINE_STATIC_KEY_FALSE(sched_schedstats);
-//static bool __initdata __sched_schedstats = false;
+	if (p->nr_cpus_allowed > 1)
+		cpu = p->sched_class->select_task_rq(p, cpu, sd_flags, wake_flags);
+	else
+		cpu = cpumask_any(p->cpus_ptr);
 
-static void set_schedstats(bool enabled)
-{
-	if (enabled)
-		static_branch_enable(&sched_schedstats);
-	else
-		static_branch_disable(&sched_schedstats);
+	/*
+	 * In order not to call set_task_cpu() on a blocking task we need
+	 * to rely on ttwu() to place the task on a valid ->cpus_ptr
+	 * CPU.
+	 *
+	 * Since this is common to all placement strategies, this lives here.
+	 *
+	 * [ this allows ->select_task() to simply return task_cpu(p) and
+	 *   not worry about this generic constraint ]
+	 */
+	if (unlikely(!is_cpu_allowed(p, cpu)))
+		cpu = select_fallback_rq(task_cpu(p), p);
+
+	return cpu;
 }
 
-//void force_schedstat_enabled(void)
-//{
-//	if (!schedstat_enabled()) {
-//		pr_info("kernel profiling enabled schedstats, disable via kernel.sched_schedstats.\n");
-//		static_branch_enable(&sched_schedstats);
-//	}
-//}
-//
-//static int __init setup_schedstats(char *str)
-//{
-//	int ret = 0;
-//	if (!str)
-//		goto out;
-//
-//	/*
-//	 * This code is called before jump labels have been set up, so we can't
-//	 * change the static branch directly just yet.  Instead set a temporary
-//	 * variable so init_schedstats() can do it later.
-//	 */
-//	if (!strcmp(str, "enable")) {
-//		__sched_schedstats = true;
-//		ret = 1;
-//	} else if (!strcmp(str, "disable")) {
-//		__sched_schedstats = false;
-//		ret = 1;
-//	}
-//out:
-//	if (!ret)
-//		pr_warn("Unable to parse schedstats=\n");
-//
-//	return ret;
-//}
-//__setup("schedstats=", setup_schedstats);
+void sched_set_stop_task(int cpu, struct task_struct *stop)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	struct task_struct *old_stop = cpu_rq(cpu)->stop;
 
-static void __init init_schedstats(void)
+	if (stop) {
+		/*
+		 * Make it appear like a SCHED_FIFO task, its something
+		 * userspace knows about and won't get confused about.
+		 *
+		 * Also, it will make PI more or less work without too
+		 * much confusion -- but then, stop work should not
+		 * rely on PI working anyway.
+		 */
+		sched_setscheduler_nocheck(stop, SCHED_FIFO, &param);
+
+		stop->sched_class = &stop_sched_class;
+	}
+
+	cpu_rq(cpu)->stop = stop;
+
+	if (old_stop) {
+		/*
+		 * Reset it back to a normal scheduling class so that
+		 * it can die in pieces.
+		 */
+		old_stop->sched_class = &rt_sched_class;
+	}
+}
+EXPORT_SYMBOL(sched_set_stop_task);
+
+#else
+static inline int __set_cpus_allowed_ptr(struct task_struct *p,
+					 const struct cpumask *new_mask, bool check)
 {
-	set_schedstats(__sched_schedstats);
+	return set_cpus_allowed_ptr(p, new_mask);
 }
 
-//#ifdef CONFIG_PROC_SYSCTL
-//int sysctl_schedstats(struct ctl_table *table, int write, void *buffer,
-//		size_t *lenp, loff_t *ppos)
-//{
-//	struct ctl_table t;
-//	int err;
-//	int state = static_branch_likely(&sched_schedstats);
-//
-//	if (write && !capable(CAP_SYS_ADMIN))
-//		return -EPERM;
-//
-//	t = *table;
-//	t.data = &state;
-//	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
-//	if (err < 0)
-//		return err;
-//	if (write)
-//		set_schedstats(state);
-//	return err;
-//}
-//#endif /* CONFIG_PROC_SYSCTL */
-#else  /* !CONFIG_SCHEDSTATS */
-static inline void init_schedstats(void) {}
-#endif /* CONFIG_SCHEDSTATS */
+#endif /* CONFIG_SMP */
 
-/*
- * fork()/clone()-time setup:
- */
-int sched_fork(unsigned long clone_flags, struct task_struct *p)
+static void
+ttwu_stat(struct task_struct *p, int cpu, int wake_flags)
 {
-	unsigned long flags;
+	struct rq *rq;
 
-	__sched_fork(clone_flags, p);
-	/*
-	 * We mark the process as NEW here. This guarantees that
-	 * nobody will actually run it, and a signal or other external
-	 * event cannot wake it up and insert it on the runqueue either.
-	 */
-	p->state = TASK_NEW;
+	if (!schedstat_enabled())
+		return;
 
-	/*
-	 * Make sure we do not leak PI boosting priority to the child.
-	 */
-	p->prio = current->normal_prio;
+	rq = this_rq();
 
-	uclamp_fork(p);
+#ifdef CONFIG_SMP
+	if (cpu == rq->cpu) {
+		__schedstat_inc(rq->ttwu_local);
+		__schedstat_inc(p->se.statistics.nr_wakeups_local);
+	} else {
+		struct sched_domain *sd;
 
-	/*
-	 * Revert to default priority/policy on fork if requested.
-	 */
-	if (unlikely(p->sched_reset_on_fork)) {
-		if (task_has_dl_policy(p) || task_has_rt_policy(p)) {
-			p->policy = SCHED_NORMAL;
-			p->static_prio = NICE_TO_PRIO(0);
-			p->rt_priority = 0;
-		} else if (PRIO_TO_NICE(p->static_prio) < 0)
-			p->static_prio = NICE_TO_PRIO(0);
+		__schedstat_inc(p->se.statistics.nr_wakeups_remote);
+		rcu_read_lock();
+		for_each_domain(rq->cpu, sd) {
+			if (cpumask_test_cpu(cpu, sched_domain_span(sd))) {
+				__schedstat_inc(sd->ttwu_wake_remote);
+				break;
+			}
+		}
+		rcu_read_unlock();
+	}
 
-		p->prio = p->normal_prio = __normal_prio(p);
-		set_load_weight(p, false);
+	if (wake_flags & WF_MIGRATED)
+		__schedstat_inc(p->se.statistics.nr_wakeups_migrate);
+#endif /* CONFIG_SMP */
+
+	__schedstat_inc(rq->ttwu_count);
+	__schedstat_inc(p->se.statistics.nr_wakeups);
+
+	if (wake_flags & WF_SYNC)
+		__schedstat_inc(p->se.statistics.nr_wakeups_sync);
+}
+
+/*
+ * Mark the task runnable and perform wakeup-preemption.
+ */
+static void ttwu_do_wakeup(struct rq *rq, struct task_struct *p, int wake_flags,
+			   struct rq_flags *rf)
+{
+	check_preempt_curr(rq, p, wake_flags);
+	p->state = TASK_RUNNING;
+	trace_sched_wakeup(p);
 
+#ifdef CONFIG_SMP
+	if (p->sched_class->task_woken) {
 		/*
-		 * We don't need the reset flag anymore after the fork. It has
-		 * fulfilled its duty:
+		 * Our task @p is fully woken up and running; so its safe to
+		 * drop the rq->lock, hereafter rq is only used for statistics.
 		 */
-		p->sched_reset_on_fork = 0;
+		rq_unpin_lock(rq, rf);
+		p->sched_class->task_woken(rq, p);
+		rq_repin_lock(rq, rf);
 	}
 
-	if (dl_prio(p->prio))
-		return -EAGAIN;
-	else if (rt_prio(p->prio))
-		p->sched_class = &rt_sched_class;
-	else
-		p->sched_class = &fair_sched_class;
+	if (rq->idle_stamp) {
+		u64 delta = rq_clock(rq) - rq->idle_stamp;
+		u64 max = 2*rq->max_idle_balance_cost;
 
-	init_entity_runnable_average(&p->se);
+		update_avg(&rq->avg_idle, delta);
 
-	/*
-	 * The child is not yet in the pid-hash so no cgroup attach races,
-	 * and the cgroup is pinned to this child due to cgroup_fork()
-	 * is ran before sched_fork().
-	 *
-	 * Silence PROVE_RCU.
-	 */
-	raw_spin_lock_irqsave(&p->pi_lock, flags);
-	rseq_migrate(p);
-	/*
-	 * We're setting the CPU for the first time, we don't migrate,
-	 * so use __set_task_cpu().
-	 */
-	__set_task_cpu(p, smp_processor_id());
-	if (p->sched_class->task_fork)
-		p->sched_class->task_fork(p);
-	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+		if (rq->avg_idle > max)
+			rq->avg_idle = max;
 
-#ifdef CONFIG_SCHED_INFO
-	if (likely(sched_info_on()))
-		memset(&p->sched_info, 0, sizeof(p->sched_info));
-#endif
-#if defined(CONFIG_SMP)
-	p->on_cpu = 0;
-#endif
-	init_task_preempt_count(p);
-#ifdef CONFIG_SMP
-	plist_node_init(&p->pushable_tasks, MAX_PRIO);
-	RB_CLEAR_NODE(&p->pushable_dl_tasks);
+		rq->idle_stamp = 0;
+	}
 #endif
-	return 0;
 }
 
-void sched_post_fork(struct task_struct *p)
+static void
+ttwu_do_activate(struct rq *rq, struct task_struct *p, int wake_flags,
+		 struct rq_flags *rf)
 {
-	uclamp_post_fork(p);
-}
+	int en_flags = ENQUEUE_WAKEUP | ENQUEUE_NOCLOCK;
 
-unsigned long to_ratio(u64 period, u64 runtime)
-{
-	if (runtime == RUNTIME_INF)
-		return BW_UNIT;
+	lockdep_assert_held(&rq->lock);
 
-	/*
-	 * Doing this here saves a lot of checks in all
-	 * the calling paths, and returning zero seems
-	 * safe for them anyway.
-	 */
-	if (period == 0)
-		return 0;
+	if (p->sched_contributes_to_load)
+		rq->nr_uninterruptible--;
 
-	return div64_u64(runtime << BW_SHIFT, period);
+#ifdef CONFIG_SMP
+	if (wake_flags & WF_MIGRATED)
+		en_flags |= ENQUEUE_MIGRATED;
+#endif
+
+	activate_task(rq, p, en_flags);
+	ttwu_do_wakeup(rq, p, wake_flags, rf);
 }
 
 /*
- * wake_up_new_task - wake up a newly created task for the first time.
+ * Consider @p being inside a wait loop:
  *
- * This function will do some initial scheduler statistics housekeeping
- * that must be done for every newly created context, then puts the task
- * on the runqueue and wakes it.
+ *   for (;;) {
+ *      set_current_state(TASK_UNINTERRUPTIBLE);
+ *
+ *      if (CONDITION)
+ *         break;
+ *
+ *      schedule();
+ *   }
+ *   __set_current_state(TASK_RUNNING);
+ *
+ * between set_current_state() and schedule(). In this case @p is still
+ * runnable, so all that needs doing is change p->state back to TASK_RUNNING in
+ * an atomic manner.
+ *
+ * By taking task_rq(p)->lock we serialize against schedule(), if @p->on_rq
+ * then schedule() must still happen and p->state can be changed to
+ * TASK_RUNNING. Otherwise we lost the race, schedule() has happened, and we
+ * need to do a full wakeup with enqueue.
+ *
+ * Returns: %true when the wakeup is done,
+ *          %false otherwise.
  */
-void wake_up_new_task(struct task_struct *p)
+static int ttwu_runnable(struct task_struct *p, int wake_flags)
 {
 	struct rq_flags rf;
 	struct rq *rq;
+	int ret = 0;
 
-	raw_spin_lock_irqsave(&p->pi_lock, rf.flags);
-	p->state = TASK_RUNNING;
-#ifdef CONFIG_SMP
-	/*
-	 * Fork balancing, do it here and not earlier because:
-	 *  - cpus_ptr can change in the fork path
-	 *  - any previously selected CPU might disappear through hotplug
-	 *
-	 * Use __set_task_cpu() to avoid calling sched_class::migrate_task_rq,
-	 * as we're not fully set-up yet.
-	 */
-	p->recent_used_cpu = task_cpu(p);
-	rseq_migrate(p);
-	__set_task_cpu(p, select_task_rq(p, task_cpu(p), SD_BALANCE_FORK, 0));
-#endif
 	rq = __task_rq_lock(p, &rf);
-	update_rq_clock(rq);
-	post_init_entity_util_avg(p);
+	if (task_on_rq_queued(p)) {
+		/* check_preempt_curr() may use rq clock */
+		update_rq_clock(rq);
+		ttwu_do_wakeup(rq, p, wake_flags, &rf);
+		ret = 1;
+	}
+	__task_rq_unlock(rq, &rf);
+
+	return ret;
+}
 
-	activate_task(rq, p, ENQUEUE_NOCLOCK);
-	trace_sched_wakeup_new(p);
-	check_preempt_curr(rq, p, WF_FORK);
 #ifdef CONFIG_SMP
-	if (p->sched_class->task_woken) {
-		/*
-		 * Nothing relies on rq->lock after this, so its fine to
-		 * drop it.
-		 */
-		rq_unpin_lock(rq, &rf);
-		p->sched_class->task_woken(rq, p);
-		rq_repin_lock(rq, &rf);
+void sched_ttwu_pending(void *arg)
+{
+	struct llist_node *llist = arg;
+	struct rq *rq = this_rq();
+	struct task_struct *p, *t;
+	struct rq_flags rf;
+
+	if (!llist)
+		return;
+
+	/*
+	 * rq::ttwu_pending racy indication of out-standing wakeups.
+	 * Races such that false-negatives are possible, since they
+	 * are shorter lived that false-positives would be.
+	 */
+	WRITE_ONCE(rq->ttwu_pending, 0);
+
+	rq_lock_irqsave(rq, &rf);
+	update_rq_clock(rq);
+
+	llist_for_each_entry_safe(p, t, llist, wake_entry.llist) {
+		if (WARN_ON_ONCE(p->on_cpu))
+			smp_cond_load_acquire(&p->on_cpu, !VAL);
+
+		if (WARN_ON_ONCE(task_cpu(p) != cpu_of(rq)))
+			set_task_cpu(p, cpu_of(rq));
+
+		ttwu_do_activate(rq, p, p->sched_remote_wakeup ? WF_MIGRATED : 0, &rf);
 	}
-#endif
-	task_rq_unlock(rq, p, &rf);
-}
 
-#ifdef CONFIG_PREEMPT_NOTIFIERS
-//
-//static DEFINE_STATIC_KEY_FALSE(preempt_notifier_key);
-//
-//void preempt_notifier_inc(void)
-//{
-//	static_branch_inc(&preempt_notifier_key);
-//}
-//EXPORT_SYMBOL_GPL(preempt_notifier_inc);
-//
-//void preempt_notifier_dec(void)
-//{
-//	static_branch_dec(&preempt_notifier_key);
-//}
-//EXPORT_SYMBOL_GPL(preempt_notifier_dec);
-//
-///**
-// * preempt_notifier_register - tell me when current is being preempted & rescheduled
-// * @notifier: notifier struct to register
-// */
-//void preempt_notifier_register(struct preempt_notifier *notifier)
-//{
-//	if (!static_branch_unlikely(&preempt_notifier_key))
-//		WARN(1, "registering preempt_notifier while notifiers disabled\n");
-//
-//	hlist_add_head(&notifier->link, &current->preempt_notifiers);
-//}
-//EXPORT_SYMBOL_GPL(preempt_notifier_register);
-//
-///**
-// * preempt_notifier_unregister - no longer interested in preemption notifications
-// * @notifier: notifier struct to unregister
-// *
-// * This is *not* safe to call from within a preemption notifier.
-// */
-//void preempt_notifier_unregister(struct preempt_notifier *notifier)
-//{
-//	hlist_del(&notifier->link);
-//}
-//EXPORT_SYMBOL_GPL(preempt_notifier_unregister);
-//
-//static void __fire_sched_in_preempt_notifiers(struct task_struct *curr)
-//{
-//	struct preempt_notifier *notifier;
-//
-//	hlist_for_each_entry(notifier, &curr->preempt_notifiers, link)
-//		notifier->ops->sched_in(notifier, raw_smp_processor_id());
-//}
-//
-//static __always_inline void fire_sched_in_preempt_notifiers(struct task_struct *curr)
-//{
-//	if (static_branch_unlikely(&preempt_notifier_key))
-//		__fire_sched_in_preempt_notifiers(curr);
-//}
+	rq_unlock_irqrestore(rq, &rf);
+}
+EXPORT_SYMBOL(sched_ttwu_pending);
 
-static void
-__fire_sched_out_preempt_notifiers(struct task_struct *curr,
-				   struct task_struct *next)
+void send_call_function_single_ipi(int cpu)
 {
-	struct preempt_notifier *notifier;
+	struct rq *rq = cpu_rq(cpu);
 
-	hlist_for_each_entry(notifier, &curr->preempt_notifiers, link)
-		notifier->ops->sched_out(notifier, next);
+	if (!set_nr_if_polling(rq->idle))
+		arch_send_call_function_single_ipi(cpu);
+	else
+		trace_sched_wake_idle_without_ipi(cpu);
 }
+EXPORT_SYMBOL(send_call_function_single_ipi);
 
-static __always_inline void
-fire_sched_out_preempt_notifiers(struct task_struct *curr,
-				 struct task_struct *next)
+/*
+ * Queue a task on the target CPUs wake_list and wake the CPU via IPI if
+ * necessary. The wakee CPU on receipt of the IPI will queue the task
+ * via sched_ttwu_wakeup() for activation so the wakee incurs the cost
+ * of the wakeup instead of the waker.
+ */
+static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
 {
-	if (static_branch_unlikely(&preempt_notifier_key))
-		__fire_sched_out_preempt_notifiers(curr, next);
-}
+	struct rq *rq = cpu_rq(cpu);
 
-#else /* !CONFIG_PREEMPT_NOTIFIERS */
+	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
 
-static inline void fire_sched_in_preempt_notifiers(struct task_struct *curr)
-{
+	WRITE_ONCE(rq->ttwu_pending, 1);
+	__smp_call_single_queue(cpu, &p->wake_entry.llist);
 }
 
-static inline void
-fire_sched_out_preempt_notifiers(struct task_struct *curr,
-				 struct task_struct *next)
+void wake_up_if_idle(int cpu)
 {
-}
+	struct rq *rq = cpu_rq(cpu);
+	struct rq_flags rf;
 
-#endif /* CONFIG_PREEMPT_NOTIFIERS */
+	rcu_read_lock();
 
-static inline void prepare_task(struct task_struct *next)
+	if (!is_idle_task(rcu_dereference(rq->curr)))
+		goto out;
+
+	if (set_nr_if_polling(rq->idle)) {
+		trace_sched_wake_idle_without_ipi(cpu);
+	} else {
+		rq_lock_irqsave(rq, &rf);
+		if (is_idle_task(rq->curr))
+			smp_send_reschedule(cpu);
+		/* Else CPU is not idle, do nothing here: */
+		rq_unlock_irqrestore(rq, &rf);
+	}
+
+out:
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(wake_up_if_idle);
+
+bool cpus_share_cache(int this_cpu, int that_cpu)
 {
-#ifdef CONFIG_SMP
-	/*
-	 * Claim the task as running, we do this before switching to it
-	 * such that any running task will have this set.
-	 *
-	 * See the ttwu() WF_ON_CPU case and its ordering comment.
-	 */
-	WRITE_ONCE(next->on_cpu, 1);
-#endif
+	return per_cpu(sd_llc_id, this_cpu) == per_cpu(sd_llc_id, that_cpu);
 }
+EXPORT_SYMBOL(cpus_share_cache);
 
-static inline void finish_task(struct task_struct *prev)
+static inline bool ttwu_queue_cond(int cpu, int wake_flags)
 {
-#ifdef CONFIG_SMP
 	/*
-	 * This must be the very last reference to @prev from this CPU. After
-	 * p->on_cpu is cleared, the task can be moved to a different CPU. We
-	 * must ensure this doesn't happen until the switch is completely
-	 * finished.
-	 *
-	 * In particular, the load of prev->state in finish_task_switch() must
-	 * happen before this.
-	 *
-	 * Pairs with the smp_cond_load_acquire() in try_to_wake_up().
+	 * If the CPU does not share cache, then queue the task on the
+	 * remote rqs wakelist to avoid accessing remote data.
 	 */
-	smp_store_release(&prev->on_cpu, 0);
-#endif
-}
+	if (!cpus_share_cache(smp_processor_id(), cpu))
+		return true;
 
-static inline void
-prepare_lock_switch(struct rq *rq, struct task_struct *next, struct rq_flags *rf)
-{
 	/*
-	 * Since the runqueue lock will be released by the next
-	 * task (which is an invalid locking op but in the case
-	 * of the scheduler it's an obvious special-case), so we
-	 * do an early lockdep release here:
+	 * If the task is descheduling and the only running task on the
+	 * CPU then use the wakelist to offload the task activation to
+	 * the soon-to-be-idle CPU as the current CPU is likely busy.
+	 * nr_running is checked to avoid unnecessary task stacking.
 	 */
-	rq_unpin_lock(rq, rf);
-	spin_release(&rq->lock.dep_map, _THIS_IP_);
-#ifdef CONFIG_DEBUG_SPINLOCK
-	/* this is a valid case when another task releases the spinlock */
-	rq->lock.owner = next;
-#endif
+	if ((wake_flags & WF_ON_CPU) && cpu_rq(cpu)->nr_running <= 1)
+		return true;
+
+	return false;
 }
 
-static inline void finish_lock_switch(struct rq *rq)
+static bool ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
 {
-	/*
-	 * If we are tracking spinlock dependencies then we have to
-	 * fix up the runqueue lock - which gets 'carried over' from
-	 * prev into current:
-	 */
-	spin_acquire(&rq->lock.dep_map, 0, 0, _THIS_IP_);
-	raw_spin_unlock_irq(&rq->lock);
+	if (sched_feat(TTWU_QUEUE) && ttwu_queue_cond(cpu, wake_flags)) {
+		if (WARN_ON_ONCE(cpu == smp_processor_id()))
+			return false;
+
+		sched_clock_cpu(cpu); /* Sync clocks across CPUs */
+		__ttwu_queue_wakelist(p, cpu, wake_flags);
+		return true;
+	}
+
+	return false;
 }
 
-/*
- * NOP if the arch has not defined these:
- */
+#else /* !CONFIG_SMP */
 
-#ifndef prepare_arch_switch
-# define prepare_arch_switch(next)	do { } while (0)
-#endif
+static inline bool ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags)
+{
+	return false;
+}
 
-#ifndef finish_arch_post_lock_switch
-# define finish_arch_post_lock_switch()	do { } while (0)
-#endif
+#endif /* CONFIG_SMP */
 
-/**
- * prepare_task_switch - prepare to switch tasks
- * @rq: the runqueue preparing to switch
- * @prev: the current task that is being switched out
- * @next: the task we are going to switch to.
- *
- * This is called with the rq lock held and interrupts off. It must
- * be paired with a subsequent finish_task_switch after the context
- * switch.
- *
- * prepare_task_switch sets up locking and calls architecture specific
- * hooks.
- */
-static inline void
-prepare_task_switch(struct rq *rq, struct task_struct *prev,
-		    struct task_struct *next)
+static void ttwu_queue(struct task_struct *p, int cpu, int wake_flags)
 {
-	kcov_prepare_switch(prev);
-	sched_info_switch(rq, prev, next);
-	perf_event_task_sched_out(prev, next);
-	rseq_preempt(prev);
-	fire_sched_out_preempt_notifiers(prev, next);
-	prepare_task(next);
-	prepare_arch_switch(next);
+	struct rq *rq = cpu_rq(cpu);
+	struct rq_flags rf;
+
+	if (ttwu_queue_wakelist(p, cpu, wake_flags))
+		return;
+
+	rq_lock(rq, &rf);
+	update_rq_clock(rq);
+	ttwu_do_activate(rq, p, wake_flags, &rf);
+	rq_unlock(rq, &rf);
 }
 
-/**
- * finish_task_switch - clean up after a task-switch
- * @prev: the thread we just switched away from.
+///*
+// * Notes on Program-Order guarantees on SMP systems.
+// *
+// *  MIGRATION
+// *
+// * The basic program-order guarantee on SMP systems is that when a task [t]
+// * migrates, all its activity on its old CPU [c0] happens-before any subsequent
+// * execution on its new CPU [c1].
+// *
+// * For migration (of runnable tasks) this is provided by the following means:
+// *
+// *  A) UNLOCK of the rq(c0)->lock scheduling out task t
+// *  B) migration for t is required to synchronize *both* rq(c0)->lock and
+// *     rq(c1)->lock (if not at the same time, then in that order).
+// *  C) LOCK of the rq(c1)->lock scheduling in task
+// *
+// * Release/acquire chaining guarantees that B happens after A and C after B.
+// * Note: the CPU doing B need not be c0 or c1
+// *
+// * Example:
+// *
+// *   CPU0            CPU1            CPU2
+// *
+// *   LOCK rq(0)->lock
+// *   sched-out X
+// *   sched-in Y
+// *   UNLOCK rq(0)->lock
+// *
+// *                                   LOCK rq(0)->lock // orders against CPU0
+// *                                   dequeue X
+// *                                   UNLOCK rq(0)->lock
+// *
+// *                                   LOCK rq(1)->lock
+// *                                   enqueue X
+// *                                   UNLOCK rq(1)->lock
+// *
+// *                   LOCK rq(1)->lock // orders against CPU2
+// *                   sched-out Z
+// *                   sched-in X
+// *                   UNLOCK rq(1)->lock
+// *
+// *
+// *  BLOCKING -- aka. SLEEP + WAKEUP
+// *
+// * For blocking we (obviously) need to provide the same guarantee as for
+// * migration. However the means are completely different as there is no lock
+// * chain to provide order. Instead we do:
+// *
+// *   1) smp_store_release(X->on_cpu, 0)   -- finish_task()
+// *   2) smp_cond_load_acquire(!X->on_cpu) -- try_to_wake_up()
+// *
+// * Example:
+// *
+// *   CPU0 (schedule)  CPU1 (try_to_wake_up) CPU2 (schedule)
+// *
+// *   LOCK rq(0)->lock LOCK X->pi_lock
+// *   dequeue X
+// *   sched-out X
+// *   smp_store_release(X->on_cpu, 0);
+// *
+// *                    smp_cond_load_acquire(&X->on_cpu, !VAL);
+// *                    X->state = WAKING
+// *                    set_task_cpu(X,2)
+// *
+// *                    LOCK rq(2)->lock
+// *                    enqueue X
+// *                    X->state = RUNNING
+// *                    UNLOCK rq(2)->lock
+// *
+// *                                          LOCK rq(2)->lock // orders against CPU1
+// *                                          sched-out Z
+// *                                          sched-in X
+// *                                          UNLOCK rq(2)->lock
+// *
+// *                    UNLOCK X->pi_lock
+// *   UNLOCK rq(0)->lock
+// *
+// *
+// * However, for wakeups there is a second guarantee we must provide, namely we
+// * must ensure that CONDITION=1 done by the caller can not be reordered with
+// * accesses to the task state; see try_to_wake_up() and set_current_state().
+// */
+
+/**
+ * try_to_wake_up - wake up a thread
+ * @p: the thread to be awakened
+ * @state: the mask of task states that can be woken
+ * @wake_flags: wake modifier flags (WF_*)
  *
- * finish_task_switch must be called after the context switch, paired
- * with a prepare_task_switch call before the context switch.
- * finish_task_switch will reconcile locking set up by prepare_task_switch,
- * and do any other architecture-specific cleanup actions.
+ * Conceptually does:
  *
- * Note that we may have delayed dropping an mm in context_switch(). If
- * so, we finish that here outside of the runqueue lock. (Doing it
- * with the lock held can cause deadlocks; see schedule() for
- * details.)
+ *   If (@state & @p->state) @p->state = TASK_RUNNING.
  *
- * The context switch have flipped the stack from under us and restored the
- * local variables which were saved when this task called schedule() in the
- * past. prev == current is still correct but we need to recalculate this_rq
- * because prev may have moved to another CPU.
+ * If the task was not queued/runnable, also place it back on a runqueue.
+ *
+ * This function is atomic against schedule() which would dequeue the task.
+ *
+ * It issues a full memory barrier before accessing @p->state, see the comment
+ * with set_current_state().
+ *
+ * Uses p->pi_lock to serialize against concurrent wake-ups.
+ *
+ * Relies on p->pi_lock stabilizing:
+ *  - p->sched_class
+ *  - p->cpus_ptr
+ *  - p->sched_task_group
+ * in order to do migration, see its use of select_task_rq()/set_task_cpu().
+ *
+ * Tries really hard to only take one task_rq(p)->lock for performance.
+ * Takes rq->lock in:
+ *  - ttwu_runnable()    -- old rq, unavoidable, see comment there;
+ *  - ttwu_queue()       -- new rq, for enqueue of the task;
+ *  - psi_ttwu_dequeue() -- much sadness :-( accounting will kill us.
+ *
+ * As a consequence we race really badly with just about everything. See the
+ * many memory barriers and their comments for details.
+ *
+ * Return: %true if @p->state changes (an actual wakeup was done),
+ *	   %false otherwise.
  */
-static struct rq *finish_task_switch(struct task_struct *prev)
-	__releases(rq->lock)
+static int
+try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 {
-	struct rq *rq = this_rq();
-	struct mm_struct *mm = rq->prev_mm;
-	long prev_state;
+	unsigned long flags;
+	int cpu, success = 0;
+
+	preempt_disable();
+	if (p == current) {
+		/*
+		 * We're waking current, this means 'p->on_rq' and 'task_cpu(p)
+		 * == smp_processor_id()'. Together this means we can special
+		 * case the whole 'p->on_rq && ttwu_runnable()' case below
+		 * without taking any locks.
+		 *
+		 * In particular:
+		 *  - we rely on Program-Order guarantees for all the ordering,
+		 *  - we're serialized against set_special_state() by virtue of
+		 *    it disabling IRQs (this allows not taking ->pi_lock).
+		 */
+		if (!(p->state & state))
+			goto out;
+
+		success = 1;
+		trace_sched_waking(p);
+		p->state = TASK_RUNNING;
+		trace_sched_wakeup(p);
+		goto out;
+	}
 
 	/*
-	 * The previous task will have left us with a preempt_count of 2
-	 * because it left us after:
+	 * If we are going to wake up a thread waiting for CONDITION we
+	 * need to ensure that CONDITION=1 done by the caller can not be
+	 * reordered with p->state check below. This pairs with smp_store_mb()
+	 * in set_current_state() that the waiting thread does.
+	 */
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	smp_mb__after_spinlock();
+	if (!(p->state & state))
+		goto unlock;
+
+	trace_sched_waking(p);
+
+	/* We're going to change ->state: */
+	success = 1;
+
+	/*
+	 * Ensure we load p->on_rq _after_ p->state, otherwise it would
+	 * be possible to, falsely, observe p->on_rq == 0 and get stuck
+	 * in smp_cond_load_acquire() below.
 	 *
-	 *	schedule()
-	 *	  preempt_disable();			// 1
-	 *	  __schedule()
-	 *	    raw_spin_lock_irq(&rq->lock)	// 2
+	 * sched_ttwu_pending()			try_to_wake_up()
+	 *   STORE p->on_rq = 1			  LOAD p->state
+	 *   UNLOCK rq->lock
 	 *
-	 * Also, see FORK_PREEMPT_COUNT.
+	 * __schedule() (switch to task 'p')
+	 *   LOCK rq->lock			  smp_rmb();
+	 *   smp_mb__after_spinlock();
+	 *   UNLOCK rq->lock
+	 *
+	 * [task p]
+	 *   STORE p->state = UNINTERRUPTIBLE	  LOAD p->on_rq
+	 *
+	 * Pairs with the LOCK+smp_mb__after_spinlock() on rq->lock in
+	 * __schedule().  See the comment for smp_mb__after_spinlock().
+	 *
+	 * A similar smb_rmb() lives in try_invoke_on_locked_down_task().
 	 */
-	if (WARN_ONCE(preempt_count() != 2*PREEMPT_DISABLE_OFFSET,
-		      "corrupted preempt_count: %s/%d/0x%x\n",
-		      current->comm, current->pid, preempt_count()))
-		preempt_count_set(FORK_PREEMPT_COUNT);
+	smp_rmb();
+	if (READ_ONCE(p->on_rq) && ttwu_runnable(p, wake_flags))
+		goto unlock;
 
-	rq->prev_mm = NULL;
+	if (p->in_iowait) {
+		delayacct_blkio_end(p);
+		atomic_dec(&task_rq(p)->nr_iowait);
+	}
 
+#ifdef CONFIG_SMP
 	/*
-	 * A task struct has one reference for the use as "current".
-	 * If a task dies, then it sets TASK_DEAD in tsk->state and calls
-	 * schedule one last time. The schedule call will never return, and
-	 * the scheduled task must drop that reference.
+	 * Ensure we load p->on_cpu _after_ p->on_rq, otherwise it would be
+	 * possible to, falsely, observe p->on_cpu == 0.
 	 *
-	 * We must observe prev->state before clearing prev->on_cpu (in
-	 * finish_task), otherwise a concurrent wakeup can get prev
-	 * running on another CPU and we could rave with its RUNNING -> DEAD
-	 * transition, resulting in a double drop.
+	 * One must be running (->on_cpu == 1) in order to remove oneself
+	 * from the runqueue.
+	 *
+	 * __schedule() (switch to task 'p')	try_to_wake_up()
+	 *   STORE p->on_cpu = 1		  LOAD p->on_rq
+	 *   UNLOCK rq->lock
+	 *
+	 * __schedule() (put 'p' to sleep)
+	 *   LOCK rq->lock			  smp_rmb();
+	 *   smp_mb__after_spinlock();
+	 *   STORE p->on_rq = 0			  LOAD p->on_cpu
+	 *
+	 * Pairs with the LOCK+smp_mb__after_spinlock() on rq->lock in
+	 * __schedule().  See the comment for smp_mb__after_spinlock().
+	 *
+	 * Form a control-dep-acquire with p->on_rq == 0 above, to ensure
+	 * schedule()'s deactivate_task() has 'happened' and p will no longer
+	 * care about it's own p->state. See the comment in __schedule().
 	 */
-	prev_state = prev->state;
-	vtime_task_switch(prev);
-	perf_event_task_sched_in(prev, current);
-	finish_task(prev);
-	finish_lock_switch(rq);
-	finish_arch_post_lock_switch();
-	kcov_finish_switch(current);
+	smp_acquire__after_ctrl_dep();
 
-	fire_sched_in_preempt_notifiers(current);
 	/*
-	 * When switching through a kernel thread, the loop in
-	 * membarrier_{private,global}_expedited() may have observed that
-	 * kernel thread and not issued an IPI. It is therefore possible to
-	 * schedule between user->kernel->user threads without passing though
-	 * switch_mm(). Membarrier requires a barrier after storing to
-	 * rq->curr, before returning to userspace, so provide them here:
-	 *
-	 * - a full memory barrier for {PRIVATE,GLOBAL}_EXPEDITED, implicitly
-	 *   provided by mmdrop(),
-	 * - a sync_core for SYNC_CORE.
+	 * We're doing the wakeup (@success == 1), they did a dequeue (p->on_rq
+	 * == 0), which means we need to do an enqueue, change p->state to
+	 * TASK_WAKING such that we can unlock p->pi_lock before doing the
+	 * enqueue, such as ttwu_queue_wakelist().
 	 */
-	if (mm) {
-		membarrier_mm_sync_core_before_usermode(mm);
-		mmdrop(mm);
-	}
-	if (unlikely(prev_state == TASK_DEAD)) {
-		if (prev->sched_class->task_dead)
-			prev->sched_class->task_dead(prev);
+	p->state = TASK_WAKING;
 
-		/*
-		 * Remove function-return probe instances associated with this
-		 * task and put them back on the free list.
-		 */
-		kprobe_flush_task(prev);
+	/*
+	 * If the owning (remote) CPU is still in the middle of schedule() with
+	 * this task as prev, considering queueing p on the remote CPUs wake_list
+	 * which potentially sends an IPI instead of spinning on p->on_cpu to
+	 * let the waker make forward progress. This is safe because IRQs are
+	 * disabled and the IPI will deliver after on_cpu is cleared.
+	 *
+	 * Ensure we load task_cpu(p) after p->on_cpu:
+	 *
+	 * set_task_cpu(p, cpu);
+	 *   STORE p->cpu = @cpu
+	 * __schedule() (switch to task 'p')
+	 *   LOCK rq->lock
+	 *   smp_mb__after_spin_lock()		smp_cond_load_acquire(&p->on_cpu)
+	 *   STORE p->on_cpu = 1		LOAD p->cpu
+	 *
+	 * to ensure we observe the correct CPU on which the task is currently
+	 * scheduling.
+	 */
+	if (smp_load_acquire(&p->on_cpu) &&
+	    ttwu_queue_wakelist(p, task_cpu(p), wake_flags | WF_ON_CPU))
+		goto unlock;
 
-		/* Task is done with its stack. */
-		put_task_stack(prev);
+	/*
+	 * If the owning (remote) CPU is still in the middle of schedule() with
+	 * this task as prev, wait until its done referencing the task.
+	 *
+	 * Pairs with the smp_store_release() in finish_task().
+	 *
+	 * This ensures that tasks getting woken will be fully ordered against
+	 * their previous state and preserve Program Order.
+	 */
+	smp_cond_load_acquire(&p->on_cpu, !VAL);
 
-		put_task_struct_rcu_user(prev);
+	cpu = select_task_rq(p, p->wake_cpu, SD_BALANCE_WAKE, wake_flags);
+	if (task_cpu(p) != cpu) {
+		wake_flags |= WF_MIGRATED;
+		psi_ttwu_dequeue(p);
+		set_task_cpu(p, cpu);
 	}
+#else
+	cpu = task_cpu(p);
+#endif /* CONFIG_SMP */
 
-	tick_nohz_task_switch();
-	return rq;
+	ttwu_queue(p, cpu, wake_flags);
+unlock:
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+out:
+	if (success)
+		ttwu_stat(p, task_cpu(p), wake_flags);
+	preempt_enable();
+
+	return success;
 }
 
-#ifdef CONFIG_SMP
-//
-///* rq->lock is NOT held, but preemption is disabled */
-//static void __balance_callback(struct rq *rq)
+///**
+// * try_invoke_on_locked_down_task - Invoke a function on task in fixed state
+// * @p: Process for which the function is to be invoked.
+// * @func: Function to invoke.
+// * @arg: Argument to function.
+// *
+// * If the specified task can be quickly locked into a definite state
+// * (either sleeping or on a given runqueue), arrange to keep it in that
+// * state while invoking @func(@arg).  This function can use ->on_rq and
+// * task_curr() to work out what the state is, if required.  Given that
+// * @func can be invoked with a runqueue lock held, it had better be quite
+// * lightweight.
+// *
+// * Returns:
+// *	@false if the task slipped out from under the locks.
+// *	@true if the task was locked onto a runqueue or is sleeping.
+// *		However, @func can override this by returning @false.
+// */
+//bool try_invoke_on_locked_down_task(struct task_struct *p, bool (*func)(struct task_struct *t, void *arg), void *arg)
 //{
-//	struct callback_head *head, *next;
-//	void (*func)(struct rq *rq);
-//	unsigned long flags;
-//
-//	raw_spin_lock_irqsave(&rq->lock, flags);
-//	head = rq->balance_callback;
-//	rq->balance_callback = NULL;
-//	while (head) {
-//		func = (void (*)(struct rq *))head->func;
-//		next = head->next;
-//		head->next = NULL;
-//		head = next;
+//	bool ret = false;
+//	struct rq_flags rf;
+//	struct rq *rq;
 //
-//		func(rq);
+//	lockdep_assert_irqs_enabled();
+//	raw_spin_lock_irq(&p->pi_lock);
+//	if (p->on_rq) {
+//		rq = __task_rq_lock(p, &rf);
+//		if (task_rq(p) == rq)
+//			ret = func(p, arg);
+//		rq_unlock(rq, &rf);
+//	} else {
+//		switch (p->state) {
+//		case TASK_RUNNING:
+//		case TASK_WAKING:
+//			break;
+//		default:
+//			smp_rmb(); // See smp_rmb() comment in try_to_wake_up().
+//			if (!p->on_rq)
+//				ret = func(p, arg);
+//		}
 //	}
-//	raw_spin_unlock_irqrestore(&rq->lock, flags);
+//	raw_spin_unlock_irq(&p->pi_lock);
+//	return ret;
 //}
 
-static inline void balance_callback(struct rq *rq)
+/**
+ * wake_up_process - Wake up a specific process
+ * @p: The process to be woken up.
+ *
+ * Attempt to wake up the nominated process and move it to the set of runnable
+ * processes.
+ *
+ * Return: 1 if the process was woken up, 0 if it was already running.
+ *
+ * This function executes a full memory barrier before accessing the task state.
+ */
+int wake_up_process(struct task_struct *p)
 {
-	if (unlikely(rq->balance_callback))
-		__balance_callback(rq);
+	return try_to_wake_up(p, TASK_NORMAL, 0);
 }
 
-#else
-
-static inline void balance_callback(struct rq *rq)
+int wake_up_state(struct task_struct *p, unsigned int state)
 {
+	return try_to_wake_up(p, state, 0);
 }
 
-#endif
-
-/**
- * schedule_tail - first thing a freshly forked thread must call.
- * @prev: the thread we just switched away from.
+/*
+ * Perform scheduler related setup for a newly forked process p.
+ * p is forked by current.
+ *
+ * __sched_fork() is basic setup used by init_idle() too:
  */
-asmlinkage __visible void schedule_tail(struct task_struct *prev)
-	__releases(rq->lock)
+static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 {
-	struct rq *rq;
-
-	/*
-	 * New tasks start with FORK_PREEMPT_COUNT, see there and
-	 * finish_task_switch() for details.
-	 *
-	 * finish_task_switch() will drop rq->lock() and lower preempt_count
-	 * and the preempt_enable() will end up enabling preemption (on
-	 * PREEMPT_COUNT kernels).
-	 */
+	p->on_rq			= 0;
 
-	rq = finish_task_switch(prev);
-	balance_callback(rq);
-	preempt_enable();
+	p->se.on_rq			= 0;
+	p->se.exec_start		= 0;
+	p->se.sum_exec_runtime		= 0;
+	p->se.prev_sum_exec_runtime	= 0;
+	p->se.nr_migrations		= 0;
+	p->se.vruntime			= 0;
+	INIT_LIST_HEAD(&p->se.group_node);
 
-	if (current->set_child_tid)
-		put_user(task_pid_vnr(current), current->set_child_tid);
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	p->se.cfs_rq			= NULL;
+#endif
 
-	calculate_sigpending();
-}
-EXPORT_SYMBOL(schedule_tail);
+#ifdef CONFIG_SCHEDSTATS
+	/* Even if schedstat is disabled, there should not be garbage */
+	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
+#endif
 
-/*
- * context_switch - switch to the new MM and the new thread's register state.
- */
-static __always_inline struct rq *
-context_switch(struct rq *rq, struct task_struct *prev,
-	       struct task_struct *next, struct rq_flags *rf)
-{
-	prepare_task_switch(rq, prev, next);
+	RB_CLEAR_NODE(&p->dl.rb_node);
+	init_dl_task_timer(&p->dl);
+	init_dl_inactive_task_timer(&p->dl);
+	__dl_clear_params(p);
 
-	/*
-	 * For paravirt, this is coupled with an exit in switch_to to
-	 * combine the page table reload and the switch backend into
-	 * one hypercall.
-	 */
-	arch_start_context_switch(prev);
+	INIT_LIST_HEAD(&p->rt.run_list);
+	p->rt.timeout		= 0;
+	p->rt.time_slice	= sched_rr_timeslice;
+	p->rt.on_rq		= 0;
+	p->rt.on_list		= 0;
 
-	/*
-	 * kernel -> kernel   lazy + transfer active
-	 *   user -> kernel   lazy + mmgrab() active
-	 *
-	 * kernel ->   user   switch + mmdrop() active
-	 *   user ->   user   switch
-	 */
-	if (!next->mm) {                                // to kernel
-		enter_lazy_tlb(prev->active_mm, next);
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+	INIT_HLIST_HEAD(&p->preempt_notifiers);
+#endif
 
-		next->active_mm = prev->active_mm;
-		if (prev->mm)                           // from user
-			mmgrab(prev->active_mm);
-		else
-			prev->active_mm = NULL;
-	} else {                                        // to user
-		membarrier_switch_mm(rq, prev->active_mm, next->mm);
-		/*
-		 * sys_membarrier() requires an smp_mb() between setting
-		 * rq->curr / membarrier_switch_mm() and returning to userspace.
-		 *
-		 * The below provides this either through switch_mm(), or in
-		 * case 'prev->active_mm == next->mm' through
-		 * finish_task_switch()'s mmdrop().
-		 */
-		switch_mm_irqs_off(prev->active_mm, next->mm, next);
+#ifdef CONFIG_COMPACTION
+	p->capture_control = NULL;
+#endif
+	init_numa_balancing(clone_flags, p);
+#ifdef CONFIG_SMP
+	p->wake_entry.u_flags = CSD_TYPE_TTWU;
+#endif
+}
 
-		if (!prev->mm) {                        // from kernel
-			/* will mmdrop() in finish_task_switch(). */
-			rq->prev_mm = prev->active_mm;
-			prev->active_mm = NULL;
-		}
-	}
+DEFINE_STATIC_KEY_FALSE(sched_numa_balancing);
 
-	rq->clock_update_flags &= ~(RQCF_ACT_SKIP|RQCF_REQ_SKIP);
-
-	prepare_lock_switch(rq, next, rf);
-
-	/* Here we just switch the register state and the stack. */
-	switch_to(prev, next, prev);
-	barrier();
-
-	return finish_task_switch(prev);
-}
-
-///*
-// * nr_running and nr_context_switches:
-// *
-// * externally visible scheduler statistics: current number of runnable
-// * threads, total number of context switches performed since bootup.
-// */
-//unsigned long nr_running(void)
-//{
-//	unsigned long i, sum = 0;
-//
-//	for_each_online_cpu(i)
-//		sum += cpu_rq(i)->nr_running;
-//
-//	return sum;
-//}
+//#ifdef CONFIG_NUMA_BALANCING
 //
-///*
-// * Check if only the current task is running on the CPU.
-// *
-// * Caution: this function does not check that the caller has disabled
-// * preemption, thus the result might have a time-of-check-to-time-of-use
-// * race.  The caller is responsible to use it correctly, for example:
-// *
-// * - from a non-preemptible section (of course)
-// *
-// * - from a thread that is bound to a single CPU
-// *
-// * - in a loop with very short iterations (e.g. a polling loop)
-// */
-//bool single_task_running(void)
+//void set_numabalancing_state(bool enabled)
 //{
-//	return raw_rq()->nr_running == 1;
+//	if (enabled)
+//		static_branch_enable(&sched_numa_balancing);
+//	else
+//		static_branch_disable(&sched_numa_balancing);
 //}
-//EXPORT_SYMBOL(single_task_running);
 //
-//unsigned long long nr_context_switches(void)
+//#ifdef CONFIG_PROC_SYSCTL
+//int sysctl_numa_balancing(struct ctl_table *table, int write,
+//			  void *buffer, size_t *lenp, loff_t *ppos)
 //{
-//	int i;
-//	unsigned long long sum = 0;
+//	struct ctl_table t;
+//	int err;
+//	int state = static_branch_likely(&sched_numa_balancing);
 //
-//	for_each_possible_cpu(i)
-//		sum += cpu_rq(i)->nr_switches;
+//	if (write && !capable(CAP_SYS_ADMIN))
+//		return -EPERM;
 //
-//	return sum;
+//	t = *table;
+//	t.data = &state;
+//	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+//	if (err < 0)
+//		return err;
+//	if (write)
+//		set_numabalancing_state(state);
+//	return err;
 //}
+//#endif
+//#endif
+//
+#ifdef CONFIG_SCHEDSTATS
 
-/*
- * Consumers of these two interfaces, like for example the cpuidle menu
- * governor, are using nonsensical data. Preferring shallow idle state selection
- * for a CPU that has IO-wait which might not even end up running the task when
- * it does become runnable.
- */
+DEFINE_STATIC_KEY_FALSE(sched_schedstats);
+static bool __initdata __sched_schedstats = false;
 
-unsigned long nr_iowait_cpu(int cpu)
+static void set_schedstats(bool enabled)
 {
-	return atomic_read(&cpu_rq(cpu)->nr_iowait);
+	if (enabled)
+		static_branch_enable(&sched_schedstats);
+	else
+		static_branch_disable(&sched_schedstats);
 }
 
-///*
-// * IO-wait accounting, and how its mostly bollocks (on SMP).
-// *
-// * The idea behind IO-wait account is to account the idle time that we could
-// * have spend running if it were not for IO. That is, if we were to improve the
-// * storage performance, we'd have a proportional reduction in IO-wait time.
-// *
-// * This all works nicely on UP, where, when a task blocks on IO, we account
-// * idle time as IO-wait, because if the storage were faster, it could've been
-// * running and we'd not be idle.
-// *
-// * This has been extended to SMP, by doing the same for each CPU. This however
-// * is broken.
-// *
-// * Imagine for instance the case where two tasks block on one CPU, only the one
-// * CPU will have IO-wait accounted, while the other has regular idle. Even
-// * though, if the storage were faster, both could've ran at the same time,
-// * utilising both CPUs.
-// *
-// * This means, that when looking globally, the current IO-wait accounting on
-// * SMP is a lower bound, by reason of under accounting.
-// *
-// * Worse, since the numbers are provided per CPU, they are sometimes
-// * interpreted per CPU, and that is nonsensical. A blocked task isn't strictly
-// * associated with any one particular CPU, it can wake to another CPU than it
-// * blocked on. This means the per CPU IO-wait number is meaningless.
-// *
-// * Task CPU affinities can make all that even more 'interesting'.
-// */
-//
-//unsigned long nr_iowait(void)
-//{
-//	unsigned long i, sum = 0;
-//
-//	for_each_possible_cpu(i)
-//		sum += nr_iowait_cpu(i);
-//
-//	return sum;
-//}
-//
-//#ifdef CONFIG_SMP
-//
-///*
-// * sched_exec - execve() is a valuable balancing opportunity, because at
-// * this point the task has the smallest effective memory and cache footprint.
-// */
-//void sched_exec(void)
-//{
-//	struct task_struct *p = current;
-//	unsigned long flags;
-//	int dest_cpu;
-//
-//	raw_spin_lock_irqsave(&p->pi_lock, flags);
-//	dest_cpu = p->sched_class->select_task_rq(p, task_cpu(p), SD_BALANCE_EXEC, 0);
-//	if (dest_cpu == smp_processor_id())
-//		goto unlock;
-//
-//	if (likely(cpu_active(dest_cpu))) {
-//		struct migration_arg arg = { p, dest_cpu };
-//
-//		raw_spin_unlock_irqrestore(&p->pi_lock, flags);
-//		stop_one_cpu(task_cpu(p), migration_cpu_stop, &arg);
-//		return;
-//	}
-//unlock:
-//	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
-//}
-//
-//#endif
+void force_schedstat_enabled(void)
+{
+	if (!schedstat_enabled()) {
+		pr_info("kernel profiling enabled schedstats, disable via kernel.sched_schedstats.\n");
+		static_branch_enable(&sched_schedstats);
+	}
+}
 
-//DEFINE_PER_CPU(struct kernel_stat, kstat);
-//DEFINE_PER_CPU(struct kernel_cpustat, kernel_cpustat);
-//
-//EXPORT_PER_CPU_SYMBOL(kstat);
-//EXPORT_PER_CPU_SYMBOL(kernel_cpustat);
+static int __init setup_schedstats(char *str)
+{
+	int ret = 0;
+	if (!str)
+		goto out;
 
-///*
-// * The function fair_sched_class.update_curr accesses the struct curr
-// * and its field curr->exec_start; when called from task_sched_runtime(),
-// * we observe a high rate of cache misses in practice.
-// * Prefetching this data results in improved performance.
-// */
-//static inline void prefetch_curr_exec_start(struct task_struct *p)
-//{
-//#ifdef CONFIG_FAIR_GROUP_SCHED
-//	struct sched_entity *curr = (&p->se)->cfs_rq->curr;
-//#else
-//	struct sched_entity *curr = (&task_rq(p)->cfs)->curr;
-//#endif
-//	prefetch(curr);
-//	prefetch(&curr->exec_start);
-//}
-//
-///*
-// * Return accounted runtime for the task.
-// * In case the task is currently running, return the runtime plus current's
-// * pending runtime that have not been accounted yet.
-// */
-//unsigned long long task_sched_runtime(struct task_struct *p)
-//{
-//	struct rq_flags rf;
-//	struct rq *rq;
-//	u64 ns;
-//
-//#if defined(CONFIG_64BIT) && defined(CONFIG_SMP)
-//	/*
-//	 * 64-bit doesn't need locks to atomically read a 64-bit value.
-//	 * So we have a optimization chance when the task's delta_exec is 0.
-//	 * Reading ->on_cpu is racy, but this is ok.
-//	 *
-//	 * If we race with it leaving CPU, we'll take a lock. So we're correct.
-//	 * If we race with it entering CPU, unaccounted time is 0. This is
-//	 * indistinguishable from the read occurring a few cycles earlier.
-//	 * If we see ->on_cpu without ->on_rq, the task is leaving, and has
-//	 * been accounted, so we're correct here as well.
-//	 */
-//	if (!p->on_cpu || !task_on_rq_queued(p))
-//		return p->se.sum_exec_runtime;
-//#endif
-//
-//	rq = task_rq_lock(p, &rf);
-//	/*
-//	 * Must be ->curr _and_ ->on_rq.  If dequeued, we would
-//	 * project cycles that may never be accounted to this
-//	 * thread, breaking clock_gettime().
-//	 */
-//	if (task_current(rq, p) && task_on_rq_queued(p)) {
-//		prefetch_curr_exec_start(p);
-//		update_rq_clock(rq);
-//		p->sched_class->update_curr(rq);
-//	}
-//	ns = p->se.sum_exec_runtime;
-//	task_rq_unlock(rq, p, &rf);
-//
-//	return ns;
-//}
+	/*
+	 * This code is called before jump labels have been set up, so we can't
+	 * change the static branch directly just yet.  Instead set a temporary
+	 * variable so init_schedstats() can do it later.
+	 */
+	if (!strcmp(str, "enable")) {
+		__sched_schedstats = true;
+		ret = 1;
+	} else if (!strcmp(str, "disable")) {
+		__sched_schedstats = false;
+		ret = 1;
+	}
+out:
+	if (!ret)
+		pr_warn("Unable to parse schedstats=\n");
+
+	return ret;
+}
+__setup("schedstats=", setup_schedstats);
+
+static void __init init_schedstats(void)
+{
+	set_schedstats(__sched_schedstats);
+}
+
+#ifdef CONFIG_PROC_SYSCTL
+int sysctl_schedstats(struct ctl_table *table, int write, void *buffer,
+		size_t *lenp, loff_t *ppos)
+{
+	struct ctl_table t;
+	int err;
+	int state = static_branch_likely(&sched_schedstats);
+
+	if (write && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	t = *table;
+	t.data = &state;
+	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+	if (err < 0)
+		return err;
+	if (write)
+		set_schedstats(state);
+	return err;
+}
+#endif /* CONFIG_PROC_SYSCTL */
+#else  /* !CONFIG_SCHEDSTATS */
+static inline void init_schedstats(void) {}
+#endif /* CONFIG_SCHEDSTATS */
 
 /*
- * This function gets called by the timer code, with HZ frequency.
- * We call it with interrupts disabled.
+ * fork()/clone()-time setup:
  */
-void scheduler_tick(void)
+int sched_fork(unsigned long clone_flags, struct task_struct *p)
 {
-	int cpu = smp_processor_id();
-	struct rq *rq = cpu_rq(cpu);
-	struct task_struct *curr = rq->curr;
-	struct rq_flags rf;
-	unsigned long thermal_pressure;
+	unsigned long flags;
 
-	arch_scale_freq_tick();
-	sched_clock_tick();
+	__sched_fork(clone_flags, p);
+	/*
+	 * We mark the process as NEW here. This guarantees that
+	 * nobody will actually run it, and a signal or other external
+	 * event cannot wake it up and insert it on the runqueue either.
+	 */
+	p->state = TASK_NEW;
 
-	rq_lock(rq, &rf);
+	/*
+	 * Make sure we do not leak PI boosting priority to the child.
+	 */
+	p->prio = current->normal_prio;
 
-	update_rq_clock(rq);
-	thermal_pressure = arch_scale_thermal_pressure(cpu_of(rq));
-	update_thermal_load_avg(rq_clock_thermal(rq), rq, thermal_pressure);
-	curr->sched_class->task_tick(rq, curr, 0);
-	calc_global_load_tick(rq);
-	psi_task_tick(rq);
+	uclamp_fork(p);
 
-	rq_unlock(rq, &rf);
+	/*
+	 * Revert to default priority/policy on fork if requested.
+	 */
+	if (unlikely(p->sched_reset_on_fork)) {
+		if (task_has_dl_policy(p) || task_has_rt_policy(p)) {
+			p->policy = SCHED_NORMAL;
+			p->static_prio = NICE_TO_PRIO(0);
+			p->rt_priority = 0;
+		} else if (PRIO_TO_NICE(p->static_prio) < 0)
+			p->static_prio = NICE_TO_PRIO(0);
 
-	perf_event_task_tick();
+		p->prio = p->normal_prio = __normal_prio(p);
+		set_load_weight(p, false);
+
+		/*
+		 * We don't need the reset flag anymore after the fork. It has
+		 * fulfilled its duty:
+		 */
+		p->sched_reset_on_fork = 0;
+	}
+
+	if (dl_prio(p->prio))
+		return -EAGAIN;
+	else if (rt_prio(p->prio))
+		p->sched_class = &rt_sched_class;
+	else
+		p->sched_class = &fair_sched_class;
 
+	init_entity_runnable_average(&p->se);
+
+	/*
+	 * The child is not yet in the pid-hash so no cgroup attach races,
+	 * and the cgroup is pinned to this child due to cgroup_fork()
+	 * is ran before sched_fork().
+	 *
+	 * Silence PROVE_RCU.
+	 */
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	rseq_migrate(p);
+	/*
+	 * We're setting the CPU for the first time, we don't migrate,
+	 * so use __set_task_cpu().
+	 */
+	__set_task_cpu(p, smp_processor_id());
+	if (p->sched_class->task_fork)
+		p->sched_class->task_fork(p);
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+
+#ifdef CONFIG_SCHED_INFO
+	if (likely(sched_info_on()))
+		memset(&p->sched_info, 0, sizeof(p->sched_info));
+#endif
+#if defined(CONFIG_SMP)
+	p->on_cpu = 0;
+#endif
+	init_task_preempt_count(p);
 #ifdef CONFIG_SMP
-	rq->idle_balance = idle_cpu(cpu);
-	trigger_load_balance(rq);
+	plist_node_init(&p->pushable_tasks, MAX_PRIO);
+	RB_CLEAR_NODE(&p->pushable_dl_tasks);
 #endif
+	return 0;
 }
 
-//#ifdef CONFIG_NO_HZ_FULL
-//
-//struct tick_work {
-//	int			cpu;
-//	atomic_t		state;
-//	struct delayed_work	work;
-//};
-///* Values for ->state, see diagram below. */
-//#define TICK_SCHED_REMOTE_OFFLINE	0
-//#define TICK_SCHED_REMOTE_OFFLINING	1
-//#define TICK_SCHED_REMOTE_RUNNING	2
-//
-///*
-// * State diagram for ->state:
-// *
-// *
-// *          TICK_SCHED_REMOTE_OFFLINE
-// *                    |   ^
-// *                    |   |
-// *                    |   | sched_tick_remote()
-// *                    |   |
-// *                    |   |
-// *                    +--TICK_SCHED_REMOTE_OFFLINING
-// *                    |   ^
-// *                    |   |
-// * sched_tick_start() |   | sched_tick_stop()
-// *                    |   |
-// *                    V   |
-// *          TICK_SCHED_REMOTE_RUNNING
-// *
-// *
-// * Other transitions get WARN_ON_ONCE(), except that sched_tick_remote()
-// * and sched_tick_start() are happy to leave the state in RUNNING.
-// */
+void sched_post_fork(struct task_struct *p)
+{
+	uclamp_post_fork(p);
+}
+
+unsigned long to_ratio(u64 period, u64 runtime)
+{
+	if (runtime == RUNTIME_INF)
+		return BW_UNIT;
+
+	/*
+	 * Doing this here saves a lot of checks in all
+	 * the calling paths, and returning zero seems
+	 * safe for them anyway.
+	 */
+	if (period == 0)
+		return 0;
+
+	return div64_u64(runtime << BW_SHIFT, period);
+}
+
+/*
+ * wake_up_new_task - wake up a newly created task for the first time.
+ *
+ * This function will do some initial scheduler statistics housekeeping
+ * that must be done for every newly created context, then puts the task
+ * on the runqueue and wakes it.
+ */
+void wake_up_new_task(struct task_struct *p)
+{
+	struct rq_flags rf;
+	struct rq *rq;
+
+	raw_spin_lock_irqsave(&p->pi_lock, rf.flags);
+	p->state = TASK_RUNNING;
+#ifdef CONFIG_SMP
+	/*
+	 * Fork balancing, do it here and not earlier because:
+	 *  - cpus_ptr can change in the fork path
+	 *  - any previously selected CPU might disappear through hotplug
+	 *
+	 * Use __set_task_cpu() to avoid calling sched_class::migrate_task_rq,
+	 * as we're not fully set-up yet.
+	 */
+	p->recent_used_cpu = task_cpu(p);
+	rseq_migrate(p);
+	__set_task_cpu(p, select_task_rq(p, task_cpu(p), SD_BALANCE_FORK, 0));
+#endif
+	rq = __task_rq_lock(p, &rf);
+	update_rq_clock(rq);
+	post_init_entity_util_avg(p);
+
+	activate_task(rq, p, ENQUEUE_NOCLOCK);
+	trace_sched_wakeup_new(p);
+	check_preempt_curr(rq, p, WF_FORK);
+#ifdef CONFIG_SMP
+	if (p->sched_class->task_woken) {
+		/*
+		 * Nothing relies on rq->lock after this, so its fine to
+		 * drop it.
+		 */
+		rq_unpin_lock(rq, &rf);
+		p->sched_class->task_woken(rq, p);
+		rq_repin_lock(rq, &rf);
+	}
+#endif
+	task_rq_unlock(rq, p, &rf);
+}
+
+#ifdef CONFIG_PREEMPT_NOTIFIERS
 //
-//static struct tick_work __percpu *tick_work_cpu;
+//static DEFINE_STATIC_KEY_FALSE(preempt_notifier_key);
 //
-//static void sched_tick_remote(struct work_struct *work)
+//void preempt_notifier_inc(void)
 //{
-//	struct delayed_work *dwork = to_delayed_work(work);
-//	struct tick_work *twork = container_of(dwork, struct tick_work, work);
-//	int cpu = twork->cpu;
-//	struct rq *rq = cpu_rq(cpu);
-//	struct task_struct *curr;
-//	struct rq_flags rf;
-//	u64 delta;
-//	int os;
-//
-//	/*
-//	 * Handle the tick only if it appears the remote CPU is running in full
-//	 * dynticks mode. The check is racy by nature, but missing a tick or
-//	 * having one too much is no big deal because the scheduler tick updates
-//	 * statistics and checks timeslices in a time-independent way, regardless
-//	 * of when exactly it is running.
-//	 */
-//	if (!tick_nohz_tick_stopped_cpu(cpu))
-//		goto out_requeue;
-//
-//	rq_lock_irq(rq, &rf);
-//	curr = rq->curr;
-//	if (cpu_is_offline(cpu))
-//		goto out_unlock;
-//
-//	update_rq_clock(rq);
-//
-//	if (!is_idle_task(curr)) {
-//		/*
-//		 * Make sure the next tick runs within a reasonable
-//		 * amount of time.
-//		 */
-//		delta = rq_clock_task(rq) - curr->se.exec_start;
-//		WARN_ON_ONCE(delta > (u64)NSEC_PER_SEC * 3);
-//	}
-//	curr->sched_class->task_tick(rq, curr, 0);
-//
-//	calc_load_nohz_remote(rq);
-//out_unlock:
-//	rq_unlock_irq(rq, &rf);
-//out_requeue:
-//
-//	/*
-//	 * Run the remote tick once per second (1Hz). This arbitrary
-//	 * frequency is large enough to avoid overload but short enough
-//	 * to keep scheduler internal stats reasonably up to date.  But
-//	 * first update state to reflect hotplug activity if required.
-//	 */
-//	os = atomic_fetch_add_unless(&twork->state, -1, TICK_SCHED_REMOTE_RUNNING);
-//	WARN_ON_ONCE(os == TICK_SCHED_REMOTE_OFFLINE);
-//	if (os == TICK_SCHED_REMOTE_RUNNING)
-//		queue_delayed_work(system_unbound_wq, dwork, HZ);
+//	static_branch_inc(&preempt_notifier_key);
 //}
+//EXPORT_SYMBOL_GPL(preempt_notifier_inc);
 //
-//static void sched_tick_start(int cpu)
+//void preempt_notifier_dec(void)
 //{
-//	int os;
-//	struct tick_work *twork;
-//
-//	if (housekeeping_cpu(cpu, HK_FLAG_TICK))
-//		return;
+//	static_branch_dec(&preempt_notifier_key);
+//}
+//EXPORT_SYMBOL_GPL(preempt_notifier_dec);
 //
-//	WARN_ON_ONCE(!tick_work_cpu);
+///**
+// * preempt_notifier_register - tell me when current is being preempted & rescheduled
+// * @notifier: notifier struct to register
+// */
+//void preempt_notifier_register(struct preempt_notifier *notifier)
+//{
+//	if (!static_branch_unlikely(&preempt_notifier_key))
+//		WARN(1, "registering preempt_notifier while notifiers disabled\n");
 //
-//	twork = per_cpu_ptr(tick_work_cpu, cpu);
-//	os = atomic_xchg(&twork->state, TICK_SCHED_REMOTE_RUNNING);
-//	WARN_ON_ONCE(os == TICK_SCHED_REMOTE_RUNNING);
-//	if (os == TICK_SCHED_REMOTE_OFFLINE) {
-//		twork->cpu = cpu;
-//		INIT_DELAYED_WORK(&twork->work, sched_tick_remote);
-//		queue_delayed_work(system_unbound_wq, &twork->work, HZ);
-//	}
+//	hlist_add_head(&notifier->link, &current->preempt_notifiers);
 //}
+//EXPORT_SYMBOL_GPL(preempt_notifier_register);
 //
-//#ifdef CONFIG_HOTPLUG_CPU
-//static void sched_tick_stop(int cpu)
+///**
+// * preempt_notifier_unregister - no longer interested in preemption notifications
+// * @notifier: notifier struct to unregister
+// *
+// * This is *not* safe to call from within a preemption notifier.
+// */
+//void preempt_notifier_unregister(struct preempt_notifier *notifier)
 //{
-//	struct tick_work *twork;
-//	int os;
-//
-//	if (housekeeping_cpu(cpu, HK_FLAG_TICK))
-//		return;
+//	hlist_del(&notifier->link);
+//}
+//EXPORT_SYMBOL_GPL(preempt_notifier_unregister);
 //
-//	WARN_ON_ONCE(!tick_work_cpu);
+//static void __fire_sched_in_preempt_notifiers(struct task_struct *curr)
+//{
+//	struct preempt_notifier *notifier;
 //
-//	twork = per_cpu_ptr(tick_work_cpu, cpu);
-//	/* There cannot be competing actions, but don't rely on stop-machine. */
-//	os = atomic_xchg(&twork->state, TICK_SCHED_REMOTE_OFFLINING);
-//	WARN_ON_ONCE(os != TICK_SCHED_REMOTE_RUNNING);
-//	/* Don't cancel, as this would mess up the state machine. */
+//	hlist_for_each_entry(notifier, &curr->preempt_notifiers, link)
+//		notifier->ops->sched_in(notifier, raw_smp_processor_id());
 //}
-//#endif /* CONFIG_HOTPLUG_CPU */
 //
-//int __init sched_tick_offload_init(void)
+//static __always_inline void fire_sched_in_preempt_notifiers(struct task_struct *curr)
 //{
-//	tick_work_cpu = alloc_percpu(struct tick_work);
-//	BUG_ON(!tick_work_cpu);
-//	return 0;
+//	if (static_branch_unlikely(&preempt_notifier_key))
+//		__fire_sched_in_preempt_notifiers(curr);
 //}
-//
-//#else /* !CONFIG_NO_HZ_FULL */
-//static inline void sched_tick_start(int cpu) { }
-//static inline void sched_tick_stop(int cpu) { }
-//#endif
 
-#if defined(CONFIG_PREEMPTION) && (defined(CONFIG_DEBUG_PREEMPT) || \
-				defined(CONFIG_TRACE_PREEMPT_TOGGLE))
-/*
- * If the value passed in is equal to the current preempt count
- * then we just disabled preemption. Start timing the latency.
- */
-static inline void preempt_latency_start(int val)
+static void
+__fire_sched_out_preempt_notifiers(struct task_struct *curr,
+				   struct task_struct *next)
 {
-	if (preempt_count() == val) {
-		unsigned long ip = get_lock_parent_ip();
-#ifdef CONFIG_DEBUG_PREEMPT
-		current->preempt_disable_ip = ip;
-#endif
-		trace_preempt_off(CALLER_ADDR0, ip);
-	}
+	struct preempt_notifier *notifier;
+
+	hlist_for_each_entry(notifier, &curr->preempt_notifiers, link)
+		notifier->ops->sched_out(notifier, next);
 }
 
-//void preempt_count_add(int val)
-//{
-//#ifdef CONFIG_DEBUG_PREEMPT
-//	/*
-//	 * Underflow?
-//	 */
-//	if (DEBUG_LOCKS_WARN_ON((preempt_count() < 0)))
-//		return;
-//#endif
-//	__preempt_count_add(val);
-//#ifdef CONFIG_DEBUG_PREEMPT
-//	/*
-//	 * Spinlock count overflowing soon?
-//	 */
-//	DEBUG_LOCKS_WARN_ON((preempt_count() & PREEMPT_MASK) >=
-//				PREEMPT_MASK - 10);
-//#endif
-//	preempt_latency_start(val);
-//}
-//EXPORT_SYMBOL(preempt_count_add);
-//NOKPROBE_SYMBOL(preempt_count_add);
-//
-///*
-// * If the value passed in equals to the current preempt count
-// * then we just enabled preemption. Stop timing the latency.
-// */
-//static inline void preempt_latency_stop(int val)
-//{
-//	if (preempt_count() == val)
-//		trace_preempt_on(CALLER_ADDR0, get_lock_parent_ip());
-//}
-//
-//void preempt_count_sub(int val)
-//{
-//#ifdef CONFIG_DEBUG_PREEMPT
-//	/*
-//	 * Underflow?
-//	 */
-//	if (DEBUG_LOCKS_WARN_ON(val > preempt_count()))
-//		return;
-//	/*
-//	 * Is the spinlock portion underflowing?
-//	 */
-//	if (DEBUG_LOCKS_WARN_ON((val < PREEMPT_MASK) &&
-//			!(preempt_count() & PREEMPT_MASK)))
-//		return;
-//#endif
-//
-//	preempt_latency_stop(val);
-//	__preempt_count_sub(val);
-//}
-//EXPORT_SYMBOL(preempt_count_sub);
-//NOKPROBE_SYMBOL(preempt_count_sub);
-//
-#else
-static inline void preempt_latency_start(int val) { }
-static inline void preempt_latency_stop(int val) { }
-#endif
-
-static inline unsigned long get_preempt_disable_ip(struct task_struct *p)
+static __always_inline void
+fire_sched_out_preempt_notifiers(struct task_struct *curr,
+				 struct task_struct *next)
 {
-#ifdef CONFIG_DEBUG_PREEMPT
-	return p->preempt_disable_ip;
-#else
-	return 0;
-#endif
+	if (static_branch_unlikely(&preempt_notifier_key))
+		__fire_sched_out_preempt_notifiers(curr, next);
 }
 
-/*
- * Print scheduling while atomic bug:
- */
-static noinline void __schedule_bug(struct task_struct *prev)
-{
-	/* Save this before calling printk(), since that will clobber it */
-	unsigned long preempt_disable_ip = get_preempt_disable_ip(current);
-
-	if (oops_in_progress)
-		return;
-
-	printk(KERN_ERR "BUG: scheduling while atomic: %s/%d/0x%08x\n",
-		prev->comm, prev->pid, preempt_count());
-
-	debug_show_held_locks(prev);
-	print_modules();
-	if (irqs_disabled())
-		print_irqtrace_events(prev);
-	if (IS_ENABLED(CONFIG_DEBUG_PREEMPT)
-	    && in_atomic_preempt_off()) {
-		pr_err("Preemption disabled at:");
-		print_ip_sym(KERN_ERR, preempt_disable_ip);
-	}
-	if (panic_on_warn)
-		panic("scheduling while atomic\n");
+#else /* !CONFIG_PREEMPT_NOTIFIERS */
 
-	dump_stack();
-	add_taint(TAINT_WARN, LOCKDEP_STILL_OK);
+static inline void fire_sched_in_preempt_notifiers(struct task_struct *curr)
+{
 }
 
-/*
- * Various schedule()-time debugging checks and statistics:
- */
-static inline void schedule_debug(struct task_struct *prev, bool preempt)
+static inline void
+fire_sched_out_preempt_notifiers(struct task_struct *curr,
+				 struct task_struct *next)
 {
-#ifdef CONFIG_SCHED_STACK_END_CHECK
-	if (task_stack_end_corrupted(prev))
-		panic("corrupted stack end detected inside scheduler\n");
+}
 
-	if (task_scs_end_corrupted(prev))
-		panic("corrupted shadow stack detected inside scheduler\n");
-#endif
+#endif /* CONFIG_PREEMPT_NOTIFIERS */
 
-#ifdef CONFIG_DEBUG_ATOMIC_SLEEP
-	if (!preempt && prev->state && prev->non_block_count) {
-		printk(KERN_ERR "BUG: scheduling in a non-blocking section: %s/%d/%i\n",
-			prev->comm, prev->pid, prev->non_block_count);
-		dump_stack();
-		add_taint(TAINT_WARN, LOCKDEP_STILL_OK);
-	}
+static inline void prepare_task(struct task_struct *next)
+{
+#ifdef CONFIG_SMP
+	/*
+	 * Claim the task as running, we do this before switching to it
+	 * such that any running task will have this set.
+	 *
+	 * See the ttwu() WF_ON_CPU case and its ordering comment.
+	 */
+	WRITE_ONCE(next->on_cpu, 1);
 #endif
-
-	if (unlikely(in_atomic_preempt_off())) {
-		__schedule_bug(prev);
-		preempt_count_set(PREEMPT_DISABLED);
-	}
-	rcu_sleep_check();
-
-	profile_hit(SCHED_PROFILING, __builtin_return_address(0));
-
-	schedstat_inc(this_rq()->sched_count);
 }
 
-static void put_prev_task_balance(struct rq *rq, struct task_struct *prev,
-				  struct rq_flags *rf)
+static inline void finish_task(struct task_struct *prev)
 {
 #ifdef CONFIG_SMP
-	const struct sched_class *class;
 	/*
-	 * We must do the balancing pass before put_prev_task(), such
-	 * that when we release the rq->lock the task is in the same
-	 * state as before we took rq->lock.
+	 * This must be the very last reference to @prev from this CPU. After
+	 * p->on_cpu is cleared, the task can be moved to a different CPU. We
+	 * must ensure this doesn't happen until the switch is completely
+	 * finished.
 	 *
-	 * We can terminate the balance pass as soon as we know there is
-	 * a runnable task of @class priority or higher.
+	 * In particular, the load of prev->state in finish_task_switch() must
+	 * happen before this.
+	 *
+	 * Pairs with the smp_cond_load_acquire() in try_to_wake_up().
 	 */
-	for_class_range(class, prev->sched_class, &idle_sched_class) {
-		if (class->balance(rq, prev, rf))
-			break;
-	}
+	smp_store_release(&prev->on_cpu, 0);
 #endif
-
-	put_prev_task(rq, prev);
 }
 
-/*
- * Pick up the highest-prio task:
- */
-static inline struct task_struct *
-pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
+static inline void
+prepare_lock_switch(struct rq *rq, struct task_struct *next, struct rq_flags *rf)
 {
-	const struct sched_class *class;
-	struct task_struct *p;
-
 	/*
-	 * Optimization: we know that if all tasks are in the fair class we can
-	 * call that function directly, but only if the @prev task wasn't of a
-	 * higher scheduling class, because otherwise those loose the
-	 * opportunity to pull in more work from other CPUs.
+	 * Since the runqueue lock will be released by the next
+	 * task (which is an invalid locking op but in the case
+	 * of the scheduler it's an obvious special-case), so we
+	 * do an early lockdep release here:
 	 */
-	if (likely(prev->sched_class <= &fair_sched_class &&
-		   rq->nr_running == rq->cfs.h_nr_running)) {
-
-		p = pick_next_task_fair(rq, prev, rf);
-		if (unlikely(p == RETRY_TASK))
-			goto restart;
-
-		/* Assumes fair_sched_class->next == idle_sched_class */
-		if (!p) {
-			put_prev_task(rq, prev);
-			p = pick_next_task_idle(rq);
-		}
+	rq_unpin_lock(rq, rf);
+	spin_release(&rq->lock.dep_map, _THIS_IP_);
+#ifdef CONFIG_DEBUG_SPINLOCK
+	/* this is a valid case when another task releases the spinlock */
+	rq->lock.owner = next;
+#endif
+}
 
-		return p;
-	}
+static inline void finish_lock_switch(struct rq *rq)
+{
+	/*
+	 * If we are tracking spinlock dependencies then we have to
+	 * fix up the runqueue lock - which gets 'carried over' from
+	 * prev into current:
+	 */
+	spin_acquire(&rq->lock.dep_map, 0, 0, _THIS_IP_);
+	raw_spin_unlock_irq(&rq->lock);
+}
 
-restart:
-	put_prev_task_balance(rq, prev, rf);
+/*
+ * NOP if the arch has not defined these:
+ */
 
-	for_each_class(class) {
-		p = class->pick_next_task(rq);
-		if (p)
-			return p;
-	}
+#ifndef prepare_arch_switch
+# define prepare_arch_switch(next)	do { } while (0)
+#endif
 
-	/* The idle class should always have a runnable task: */
-	BUG();
-}
+#ifndef finish_arch_post_lock_switch
+# define finish_arch_post_lock_switch()	do { } while (0)
+#endif
 
-/*
- * __schedule() is the main scheduler function.
- *
- * The main means of driving the scheduler and thus entering this function are:
- *
- *   1. Explicit blocking: mutex, semaphore, waitqueue, etc.
- *
- *   2. TIF_NEED_RESCHED flag is checked on interrupt and userspace return
- *      paths. For example, see arch/x86/entry_64.S.
+/**
+ * prepare_task_switch - prepare to switch tasks
+ * @rq: the runqueue preparing to switch
+ * @prev: the current task that is being switched out
+ * @next: the task we are going to switch to.
  *
- *      To drive preemption between tasks, the scheduler sets the flag in timer
- *      interrupt handler scheduler_tick().
+ * This is called with the rq lock held and interrupts off. It must
+ * be paired with a subsequent finish_task_switch after the context
+ * switch.
  *
- *   3. Wakeups don't really cause entry into schedule(). They add a
- *      task to the run-queue and that's it.
+ * prepare_task_switch sets up locking and calls architecture specific
+ * hooks.
+ */
+static inline void
+prepare_task_switch(struct rq *rq, struct task_struct *prev,
+		    struct task_struct *next)
+{
+	kcov_prepare_switch(prev);
+	sched_info_switch(rq, prev, next);
+	perf_event_task_sched_out(prev, next);
+	rseq_preempt(prev);
+	fire_sched_out_preempt_notifiers(prev, next);
+	prepare_task(next);
+	prepare_arch_switch(next);
+}
+
+/**
+ * finish_task_switch - clean up after a task-switch
+ * @prev: the thread we just switched away from.
  *
- *      Now, if the new task added to the run-queue preempts the current
- *      task, then the wakeup sets TIF_NEED_RESCHED and schedule() gets
- *      called on the nearest possible occasion:
+ * finish_task_switch must be called after the context switch, paired
+ * with a prepare_task_switch call before the context switch.
+ * finish_task_switch will reconcile locking set up by prepare_task_switch,
+ * and do any other architecture-specific cleanup actions.
  *
- *       - If the kernel is preemptible (CONFIG_PREEMPTION=y):
+ * Note that we may have delayed dropping an mm in context_switch(). If
+ * so, we finish that here outside of the runqueue lock. (Doing it
+ * with the lock held can cause deadlocks; see schedule() for
+ * details.)
  *
- *         - in syscall or exception context, at the next outmost
- *           preempt_enable(). (this might be as soon as the wake_up()'s
- *           spin_unlock()!)
- *
- *         - in IRQ context, return from interrupt-handler to
- *           preemptible context
- *
- *       - If the kernel is not preemptible (CONFIG_PREEMPTION is not set)
- *         then at the next:
- *
- *          - cond_resched() call
- *          - explicit schedule() call
- *          - return from syscall or exception to user-space
- *          - return from interrupt-handler to user-space
- *
- * WARNING: must be called with preemption disabled!
+ * The context switch have flipped the stack from under us and restored the
+ * local variables which were saved when this task called schedule() in the
+ * past. prev == current is still correct but we need to recalculate this_rq
+ * because prev may have moved to another CPU.
  */
-static void __sched notrace __schedule(bool preempt)
+static struct rq *finish_task_switch(struct task_struct *prev)
+	__releases(rq->lock)
 {
-	struct task_struct *prev, *next;
-	unsigned long *switch_count;
-	unsigned long prev_state;
-	struct rq_flags rf;
-	struct rq *rq;
-	int cpu;
-
-	cpu = smp_processor_id();
-	rq = cpu_rq(cpu);
-	prev = rq->curr;
-
-	schedule_debug(prev, preempt);
-
-	if (sched_feat(HRTICK))
-		hrtick_clear(rq);
-
-	local_irq_disable();
-	rcu_note_context_switch(preempt);
+	struct rq *rq = this_rq();
+	struct mm_struct *mm = rq->prev_mm;
+	long prev_state;
 
 	/*
-	 * Make sure that signal_pending_state()->signal_pending() below
-	 * can't be reordered with __set_current_state(TASK_INTERRUPTIBLE)
-	 * done by the caller to avoid the race with signal_wake_up():
+	 * The previous task will have left us with a preempt_count of 2
+	 * because it left us after:
 	 *
-	 * __set_current_state(@state)		signal_wake_up()
-	 * schedule()				  set_tsk_thread_flag(p, TIF_SIGPENDING)
-	 *					  wake_up_state(p, state)
-	 *   LOCK rq->lock			    LOCK p->pi_state
-	 *   smp_mb__after_spinlock()		    smp_mb__after_spinlock()
-	 *     if (signal_pending_state())	    if (p->state & @state)
+	 *	schedule()
+	 *	  preempt_disable();			// 1
+	 *	  __schedule()
+	 *	    raw_spin_lock_irq(&rq->lock)	// 2
 	 *
-	 * Also, the membarrier system call requires a full memory barrier
-	 * after coming from user-space, before storing to rq->curr.
+	 * Also, see FORK_PREEMPT_COUNT.
 	 */
-	rq_lock(rq, &rf);
-	smp_mb__after_spinlock();
-
-	/* Promote REQ to ACT */
-	rq->clock_update_flags <<= 1;
-	update_rq_clock(rq);
+	if (WARN_ONCE(preempt_count() != 2*PREEMPT_DISABLE_OFFSET,
+		      "corrupted preempt_count: %s/%d/0x%x\n",
+		      current->comm, current->pid, preempt_count()))
+		preempt_count_set(FORK_PREEMPT_COUNT);
 
-	switch_count = &prev->nivcsw;
+	rq->prev_mm = NULL;
 
 	/*
-	 * We must load prev->state once (task_struct::state is volatile), such
-	 * that:
+	 * A task struct has one reference for the use as "current".
+	 * If a task dies, then it sets TASK_DEAD in tsk->state and calls
+	 * schedule one last time. The schedule call will never return, and
+	 * the scheduled task must drop that reference.
 	 *
-	 *  - we form a control dependency vs deactivate_task() below.
-	 *  - ptrace_{,un}freeze_traced() can change ->state underneath us.
+	 * We must observe prev->state before clearing prev->on_cpu (in
+	 * finish_task), otherwise a concurrent wakeup can get prev
+	 * running on another CPU and we could rave with its RUNNING -> DEAD
+	 * transition, resulting in a double drop.
 	 */
 	prev_state = prev->state;
-	if (!preempt && prev_state) {
-		if (signal_pending_state(prev_state, prev)) {
-			prev->state = TASK_RUNNING;
-		} else {
-			prev->sched_contributes_to_load =
-				(prev_state & TASK_UNINTERRUPTIBLE) &&
-				!(prev_state & TASK_NOLOAD) &&
-				!(prev->flags & PF_FROZEN);
-
-			if (prev->sched_contributes_to_load)
-				rq->nr_uninterruptible++;
-
-			/*
-			 * __schedule()			ttwu()
-			 *   prev_state = prev->state;    if (p->on_rq && ...)
-			 *   if (prev_state)		    goto out;
-			 *     p->on_rq = 0;		  smp_acquire__after_ctrl_dep();
-			 *				  p->state = TASK_WAKING
-			 *
-			 * Where __schedule() and ttwu() have matching control dependencies.
-			 *
-			 * After this, schedule() must not care about p->state any more.
-			 */
-			deactivate_task(rq, prev, DEQUEUE_SLEEP | DEQUEUE_NOCLOCK);
+	vtime_task_switch(prev);
+	perf_event_task_sched_in(prev, current);
+	finish_task(prev);
+	finish_lock_switch(rq);
+	finish_arch_post_lock_switch();
+	kcov_finish_switch(current);
 
-			if (prev->in_iowait) {
-				atomic_inc(&rq->nr_iowait);
-				delayacct_blkio_start();
-			}
-		}
-		switch_count = &prev->nvcsw;
+	fire_sched_in_preempt_notifiers(current);
+	/*
+	 * When switching through a kernel thread, the loop in
+	 * membarrier_{private,global}_expedited() may have observed that
+	 * kernel thread and not issued an IPI. It is therefore possible to
+	 * schedule between user->kernel->user threads without passing though
+	 * switch_mm(). Membarrier requires a barrier after storing to
+	 * rq->curr, before returning to userspace, so provide them here:
+	 *
+	 * - a full memory barrier for {PRIVATE,GLOBAL}_EXPEDITED, implicitly
+	 *   provided by mmdrop(),
+	 * - a sync_core for SYNC_CORE.
+	 */
+	if (mm) {
+		membarrier_mm_sync_core_before_usermode(mm);
+		mmdrop(mm);
 	}
+	if (unlikely(prev_state == TASK_DEAD)) {
+		if (prev->sched_class->task_dead)
+			prev->sched_class->task_dead(prev);
 
-	next = pick_next_task(rq, prev, &rf);
-	clear_tsk_need_resched(prev);
-	clear_preempt_need_resched();
-
-	if (likely(prev != next)) {
-		rq->nr_switches++;
-		/*
-		 * RCU users of rcu_dereference(rq->curr) may not see
-		 * changes to task_struct made by pick_next_task().
-		 */
-		RCU_INIT_POINTER(rq->curr, next);
 		/*
-		 * The membarrier system call requires each architecture
-		 * to have a full memory barrier after updating
-		 * rq->curr, before returning to user-space.
-		 *
-		 * Here are the schemes providing that barrier on the
-		 * various architectures:
-		 * - mm ? switch_mm() : mmdrop() for x86, s390, sparc, PowerPC.
-		 *   switch_mm() rely on membarrier_arch_switch_mm() on PowerPC.
-		 * - finish_lock_switch() for weakly-ordered
-		 *   architectures where spin_unlock is a full barrier,
-		 * - switch_to() for arm64 (weakly-ordered, spin_unlock
-		 *   is a RELEASE barrier),
+		 * Remove function-return probe instances associated with this
+		 * task and put them back on the free list.
 		 */
-		++*switch_count;
-
-		psi_sched_switch(prev, next, !task_on_rq_queued(prev));
+		kprobe_flush_task(prev);
 
-		trace_sched_switch(preempt, prev, next);
+		/* Task is done with its stack. */
+		put_task_stack(prev);
 
-		/* Also unlocks the rq: */
-		rq = context_switch(rq, prev, next, &rf);
-	} else {
-		rq->clock_update_flags &= ~(RQCF_ACT_SKIP|RQCF_REQ_SKIP);
-		rq_unlock_irq(rq, &rf);
+		put_task_struct_rcu_user(prev);
 	}
 
-	balance_callback(rq);
+	tick_nohz_task_switch();
+	return rq;
 }
 
-void __noreturn do_task_dead(void)
+#ifdef CONFIG_SMP
+
+/* rq->lock is NOT held, but preemption is disabled */
+static void __balance_callback(struct rq *rq)
 {
-	/* Causes final put_task_struct in finish_task_switch(): */
-	set_special_state(TASK_DEAD);
+	struct callback_head *head, *next;
+	void (*func)(struct rq *rq);
+	unsigned long flags;
 
-	/* Tell freezer to ignore us: */
-	current->flags |= PF_NOFREEZE;
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	head = rq->balance_callback;
+	rq->balance_callback = NULL;
+	while (head) {
+		func = (void (*)(struct rq *))head->func;
+		next = head->next;
+		head->next = NULL;
+		head = next;
+
+		func(rq);
+	}
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+}
 
-	__schedule(false);
-	BUG();
+static inline void balance_callback(struct rq *rq)
+{
+	if (unlikely(rq->balance_callback))
+		__balance_callback(rq);
+}
 
-	/* Avoid "noreturn function does return" - but don't continue if BUG() is a NOP: */
-	for (;;)
-		cpu_relax();
+#else
+
+static inline void balance_callback(struct rq *rq)
+{
 }
-EXPORT_SYMBOL(do_task_dead);
 
-static inline void sched_submit_work(struct task_struct *tsk)
+#endif
+
+/**
+ * schedule_tail - first thing a freshly forked thread must call.
+ * @prev: the thread we just switched away from.
+ */
+asmlinkage __visible void schedule_tail(struct task_struct *prev)
+	__releases(rq->lock)
 {
-	if (!tsk->state)
-		return;
+	struct rq *rq;
 
 	/*
-	 * If a worker went to sleep, notify and ask workqueue whether
-	 * it wants to wake up a task to maintain concurrency.
-	 * As this function is called inside the schedule() context,
-	 * we disable preemption to avoid it calling schedule() again
-	 * in the possible wakeup of a kworker and because wq_worker_sleeping()
-	 * requires it.
+	 * New tasks start with FORK_PREEMPT_COUNT, see there and
+	 * finish_task_switch() for details.
+	 *
+	 * finish_task_switch() will drop rq->lock() and lower preempt_count
+	 * and the preempt_enable() will end up enabling preemption (on
+	 * PREEMPT_COUNT kernels).
 	 */
-	if (tsk->flags & (PF_WQ_WORKER | PF_IO_WORKER)) {
-		preempt_disable();
-		if (tsk->flags & PF_WQ_WORKER)
-			wq_worker_sleeping(tsk);
-		else
-			io_wq_worker_sleeping(tsk);
-		preempt_enable_no_resched();
-	}
 
-	if (tsk_is_pi_blocked(tsk))
-		return;
+	rq = finish_task_switch(prev);
+	balance_callback(rq);
+	preempt_enable();
 
-	/*
-	 * If we are going to sleep and we have plugged IO queued,
-	 * make sure to submit it to avoid deadlocks.
-	 */
-	if (blk_needs_flush_plug(tsk))
-		blk_schedule_flush_plug(tsk);
-}
+	if (current->set_child_tid)
+		put_user(task_pid_vnr(current), current->set_child_tid);
 
-static void sched_update_worker(struct task_struct *tsk)
-{
-	if (tsk->flags & (PF_WQ_WORKER | PF_IO_WORKER)) {
-		if (tsk->flags & PF_WQ_WORKER)
-			wq_worker_running(tsk);
-		else
-			io_wq_worker_running(tsk);
-	}
-}
-
-asmlinkage __visible void __sched schedule(void)
-{
-	struct task_struct *tsk = current;
-
-	sched_submit_work(tsk);
-	do {
-		preempt_disable();
-		__schedule(false);
-		sched_preempt_enable_no_resched();
-	} while (need_resched());
-	sched_update_worker(tsk);
+	calculate_sigpending();
 }
+EXPORT_SYMBOL(schedule_tail);
 
 /*
- * synchronize_rcu_tasks() makes sure that no task is stuck in preempted
- * state (have scheduled out non-voluntarily) by making sure that all
- * tasks have either left the run queue or have gone into user space.
- * As idle tasks do not do either, they must not ever be preempted
- * (schedule out non-voluntarily).
- *
- * schedule_idle() is similar to schedule_preempt_disable() except that it
- * never enables preemption because it does not call sched_submit_work().
+ * context_switch - switch to the new MM and the new thread's register state.
  */
-void __sched schedule_idle(void)
+static __always_inline struct rq *
+context_switch(struct rq *rq, struct task_struct *prev,
+	       struct task_struct *next, struct rq_flags *rf)
 {
+	prepare_task_switch(rq, prev, next);
+
 	/*
-	 * As this skips calling sched_submit_work(), which the idle task does
-	 * regardless because that function is a nop when the task is in a
-	 * TASK_RUNNING state, make sure this isn't used someplace that the
-	 * current task can be in any other state. Note, idle is always in the
-	 * TASK_RUNNING state.
+	 * For paravirt, this is coupled with an exit in switch_to to
+	 * combine the page table reload and the switch backend into
+	 * one hypercall.
 	 */
-	WARN_ON_ONCE(current->state);
-	do {
-		__schedule(false);
-	} while (need_resched());
-}
-
-//#ifdef CONFIG_CONTEXT_TRACKING
-//asmlinkage __visible void __sched schedule_user(void)
-//{
-//	/*
-//	 * If we come here after a random call to set_need_resched(),
-//	 * or we have been woken up remotely but the IPI has not yet arrived,
-//	 * we haven't yet exited the RCU idle mode. Do it here manually until
-//	 * we find a better solution.
-//	 *
-//	 * NB: There are buggy callers of this function.  Ideally we
-//	 * should warn if prev_state != CONTEXT_USER, but that will trigger
-//	 * too frequently to make sense yet.
-//	 */
-//	enum ctx_state prev_state = exception_enter();
-//	schedule();
-//	exception_exit(prev_state);
-//}
-//#endif
+	arch_start_context_switch(prev);
 
-/**
- * schedule_preempt_disabled - called with preemption disabled
- *
- * Returns with preemption disabled. Note: preempt_count must be 1
- */
-void __sched schedule_preempt_disabled(void)
-{
-	sched_preempt_enable_no_resched();
-	schedule();
-	preempt_disable();
-}
+	/*
+	 * kernel -> kernel   lazy + transfer active
+	 *   user -> kernel   lazy + mmgrab() active
+	 *
+	 * kernel ->   user   switch + mmdrop() active
+	 *   user ->   user   switch
+	 */
+	if (!next->mm) {                                // to kernel
+		enter_lazy_tlb(prev->active_mm, next);
 
-static void __sched notrace preempt_schedule_common(void)
-{
-	do {
+		next->active_mm = prev->active_mm;
+		if (prev->mm)                           // from user
+			mmgrab(prev->active_mm);
+		else
+			prev->active_mm = NULL;
+	} else {                                        // to user
+		membarrier_switch_mm(rq, prev->active_mm, next->mm);
 		/*
-		 * Because the function tracer can trace preempt_count_sub()
-		 * and it also uses preempt_enable/disable_notrace(), if
-		 * NEED_RESCHED is set, the preempt_enable_notrace() called
-		 * by the function tracer will call this function again and
-		 * cause infinite recursion.
+		 * sys_membarrier() requires an smp_mb() between setting
+		 * rq->curr / membarrier_switch_mm() and returning to userspace.
 		 *
-		 * Preemption must be disabled here before the function
-		 * tracer can trace. Break up preempt_disable() into two
-		 * calls. One to disable preemption without fear of being
-		 * traced. The other to still record the preemption latency,
-		 * which can also be traced by the function tracer.
+		 * The below provides this either through switch_mm(), or in
+		 * case 'prev->active_mm == next->mm' through
+		 * finish_task_switch()'s mmdrop().
 		 */
-		preempt_disable_notrace();
-		preempt_latency_start(1);
-		__schedule(true);
-		preempt_latency_stop(1);
-		preempt_enable_no_resched_notrace();
+		switch_mm_irqs_off(prev->active_mm, next->mm, next);
 
-		/*
-		 * Check again in case we missed a preemption opportunity
-		 * between schedule and now.
-		 */
-	} while (need_resched());
+		if (!prev->mm) {                        // from kernel
+			/* will mmdrop() in finish_task_switch(). */
+			rq->prev_mm = prev->active_mm;
+			prev->active_mm = NULL;
+		}
+	}
+
+	rq->clock_update_flags &= ~(RQCF_ACT_SKIP|RQCF_REQ_SKIP);
+
+	prepare_lock_switch(rq, next, rf);
+
+	/* Here we just switch the register state and the stack. */
+	switch_to(prev, next, prev);
+	barrier();
+
+	return finish_task_switch(prev);
 }
 
-//#ifdef CONFIG_PREEMPTION
 ///*
-// * This is the entry point to schedule() from in-kernel preemption
-// * off of preempt_enable.
+// * nr_running and nr_context_switches:
+// *
+// * externally visible scheduler statistics: current number of runnable
+// * threads, total number of context switches performed since bootup.
 // */
-//asmlinkage __visible void __sched notrace preempt_schedule(void)
+//unsigned long nr_running(void)
 //{
-//	/*
-//	 * If there is a non-zero preempt_count or interrupts are disabled,
-//	 * we do not want to preempt the current task. Just return..
-//	 */
-//	if (likely(!preemptible()))
-//		return;
+//	unsigned long i, sum = 0;
+//
+//	for_each_online_cpu(i)
+//		sum += cpu_rq(i)->nr_running;
 //
-//	preempt_schedule_common();
+//	return sum;
 //}
-//NOKPROBE_SYMBOL(preempt_schedule);
-//EXPORT_SYMBOL(preempt_schedule);
 //
-///**
-// * preempt_schedule_notrace - preempt_schedule called by tracing
+///*
+// * Check if only the current task is running on the CPU.
+// *
+// * Caution: this function does not check that the caller has disabled
+// * preemption, thus the result might have a time-of-check-to-time-of-use
+// * race.  The caller is responsible to use it correctly, for example:
+// *
+// * - from a non-preemptible section (of course)
 // *
-// * The tracing infrastructure uses preempt_enable_notrace to prevent
-// * recursion and tracing preempt enabling caused by the tracing
-// * infrastructure itself. But as tracing can happen in areas coming
-// * from userspace or just about to enter userspace, a preempt enable
-// * can occur before user_exit() is called. This will cause the scheduler
-// * to be called when the system is still in usermode.
+// * - from a thread that is bound to a single CPU
 // *
-// * To prevent this, the preempt_enable_notrace will use this function
-// * instead of preempt_schedule() to exit user context if needed before
-// * calling the scheduler.
+// * - in a loop with very short iterations (e.g. a polling loop)
 // */
-//asmlinkage __visible void __sched notrace preempt_schedule_notrace(void)
+//bool single_task_running(void)
 //{
-//	enum ctx_state prev_ctx;
-//
-//	if (likely(!preemptible()))
-//		return;
-//
-//	do {
-//		/*
-//		 * Because the function tracer can trace preempt_count_sub()
-//		 * and it also uses preempt_enable/disable_notrace(), if
-//		 * NEED_RESCHED is set, the preempt_enable_notrace() called
-//		 * by the function tracer will call this function again and
-//		 * cause infinite recursion.
-//		 *
-//		 * Preemption must be disabled here before the function
-//		 * tracer can trace. Break up preempt_disable() into two
-//		 * calls. One to disable preemption without fear of being
-//		 * traced. The other to still record the preemption latency,
-//		 * which can also be traced by the function tracer.
-//		 */
-//		preempt_disable_notrace();
-//		preempt_latency_start(1);
-//		/*
-//		 * Needs preempt disabled in case user_exit() is traced
-//		 * and the tracer calls preempt_enable_notrace() causing
-//		 * an infinite recursion.
-//		 */
-//		prev_ctx = exception_enter();
-//		__schedule(true);
-//		exception_exit(prev_ctx);
-//
-//		preempt_latency_stop(1);
-//		preempt_enable_no_resched_notrace();
-//	} while (need_resched());
+//	return raw_rq()->nr_running == 1;
 //}
-//EXPORT_SYMBOL_GPL(preempt_schedule_notrace);
-//
-//#endif /* CONFIG_PREEMPTION */
+//EXPORT_SYMBOL(single_task_running);
 //
+unsigned long long nr_context_switches(void)
+{
+	int i;
+	unsigned long long sum = 0;
+
+	for_each_possible_cpu(i)
+		sum += cpu_rq(i)->nr_switches;
+
+	return sum;
+}
+EXPORT_SYMBOL(nr_context_switches);
+
+/*
+ * Consumers of these two interfaces, like for example the cpuidle menu
+ * governor, are using nonsensical data. Preferring shallow idle state selection
+ * for a CPU that has IO-wait which might not even end up running the task when
+ * it does become runnable.
+ */
+
+unsigned long nr_iowait_cpu(int cpu)
+{
+	return atomic_read(&cpu_rq(cpu)->nr_iowait);
+}
+
 ///*
-// * This is the entry point to schedule() from kernel preemption
-// * off of irq context.
-// * Note, that this is called and return with irqs disabled. This will
-// * protect us against recursive calling from irq.
+// * IO-wait accounting, and how its mostly bollocks (on SMP).
+// *
+// * The idea behind IO-wait account is to account the idle time that we could
+// * have spend running if it were not for IO. That is, if we were to improve the
+// * storage performance, we'd have a proportional reduction in IO-wait time.
+// *
+// * This all works nicely on UP, where, when a task blocks on IO, we account
+// * idle time as IO-wait, because if the storage were faster, it could've been
+// * running and we'd not be idle.
+// *
+// * This has been extended to SMP, by doing the same for each CPU. This however
+// * is broken.
+// *
+// * Imagine for instance the case where two tasks block on one CPU, only the one
+// * CPU will have IO-wait accounted, while the other has regular idle. Even
+// * though, if the storage were faster, both could've ran at the same time,
+// * utilising both CPUs.
+// *
+// * This means, that when looking globally, the current IO-wait accounting on
+// * SMP is a lower bound, by reason of under accounting.
+// *
+// * Worse, since the numbers are provided per CPU, they are sometimes
+// * interpreted per CPU, and that is nonsensical. A blocked task isn't strictly
+// * associated with any one particular CPU, it can wake to another CPU than it
+// * blocked on. This means the per CPU IO-wait number is meaningless.
+// *
+// * Task CPU affinities can make all that even more 'interesting'.
 // */
-//asmlinkage __visible void __sched preempt_schedule_irq(void)
-//{
-//	enum ctx_state prev_state;
 //
-//	/* Catch callers which need to be fixed */
-//	BUG_ON(preempt_count() || !irqs_disabled());
-//
-//	prev_state = exception_enter();
+//unsigned long nr_iowait(void)
+//{
+//	unsigned long i, sum = 0;
 //
-//	do {
-//		preempt_disable();
-//		local_irq_enable();
-//		__schedule(true);
-//		local_irq_disable();
-//		sched_preempt_enable_no_resched();
-//	} while (need_resched());
+//	for_each_possible_cpu(i)
+//		sum += nr_iowait_cpu(i);
 //
-//	exception_exit(prev_state);
+//	return sum;
 //}
+//
+#ifdef CONFIG_SMP
 
-int default_wake_function(wait_queue_entry_t *curr, unsigned mode, int wake_flags,
-			  void *key)
+/*
+ * sched_exec - execve() is a valuable balancing opportunity, because at
+ * this point the task has the smallest effective memory and cache footprint.
+ */
+void sched_exec(void)
 {
-	WARN_ON_ONCE(IS_ENABLED(CONFIG_SCHED_DEBUG) && wake_flags & ~WF_SYNC);
-	return try_to_wake_up(curr->private, mode, wake_flags);
-}
+	struct task_struct *p = current;
+	unsigned long flags;
+	int dest_cpu;
 
-#ifdef CONFIG_RT_MUTEXES
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	dest_cpu = p->sched_class->select_task_rq(p, task_cpu(p), SD_BALANCE_EXEC, 0);
+	if (dest_cpu == smp_processor_id())
+		goto unlock;
 
-static inline int __rt_effective_prio(struct task_struct *pi_task, int prio)
-{
-	if (pi_task)
-		prio = min(prio, pi_task->prio);
+	if (likely(cpu_active(dest_cpu))) {
+		struct migration_arg arg = { p, dest_cpu };
 
-	return prio;
+		raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+		stop_one_cpu(task_cpu(p), migration_cpu_stop, &arg);
+		return;
+	}
+unlock:
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
 }
+EXPORT_SYMBOL(sched_exec);
 
-static inline int rt_effective_prio(struct task_struct *p, int prio)
-{
-	struct task_struct *pi_task = rt_mutex_get_top_task(p);
+#endif
 
-	return __rt_effective_prio(pi_task, prio);
+//DEFINE_PER_CPU(struct kernel_stat, kstat);
+//DEFINE_PER_CPU(struct kernel_cpustat, kernel_cpustat);
+//
+//EXPORT_PER_CPU_SYMBOL(kstat);
+//EXPORT_PER_CPU_SYMBOL(kernel_cpustat);
+
+///*
+// * The function fair_sched_class.update_curr accesses the struct curr
+// * and its field curr->exec_start; when called from task_sched_runtime(),
+// * we observe a high rate of cache misses in practice.
+// * Prefetching this data results in improved performance.
+// */
+//static inline void prefetch_curr_exec_start(struct task_struct *p)
+//{
+//#ifdef CONFIG_FAIR_GROUP_SCHED
+//	struct sched_entity *curr = (&p->se)->cfs_rq->curr;
+//#else
+//	struct sched_entity *curr = (&task_rq(p)->cfs)->curr;
+//#endif
+//	prefetch(curr);
+//	prefetch(&curr->exec_start);
+//}
+//
+///*
+// * Return accounted runtime for the task.
+// * In case the task is currently running, return the runtime plus current's
+// * pending runtime that have not been accounted yet.
+// */
+//unsigned long long task_sched_runtime(struct task_struct *p)
+//{
+//	struct rq_flags rf;
+//	struct rq *rq;
+//	u64 ns;
+//
+//#if defined(CONFIG_64BIT) && defined(CONFIG_SMP)
+//	/*
+//	 * 64-bit doesn't need locks to atomically read a 64-bit value.
+//	 * So we have a optimization chance when the task's delta_exec is 0.
+//	 * Reading ->on_cpu is racy, but this is ok.
+//	 *
+//	 * If we race with it leaving CPU, we'll take a lock. So we're correct.
+//	 * If we race with it entering CPU, unaccounted time is 0. This is
+//	 * indistinguishable from the read occurring a few cycles earlier.
+//	 * If we see ->on_cpu without ->on_rq, the task is leaving, and has
+//	 * been accounted, so we're correct here as well.
+//	 */
+//	if (!p->on_cpu || !task_on_rq_queued(p))
+//		return p->se.sum_exec_runtime;
+//#endif
+//
+//	rq = task_rq_lock(p, &rf);
+//	/*
+//	 * Must be ->curr _and_ ->on_rq.  If dequeued, we would
+//	 * project cycles that may never be accounted to this
+//	 * thread, breaking clock_gettime().
+//	 */
+//	if (task_current(rq, p) && task_on_rq_queued(p)) {
+//		prefetch_curr_exec_start(p);
+//		update_rq_clock(rq);
+//		p->sched_class->update_curr(rq);
+//	}
+//	ns = p->se.sum_exec_runtime;
+//	task_rq_unlock(rq, p, &rf);
+//
+//	return ns;
+//}
+
+/*
+ * This function gets called by the timer code, with HZ frequency.
+ * We call it with interrupts disabled.
+ */
+void scheduler_tick(void)
+{
+	int cpu = smp_processor_id();
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *curr = rq->curr;
+	struct rq_flags rf;
+	unsigned long thermal_pressure;
+
+	arch_scale_freq_tick();
+	sched_clock_tick();
+
+	rq_lock(rq, &rf);
+
+	update_rq_clock(rq);
+	thermal_pressure = arch_scale_thermal_pressure(cpu_of(rq));
+	update_thermal_load_avg(rq_clock_thermal(rq), rq, thermal_pressure);
+	curr->sched_class->task_tick(rq, curr, 0);
+	calc_global_load_tick(rq);
+	psi_task_tick(rq);
+
+	rq_unlock(rq, &rf);
+
+	perf_event_task_tick();
+
+#ifdef CONFIG_SMP
+	rq->idle_balance = idle_cpu(cpu);
+	trigger_load_balance(rq);
+#endif
 }
 
+#ifdef CONFIG_NO_HZ_FULL
+
+struct tick_work {
+	int			cpu;
+	atomic_t		state;
+	struct delayed_work	work;
+};
+/* Values for ->state, see diagram below. */
+#define TICK_SCHED_REMOTE_OFFLINE	0
+#define TICK_SCHED_REMOTE_OFFLINING	1
+#define TICK_SCHED_REMOTE_RUNNING	2
+
 /*
- * rt_mutex_setprio - set the current priority of a task
- * @p: task to boost
- * @pi_task: donor task
+ * State diagram for ->state:
  *
- * This function changes the 'effective' priority of a task. It does
- * not touch ->normal_prio like __setscheduler().
  *
- * Used by the rt_mutex code to implement priority inheritance
- * logic. Call site only calls if the priority of the task changed.
+ *          TICK_SCHED_REMOTE_OFFLINE
+ *                    |   ^
+ *                    |   |
+ *                    |   | sched_tick_remote()
+ *                    |   |
+ *                    |   |
+ *                    +--TICK_SCHED_REMOTE_OFFLINING
+ *                    |   ^
+ *                    |   |
+ * sched_tick_start() |   | sched_tick_stop()
+ *                    |   |
+ *                    V   |
+ *          TICK_SCHED_REMOTE_RUNNING
+ *
+ *
+ * Other transitions get WARN_ON_ONCE(), except that sched_tick_remote()
+ * and sched_tick_start() are happy to leave the state in RUNNING.
  */
-void rt_mutex_setprio(struct task_struct *p, struct task_struct *pi_task)
+
+static struct tick_work __percpu *tick_work_cpu;
+
+static void sched_tick_remote(struct work_struct *work)
 {
-	int prio, oldprio, queued, running, queue_flag =
-		DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK;
-	const struct sched_class *prev_class;
+	struct delayed_work *dwork = to_delayed_work(work);
+	struct tick_work *twork = container_of(dwork, struct tick_work, work);
+	int cpu = twork->cpu;
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *curr;
 	struct rq_flags rf;
-	struct rq *rq;
-
-	/* XXX used to be waiter->prio, not waiter->task->prio */
-	prio = __rt_effective_prio(pi_task, p->normal_prio);
+	u64 delta;
+	int os;
 
 	/*
-	 * If nothing changed; bail early.
+	 * Handle the tick only if it appears the remote CPU is running in full
+	 * dynticks mode. The check is racy by nature, but missing a tick or
+	 * having one too much is no big deal because the scheduler tick updates
+	 * statistics and checks timeslices in a time-independent way, regardless
+	 * of when exactly it is running.
 	 */
-	if (p->pi_top_task == pi_task && prio == p->prio && !dl_prio(prio))
-		return;
+	if (!tick_nohz_tick_stopped_cpu(cpu))
+		goto out_requeue;
+
+	rq_lock_irq(rq, &rf);
+	curr = rq->curr;
+	if (cpu_is_offline(cpu))
+		goto out_unlock;
 
-	rq = __task_rq_lock(p, &rf);
 	update_rq_clock(rq);
-	/*
-	 * Set under pi_lock && rq->lock, such that the value can be used under
-	 * either lock.
-	 *
-	 * Note that there is loads of tricky to make this pointer cache work
-	 * right. rt_mutex_slowunlock()+rt_mutex_postunlock() work together to
-	 * ensure a task is de-boosted (pi_task is set to NULL) before the
-	 * task is allowed to run again (and can exit). This ensures the pointer
-	 * points to a blocked task -- which guaratees the task is present.
-	 */
-	p->pi_top_task = pi_task;
 
-	/*
-	 * For FIFO/RR we only need to set prio, if that matches we're done.
-	 */
-	if (prio == p->prio && !dl_prio(prio))
-		goto out_unlock;
+	if (!is_idle_task(curr)) {
+		/*
+		 * Make sure the next tick runs within a reasonable
+		 * amount of time.
+		 */
+		delta = rq_clock_task(rq) - curr->se.exec_start;
+		WARN_ON_ONCE(delta > (u64)NSEC_PER_SEC * 3);
+	}
+	curr->sched_class->task_tick(rq, curr, 0);
+
+	calc_load_nohz_remote(rq);
+out_unlock:
+	rq_unlock_irq(rq, &rf);
+out_requeue:
 
 	/*
-	 * Idle task boosting is a nono in general. There is one
-	 * exception, when PREEMPT_RT and NOHZ is active:
-	 *
-	 * The idle task calls get_next_timer_interrupt() and holds
-	 * the timer wheel base->lock on the CPU and another CPU wants
-	 * to access the timer (probably to cancel it). We can safely
-	 * ignore the boosting request, as the idle CPU runs this code
-	 * with interrupts disabled and will complete the lock
-	 * protected section without being interrupted. So there is no
-	 * real need to boost.
+	 * Run the remote tick once per second (1Hz). This arbitrary
+	 * frequency is large enough to avoid overload but short enough
+	 * to keep scheduler internal stats reasonably up to date.  But
+	 * first update state to reflect hotplug activity if required.
 	 */
-	if (unlikely(p == rq->idle)) {
-		WARN_ON(p != rq->curr);
-		WARN_ON(p->pi_blocked_on);
-		goto out_unlock;
-	}
+	os = atomic_fetch_add_unless(&twork->state, -1, TICK_SCHED_REMOTE_RUNNING);
+	WARN_ON_ONCE(os == TICK_SCHED_REMOTE_OFFLINE);
+	if (os == TICK_SCHED_REMOTE_RUNNING)
+		queue_delayed_work(system_unbound_wq, dwork, HZ);
+}
 
-	trace_sched_pi_setprio(p, pi_task);
-	oldprio = p->prio;
+static void sched_tick_start(int cpu)
+{
+	int os;
+	struct tick_work *twork;
 
-	if (oldprio == prio)
-		queue_flag &= ~DEQUEUE_MOVE;
+	if (housekeeping_cpu(cpu, HK_FLAG_TICK))
+		return;
 
-	prev_class = p->sched_class;
-	queued = task_on_rq_queued(p);
-	running = task_current(rq, p);
-	if (queued)
-		dequeue_task(rq, p, queue_flag);
-	if (running)
-		put_prev_task(rq, p);
+	WARN_ON_ONCE(!tick_work_cpu);
 
-	/*
-	 * Boosting condition are:
-	 * 1. -rt task is running and holds mutex A
-	 *      --> -dl task blocks on mutex A
-	 *
-	 * 2. -dl task is running and holds mutex A
-	 *      --> -dl task blocks on mutex A and could preempt the
-	 *          running task
-	 */
-	if (dl_prio(prio)) {
-		if (!dl_prio(p->normal_prio) ||
-		    (pi_task && dl_prio(pi_task->prio) &&
-		     dl_entity_preempt(&pi_task->dl, &p->dl))) {
-			p->dl.dl_boosted = 1;
-			queue_flag |= ENQUEUE_REPLENISH;
-		} else
-			p->dl.dl_boosted = 0;
-		p->sched_class = &dl_sched_class;
-	} else if (rt_prio(prio)) {
-		if (dl_prio(oldprio))
-			p->dl.dl_boosted = 0;
-		if (oldprio < prio)
-			queue_flag |= ENQUEUE_HEAD;
-		p->sched_class = &rt_sched_class;
-	} else {
-		if (dl_prio(oldprio))
-			p->dl.dl_boosted = 0;
-		if (rt_prio(oldprio))
-			p->rt.timeout = 0;
-		p->sched_class = &fair_sched_class;
+	twork = per_cpu_ptr(tick_work_cpu, cpu);
+	os = atomic_xchg(&twork->state, TICK_SCHED_REMOTE_RUNNING);
+	WARN_ON_ONCE(os == TICK_SCHED_REMOTE_RUNNING);
+	if (os == TICK_SCHED_REMOTE_OFFLINE) {
+		twork->cpu = cpu;
+		INIT_DELAYED_WORK(&twork->work, sched_tick_remote);
+		queue_delayed_work(system_unbound_wq, &twork->work, HZ);
 	}
+}
 
-	p->prio = prio;
+#ifdef CONFIG_HOTPLUG_CPU
+static void sched_tick_stop(int cpu)
+{
+	struct tick_work *twork;
+	int os;
 
-	if (queued)
-		enqueue_task(rq, p, queue_flag);
-	if (running)
-		set_next_task(rq, p);
+	if (housekeeping_cpu(cpu, HK_FLAG_TICK))
+		return;
 
-	check_class_changed(rq, p, prev_class, oldprio);
-out_unlock:
-	/* Avoid rq from going away on us: */
-	preempt_disable();
-	__task_rq_unlock(rq, &rf);
+	WARN_ON_ONCE(!tick_work_cpu);
 
-	balance_callback(rq);
-	preempt_enable();
+	twork = per_cpu_ptr(tick_work_cpu, cpu);
+	/* There cannot be competing actions, but don't rely on stop-machine. */
+	os = atomic_xchg(&twork->state, TICK_SCHED_REMOTE_OFFLINING);
+	WARN_ON_ONCE(os != TICK_SCHED_REMOTE_RUNNING);
+	/* Don't cancel, as this would mess up the state machine. */
 }
-#else
-static inline int rt_effective_prio(struct task_struct *p, int prio)
+#endif /* CONFIG_HOTPLUG_CPU */
+
+int __init sched_tick_offload_init(void)
 {
-	return prio;
+	tick_work_cpu = alloc_percpu(struct tick_work);
+	BUG_ON(!tick_work_cpu);
+	return 0;
 }
+
+#else /* !CONFIG_NO_HZ_FULL */
+static inline void sched_tick_start(int cpu) { }
+static inline void sched_tick_stop(int cpu) { }
 #endif
 
-void set_user_nice(struct task_struct *p, long nice)
+#if defined(CONFIG_PREEMPTION) && (defined(CONFIG_DEBUG_PREEMPT) || \
+				defined(CONFIG_TRACE_PREEMPT_TOGGLE))
+/*
+ * If the value passed in is equal to the current preempt count
+ * then we just disabled preemption. Start timing the latency.
+ */
+static inline void preempt_latency_start(int val)
 {
-	bool queued, running;
-	int old_prio;
-	struct rq_flags rf;
-	struct rq *rq;
+	if (preempt_count() == val) {
+		unsigned long ip = get_lock_parent_ip();
+#ifdef CONFIG_DEBUG_PREEMPT
+		current->preempt_disable_ip = ip;
+#endif
+		trace_preempt_off(CALLER_ADDR0, ip);
+	}
+}
 
-	if (task_nice(p) == nice || nice < MIN_NICE || nice > MAX_NICE)
-		return;
-	/*
-	 * We have to be careful, if called from sys_setpriority(),
-	 * the task might be in the middle of scheduling on another CPU.
-	 */
-	rq = task_rq_lock(p, &rf);
-	update_rq_clock(rq);
-
-	/*
-	 * The RT priorities are set via sched_setscheduler(), but we still
-	 * allow the 'normal' nice value to be set - but as expected
-	 * it wont have any effect on scheduling until the task is
-	 * SCHED_DEADLINE, SCHED_FIFO or SCHED_RR:
-	 */
-	if (task_has_dl_policy(p) || task_has_rt_policy(p)) {
-		p->static_prio = NICE_TO_PRIO(nice);
-		goto out_unlock;
-	}
-	queued = task_on_rq_queued(p);
-	running = task_current(rq, p);
-	if (queued)
-		dequeue_task(rq, p, DEQUEUE_SAVE | DEQUEUE_NOCLOCK);
-	if (running)
-		put_prev_task(rq, p);
-
-	p->static_prio = NICE_TO_PRIO(nice);
-	set_load_weight(p, true);
-	old_prio = p->prio;
-	p->prio = effective_prio(p);
-
-	if (queued)
-		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
-	if (running)
-		set_next_task(rq, p);
-
-	/*
-	 * If the task increased its priority or is running and
-	 * lowered its priority, then reschedule its CPU:
-	 */
-	p->sched_class->prio_changed(rq, p, old_prio);
-
-out_unlock:
-	task_rq_unlock(rq, p, &rf);
-}
-
-///*
-// * can_nice - check if a task can reduce its nice value
-// * @p: task
-// * @nice: nice value
-// */
-//int can_nice(const struct task_struct *p, const int nice)
+//void preempt_count_add(int val)
 //{
-//	/* Convert nice value [19,-20] to rlimit style value [1,40]: */
-//	int nice_rlim = nice_to_rlimit(nice);
-//
-//	return (nice_rlim <= task_rlimit(p, RLIMIT_NICE) ||
-//		capable(CAP_SYS_NICE));
+//#ifdef CONFIG_DEBUG_PREEMPT
+//	/*
+//	 * Underflow?
+//	 */
+//	if (DEBUG_LOCKS_WARN_ON((preempt_count() < 0)))
+//		return;
+//#endif
+//	__preempt_count_add(val);
+//#ifdef CONFIG_DEBUG_PREEMPT
+//	/*
+//	 * Spinlock count overflowing soon?
+//	 */
+//	DEBUG_LOCKS_WARN_ON((preempt_count() & PREEMPT_MASK) >=
+//				PREEMPT_MASK - 10);
+//#endif
+//	preempt_latency_start(val);
 //}
-//
-//#ifdef __ARCH_WANT_SYS_NICE
+//EXPORT_SYMBOL(preempt_count_add);
+//NOKPROBE_SYMBOL(preempt_count_add);
 //
 ///*
-// * sys_nice - change the priority of the current process.
-// * @increment: priority increment
-// *
-// * sys_setpriority is a more generic, but much slower function that
-// * does similar things.
+// * If the value passed in equals to the current preempt count
+// * then we just enabled preemption. Stop timing the latency.
 // */
-//SYSCALL_DEFINE1(nice, int, increment)
+//static inline void preempt_latency_stop(int val)
 //{
-//	long nice, retval;
+//	if (preempt_count() == val)
+//		trace_preempt_on(CALLER_ADDR0, get_lock_parent_ip());
+//}
 //
+//void preempt_count_sub(int val)
+//{
+//#ifdef CONFIG_DEBUG_PREEMPT
 //	/*
-//	 * Setpriority might change our priority at the same moment.
-//	 * We don't have to worry. Conceptually one call occurs first
-//	 * and we have a single winner.
+//	 * Underflow?
 //	 */
-//	increment = clamp(increment, -NICE_WIDTH, NICE_WIDTH);
-//	nice = task_nice(current) + increment;
-//
-//	nice = clamp_val(nice, MIN_NICE, MAX_NICE);
-//	if (increment < 0 && !can_nice(current, nice))
-//		return -EPERM;
-//
-//	retval = security_task_setnice(current, nice);
-//	if (retval)
-//		return retval;
-//
-//	set_user_nice(current, nice);
-//	return 0;
-//}
-//
+//	if (DEBUG_LOCKS_WARN_ON(val > preempt_count()))
+//		return;
+//	/*
+//	 * Is the spinlock portion underflowing?
+//	 */
+//	if (DEBUG_LOCKS_WARN_ON((val < PREEMPT_MASK) &&
+//			!(preempt_count() & PREEMPT_MASK)))
+//		return;
 //#endif
 //
-///**
-// * task_prio - return the priority value of a given task.
-// * @p: the task in question.
-// *
-// * Return: The priority value as seen by users in /proc.
-// * RT tasks are offset by -200. Normal tasks are centered
-// * around 0, value goes from -16 to +15.
-// */
-//int task_prio(const struct task_struct *p)
-//{
-//	return p->prio - MAX_RT_PRIO;
+//	preempt_latency_stop(val);
+//	__preempt_count_sub(val);
 //}
+//EXPORT_SYMBOL(preempt_count_sub);
+//NOKPROBE_SYMBOL(preempt_count_sub);
+//
+#else
+static inline void preempt_latency_start(int val) { }
+static inline void preempt_latency_stop(int val) { }
+#endif
 
-/**
- * idle_cpu - is a given CPU idle currently?
- * @cpu: the processor in question.
- *
- * Return: 1 if the CPU is currently idle. 0 otherwise.
+static inline unsigned long get_preempt_disable_ip(struct task_struct *p)
+{
+#ifdef CONFIG_DEBUG_PREEMPT
+	return p->preempt_disable_ip;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Print scheduling while atomic bug:
  */
-int idle_cpu(int cpu)
+static noinline void __schedule_bug(struct task_struct *prev)
 {
-	struct rq *rq = cpu_rq(cpu);
+	/* Save this before calling printk(), since that will clobber it */
+	unsigned long preempt_disable_ip = get_preempt_disable_ip(current);
 
-	if (rq->curr != rq->idle)
-		return 0;
+	if (oops_in_progress)
+		return;
 
-	if (rq->nr_running)
-		return 0;
+	printk(KERN_ERR "BUG: scheduling while atomic: %s/%d/0x%08x\n",
+		prev->comm, prev->pid, preempt_count());
 
-#ifdef CONFIG_SMP
-	if (rq->ttwu_pending)
-		return 0;
-#endif
+	debug_show_held_locks(prev);
+	print_modules();
+	if (irqs_disabled())
+		print_irqtrace_events(prev);
+	if (IS_ENABLED(CONFIG_DEBUG_PREEMPT)
+	    && in_atomic_preempt_off()) {
+		pr_err("Preemption disabled at:");
+		print_ip_sym(KERN_ERR, preempt_disable_ip);
+	}
+	if (panic_on_warn)
+		panic("scheduling while atomic\n");
 
-	return 1;
+	dump_stack();
+	add_taint(TAINT_WARN, LOCKDEP_STILL_OK);
 }
 
-///**
-// * available_idle_cpu - is a given CPU idle for enqueuing work.
-// * @cpu: the CPU in question.
-// *
-// * Return: 1 if the CPU is currently idle. 0 otherwise.
-// */
-//int available_idle_cpu(int cpu)
-//{
-//	if (!idle_cpu(cpu))
-//		return 0;
-//
-//	if (vcpu_is_preempted(cpu))
-//		return 0;
-//
-//	return 1;
-//}
-//
-///**
-// * idle_task - return the idle task for a given CPU.
-// * @cpu: the processor in question.
-// *
-// * Return: The idle task for the CPU @cpu.
-// */
-//struct task_struct *idle_task(int cpu)
-//{
-//	return cpu_rq(cpu)->idle;
-//}
-//
-///**
-// * find_process_by_pid - find a process with a matching PID value.
-// * @pid: the pid in question.
-// *
-// * The task of @pid, if found. %NULL otherwise.
-// */
-//static struct task_struct *find_process_by_pid(pid_t pid)
-//{
-//	return pid ? find_task_by_vpid(pid) : current;
-//}
-
 /*
- * sched_setparam() passes in -1 for its policy, to let the functions
- * it calls know not to change it.
+ * Various schedule()-time debugging checks and statistics:
  */
-#define SETPARAM_POLICY	-1
-
-static void __setscheduler_params(struct task_struct *p,
-		const struct sched_attr *attr)
+static inline void schedule_debug(struct task_struct *prev, bool preempt)
 {
-	int policy = attr->sched_policy;
+#ifdef CONFIG_SCHED_STACK_END_CHECK
+	if (task_stack_end_corrupted(prev))
+		panic("corrupted stack end detected inside scheduler\n");
 
-	if (policy == SETPARAM_POLICY)
-		policy = p->policy;
+	if (task_scs_end_corrupted(prev))
+		panic("corrupted shadow stack detected inside scheduler\n");
+#endif
 
-	p->policy = policy;
+#ifdef CONFIG_DEBUG_ATOMIC_SLEEP
+	if (!preempt && prev->state && prev->non_block_count) {
+		printk(KERN_ERR "BUG: scheduling in a non-blocking section: %s/%d/%i\n",
+			prev->comm, prev->pid, prev->non_block_count);
+		dump_stack();
+		add_taint(TAINT_WARN, LOCKDEP_STILL_OK);
+	}
+#endif
 
-	if (dl_policy(policy))
-		__setparam_dl(p, attr);
-	else if (fair_policy(policy))
-		p->static_prio = NICE_TO_PRIO(attr->sched_nice);
+	if (unlikely(in_atomic_preempt_off())) {
+		__schedule_bug(prev);
+		preempt_count_set(PREEMPT_DISABLED);
+	}
+	rcu_sleep_check();
 
-	/*
-	 * __sched_setscheduler() ensures attr->sched_priority == 0 when
-	 * !rt_policy. Always setting this ensures that things like
-	 * getparam()/getattr() don't report silly values for !rt tasks.
-	 */
-	p->rt_priority = attr->sched_priority;
-	p->normal_prio = normal_prio(p);
-	set_load_weight(p, true);
+	profile_hit(SCHED_PROFILING, __builtin_return_address(0));
+
+	schedstat_inc(this_rq()->sched_count);
 }
 
-/* Actually do priority change: must hold pi & rq lock. */
-static void __setscheduler(struct rq *rq, struct task_struct *p,
-			   const struct sched_attr *attr, bool keep_boost)
+static void put_prev_task_balance(struct rq *rq, struct task_struct *prev,
+				  struct rq_flags *rf)
 {
+#ifdef CONFIG_SMP
+	const struct sched_class *class;
 	/*
-	 * If params can't change scheduling class changes aren't allowed
-	 * either.
-	 */
-	if (attr->sched_flags & SCHED_FLAG_KEEP_PARAMS)
-		return;
-
-	__setscheduler_params(p, attr);
-
-	/*
-	 * Keep a potential priority boosting if called from
-	 * sched_setscheduler().
+	 * We must do the balancing pass before put_prev_task(), such
+	 * that when we release the rq->lock the task is in the same
+	 * state as before we took rq->lock.
+	 *
+	 * We can terminate the balance pass as soon as we know there is
+	 * a runnable task of @class priority or higher.
 	 */
-	p->prio = normal_prio(p);
-	if (keep_boost)
-		p->prio = rt_effective_prio(p, p->prio);
+	for_class_range(class, prev->sched_class, &idle_sched_class) {
+		if (class->balance(rq, prev, rf))
+			break;
+	}
+#endif
 
-	if (dl_prio(p->prio))
-		p->sched_class = &dl_sched_class;
-	else if (rt_prio(p->prio))
-		p->sched_class = &rt_sched_class;
-	else
-		p->sched_class = &fair_sched_class;
+	put_prev_task(rq, prev);
 }
 
 /*
- * Check the target process has a UID that matches the current process's:
+ * Pick up the highest-prio task:
  */
-static bool check_same_owner(struct task_struct *p)
+static inline struct task_struct *
+pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 {
-	const struct cred *cred = current_cred(), *pcred;
-	bool match;
+	const struct sched_class *class;
+	struct task_struct *p;
 
-	rcu_read_lock();
-	pcred = __task_cred(p);
-	match = (uid_eq(cred->euid, pcred->euid) ||
-		 uid_eq(cred->euid, pcred->uid));
-	rcu_read_unlock();
-	return match;
+	/*
+	 * Optimization: we know that if all tasks are in the fair class we can
+	 * call that function directly, but only if the @prev task wasn't of a
+	 * higher scheduling class, because otherwise those loose the
+	 * opportunity to pull in more work from other CPUs.
+	 */
+	if (likely(prev->sched_class <= &fair_sched_class &&
+		   rq->nr_running == rq->cfs.h_nr_running)) {
+
+		p = pick_next_task_fair(rq, prev, rf);
+		if (unlikely(p == RETRY_TASK))
+			goto restart;
+
+		/* Assumes fair_sched_class->next == idle_sched_class */
+		if (!p) {
+			put_prev_task(rq, prev);
+			p = pick_next_task_idle(rq);
+		}
+
+		return p;
+	}
+
+restart:
+	put_prev_task_balance(rq, prev, rf);
+
+	for_each_class(class) {
+		p = class->pick_next_task(rq);
+		if (p)
+			return p;
+	}
+
+	/* The idle class should always have a runnable task: */
+	BUG();
 }
 
-static int __sched_setscheduler(struct task_struct *p,
-				const struct sched_attr *attr,
-				bool user, bool pi)
+/*
+ * __schedule() is the main scheduler function.
+ *
+ * The main means of driving the scheduler and thus entering this function are:
+ *
+ *   1. Explicit blocking: mutex, semaphore, waitqueue, etc.
+ *
+ *   2. TIF_NEED_RESCHED flag is checked on interrupt and userspace return
+ *      paths. For example, see arch/x86/entry_64.S.
+ *
+ *      To drive preemption between tasks, the scheduler sets the flag in timer
+ *      interrupt handler scheduler_tick().
+ *
+ *   3. Wakeups don't really cause entry into schedule(). They add a
+ *      task to the run-queue and that's it.
+ *
+ *      Now, if the new task added to the run-queue preempts the current
+ *      task, then the wakeup sets TIF_NEED_RESCHED and schedule() gets
+ *      called on the nearest possible occasion:
+ *
+ *       - If the kernel is preemptible (CONFIG_PREEMPTION=y):
+ *
+ *         - in syscall or exception context, at the next outmost
+ *           preempt_enable(). (this might be as soon as the wake_up()'s
+ *           spin_unlock()!)
+ *
+ *         - in IRQ context, return from interrupt-handler to
+ *           preemptible context
+ *
+ *       - If the kernel is not preemptible (CONFIG_PREEMPTION is not set)
+ *         then at the next:
+ *
+ *          - cond_resched() call
+ *          - explicit schedule() call
+ *          - return from syscall or exception to user-space
+ *          - return from interrupt-handler to user-space
+ *
+ * WARNING: must be called with preemption disabled!
+ */
+static void __sched notrace __schedule(bool preempt)
 {
-	int newprio = dl_policy(attr->sched_policy) ? MAX_DL_PRIO - 1 :
-		      MAX_RT_PRIO - 1 - attr->sched_priority;
-	int retval, oldprio, oldpolicy = -1, queued, running;
-	int new_effective_prio, policy = attr->sched_policy;
-	const struct sched_class *prev_class;
+	struct task_struct *prev, *next;
+	unsigned long *switch_count;
+	unsigned long prev_state;
 	struct rq_flags rf;
-	int reset_on_fork;
-	int queue_flags = DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK;
 	struct rq *rq;
+	int cpu;
 
-	/* The pi code expects interrupts enabled */
-	BUG_ON(pi && in_interrupt());
-recheck:
-	/* Double check policy once rq lock held: */
-	if (policy < 0) {
-		reset_on_fork = p->sched_reset_on_fork;
-		policy = oldpolicy = p->policy;
-	} else {
-		reset_on_fork = !!(attr->sched_flags & SCHED_FLAG_RESET_ON_FORK);
+	cpu = smp_processor_id();
+	rq = cpu_rq(cpu);
+	prev = rq->curr;
 
-		if (!valid_policy(policy))
-			return -EINVAL;
-	}
+	schedule_debug(prev, preempt);
 
-	if (attr->sched_flags & ~(SCHED_FLAG_ALL | SCHED_FLAG_SUGOV))
-		return -EINVAL;
+	if (sched_feat(HRTICK))
+		hrtick_clear(rq);
+
+	local_irq_disable();
+	rcu_note_context_switch(preempt);
 
 	/*
-	 * Valid priorities for SCHED_FIFO and SCHED_RR are
-	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL,
-	 * SCHED_BATCH and SCHED_IDLE is 0.
+	 * Make sure that signal_pending_state()->signal_pending() below
+	 * can't be reordered with __set_current_state(TASK_INTERRUPTIBLE)
+	 * done by the caller to avoid the race with signal_wake_up():
+	 *
+	 * __set_current_state(@state)		signal_wake_up()
+	 * schedule()				  set_tsk_thread_flag(p, TIF_SIGPENDING)
+	 *					  wake_up_state(p, state)
+	 *   LOCK rq->lock			    LOCK p->pi_state
+	 *   smp_mb__after_spinlock()		    smp_mb__after_spinlock()
+	 *     if (signal_pending_state())	    if (p->state & @state)
+	 *
+	 * Also, the membarrier system call requires a full memory barrier
+	 * after coming from user-space, before storing to rq->curr.
 	 */
-	if ((p->mm && attr->sched_priority > MAX_USER_RT_PRIO-1) ||
-	    (!p->mm && attr->sched_priority > MAX_RT_PRIO-1))
-		return -EINVAL;
-	if ((dl_policy(policy) && !__checkparam_dl(attr)) ||
-	    (rt_policy(policy) != (attr->sched_priority != 0)))
-		return -EINVAL;
+	rq_lock(rq, &rf);
+	smp_mb__after_spinlock();
+
+	/* Promote REQ to ACT */
+	rq->clock_update_flags <<= 1;
+	update_rq_clock(rq);
+
+	switch_count = &prev->nivcsw;
 
 	/*
-	 * Allow unprivileged RT tasks to decrease priority:
+	 * We must load prev->state once (task_struct::state is volatile), such
+	 * that:
+	 *
+	 *  - we form a control dependency vs deactivate_task() below.
+	 *  - ptrace_{,un}freeze_traced() can change ->state underneath us.
 	 */
-	if (user && !capable(CAP_SYS_NICE)) {
-		if (fair_policy(policy)) {
-			if (attr->sched_nice < task_nice(p) &&
-			    !can_nice(p, attr->sched_nice))
-				return -EPERM;
-		}
+	prev_state = prev->state;
+	if (!preempt && prev_state) {
+		if (signal_pending_state(prev_state, prev)) {
+			prev->state = TASK_RUNNING;
+		} else {
+			prev->sched_contributes_to_load =
+				(prev_state & TASK_UNINTERRUPTIBLE) &&
+				!(prev_state & TASK_NOLOAD) &&
+				!(prev->flags & PF_FROZEN);
 
-		if (rt_policy(policy)) {
-			unsigned long rlim_rtprio =
-					task_rlimit(p, RLIMIT_RTPRIO);
+			if (prev->sched_contributes_to_load)
+				rq->nr_uninterruptible++;
 
-			/* Can't set/change the rt policy: */
-			if (policy != p->policy && !rlim_rtprio)
-				return -EPERM;
+			/*
+			 * __schedule()			ttwu()
+			 *   prev_state = prev->state;    if (p->on_rq && ...)
+			 *   if (prev_state)		    goto out;
+			 *     p->on_rq = 0;		  smp_acquire__after_ctrl_dep();
+			 *				  p->state = TASK_WAKING
+			 *
+			 * Where __schedule() and ttwu() have matching control dependencies.
+			 *
+			 * After this, schedule() must not care about p->state any more.
+			 */
+			deactivate_task(rq, prev, DEQUEUE_SLEEP | DEQUEUE_NOCLOCK);
 
-			/* Can't increase priority: */
-			if (attr->sched_priority > p->rt_priority &&
-			    attr->sched_priority > rlim_rtprio)
-				return -EPERM;
+			if (prev->in_iowait) {
+				atomic_inc(&rq->nr_iowait);
+				delayacct_blkio_start();
+			}
 		}
+		switch_count = &prev->nvcsw;
+	}
 
-		 /*
-		  * Can't set/change SCHED_DEADLINE policy at all for now
-		  * (safest behavior); in the future we would like to allow
-		  * unprivileged DL tasks to increase their relative deadline
-		  * or reduce their runtime (both ways reducing utilization)
-		  */
-		if (dl_policy(policy))
-			return -EPERM;
+	next = pick_next_task(rq, prev, &rf);
+	clear_tsk_need_resched(prev);
+	clear_preempt_need_resched();
 
+	if (likely(prev != next)) {
+		rq->nr_switches++;
 		/*
-		 * Treat SCHED_IDLE as nice 20. Only allow a switch to
-		 * SCHED_NORMAL if the RLIMIT_NICE would normally permit it.
-		 */
-		if (task_has_idle_policy(p) && !idle_policy(policy)) {
-			if (!can_nice(p, task_nice(p)))
-				return -EPERM;
-		}
+		 * RCU users of rcu_dereference(rq->curr) may not see
+		 * changes to task_struct made by pick_next_task().
+		 */
+		RCU_INIT_POINTER(rq->curr, next);
+		/*
+		 * The membarrier system call requires each architecture
+		 * to have a full memory barrier after updating
+		 * rq->curr, before returning to user-space.
+		 *
+		 * Here are the schemes providing that barrier on the
+		 * various architectures:
+		 * - mm ? switch_mm() : mmdrop() for x86, s390, sparc, PowerPC.
+		 *   switch_mm() rely on membarrier_arch_switch_mm() on PowerPC.
+		 * - finish_lock_switch() for weakly-ordered
+		 *   architectures where spin_unlock is a full barrier,
+		 * - switch_to() for arm64 (weakly-ordered, spin_unlock
+		 *   is a RELEASE barrier),
+		 */
+		++*switch_count;
 
-		/* Can't change other user's priorities: */
-		if (!check_same_owner(p))
-			return -EPERM;
+		psi_sched_switch(prev, next, !task_on_rq_queued(prev));
 
-		/* Normal users shall not reset the sched_reset_on_fork flag: */
-		if (p->sched_reset_on_fork && !reset_on_fork)
-			return -EPERM;
+		trace_sched_switch(preempt, prev, next);
+
+		/* Also unlocks the rq: */
+		rq = context_switch(rq, prev, next, &rf);
+	} else {
+		rq->clock_update_flags &= ~(RQCF_ACT_SKIP|RQCF_REQ_SKIP);
+		rq_unlock_irq(rq, &rf);
 	}
 
-	if (user) {
-		if (attr->sched_flags & SCHED_FLAG_SUGOV)
-			return -EINVAL;
+	balance_callback(rq);
+}
 
-		retval = security_task_setscheduler(p);
-		if (retval)
-			return retval;
-	}
+void __noreturn do_task_dead(void)
+{
+	/* Causes final put_task_struct in finish_task_switch(): */
+	set_special_state(TASK_DEAD);
 
-	/* Update task specific "requested" clamps */
-	if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP) {
-		retval = uclamp_validate(p, attr);
-		if (retval)
-			return retval;
-	}
+	/* Tell freezer to ignore us: */
+	current->flags |= PF_NOFREEZE;
 
-	if (pi)
-		cpuset_read_lock();
+	__schedule(false);
+	BUG();
 
-	/*
-	 * Make sure no PI-waiters arrive (or leave) while we are
-	 * changing the priority of the task:
-	 *
-	 * To be able to change p->policy safely, the appropriate
-	 * runqueue lock must be held.
-	 */
-	rq = task_rq_lock(p, &rf);
-	update_rq_clock(rq);
+	/* Avoid "noreturn function does return" - but don't continue if BUG() is a NOP: */
+	for (;;)
+		cpu_relax();
+}
+EXPORT_SYMBOL(do_task_dead);
+
+static inline void sched_submit_work(struct task_struct *tsk)
+{
+	if (!tsk->state)
+		return;
 
 	/*
-	 * Changing the policy of the stop threads its a very bad idea:
+	 * If a worker went to sleep, notify and ask workqueue whether
+	 * it wants to wake up a task to maintain concurrency.
+	 * As this function is called inside the schedule() context,
+	 * we disable preemption to avoid it calling schedule() again
+	 * in the possible wakeup of a kworker and because wq_worker_sleeping()
+	 * requires it.
 	 */
-	if (p == rq->stop) {
-		retval = -EINVAL;
-		goto unlock;
+	if (tsk->flags & (PF_WQ_WORKER | PF_IO_WORKER)) {
+		preempt_disable();
+		if (tsk->flags & PF_WQ_WORKER)
+			wq_worker_sleeping(tsk);
+		else
+			io_wq_worker_sleeping(tsk);
+		preempt_enable_no_resched();
 	}
 
+	if (tsk_is_pi_blocked(tsk))
+		return;
+
 	/*
-	 * If not changing anything there's no need to proceed further,
-	 * but store a possible modification of reset_on_fork.
+	 * If we are going to sleep and we have plugged IO queued,
+	 * make sure to submit it to avoid deadlocks.
 	 */
-	if (unlikely(policy == p->policy)) {
-		if (fair_policy(policy) && attr->sched_nice != task_nice(p))
-			goto change;
-		if (rt_policy(policy) && attr->sched_priority != p->rt_priority)
-			goto change;
-		if (dl_policy(policy) && dl_param_changed(p, attr))
-			goto change;
-		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
-			goto change;
+	if (blk_needs_flush_plug(tsk))
+		blk_schedule_flush_plug(tsk);
+}
 
-		p->sched_reset_on_fork = reset_on_fork;
-		retval = 0;
-		goto unlock;
+static void sched_update_worker(struct task_struct *tsk)
+{
+	if (tsk->flags & (PF_WQ_WORKER | PF_IO_WORKER)) {
+		if (tsk->flags & PF_WQ_WORKER)
+			wq_worker_running(tsk);
+		else
+			io_wq_worker_running(tsk);
 	}
-change:
-
-	if (user) {
-#ifdef CONFIG_RT_GROUP_SCHED
-		/*
-		 * Do not allow realtime tasks into groups that have no runtime
-		 * assigned.
-		 */
-		if (rt_bandwidth_enabled() && rt_policy(policy) &&
-				task_group(p)->rt_bandwidth.rt_runtime == 0 &&
-				!task_group_is_autogroup(task_group(p))) {
-			retval = -EPERM;
-			goto unlock;
-		}
-#endif
-#ifdef CONFIG_SMP
-		if (dl_bandwidth_enabled() && dl_policy(policy) &&
-				!(attr->sched_flags & SCHED_FLAG_SUGOV)) {
-			cpumask_t *span = rq->rd->span;
+}
 
-			/*
-			 * Don't allow tasks with an affinity mask smaller than
-			 * the entire root_domain to become SCHED_DEADLINE. We
-			 * will also fail if there's no bandwidth available.
-			 */
-			if (!cpumask_subset(span, p->cpus_ptr) ||
-			    rq->rd->dl_bw.bw == 0) {
-				retval = -EPERM;
-				goto unlock;
-			}
-		}
-#endif
-	}
+asmlinkage __visible void __sched schedule(void)
+{
+	struct task_struct *tsk = current;
 
-	/* Re-check policy now with rq lock held: */
-	if (unlikely(oldpolicy != -1 && oldpolicy != p->policy)) {
-		policy = oldpolicy = -1;
-		task_rq_unlock(rq, p, &rf);
-		if (pi)
-			cpuset_read_unlock();
-		goto recheck;
-	}
+	sched_submit_work(tsk);
+	do {
+		preempt_disable();
+		__schedule(false);
+		sched_preempt_enable_no_resched();
+	} while (need_resched());
+	sched_update_worker(tsk);
+}
 
+/*
+ * synchronize_rcu_tasks() makes sure that no task is stuck in preempted
+ * state (have scheduled out non-voluntarily) by making sure that all
+ * tasks have either left the run queue or have gone into user space.
+ * As idle tasks do not do either, they must not ever be preempted
+ * (schedule out non-voluntarily).
+ *
+ * schedule_idle() is similar to schedule_preempt_disable() except that it
+ * never enables preemption because it does not call sched_submit_work().
+ */
+void __sched schedule_idle(void)
+{
 	/*
-	 * If setscheduling to SCHED_DEADLINE (or changing the parameters
-	 * of a SCHED_DEADLINE task) we need to check if enough bandwidth
-	 * is available.
+	 * As this skips calling sched_submit_work(), which the idle task does
+	 * regardless because that function is a nop when the task is in a
+	 * TASK_RUNNING state, make sure this isn't used someplace that the
+	 * current task can be in any other state. Note, idle is always in the
+	 * TASK_RUNNING state.
 	 */
-	if ((dl_policy(policy) || dl_task(p)) && sched_dl_overflow(p, policy, attr)) {
-		retval = -EBUSY;
-		goto unlock;
-	}
+	WARN_ON_ONCE(current->state);
+	do {
+		__schedule(false);
+	} while (need_resched());
+}
 
-	p->sched_reset_on_fork = reset_on_fork;
-	oldprio = p->prio;
+//#ifdef CONFIG_CONTEXT_TRACKING
+//asmlinkage __visible void __sched schedule_user(void)
+//{
+//	/*
+//	 * If we come here after a random call to set_need_resched(),
+//	 * or we have been woken up remotely but the IPI has not yet arrived,
+//	 * we haven't yet exited the RCU idle mode. Do it here manually until
+//	 * we find a better solution.
+//	 *
+//	 * NB: There are buggy callers of this function.  Ideally we
+//	 * should warn if prev_state != CONTEXT_USER, but that will trigger
+//	 * too frequently to make sense yet.
+//	 */
+//	enum ctx_state prev_state = exception_enter();
+//	schedule();
+//	exception_exit(prev_state);
+//}
+//#endif
 
-	if (pi) {
-		/*
-		 * Take priority boosted tasks into account. If the new
-		 * effective priority is unchanged, we just store the new
-		 * normal parameters and do not touch the scheduler class and
-		 * the runqueue. This will be done when the task deboost
-		 * itself.
-		 */
-		new_effective_prio = rt_effective_prio(p, newprio);
-		if (new_effective_prio == oldprio)
-			queue_flags &= ~DEQUEUE_MOVE;
-	}
+/**
+ * schedule_preempt_disabled - called with preemption disabled
+ *
+ * Returns with preemption disabled. Note: preempt_count must be 1
+ */
+void __sched schedule_preempt_disabled(void)
+{
+	sched_preempt_enable_no_resched();
+	schedule();
+	preempt_disable();
+}
 
-	queued = task_on_rq_queued(p);
-	running = task_current(rq, p);
-	if (queued)
-		dequeue_task(rq, p, queue_flags);
-	if (running)
-		put_prev_task(rq, p);
+static void __sched notrace preempt_schedule_common(void)
+{
+	do {
+		/*
+		 * Because the function tracer can trace preempt_count_sub()
+		 * and it also uses preempt_enable/disable_notrace(), if
+		 * NEED_RESCHED is set, the preempt_enable_notrace() called
+		 * by the function tracer will call this function again and
+		 * cause infinite recursion.
+		 *
+		 * Preemption must be disabled here before the function
+		 * tracer can trace. Break up preempt_disable() into two
+		 * calls. One to disable preemption without fear of being
+		 * traced. The other to still record the preemption latency,
+		 * which can also be traced by the function tracer.
+		 */
+		preempt_disable_notrace();
+		preempt_latency_start(1);
+		__schedule(true);
+		preempt_latency_stop(1);
+		preempt_enable_no_resched_notrace();
 
-	prev_class = p->sched_class;
+		/*
+		 * Check again in case we missed a preemption opportunity
+		 * between schedule and now.
+		 */
+	} while (need_resched());
+}
 
-	__setscheduler(rq, p, attr, pi);
-	__setscheduler_uclamp(p, attr);
+#ifdef CONFIG_PREEMPTION
+/*
+ * This is the entry point to schedule() from in-kernel preemption
+ * off of preempt_enable.
+ */
+asmlinkage __visible void __sched notrace preempt_schedule(void)
+{
+	/*
+	 * If there is a non-zero preempt_count or interrupts are disabled,
+	 * we do not want to preempt the current task. Just return..
+	 */
+	if (likely(!preemptible()))
+		return;
 
-	if (queued) {
+	preempt_schedule_common();
+}
+NOKPROBE_SYMBOL(preempt_schedule);
+EXPORT_SYMBOL(preempt_schedule);
+
+/**
+ * preempt_schedule_notrace - preempt_schedule called by tracing
+ *
+ * The tracing infrastructure uses preempt_enable_notrace to prevent
+ * recursion and tracing preempt enabling caused by the tracing
+ * infrastructure itself. But as tracing can happen in areas coming
+ * from userspace or just about to enter userspace, a preempt enable
+ * can occur before user_exit() is called. This will cause the scheduler
+ * to be called when the system is still in usermode.
+ *
+ * To prevent this, the preempt_enable_notrace will use this function
+ * instead of preempt_schedule() to exit user context if needed before
+ * calling the scheduler.
+ */
+asmlinkage __visible void __sched notrace preempt_schedule_notrace(void)
+{
+	enum ctx_state prev_ctx;
+
+	if (likely(!preemptible()))
+		return;
+
+	do {
 		/*
-		 * We enqueue to tail when the priority of a task is
-		 * increased (user space view).
+		 * Because the function tracer can trace preempt_count_sub()
+		 * and it also uses preempt_enable/disable_notrace(), if
+		 * NEED_RESCHED is set, the preempt_enable_notrace() called
+		 * by the function tracer will call this function again and
+		 * cause infinite recursion.
+		 *
+		 * Preemption must be disabled here before the function
+		 * tracer can trace. Break up preempt_disable() into two
+		 * calls. One to disable preemption without fear of being
+		 * traced. The other to still record the preemption latency,
+		 * which can also be traced by the function tracer.
 		 */
-		if (oldprio < p->prio)
-			queue_flags |= ENQUEUE_HEAD;
+		preempt_disable_notrace();
+		preempt_latency_start(1);
+		/*
+		 * Needs preempt disabled in case user_exit() is traced
+		 * and the tracer calls preempt_enable_notrace() causing
+		 * an infinite recursion.
+		 */
+		prev_ctx = exception_enter();
+		__schedule(true);
+		exception_exit(prev_ctx);
 
-		enqueue_task(rq, p, queue_flags);
-	}
-	if (running)
-		set_next_task(rq, p);
+		preempt_latency_stop(1);
+		preempt_enable_no_resched_notrace();
+	} while (need_resched());
+}
+EXPORT_SYMBOL_GPL(preempt_schedule_notrace);
 
-	check_class_changed(rq, p, prev_class, oldprio);
+#endif /* CONFIG_PREEMPTION */
 
-	/* Avoid rq from going away on us: */
-	preempt_disable();
-	task_rq_unlock(rq, p, &rf);
+/*
+ * This is the entry point to schedule() from kernel preemption
+ * off of irq context.
+ * Note, that this is called and return with irqs disabled. This will
+ * protect us against recursive calling from irq.
+ */
+asmlinkage __visible void __sched preempt_schedule_irq(void)
+{
+	enum ctx_state prev_state;
 
-	if (pi) {
-		cpuset_read_unlock();
-		rt_mutex_adjust_pi(p);
-	}
+	/* Catch callers which need to be fixed */
+	BUG_ON(preempt_count() || !irqs_disabled());
 
-	/* Run balance callbacks after we've adjusted the PI chain: */
-	balance_callback(rq);
-	preempt_enable();
+	prev_state = exception_enter();
 
-	return 0;
+	do {
+		preempt_disable();
+		local_irq_enable();
+		__schedule(true);
+		local_irq_disable();
+		sched_preempt_enable_no_resched();
+	} while (need_resched());
 
-unlock:
-	task_rq_unlock(rq, p, &rf);
-	if (pi)
-		cpuset_read_unlock();
-	return retval;
+	exception_exit(prev_state);
 }
+EXPORT_SYMBOL(preempt_schedule_irq);
 
-static int _sched_setscheduler(struct task_struct *p, int policy,
-			       const struct sched_param *param, bool check)
+int default_wake_function(wait_queue_entry_t *curr, unsigned mode, int wake_flags,
+			  void *key)
 {
-	struct sched_attr attr = {
-		.sched_policy   = policy,
-		.sched_priority = param->sched_priority,
-		.sched_nice	= PRIO_TO_NICE(p->static_prio),
-	};
+	WARN_ON_ONCE(IS_ENABLED(CONFIG_SCHED_DEBUG) && wake_flags & ~WF_SYNC);
+	return try_to_wake_up(curr->private, mode, wake_flags);
+}
 
-	/* Fixup the legacy SCHED_RESET_ON_FORK hack. */
-	if ((policy != SETPARAM_POLICY) && (policy & SCHED_RESET_ON_FORK)) {
-		attr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
-		policy &= ~SCHED_RESET_ON_FORK;
-		attr.sched_policy = policy;
-	}
+#ifdef CONFIG_RT_MUTEXES
 
-	return __sched_setscheduler(p, &attr, check, true);
+static inline int __rt_effective_prio(struct task_struct *pi_task, int prio)
+{
+	if (pi_task)
+		prio = min(prio, pi_task->prio);
+
+	return prio;
 }
-///**
-// * sched_setscheduler - change the scheduling policy and/or RT priority of a thread.
-// * @p: the task in question.
-// * @policy: new policy.
-// * @param: structure containing the new RT priority.
-// *
-// * Use sched_set_fifo(), read its comment.
-// *
-// * Return: 0 on success. An error code otherwise.
-// *
-// * NOTE that the task may be already dead.
-// */
-//int sched_setscheduler(struct task_struct *p, int policy,
-//		       const struct sched_param *param)
-//{
-//	return _sched_setscheduler(p, policy, param, true);
-//}
-//
-//int sched_setattr(struct task_struct *p, const struct sched_attr *attr)
-//{
-//	return __sched_setscheduler(p, attr, true, true);
-//}
-//
-//int sched_setattr_nocheck(struct task_struct *p, const struct sched_attr *attr)
-//{
-//	return __sched_setscheduler(p, attr, false, true);
-//}
 
-/**
- * sched_setscheduler_nocheck - change the scheduling policy and/or RT priority of a thread from kernelspace.
- * @p: the task in question.
- * @policy: new policy.
- * @param: structure containing the new RT priority.
- *
- * Just like sched_setscheduler, only don't bother checking if the
- * current context has permission.  For example, this is needed in
- * stop_machine(): we create temporary high priority worker threads,
- * but our caller might not have that capability.
- *
- * Return: 0 on success. An error code otherwise.
- */
-int sched_setscheduler_nocheck(struct task_struct *p, int policy,
-			       const struct sched_param *param)
+static inline int rt_effective_prio(struct task_struct *p, int prio)
 {
-	return _sched_setscheduler(p, policy, param, false);
+	struct task_struct *pi_task = rt_mutex_get_top_task(p);
+
+	return __rt_effective_prio(pi_task, prio);
 }
-EXPORT_SYMBOL(sched_setscheduler_nocheck);
 
 /*
- * SCHED_FIFO is a broken scheduler model; that is, it is fundamentally
- * incapable of resource management, which is the one thing an OS really should
- * be doing.
- *
- * This is of course the reason it is limited to privileged users only.
- *
- * Worse still; it is fundamentally impossible to compose static priority
- * workloads. You cannot take two correctly working static prio workloads
- * and smash them together and still expect them to work.
- *
- * For this reason 'all' FIFO tasks the kernel creates are basically at:
+ * rt_mutex_setprio - set the current priority of a task
+ * @p: task to boost
+ * @pi_task: donor task
  *
- *   MAX_RT_PRIO / 2
+ * This function changes the 'effective' priority of a task. It does
+ * not touch ->normal_prio like __setscheduler().
  *
- * The administrator _MUST_ configure the system, the kernel simply doesn't
- * know enough information to make a sensible choice.
+ * Used by the rt_mutex code to implement priority inheritance
+ * logic. Call site only calls if the priority of the task changed.
  */
-void sched_set_fifo(struct task_struct *p)
+void rt_mutex_setprio(struct task_struct *p, struct task_struct *pi_task)
 {
-	struct sched_param sp = { .sched_priority = MAX_RT_PRIO / 2 };
-	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
-}
+	int prio, oldprio, queued, running, queue_flag =
+		DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK;
+	const struct sched_class *prev_class;
+	struct rq_flags rf;
+	struct rq *rq;
 
-///*
-// * For when you don't much care about FIFO, but want to be above SCHED_NORMAL.
-// */
-//void sched_set_fifo_low(struct task_struct *p)
-//{
-//	struct sched_param sp = { .sched_priority = 1 };
-//	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
-//}
-//EXPORT_SYMBOL_GPL(sched_set_fifo_low);
-//
-//void sched_set_normal(struct task_struct *p, int nice)
-//{
-//	struct sched_attr attr = {
-//		.sched_policy = SCHED_NORMAL,
-//		.sched_nice = nice,
-//	};
-//	WARN_ON_ONCE(sched_setattr_nocheck(p, &attr) != 0);
-//}
-//EXPORT_SYMBOL_GPL(sched_set_normal);
-//
-//static int
-//do_sched_setscheduler(pid_t pid, int policy, struct sched_param __user *param)
-//{
-//	struct sched_param lparam;
-//	struct task_struct *p;
-//	int retval;
-//
-//	if (!param || pid < 0)
-//		return -EINVAL;
-//	if (copy_from_user(&lparam, param, sizeof(struct sched_param)))
-//		return -EFAULT;
-//
-//	rcu_read_lock();
-//	retval = -ESRCH;
-//	p = find_process_by_pid(pid);
-//	if (likely(p))
-//		get_task_struct(p);
-//	rcu_read_unlock();
-//
-//	if (likely(p)) {
-//		retval = sched_setscheduler(p, policy, &lparam);
-//		put_task_struct(p);
-//	}
-//
-//	return retval;
-//}
-//
-///*
-// * Mimics kernel/events/core.c perf_copy_attr().
-// */
-//static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *attr)
-//{
-//	u32 size;
-//	int ret;
-//
-//	/* Zero the full structure, so that a short copy will be nice: */
-//	memset(attr, 0, sizeof(*attr));
-//
-//	ret = get_user(size, &uattr->size);
-//	if (ret)
-//		return ret;
-//
-//	/* ABI compatibility quirk: */
-//	if (!size)
-//		size = SCHED_ATTR_SIZE_VER0;
-//	if (size < SCHED_ATTR_SIZE_VER0 || size > PAGE_SIZE)
-//		goto err_size;
-//
-//	ret = copy_struct_from_user(attr, sizeof(*attr), uattr, size);
-//	if (ret) {
-//		if (ret == -E2BIG)
-//			goto err_size;
-//		return ret;
-//	}
-//
-//	if ((attr->sched_flags & SCHED_FLAG_UTIL_CLAMP) &&
-//	    size < SCHED_ATTR_SIZE_VER1)
-//		return -EINVAL;
-//
-//	/*
-//	 * XXX: Do we want to be lenient like existing syscalls; or do we want
-//	 * to be strict and return an error on out-of-bounds values?
-//	 */
-//	attr->sched_nice = clamp(attr->sched_nice, MIN_NICE, MAX_NICE);
-//
-//	return 0;
-//
-//err_size:
-//	put_user(sizeof(*attr), &uattr->size);
-//	return -E2BIG;
-//}
-//
-///**
-// * sys_sched_setscheduler - set/change the scheduler policy and RT priority
-// * @pid: the pid in question.
-// * @policy: new policy.
-// * @param: structure containing the new RT priority.
-// *
-// * Return: 0 on success. An error code otherwise.
-// */
-//SYSCALL_DEFINE3(sched_setscheduler, pid_t, pid, int, policy, struct sched_param __user *, param)
-//{
-//	if (policy < 0)
-//		return -EINVAL;
-//
-//	return do_sched_setscheduler(pid, policy, param);
-//}
-//
-///**
-// * sys_sched_setparam - set/change the RT priority of a thread
-// * @pid: the pid in question.
-// * @param: structure containing the new RT priority.
-// *
-// * Return: 0 on success. An error code otherwise.
-// */
-//SYSCALL_DEFINE2(sched_setparam, pid_t, pid, struct sched_param __user *, param)
-//{
-//	return do_sched_setscheduler(pid, SETPARAM_POLICY, param);
-//}
-//
-///**
-// * sys_sched_setattr - same as above, but with extended sched_attr
-// * @pid: the pid in question.
-// * @uattr: structure containing the extended parameters.
-// * @flags: for future extension.
-// */
-//SYSCALL_DEFINE3(sched_setattr, pid_t, pid, struct sched_attr __user *, uattr,
-//			       unsigned int, flags)
-//{
-//	struct sched_attr attr;
-//	struct task_struct *p;
-//	int retval;
-//
-//	if (!uattr || pid < 0 || flags)
-//		return -EINVAL;
-//
-//	retval = sched_copy_attr(uattr, &attr);
-//	if (retval)
-//		return retval;
-//
-//	if ((int)attr.sched_policy < 0)
-//		return -EINVAL;
-//	if (attr.sched_flags & SCHED_FLAG_KEEP_POLICY)
-//		attr.sched_policy = SETPARAM_POLICY;
-//
-//	rcu_read_lock();
-//	retval = -ESRCH;
-//	p = find_process_by_pid(pid);
-//	if (likely(p))
-//		get_task_struct(p);
-//	rcu_read_unlock();
-//
-//	if (likely(p)) {
-//		retval = sched_setattr(p, &attr);
-//		put_task_struct(p);
-//	}
-//
-//	return retval;
-//}
-//
-///**
-// * sys_sched_getscheduler - get the policy (scheduling class) of a thread
-// * @pid: the pid in question.
-// *
-// * Return: On success, the policy of the thread. Otherwise, a negative error
-// * code.
-// */
-//SYSCALL_DEFINE1(sched_getscheduler, pid_t, pid)
-//{
-//	struct task_struct *p;
-//	int retval;
-//
-//	if (pid < 0)
-//		return -EINVAL;
-//
-//	retval = -ESRCH;
-//	rcu_read_lock();
-//	p = find_process_by_pid(pid);
-//	if (p) {
-//		retval = security_task_getscheduler(p);
-//		if (!retval)
-//			retval = p->policy
-//				| (p->sched_reset_on_fork ? SCHED_RESET_ON_FORK : 0);
-//	}
-//	rcu_read_unlock();
-//	return retval;
-//}
-//
-///**
-// * sys_sched_getparam - get the RT priority of a thread
-// * @pid: the pid in question.
-// * @param: structure containing the RT priority.
-// *
-// * Return: On success, 0 and the RT priority is in @param. Otherwise, an error
-// * code.
-// */
-//SYSCALL_DEFINE2(sched_getparam, pid_t, pid, struct sched_param __user *, param)
-//{
-//	struct sched_param lp = { .sched_priority = 0 };
-//	struct task_struct *p;
-//	int retval;
-//
-//	if (!param || pid < 0)
-//		return -EINVAL;
-//
-//	rcu_read_lock();
-//	p = find_process_by_pid(pid);
-//	retval = -ESRCH;
-//	if (!p)
-//		goto out_unlock;
-//
-//	retval = security_task_getscheduler(p);
-//	if (retval)
-//		goto out_unlock;
-//
-//	if (task_has_rt_policy(p))
-//		lp.sched_priority = p->rt_priority;
-//	rcu_read_unlock();
-//
-//	/*
-//	 * This one might sleep, we cannot do it with a spinlock held ...
-//	 */
-//	retval = copy_to_user(param, &lp, sizeof(*param)) ? -EFAULT : 0;
-//
-//	return retval;
-//
-//out_unlock:
-//	rcu_read_unlock();
-//	return retval;
-//}
+	/* XXX used to be waiter->prio, not waiter->task->prio */
+	prio = __rt_effective_prio(pi_task, p->normal_prio);
+
+	/*
+	 * If nothing changed; bail early.
+	 */
+	if (p->pi_top_task == pi_task && prio == p->prio && !dl_prio(prio))
+		return;
+
+	rq = __task_rq_lock(p, &rf);
+	update_rq_clock(rq);
+	/*
+	 * Set under pi_lock && rq->lock, such that the value can be used under
+	 * either lock.
+	 *
+	 * Note that there is loads of tricky to make this pointer cache work
+	 * right. rt_mutex_slowunlock()+rt_mutex_postunlock() work together to
+	 * ensure a task is de-boosted (pi_task is set to NULL) before the
+	 * task is allowed to run again (and can exit). This ensures the pointer
+	 * points to a blocked task -- which guaratees the task is present.
+	 */
+	p->pi_top_task = pi_task;
+
+	/*
+	 * For FIFO/RR we only need to set prio, if that matches we're done.
+	 */
+	if (prio == p->prio && !dl_prio(prio))
+		goto out_unlock;
+
+	/*
+	 * Idle task boosting is a nono in general. There is one
+	 * exception, when PREEMPT_RT and NOHZ is active:
+	 *
+	 * The idle task calls get_next_timer_interrupt() and holds
+	 * the timer wheel base->lock on the CPU and another CPU wants
+	 * to access the timer (probably to cancel it). We can safely
+	 * ignore the boosting request, as the idle CPU runs this code
+	 * with interrupts disabled and will complete the lock
+	 * protected section without being interrupted. So there is no
+	 * real need to boost.
+	 */
+	if (unlikely(p == rq->idle)) {
+		WARN_ON(p != rq->curr);
+		WARN_ON(p->pi_blocked_on);
+		goto out_unlock;
+	}
+
+	trace_sched_pi_setprio(p, pi_task);
+	oldprio = p->prio;
+
+	if (oldprio == prio)
+		queue_flag &= ~DEQUEUE_MOVE;
+
+	prev_class = p->sched_class;
+	queued = task_on_rq_queued(p);
+	running = task_current(rq, p);
+	if (queued)
+		dequeue_task(rq, p, queue_flag);
+	if (running)
+		put_prev_task(rq, p);
+
+	/*
+	 * Boosting condition are:
+	 * 1. -rt task is running and holds mutex A
+	 *      --> -dl task blocks on mutex A
+	 *
+	 * 2. -dl task is running and holds mutex A
+	 *      --> -dl task blocks on mutex A and could preempt the
+	 *          running task
+	 */
+	if (dl_prio(prio)) {
+		if (!dl_prio(p->normal_prio) ||
+		    (pi_task && dl_prio(pi_task->prio) &&
+		     dl_entity_preempt(&pi_task->dl, &p->dl))) {
+			p->dl.dl_boosted = 1;
+			queue_flag |= ENQUEUE_REPLENISH;
+		} else
+			p->dl.dl_boosted = 0;
+		p->sched_class = &dl_sched_class;
+	} else if (rt_prio(prio)) {
+		if (dl_prio(oldprio))
+			p->dl.dl_boosted = 0;
+		if (oldprio < prio)
+			queue_flag |= ENQUEUE_HEAD;
+		p->sched_class = &rt_sched_class;
+	} else {
+		if (dl_prio(oldprio))
+			p->dl.dl_boosted = 0;
+		if (rt_prio(oldprio))
+			p->rt.timeout = 0;
+		p->sched_class = &fair_sched_class;
+	}
+
+	p->prio = prio;
+
+	if (queued)
+		enqueue_task(rq, p, queue_flag);
+	if (running)
+		set_next_task(rq, p);
+
+	check_class_changed(rq, p, prev_class, oldprio);
+out_unlock:
+	/* Avoid rq from going away on us: */
+	preempt_disable();
+	__task_rq_unlock(rq, &rf);
+
+	balance_callback(rq);
+	preempt_enable();
+}
+#else
+static inline int rt_effective_prio(struct task_struct *p, int prio)
+{
+	return prio;
+}
+#endif
+
+void set_user_nice(struct task_struct *p, long nice)
+{
+	bool queued, running;
+	int old_prio;
+	struct rq_flags rf;
+	struct rq *rq;
+
+	if (task_nice(p) == nice || nice < MIN_NICE || nice > MAX_NICE)
+		return;
+	/*
+	 * We have to be careful, if called from sys_setpriority(),
+	 * the task might be in the middle of scheduling on another CPU.
+	 */
+	rq = task_rq_lock(p, &rf);
+	update_rq_clock(rq);
+
+	/*
+	 * The RT priorities are set via sched_setscheduler(), but we still
+	 * allow the 'normal' nice value to be set - but as expected
+	 * it wont have any effect on scheduling until the task is
+	 * SCHED_DEADLINE, SCHED_FIFO or SCHED_RR:
+	 */
+	if (task_has_dl_policy(p) || task_has_rt_policy(p)) {
+		p->static_prio = NICE_TO_PRIO(nice);
+		goto out_unlock;
+	}
+	queued = task_on_rq_queued(p);
+	running = task_current(rq, p);
+	if (queued)
+		dequeue_task(rq, p, DEQUEUE_SAVE | DEQUEUE_NOCLOCK);
+	if (running)
+		put_prev_task(rq, p);
+
+	p->static_prio = NICE_TO_PRIO(nice);
+	set_load_weight(p, true);
+	old_prio = p->prio;
+	p->prio = effective_prio(p);
+
+	if (queued)
+		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
+	if (running)
+		set_next_task(rq, p);
+
+	/*
+	 * If the task increased its priority or is running and
+	 * lowered its priority, then reschedule its CPU:
+	 */
+	p->sched_class->prio_changed(rq, p, old_prio);
+
+out_unlock:
+	task_rq_unlock(rq, p, &rf);
+}
+
+/*
+ * can_nice - check if a task can reduce its nice value
+ * @p: task
+ * @nice: nice value
+ */
+int can_nice(const struct task_struct *p, const int nice)
+{
+	/* Convert nice value [19,-20] to rlimit style value [1,40]: */
+	int nice_rlim = nice_to_rlimit(nice);
+
+	return (nice_rlim <= task_rlimit(p, RLIMIT_NICE) ||
+		capable(CAP_SYS_NICE));
+}
+EXPORT_SYMBOL(can_nice);
+
+//#ifdef __ARCH_WANT_SYS_NICE
 //
 ///*
-// * Copy the kernel size attribute structure (which might be larger
-// * than what user-space knows about) to user-space.
+// * sys_nice - change the priority of the current process.
+// * @increment: priority increment
 // *
-// * Note that all cases are valid: user-space buffer can be larger or
-// * smaller than the kernel-space buffer. The usual case is that both
-// * have the same size.
+// * sys_setpriority is a more generic, but much slower function that
+// * does similar things.
 // */
-//static int
-//sched_attr_copy_to_user(struct sched_attr __user *uattr,
-//			struct sched_attr *kattr,
-//			unsigned int usize)
+//SYSCALL_DEFINE1(nice, int, increment)
 //{
-//	unsigned int ksize = sizeof(*kattr);
-//
-//	if (!access_ok(uattr, usize))
-//		return -EFAULT;
+//	long nice, retval;
 //
 //	/*
-//	 * sched_getattr() ABI forwards and backwards compatibility:
-//	 *
-//	 * If usize == ksize then we just copy everything to user-space and all is good.
-//	 *
-//	 * If usize < ksize then we only copy as much as user-space has space for,
-//	 * this keeps ABI compatibility as well. We skip the rest.
-//	 *
-//	 * If usize > ksize then user-space is using a newer version of the ABI,
-//	 * which part the kernel doesn't know about. Just ignore it - tooling can
-//	 * detect the kernel's knowledge of attributes from the attr->size value
-//	 * which is set to ksize in this case.
+//	 * Setpriority might change our priority at the same moment.
+//	 * We don't have to worry. Conceptually one call occurs first
+//	 * and we have a single winner.
 //	 */
-//	kattr->size = min(usize, ksize);
+//	increment = clamp(increment, -NICE_WIDTH, NICE_WIDTH);
+//	nice = task_nice(current) + increment;
+//
+//	nice = clamp_val(nice, MIN_NICE, MAX_NICE);
+//	if (increment < 0 && !can_nice(current, nice))
+//		return -EPERM;
 //
-//	if (copy_to_user(uattr, kattr, kattr->size))
-//		return -EFAULT;
+//	retval = security_task_setnice(current, nice);
+//	if (retval)
+//		return retval;
 //
+//	set_user_nice(current, nice);
 //	return 0;
 //}
 //
-///**
-// * sys_sched_getattr - similar to sched_getparam, but with sched_attr
-// * @pid: the pid in question.
-// * @uattr: structure containing the extended parameters.
-// * @usize: sizeof(attr) for fwd/bwd comp.
-// * @flags: for future extension.
-// */
-//SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
-//		unsigned int, usize, unsigned int, flags)
-//{
-//	struct sched_attr kattr = { };
-//	struct task_struct *p;
-//	int retval;
-//
-//	if (!uattr || pid < 0 || usize > PAGE_SIZE ||
-//	    usize < SCHED_ATTR_SIZE_VER0 || flags)
-//		return -EINVAL;
-//
-//	rcu_read_lock();
-//	p = find_process_by_pid(pid);
-//	retval = -ESRCH;
-//	if (!p)
-//		goto out_unlock;
-//
-//	retval = security_task_getscheduler(p);
-//	if (retval)
-//		goto out_unlock;
-//
-//	kattr.sched_policy = p->policy;
-//	if (p->sched_reset_on_fork)
-//		kattr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
-//	if (task_has_dl_policy(p))
-//		__getparam_dl(p, &kattr);
-//	else if (task_has_rt_policy(p))
-//		kattr.sched_priority = p->rt_priority;
-//	else
-//		kattr.sched_nice = task_nice(p);
-//
-//#ifdef CONFIG_UCLAMP_TASK
-//	/*
-//	 * This could race with another potential updater, but this is fine
-//	 * because it'll correctly read the old or the new value. We don't need
-//	 * to guarantee who wins the race as long as it doesn't return garbage.
-//	 */
-//	kattr.sched_util_min = p->uclamp_req[UCLAMP_MIN].value;
-//	kattr.sched_util_max = p->uclamp_req[UCLAMP_MAX].value;
-//#endif
-//
-//	rcu_read_unlock();
-//
-//	return sched_attr_copy_to_user(uattr, &kattr, usize);
-//
-//out_unlock:
-//	rcu_read_unlock();
-//	return retval;
-//}
-//
-//long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
-//{
-//	cpumask_var_t cpus_allowed, new_mask;
-//	struct task_struct *p;
-//	int retval;
-//
-//	rcu_read_lock();
-//
-//	p = find_process_by_pid(pid);
-//	if (!p) {
-//		rcu_read_unlock();
-//		return -ESRCH;
-//	}
-//
-//	/* Prevent p going away */
-//	get_task_struct(p);
-//	rcu_read_unlock();
-//
-//	if (p->flags & PF_NO_SETAFFINITY) {
-//		retval = -EINVAL;
-//		goto out_put_task;
-//	}
-//	if (!alloc_cpumask_var(&cpus_allowed, GFP_KERNEL)) {
-//		retval = -ENOMEM;
-//		goto out_put_task;
-//	}
-//	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL)) {
-//		retval = -ENOMEM;
-//		goto out_free_cpus_allowed;
-//	}
-//	retval = -EPERM;
-//	if (!check_same_owner(p)) {
-//		rcu_read_lock();
-//		if (!ns_capable(__task_cred(p)->user_ns, CAP_SYS_NICE)) {
-//			rcu_read_unlock();
-//			goto out_free_new_mask;
-//		}
-//		rcu_read_unlock();
-//	}
-//
-//	retval = security_task_setscheduler(p);
-//	if (retval)
-//		goto out_free_new_mask;
-//
-//
-//	cpuset_cpus_allowed(p, cpus_allowed);
-//	cpumask_and(new_mask, in_mask, cpus_allowed);
-//
-//	/*
-//	 * Since bandwidth control happens on root_domain basis,
-//	 * if admission test is enabled, we only admit -deadline
-//	 * tasks allowed to run on all the CPUs in the task's
-//	 * root_domain.
-//	 */
-//#ifdef CONFIG_SMP
-//	if (task_has_dl_policy(p) && dl_bandwidth_enabled()) {
-//		rcu_read_lock();
-//		if (!cpumask_subset(task_rq(p)->rd->span, new_mask)) {
-//			retval = -EBUSY;
-//			rcu_read_unlock();
-//			goto out_free_new_mask;
-//		}
-//		rcu_read_unlock();
-//	}
-//#endif
-//again:
-//	retval = __set_cpus_allowed_ptr(p, new_mask, true);
-//
-//	if (!retval) {
-//		cpuset_cpus_allowed(p, cpus_allowed);
-//		if (!cpumask_subset(new_mask, cpus_allowed)) {
-//			/*
-//			 * We must have raced with a concurrent cpuset
-//			 * update. Just reset the cpus_allowed to the
-//			 * cpuset's cpus_allowed
-//			 */
-//			cpumask_copy(new_mask, cpus_allowed);
-//			goto again;
-//		}
-//	}
-//out_free_new_mask:
-//	free_cpumask_var(new_mask);
-//out_free_cpus_allowed:
-//	free_cpumask_var(cpus_allowed);
-//out_put_task:
-//	put_task_struct(p);
-//	return retval;
-//}
-//
-//static int get_user_cpu_mask(unsigned long __user *user_mask_ptr, unsigned len,
-//			     struct cpumask *new_mask)
-//{
-//	if (len < cpumask_size())
-//		cpumask_clear(new_mask);
-//	else if (len > cpumask_size())
-//		len = cpumask_size();
-//
-//	return copy_from_user(new_mask, user_mask_ptr, len) ? -EFAULT : 0;
-//}
-//
-///**
-// * sys_sched_setaffinity - set the CPU affinity of a process
-// * @pid: pid of the process
-// * @len: length in bytes of the bitmask pointed to by user_mask_ptr
-// * @user_mask_ptr: user-space pointer to the new CPU mask
-// *
-// * Return: 0 on success. An error code otherwise.
-// */
-//SYSCALL_DEFINE3(sched_setaffinity, pid_t, pid, unsigned int, len,
-//		unsigned long __user *, user_mask_ptr)
-//{
-//	cpumask_var_t new_mask;
-//	int retval;
-//
-//	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL))
-//		return -ENOMEM;
-//
-//	retval = get_user_cpu_mask(user_mask_ptr, len, new_mask);
-//	if (retval == 0)
-//		retval = sched_setaffinity(pid, new_mask);
-//	free_cpumask_var(new_mask);
-//	return retval;
-//}
-//
-//long sched_getaffinity(pid_t pid, struct cpumask *mask)
-//{
-//	struct task_struct *p;
-//	unsigned long flags;
-//	int retval;
-//
-//	rcu_read_lock();
-//
-//	retval = -ESRCH;
-//	p = find_process_by_pid(pid);
-//	if (!p)
-//		goto out_unlock;
-//
-//	retval = security_task_getscheduler(p);
-//	if (retval)
-//		goto out_unlock;
-//
-//	raw_spin_lock_irqsave(&p->pi_lock, flags);
-//	cpumask_and(mask, &p->cpus_mask, cpu_active_mask);
-//	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
-//
-//out_unlock:
-//	rcu_read_unlock();
-//
-//	return retval;
-//}
+//#endif
 //
 ///**
-// * sys_sched_getaffinity - get the CPU affinity of a process
-// * @pid: pid of the process
-// * @len: length in bytes of the bitmask pointed to by user_mask_ptr
-// * @user_mask_ptr: user-space pointer to hold the current CPU mask
+// * task_prio - return the priority value of a given task.
+// * @p: the task in question.
 // *
-// * Return: size of CPU mask copied to user_mask_ptr on success. An
-// * error code otherwise.
+// * Return: The priority value as seen by users in /proc.
+// * RT tasks are offset by -200. Normal tasks are centered
+// * around 0, value goes from -16 to +15.
 // */
-//SYSCALL_DEFINE3(sched_getaffinity, pid_t, pid, unsigned int, len,
-//		unsigned long __user *, user_mask_ptr)
+//int task_prio(const struct task_struct *p)
 //{
-//	int ret;
-//	cpumask_var_t mask;
-//
-//	if ((len * BITS_PER_BYTE) < nr_cpu_ids)
-//		return -EINVAL;
-//	if (len & (sizeof(unsigned long)-1))
-//		return -EINVAL;
-//
-//	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
-//		return -ENOMEM;
-//
-//	ret = sched_getaffinity(pid, mask);
-//	if (ret == 0) {
-//		unsigned int retlen = min(len, cpumask_size());
-//
-//		if (copy_to_user(user_mask_ptr, mask, retlen))
-//			ret = -EFAULT;
-//		else
-//			ret = retlen;
-//	}
-//	free_cpumask_var(mask);
-//
-//	return ret;
+//	return p->prio - MAX_RT_PRIO;
 //}
+
+/**
+ * idle_cpu - is a given CPU idle currently?
+ * @cpu: the processor in question.
+ *
+ * Return: 1 if the CPU is currently idle. 0 otherwise.
+ */
+int idle_cpu(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (rq->curr != rq->idle)
+		return 0;
+
+	if (rq->nr_running)
+		return 0;
+
+#ifdef CONFIG_SMP
+	if (rq->ttwu_pending)
+		return 0;
+#endif
+
+	return 1;
+}
+
+/**
+ * available_idle_cpu - is a given CPU idle for enqueuing work.
+ * @cpu: the CPU in question.
+ *
+ * Return: 1 if the CPU is currently idle. 0 otherwise.
+ */
+int available_idle_cpu(int cpu)
+{
+	if (!idle_cpu(cpu))
+		return 0;
+
+	if (vcpu_is_preempted(cpu))
+		return 0;
+
+	return 1;
+}
 //
 ///**
-// * sys_sched_yield - yield the current processor to other threads.
-// *
-// * This function yields the current CPU to other tasks. If there are no
-// * other threads running on this CPU then this function will return.
+// * idle_task - return the idle task for a given CPU.
+// * @cpu: the processor in question.
 // *
-// * Return: 0.
+// * Return: The idle task for the CPU @cpu.
 // */
-//static void do_sched_yield(void)
+//struct task_struct *idle_task(int cpu)
 //{
-//	struct rq_flags rf;
-//	struct rq *rq;
-//
-//	rq = this_rq_lock_irq(&rf);
-//
-//	schedstat_inc(rq->yld_count);
-//	current->sched_class->yield_task(rq);
-//
-//	/*
-//	 * Since we are going to call schedule() anyway, there's
-//	 * no need to preempt or enable interrupts:
-//	 */
-//	preempt_disable();
-//	rq_unlock(rq, &rf);
-//	sched_preempt_enable_no_resched();
-//
-//	schedule();
+//	return cpu_rq(cpu)->idle;
 //}
 //
-//SYSCALL_DEFINE0(sched_yield)
-//{
-//	do_sched_yield();
-//	return 0;
-//}
+/**
+ * find_process_by_pid - find a process with a matching PID value.
+ * @pid: the pid in question.
+ *
+ * The task of @pid, if found. %NULL otherwise.
+ */
+static struct task_struct *find_process_by_pid(pid_t pid)
+{
+	return pid ? find_task_by_vpid(pid) : current;
+}
+
+/*
+ * sched_setparam() passes in -1 for its policy, to let the functions
+ * it calls know not to change it.
+ */
+#define SETPARAM_POLICY	-1
+
+static void __setscheduler_params(struct task_struct *p,
+		const struct sched_attr *attr)
+{
+	int policy = attr->sched_policy;
+
+	if (policy == SETPARAM_POLICY)
+		policy = p->policy;
+
+	p->policy = policy;
+
+	if (dl_policy(policy))
+		__setparam_dl(p, attr);
+	else if (fair_policy(policy))
+		p->static_prio = NICE_TO_PRIO(attr->sched_nice);
+
+	/*
+	 * __sched_setscheduler() ensures attr->sched_priority == 0 when
+	 * !rt_policy. Always setting this ensures that things like
+	 * getparam()/getattr() don't report silly values for !rt tasks.
+	 */
+	p->rt_priority = attr->sched_priority;
+	p->normal_prio = normal_prio(p);
+	set_load_weight(p, true);
+}
+
+/* Actually do priority change: must hold pi & rq lock. */
+static void __setscheduler(struct rq *rq, struct task_struct *p,
+			   const struct sched_attr *attr, bool keep_boost)
+{
+	/*
+	 * If params can't change scheduling class changes aren't allowed
+	 * either.
+	 */
+	if (attr->sched_flags & SCHED_FLAG_KEEP_PARAMS)
+		return;
+
+	__setscheduler_params(p, attr);
+
+	/*
+	 * Keep a potential priority boosting if called from
+	 * sched_setscheduler().
+	 */
+	p->prio = normal_prio(p);
+	if (keep_boost)
+		p->prio = rt_effective_prio(p, p->prio);
+
+	if (dl_prio(p->prio))
+		p->sched_class = &dl_sched_class;
+	else if (rt_prio(p->prio))
+		p->sched_class = &rt_sched_class;
+	else
+		p->sched_class = &fair_sched_class;
+}
+
+/*
+ * Check the target process has a UID that matches the current process's:
+ */
+static bool check_same_owner(struct task_struct *p)
+{
+	const struct cred *cred = current_cred(), *pcred;
+	bool match;
+
+	rcu_read_lock();
+	pcred = __task_cred(p);
+	match = (uid_eq(cred->euid, pcred->euid) ||
+		 uid_eq(cred->euid, pcred->uid));
+	rcu_read_unlock();
+	return match;
+}
+
+static int __sched_setscheduler(struct task_struct *p,
+				const struct sched_attr *attr,
+				bool user, bool pi)
+{
+	int newprio = dl_policy(attr->sched_policy) ? MAX_DL_PRIO - 1 :
+		      MAX_RT_PRIO - 1 - attr->sched_priority;
+	int retval, oldprio, oldpolicy = -1, queued, running;
+	int new_effective_prio, policy = attr->sched_policy;
+	const struct sched_class *prev_class;
+	struct rq_flags rf;
+	int reset_on_fork;
+	int queue_flags = DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK;
+	struct rq *rq;
+
+	/* The pi code expects interrupts enabled */
+	BUG_ON(pi && in_interrupt());
+recheck:
+	/* Double check policy once rq lock held: */
+	if (policy < 0) {
+		reset_on_fork = p->sched_reset_on_fork;
+		policy = oldpolicy = p->policy;
+	} else {
+		reset_on_fork = !!(attr->sched_flags & SCHED_FLAG_RESET_ON_FORK);
+
+		if (!valid_policy(policy))
+			return -EINVAL;
+	}
+
+	if (attr->sched_flags & ~(SCHED_FLAG_ALL | SCHED_FLAG_SUGOV))
+		return -EINVAL;
+
+	/*
+	 * Valid priorities for SCHED_FIFO and SCHED_RR are
+	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL,
+	 * SCHED_BATCH and SCHED_IDLE is 0.
+	 */
+	if ((p->mm && attr->sched_priority > MAX_USER_RT_PRIO-1) ||
+	    (!p->mm && attr->sched_priority > MAX_RT_PRIO-1))
+		return -EINVAL;
+	if ((dl_policy(policy) && !__checkparam_dl(attr)) ||
+	    (rt_policy(policy) != (attr->sched_priority != 0)))
+		return -EINVAL;
+
+	/*
+	 * Allow unprivileged RT tasks to decrease priority:
+	 */
+	if (user && !capable(CAP_SYS_NICE)) {
+		if (fair_policy(policy)) {
+			if (attr->sched_nice < task_nice(p) &&
+			    !can_nice(p, attr->sched_nice))
+				return -EPERM;
+		}
+
+		if (rt_policy(policy)) {
+			unsigned long rlim_rtprio =
+					task_rlimit(p, RLIMIT_RTPRIO);
+
+			/* Can't set/change the rt policy: */
+			if (policy != p->policy && !rlim_rtprio)
+				return -EPERM;
+
+			/* Can't increase priority: */
+			if (attr->sched_priority > p->rt_priority &&
+			    attr->sched_priority > rlim_rtprio)
+				return -EPERM;
+		}
+
+		 /*
+		  * Can't set/change SCHED_DEADLINE policy at all for now
+		  * (safest behavior); in the future we would like to allow
+		  * unprivileged DL tasks to increase their relative deadline
+		  * or reduce their runtime (both ways reducing utilization)
+		  */
+		if (dl_policy(policy))
+			return -EPERM;
+
+		/*
+		 * Treat SCHED_IDLE as nice 20. Only allow a switch to
+		 * SCHED_NORMAL if the RLIMIT_NICE would normally permit it.
+		 */
+		if (task_has_idle_policy(p) && !idle_policy(policy)) {
+			if (!can_nice(p, task_nice(p)))
+				return -EPERM;
+		}
+
+		/* Can't change other user's priorities: */
+		if (!check_same_owner(p))
+			return -EPERM;
+
+		/* Normal users shall not reset the sched_reset_on_fork flag: */
+		if (p->sched_reset_on_fork && !reset_on_fork)
+			return -EPERM;
+	}
+
+	if (user) {
+		if (attr->sched_flags & SCHED_FLAG_SUGOV)
+			return -EINVAL;
+
+		retval = security_task_setscheduler(p);
+		if (retval)
+			return retval;
+	}
+
+	/* Update task specific "requested" clamps */
+	if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP) {
+		retval = uclamp_validate(p, attr);
+		if (retval)
+			return retval;
+	}
+
+	if (pi)
+		cpuset_read_lock();
+
+	/*
+	 * Make sure no PI-waiters arrive (or leave) while we are
+	 * changing the priority of the task:
+	 *
+	 * To be able to change p->policy safely, the appropriate
+	 * runqueue lock must be held.
+	 */
+	rq = task_rq_lock(p, &rf);
+	update_rq_clock(rq);
+
+	/*
+	 * Changing the policy of the stop threads its a very bad idea:
+	 */
+	if (p == rq->stop) {
+		retval = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * If not changing anything there's no need to proceed further,
+	 * but store a possible modification of reset_on_fork.
+	 */
+	if (unlikely(policy == p->policy)) {
+		if (fair_policy(policy) && attr->sched_nice != task_nice(p))
+			goto change;
+		if (rt_policy(policy) && attr->sched_priority != p->rt_priority)
+			goto change;
+		if (dl_policy(policy) && dl_param_changed(p, attr))
+			goto change;
+		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
+			goto change;
+
+		p->sched_reset_on_fork = reset_on_fork;
+		retval = 0;
+		goto unlock;
+	}
+change:
+
+	if (user) {
+#ifdef CONFIG_RT_GROUP_SCHED
+		/*
+		 * Do not allow realtime tasks into groups that have no runtime
+		 * assigned.
+		 */
+		if (rt_bandwidth_enabled() && rt_policy(policy) &&
+				task_group(p)->rt_bandwidth.rt_runtime == 0 &&
+				!task_group_is_autogroup(task_group(p))) {
+			retval = -EPERM;
+			goto unlock;
+		}
+#endif
+#ifdef CONFIG_SMP
+		if (dl_bandwidth_enabled() && dl_policy(policy) &&
+				!(attr->sched_flags & SCHED_FLAG_SUGOV)) {
+			cpumask_t *span = rq->rd->span;
+
+			/*
+			 * Don't allow tasks with an affinity mask smaller than
+			 * the entire root_domain to become SCHED_DEADLINE. We
+			 * will also fail if there's no bandwidth available.
+			 */
+			if (!cpumask_subset(span, p->cpus_ptr) ||
+			    rq->rd->dl_bw.bw == 0) {
+				retval = -EPERM;
+				goto unlock;
+			}
+		}
+#endif
+	}
+
+	/* Re-check policy now with rq lock held: */
+	if (unlikely(oldpolicy != -1 && oldpolicy != p->policy)) {
+		policy = oldpolicy = -1;
+		task_rq_unlock(rq, p, &rf);
+		if (pi)
+			cpuset_read_unlock();
+		goto recheck;
+	}
+
+	/*
+	 * If setscheduling to SCHED_DEADLINE (or changing the parameters
+	 * of a SCHED_DEADLINE task) we need to check if enough bandwidth
+	 * is available.
+	 */
+	if ((dl_policy(policy) || dl_task(p)) && sched_dl_overflow(p, policy, attr)) {
+		retval = -EBUSY;
+		goto unlock;
+	}
+
+	p->sched_reset_on_fork = reset_on_fork;
+	oldprio = p->prio;
+
+	if (pi) {
+		/*
+		 * Take priority boosted tasks into account. If the new
+		 * effective priority is unchanged, we just store the new
+		 * normal parameters and do not touch the scheduler class and
+		 * the runqueue. This will be done when the task deboost
+		 * itself.
+		 */
+		new_effective_prio = rt_effective_prio(p, newprio);
+		if (new_effective_prio == oldprio)
+			queue_flags &= ~DEQUEUE_MOVE;
+	}
+
+	queued = task_on_rq_queued(p);
+	running = task_current(rq, p);
+	if (queued)
+		dequeue_task(rq, p, queue_flags);
+	if (running)
+		put_prev_task(rq, p);
+
+	prev_class = p->sched_class;
+
+	__setscheduler(rq, p, attr, pi);
+	__setscheduler_uclamp(p, attr);
+
+	if (queued) {
+		/*
+		 * We enqueue to tail when the priority of a task is
+		 * increased (user space view).
+		 */
+		if (oldprio < p->prio)
+			queue_flags |= ENQUEUE_HEAD;
+
+		enqueue_task(rq, p, queue_flags);
+	}
+	if (running)
+		set_next_task(rq, p);
+
+	check_class_changed(rq, p, prev_class, oldprio);
+
+	/* Avoid rq from going away on us: */
+	preempt_disable();
+	task_rq_unlock(rq, p, &rf);
+
+	if (pi) {
+		cpuset_read_unlock();
+		rt_mutex_adjust_pi(p);
+	}
+
+	/* Run balance callbacks after we've adjusted the PI chain: */
+	balance_callback(rq);
+	preempt_enable();
+
+	return 0;
+
+unlock:
+	task_rq_unlock(rq, p, &rf);
+	if (pi)
+		cpuset_read_unlock();
+	return retval;
+}
+
+static int _sched_setscheduler(struct task_struct *p, int policy,
+			       const struct sched_param *param, bool check)
+{
+	struct sched_attr attr = {
+		.sched_policy   = policy,
+		.sched_priority = param->sched_priority,
+		.sched_nice	= PRIO_TO_NICE(p->static_prio),
+	};
+
+	/* Fixup the legacy SCHED_RESET_ON_FORK hack. */
+	if ((policy != SETPARAM_POLICY) && (policy & SCHED_RESET_ON_FORK)) {
+		attr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
+		policy &= ~SCHED_RESET_ON_FORK;
+		attr.sched_policy = policy;
+	}
+
+	return __sched_setscheduler(p, &attr, check, true);
+}
+/**
+ * sched_setscheduler - change the scheduling policy and/or RT priority of a thread.
+ * @p: the task in question.
+ * @policy: new policy.
+ * @param: structure containing the new RT priority.
+ *
+ * Use sched_set_fifo(), read its comment.
+ *
+ * Return: 0 on success. An error code otherwise.
+ *
+ * NOTE that the task may be already dead.
+ */
+int sched_setscheduler(struct task_struct *p, int policy,
+		       const struct sched_param *param)
+{
+	return _sched_setscheduler(p, policy, param, true);
+}
+
+int sched_setattr(struct task_struct *p, const struct sched_attr *attr)
+{
+	return __sched_setscheduler(p, attr, true, true);
+}
+
+int sched_setattr_nocheck(struct task_struct *p, const struct sched_attr *attr)
+{
+	return __sched_setscheduler(p, attr, false, true);
+}
+
+/**
+ * sched_setscheduler_nocheck - change the scheduling policy and/or RT priority of a thread from kernelspace.
+ * @p: the task in question.
+ * @policy: new policy.
+ * @param: structure containing the new RT priority.
+ *
+ * Just like sched_setscheduler, only don't bother checking if the
+ * current context has permission.  For example, this is needed in
+ * stop_machine(): we create temporary high priority worker threads,
+ * but our caller might not have that capability.
+ *
+ * Return: 0 on success. An error code otherwise.
+ */
+int sched_setscheduler_nocheck(struct task_struct *p, int policy,
+			       const struct sched_param *param)
+{
+	return _sched_setscheduler(p, policy, param, false);
+}
+EXPORT_SYMBOL(sched_setscheduler_nocheck);
+
+/*
+ * SCHED_FIFO is a broken scheduler model; that is, it is fundamentally
+ * incapable of resource management, which is the one thing an OS really should
+ * be doing.
+ *
+ * This is of course the reason it is limited to privileged users only.
+ *
+ * Worse still; it is fundamentally impossible to compose static priority
+ * workloads. You cannot take two correctly working static prio workloads
+ * and smash them together and still expect them to work.
+ *
+ * For this reason 'all' FIFO tasks the kernel creates are basically at:
+ *
+ *   MAX_RT_PRIO / 2
+ *
+ * The administrator _MUST_ configure the system, the kernel simply doesn't
+ * know enough information to make a sensible choice.
+ */
+void sched_set_fifo(struct task_struct *p)
+{
+	struct sched_param sp = { .sched_priority = MAX_RT_PRIO / 2 };
+	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
+}
+
+/*
+ * For when you don't much care about FIFO, but want to be above SCHED_NORMAL.
+ */
+void sched_set_fifo_low(struct task_struct *p)
+{
+	struct sched_param sp = { .sched_priority = 1 };
+	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
+}
+EXPORT_SYMBOL_GPL(sched_set_fifo_low);
+
+void sched_set_normal(struct task_struct *p, int nice)
+{
+	struct sched_attr attr = {
+		.sched_policy = SCHED_NORMAL,
+		.sched_nice = nice,
+	};
+	WARN_ON_ONCE(sched_setattr_nocheck(p, &attr) != 0);
+}
+EXPORT_SYMBOL_GPL(sched_set_normal);
+
+static int
+do_sched_setscheduler(pid_t pid, int policy, struct sched_param __user *param)
+{
+	struct sched_param lparam;
+	struct task_struct *p;
+	int retval;
+
+	if (!param || pid < 0)
+		return -EINVAL;
+	if (copy_from_user(&lparam, param, sizeof(struct sched_param)))
+		return -EFAULT;
+
+	rcu_read_lock();
+	retval = -ESRCH;
+	p = find_process_by_pid(pid);
+	if (likely(p))
+		get_task_struct(p);
+	rcu_read_unlock();
+
+	if (likely(p)) {
+		retval = sched_setscheduler(p, policy, &lparam);
+		put_task_struct(p);
+	}
+
+	return retval;
+}
+
+/*
+ * Mimics kernel/events/core.c perf_copy_attr().
+ */
+static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *attr)
+{
+	u32 size;
+	int ret;
+
+	/* Zero the full structure, so that a short copy will be nice: */
+	memset(attr, 0, sizeof(*attr));
+
+	ret = get_user(size, &uattr->size);
+	if (ret)
+		return ret;
+
+	/* ABI compatibility quirk: */
+	if (!size)
+		size = SCHED_ATTR_SIZE_VER0;
+	if (size < SCHED_ATTR_SIZE_VER0 || size > PAGE_SIZE)
+		goto err_size;
+
+	ret = copy_struct_from_user(attr, sizeof(*attr), uattr, size);
+	if (ret) {
+		if (ret == -E2BIG)
+			goto err_size;
+		return ret;
+	}
+
+	if ((attr->sched_flags & SCHED_FLAG_UTIL_CLAMP) &&
+	    size < SCHED_ATTR_SIZE_VER1)
+		return -EINVAL;
+
+	/*
+	 * XXX: Do we want to be lenient like existing syscalls; or do we want
+	 * to be strict and return an error on out-of-bounds values?
+	 */
+	attr->sched_nice = clamp(attr->sched_nice, MIN_NICE, MAX_NICE);
+
+	return 0;
+
+err_size:
+	put_user(sizeof(*attr), &uattr->size);
+	return -E2BIG;
+}
+
+/**
+ * sys_sched_setscheduler - set/change the scheduler policy and RT priority
+ * @pid: the pid in question.
+ * @policy: new policy.
+ * @param: structure containing the new RT priority.
+ *
+ * Return: 0 on success. An error code otherwise.
+ */
+SYSCALL_DEFINE3(sched_setscheduler, pid_t, pid, int, policy, struct sched_param __user *, param)
+{
+	if (policy < 0)
+		return -EINVAL;
+
+	return do_sched_setscheduler(pid, policy, param);
+}
+
+/**
+ * sys_sched_setparam - set/change the RT priority of a thread
+ * @pid: the pid in question.
+ * @param: structure containing the new RT priority.
+ *
+ * Return: 0 on success. An error code otherwise.
+ */
+SYSCALL_DEFINE2(sched_setparam, pid_t, pid, struct sched_param __user *, param)
+{
+	return do_sched_setscheduler(pid, SETPARAM_POLICY, param);
+}
+
+/**
+ * sys_sched_setattr - same as above, but with extended sched_attr
+ * @pid: the pid in question.
+ * @uattr: structure containing the extended parameters.
+ * @flags: for future extension.
+ */
+SYSCALL_DEFINE3(sched_setattr, pid_t, pid, struct sched_attr __user *, uattr,
+			       unsigned int, flags)
+{
+	struct sched_attr attr;
+	struct task_struct *p;
+	int retval;
+
+	if (!uattr || pid < 0 || flags)
+		return -EINVAL;
+
+	retval = sched_copy_attr(uattr, &attr);
+	if (retval)
+		return retval;
+
+	if ((int)attr.sched_policy < 0)
+		return -EINVAL;
+	if (attr.sched_flags & SCHED_FLAG_KEEP_POLICY)
+		attr.sched_policy = SETPARAM_POLICY;
+
+	rcu_read_lock();
+	retval = -ESRCH;
+	p = find_process_by_pid(pid);
+	if (likely(p))
+		get_task_struct(p);
+	rcu_read_unlock();
+
+	if (likely(p)) {
+		retval = sched_setattr(p, &attr);
+		put_task_struct(p);
+	}
+
+	return retval;
+}
+
+/**
+ * sys_sched_getscheduler - get the policy (scheduling class) of a thread
+ * @pid: the pid in question.
+ *
+ * Return: On success, the policy of the thread. Otherwise, a negative error
+ * code.
+ */
+SYSCALL_DEFINE1(sched_getscheduler, pid_t, pid)
+{
+	struct task_struct *p;
+	int retval;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	retval = -ESRCH;
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	if (p) {
+		retval = security_task_getscheduler(p);
+		if (!retval)
+			retval = p->policy
+				| (p->sched_reset_on_fork ? SCHED_RESET_ON_FORK : 0);
+	}
+	rcu_read_unlock();
+	return retval;
+}
+
+/**
+ * sys_sched_getparam - get the RT priority of a thread
+ * @pid: the pid in question.
+ * @param: structure containing the RT priority.
+ *
+ * Return: On success, 0 and the RT priority is in @param. Otherwise, an error
+ * code.
+ */
+SYSCALL_DEFINE2(sched_getparam, pid_t, pid, struct sched_param __user *, param)
+{
+	struct sched_param lp = { .sched_priority = 0 };
+	struct task_struct *p;
+	int retval;
+
+	if (!param || pid < 0)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	retval = -ESRCH;
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	if (task_has_rt_policy(p))
+		lp.sched_priority = p->rt_priority;
+	rcu_read_unlock();
+
+	/*
+	 * This one might sleep, we cannot do it with a spinlock held ...
+	 */
+	retval = copy_to_user(param, &lp, sizeof(*param)) ? -EFAULT : 0;
+
+	return retval;
+
+out_unlock:
+	rcu_read_unlock();
+	return retval;
+}
+
+/*
+ * Copy the kernel size attribute structure (which might be larger
+ * than what user-space knows about) to user-space.
+ *
+ * Note that all cases are valid: user-space buffer can be larger or
+ * smaller than the kernel-space buffer. The usual case is that both
+ * have the same size.
+ */
+static int
+sched_attr_copy_to_user(struct sched_attr __user *uattr,
+			struct sched_attr *kattr,
+			unsigned int usize)
+{
+	unsigned int ksize = sizeof(*kattr);
+
+	if (!access_ok(uattr, usize))
+		return -EFAULT;
+
+	/*
+	 * sched_getattr() ABI forwards and backwards compatibility:
+	 *
+	 * If usize == ksize then we just copy everything to user-space and all is good.
+	 *
+	 * If usize < ksize then we only copy as much as user-space has space for,
+	 * this keeps ABI compatibility as well. We skip the rest.
+	 *
+	 * If usize > ksize then user-space is using a newer version of the ABI,
+	 * which part the kernel doesn't know about. Just ignore it - tooling can
+	 * detect the kernel's knowledge of attributes from the attr->size value
+	 * which is set to ksize in this case.
+	 */
+	kattr->size = min(usize, ksize);
+
+	if (copy_to_user(uattr, kattr, kattr->size))
+		return -EFAULT;
+
+	return 0;
+}
+
+/**
+ * sys_sched_getattr - similar to sched_getparam, but with sched_attr
+ * @pid: the pid in question.
+ * @uattr: structure containing the extended parameters.
+ * @usize: sizeof(attr) for fwd/bwd comp.
+ * @flags: for future extension.
+ */
+SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
+		unsigned int, usize, unsigned int, flags)
+{
+	struct sched_attr kattr = { };
+	struct task_struct *p;
+	int retval;
+
+	if (!uattr || pid < 0 || usize > PAGE_SIZE ||
+	    usize < SCHED_ATTR_SIZE_VER0 || flags)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	retval = -ESRCH;
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	kattr.sched_policy = p->policy;
+	if (p->sched_reset_on_fork)
+		kattr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
+	if (task_has_dl_policy(p))
+		__getparam_dl(p, &kattr);
+	else if (task_has_rt_policy(p))
+		kattr.sched_priority = p->rt_priority;
+	else
+		kattr.sched_nice = task_nice(p);
+
+#ifdef CONFIG_UCLAMP_TASK
+	/*
+	 * This could race with another potential updater, but this is fine
+	 * because it'll correctly read the old or the new value. We don't need
+	 * to guarantee who wins the race as long as it doesn't return garbage.
+	 */
+	kattr.sched_util_min = p->uclamp_req[UCLAMP_MIN].value;
+	kattr.sched_util_max = p->uclamp_req[UCLAMP_MAX].value;
+#endif
+
+	rcu_read_unlock();
+
+	return sched_attr_copy_to_user(uattr, &kattr, usize);
+
+out_unlock:
+	rcu_read_unlock();
+	return retval;
+}
+
+long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
+{
+	cpumask_var_t cpus_allowed, new_mask;
+	struct task_struct *p;
+	int retval;
+
+	rcu_read_lock();
+
+	p = find_process_by_pid(pid);
+	if (!p) {
+		rcu_read_unlock();
+		return -ESRCH;
+	}
+
+	/* Prevent p going away */
+	get_task_struct(p);
+	rcu_read_unlock();
+
+	if (p->flags & PF_NO_SETAFFINITY) {
+		retval = -EINVAL;
+		goto out_put_task;
+	}
+	if (!alloc_cpumask_var(&cpus_allowed, GFP_KERNEL)) {
+		retval = -ENOMEM;
+		goto out_put_task;
+	}
+	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL)) {
+		retval = -ENOMEM;
+		goto out_free_cpus_allowed;
+	}
+	retval = -EPERM;
+	if (!check_same_owner(p)) {
+		rcu_read_lock();
+		if (!ns_capable(__task_cred(p)->user_ns, CAP_SYS_NICE)) {
+			rcu_read_unlock();
+			goto out_free_new_mask;
+		}
+		rcu_read_unlock();
+	}
+
+	retval = security_task_setscheduler(p);
+	if (retval)
+		goto out_free_new_mask;
+
+
+	cpuset_cpus_allowed(p, cpus_allowed);
+	cpumask_and(new_mask, in_mask, cpus_allowed);
+
+	/*
+	 * Since bandwidth control happens on root_domain basis,
+	 * if admission test is enabled, we only admit -deadline
+	 * tasks allowed to run on all the CPUs in the task's
+	 * root_domain.
+	 */
+#ifdef CONFIG_SMP
+	if (task_has_dl_policy(p) && dl_bandwidth_enabled()) {
+		rcu_read_lock();
+		if (!cpumask_subset(task_rq(p)->rd->span, new_mask)) {
+			retval = -EBUSY;
+			rcu_read_unlock();
+			goto out_free_new_mask;
+		}
+		rcu_read_unlock();
+	}
+#endif
+again:
+	retval = __set_cpus_allowed_ptr(p, new_mask, true);
+
+	if (!retval) {
+		cpuset_cpus_allowed(p, cpus_allowed);
+		if (!cpumask_subset(new_mask, cpus_allowed)) {
+			/*
+			 * We must have raced with a concurrent cpuset
+			 * update. Just reset the cpus_allowed to the
+			 * cpuset's cpus_allowed
+			 */
+			cpumask_copy(new_mask, cpus_allowed);
+			goto again;
+		}
+	}
+out_free_new_mask:
+	free_cpumask_var(new_mask);
+out_free_cpus_allowed:
+	free_cpumask_var(cpus_allowed);
+out_put_task:
+	put_task_struct(p);
+	return retval;
+}
+
+static int get_user_cpu_mask(unsigned long __user *user_mask_ptr, unsigned len,
+			     struct cpumask *new_mask)
+{
+	if (len < cpumask_size())
+		cpumask_clear(new_mask);
+	else if (len > cpumask_size())
+		len = cpumask_size();
+
+	return copy_from_user(new_mask, user_mask_ptr, len) ? -EFAULT : 0;
+}
+
+/**
+ * sys_sched_setaffinity - set the CPU affinity of a process
+ * @pid: pid of the process
+ * @len: length in bytes of the bitmask pointed to by user_mask_ptr
+ * @user_mask_ptr: user-space pointer to the new CPU mask
+ *
+ * Return: 0 on success. An error code otherwise.
+ */
+SYSCALL_DEFINE3(sched_setaffinity, pid_t, pid, unsigned int, len,
+		unsigned long __user *, user_mask_ptr)
+{
+	cpumask_var_t new_mask;
+	int retval;
+
+	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	retval = get_user_cpu_mask(user_mask_ptr, len, new_mask);
+	if (retval == 0)
+		retval = sched_setaffinity(pid, new_mask);
+	free_cpumask_var(new_mask);
+	return retval;
+}
+
+long sched_getaffinity(pid_t pid, struct cpumask *mask)
+{
+	struct task_struct *p;
+	unsigned long flags;
+	int retval;
+
+	rcu_read_lock();
+
+	retval = -ESRCH;
+	p = find_process_by_pid(pid);
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	cpumask_and(mask, &p->cpus_mask, cpu_active_mask);
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+
+out_unlock:
+	rcu_read_unlock();
+
+	return retval;
+}
+
+/**
+ * sys_sched_getaffinity - get the CPU affinity of a process
+ * @pid: pid of the process
+ * @len: length in bytes of the bitmask pointed to by user_mask_ptr
+ * @user_mask_ptr: user-space pointer to hold the current CPU mask
+ *
+ * Return: size of CPU mask copied to user_mask_ptr on success. An
+ * error code otherwise.
+ */
+SYSCALL_DEFINE3(sched_getaffinity, pid_t, pid, unsigned int, len,
+		unsigned long __user *, user_mask_ptr)
+{
+	int ret;
+	cpumask_var_t mask;
+
+	if ((len * BITS_PER_BYTE) < nr_cpu_ids)
+		return -EINVAL;
+	if (len & (sizeof(unsigned long)-1))
+		return -EINVAL;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = sched_getaffinity(pid, mask);
+	if (ret == 0) {
+		unsigned int retlen = min(len, cpumask_size());
+
+		if (copy_to_user(user_mask_ptr, mask, retlen))
+			ret = -EFAULT;
+		else
+			ret = retlen;
+	}
+	free_cpumask_var(mask);
+
+	return ret;
+}
+
+/**
+ * sys_sched_yield - yield the current processor to other threads.
+ *
+ * This function yields the current CPU to other tasks. If there are no
+ * other threads running on this CPU then this function will return.
+ *
+ * Return: 0.
+ */
+static void do_sched_yield(void)
+{
+	struct rq_flags rf;
+	struct rq *rq;
+
+	rq = this_rq_lock_irq(&rf);
+
+	schedstat_inc(rq->yld_count);
+	current->sched_class->yield_task(rq);
+
+	/*
+	 * Since we are going to call schedule() anyway, there's
+	 * no need to preempt or enable interrupts:
+	 */
+	preempt_disable();
+	rq_unlock(rq, &rf);
+	sched_preempt_enable_no_resched();
+
+	schedule();
+}
+
+SYSCALL_DEFINE0(sched_yield)
+{
+	do_sched_yield();
+	return 0;
+}
 
 #ifndef CONFIG_PREEMPTION
 int __sched _cond_resched(void)
@@ -6122,136 +6134,136 @@ int __sched _cond_resched(void)
 }
 #endif
 
-///*
-// * __cond_resched_lock() - if a reschedule is pending, drop the given lock,
-// * call schedule, and on return reacquire the lock.
-// *
-// * This works OK both with and without CONFIG_PREEMPTION. We do strange low-level
-// * operations here to prevent schedule() from being called twice (once via
-// * spin_unlock(), once by hand).
-// */
-//int __cond_resched_lock(spinlock_t *lock)
-//{
-//	int resched = should_resched(PREEMPT_LOCK_OFFSET);
-//	int ret = 0;
-//
-//	lockdep_assert_held(lock);
-//
-//	if (spin_needbreak(lock) || resched) {
-//		spin_unlock(lock);
-//		if (resched)
-//			preempt_schedule_common();
-//		else
-//			cpu_relax();
-//		ret = 1;
-//		spin_lock(lock);
-//	}
-//	return ret;
-//}
-//EXPORT_SYMBOL(__cond_resched_lock);
-//
-///**
-// * yield - yield the current processor to other threads.
-// *
-// * Do not ever use this function, there's a 99% chance you're doing it wrong.
-// *
-// * The scheduler is at all times free to pick the calling task as the most
-// * eligible task to run, if removing the yield() call from your code breaks
-// * it, its already broken.
-// *
-// * Typical broken usage is:
-// *
-// * while (!event)
-// *	yield();
-// *
-// * where one assumes that yield() will let 'the other' process run that will
-// * make event true. If the current task is a SCHED_FIFO task that will never
-// * happen. Never use yield() as a progress guarantee!!
-// *
-// * If you want to use yield() to wait for something, use wait_event().
-// * If you want to use yield() to be 'nice' for others, use cond_resched().
-// * If you still want to use yield(), do not!
-// */
-//void __sched yield(void)
-//{
-//	set_current_state(TASK_RUNNING);
-//	do_sched_yield();
-//}
-//EXPORT_SYMBOL(yield);
-//
-///**
-// * yield_to - yield the current processor to another thread in
-// * your thread group, or accelerate that thread toward the
-// * processor it's on.
-// * @p: target task
-// * @preempt: whether task preemption is allowed or not
-// *
-// * It's the caller's job to ensure that the target task struct
-// * can't go away on us before we can do any checks.
-// *
-// * Return:
-// *	true (>0) if we indeed boosted the target task.
-// *	false (0) if we failed to boost the target.
-// *	-ESRCH if there's no task to yield to.
-// */
-//int __sched yield_to(struct task_struct *p, bool preempt)
-//{
-//	struct task_struct *curr = current;
-//	struct rq *rq, *p_rq;
-//	unsigned long flags;
-//	int yielded = 0;
-//
-//	local_irq_save(flags);
-//	rq = this_rq();
-//
-//again:
-//	p_rq = task_rq(p);
-//	/*
-//	 * If we're the only runnable task on the rq and target rq also
-//	 * has only one task, there's absolutely no point in yielding.
-//	 */
-//	if (rq->nr_running == 1 && p_rq->nr_running == 1) {
-//		yielded = -ESRCH;
-//		goto out_irq;
-//	}
-//
-//	double_rq_lock(rq, p_rq);
-//	if (task_rq(p) != p_rq) {
-//		double_rq_unlock(rq, p_rq);
-//		goto again;
-//	}
-//
-//	if (!curr->sched_class->yield_to_task)
-//		goto out_unlock;
-//
-//	if (curr->sched_class != p->sched_class)
-//		goto out_unlock;
-//
-//	if (task_running(p_rq, p) || p->state)
-//		goto out_unlock;
-//
-//	yielded = curr->sched_class->yield_to_task(rq, p);
-//	if (yielded) {
-//		schedstat_inc(rq->yld_count);
-//		/*
-//		 * Make p's CPU reschedule; pick_next_entity takes care of
-//		 * fairness.
-//		 */
-//		if (preempt && rq != p_rq)
-//			resched_curr(p_rq);
-//	}
-//
-//out_unlock:
-//	double_rq_unlock(rq, p_rq);
-//out_irq:
-//	local_irq_restore(flags);
-//
-//	if (yielded > 0)
-//		schedule();
-//
-//	return yielded;
-//}
-//EXPORT_SYMBOL_GPL(yield_to);
+/*
+ * __cond_resched_lock() - if a reschedule is pending, drop the given lock,
+ * call schedule, and on return reacquire the lock.
+ *
+ * This works OK both with and without CONFIG_PREEMPTION. We do strange low-level
+ * operations here to prevent schedule() from being called twice (once via
+ * spin_unlock(), once by hand).
+ */
+int __cond_resched_lock(spinlock_t *lock)
+{
+	int resched = should_resched(PREEMPT_LOCK_OFFSET);
+	int ret = 0;
+
+	lockdep_assert_held(lock);
+
+	if (spin_needbreak(lock) || resched) {
+		spin_unlock(lock);
+		if (resched)
+			preempt_schedule_common();
+		else
+			cpu_relax();
+		ret = 1;
+		spin_lock(lock);
+	}
+	return ret;
+}
+EXPORT_SYMBOL(__cond_resched_lock);
+
+/**
+ * yield - yield the current processor to other threads.
+ *
+ * Do not ever use this function, there's a 99% chance you're doing it wrong.
+ *
+ * The scheduler is at all times free to pick the calling task as the most
+ * eligible task to run, if removing the yield() call from your code breaks
+ * it, its already broken.
+ *
+ * Typical broken usage is:
+ *
+ * while (!event)
+ *	yield();
+ *
+ * where one assumes that yield() will let 'the other' process run that will
+ * make event true. If the current task is a SCHED_FIFO task that will never
+ * happen. Never use yield() as a progress guarantee!!
+ *
+ * If you want to use yield() to wait for something, use wait_event().
+ * If you want to use yield() to be 'nice' for others, use cond_resched().
+ * If you still want to use yield(), do not!
+ */
+void __sched yield(void)
+{
+	set_current_state(TASK_RUNNING);
+	do_sched_yield();
+}
+EXPORT_SYMBOL(yield);
+
+/**
+ * yield_to - yield the current processor to another thread in
+ * your thread group, or accelerate that thread toward the
+ * processor it's on.
+ * @p: target task
+ * @preempt: whether task preemption is allowed or not
+ *
+ * It's the caller's job to ensure that the target task struct
+ * can't go away on us before we can do any checks.
+ *
+ * Return:
+ *	true (>0) if we indeed boosted the target task.
+ *	false (0) if we failed to boost the target.
+ *	-ESRCH if there's no task to yield to.
+ */
+int __sched yield_to(struct task_struct *p, bool preempt)
+{
+	struct task_struct *curr = current;
+	struct rq *rq, *p_rq;
+	unsigned long flags;
+	int yielded = 0;
+
+	local_irq_save(flags);
+	rq = this_rq();
+
+again:
+	p_rq = task_rq(p);
+	/*
+	 * If we're the only runnable task on the rq and target rq also
+	 * has only one task, there's absolutely no point in yielding.
+	 */
+	if (rq->nr_running == 1 && p_rq->nr_running == 1) {
+		yielded = -ESRCH;
+		goto out_irq;
+	}
+
+	double_rq_lock(rq, p_rq);
+	if (task_rq(p) != p_rq) {
+		double_rq_unlock(rq, p_rq);
+		goto again;
+	}
+
+	if (!curr->sched_class->yield_to_task)
+		goto out_unlock;
+
+	if (curr->sched_class != p->sched_class)
+		goto out_unlock;
+
+	if (task_running(p_rq, p) || p->state)
+		goto out_unlock;
+
+	yielded = curr->sched_class->yield_to_task(rq, p);
+	if (yielded) {
+		schedstat_inc(rq->yld_count);
+		/*
+		 * Make p's CPU reschedule; pick_next_entity takes care of
+		 * fairness.
+		 */
+		if (preempt && rq != p_rq)
+			resched_curr(p_rq);
+	}
+
+out_unlock:
+	double_rq_unlock(rq, p_rq);
+out_irq:
+	local_irq_restore(flags);
+
+	if (yielded > 0)
+		schedule();
+
+	return yielded;
+}
+EXPORT_SYMBOL_GPL(yield_to);
 
 int io_schedule_prepare(void)
 {
@@ -6260,163 +6272,163 @@ int io_schedule_prepare(void)
 	current->in_iowait = 1;
 	blk_schedule_flush_plug(current);
 
-	return old_iowait;
-}
+	return old_iowait;
+}
+
+void io_schedule_finish(int token)
+{
+	current->in_iowait = token;
+}
+
+/*
+ * This task is about to go to sleep on IO. Increment rq->nr_iowait so
+ * that process accounting knows that this is a task in IO wait state.
+ */
+long __sched io_schedule_timeout(long timeout)
+{
+	int token;
+	long ret;
+
+	token = io_schedule_prepare();
+	ret = schedule_timeout(timeout);
+	io_schedule_finish(token);
+
+	return ret;
+}
+
+void __sched io_schedule(void)
+{
+	int token;
+
+	token = io_schedule_prepare();
+	schedule();
+	io_schedule_finish(token);
+}
+
+/**
+ * sys_sched_get_priority_max - return maximum RT priority.
+ * @policy: scheduling class.
+ *
+ * Return: On success, this syscall returns the maximum
+ * rt_priority that can be used by a given scheduling class.
+ * On failure, a negative error code is returned.
+ */
+SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
+{
+	int ret = -EINVAL;
+
+	switch (policy) {
+	case SCHED_FIFO:
+	case SCHED_RR:
+		ret = MAX_USER_RT_PRIO-1;
+		break;
+	case SCHED_DEADLINE:
+	case SCHED_NORMAL:
+	case SCHED_BATCH:
+	case SCHED_IDLE:
+		ret = 0;
+		break;
+	}
+	return ret;
+}
+
+/**
+ * sys_sched_get_priority_min - return minimum RT priority.
+ * @policy: scheduling class.
+ *
+ * Return: On success, this syscall returns the minimum
+ * rt_priority that can be used by a given scheduling class.
+ * On failure, a negative error code is returned.
+ */
+SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
+{
+	int ret = -EINVAL;
+
+	switch (policy) {
+	case SCHED_FIFO:
+	case SCHED_RR:
+		ret = 1;
+		break;
+	case SCHED_DEADLINE:
+	case SCHED_NORMAL:
+	case SCHED_BATCH:
+	case SCHED_IDLE:
+		ret = 0;
+	}
+	return ret;
+}
+
+static int sched_rr_get_interval(pid_t pid, struct timespec64 *t)
+{
+	struct task_struct *p;
+	unsigned int time_slice;
+	struct rq_flags rf;
+	struct rq *rq;
+	int retval;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	retval = -ESRCH;
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	rq = task_rq_lock(p, &rf);
+	time_slice = 0;
+	if (p->sched_class->get_rr_interval)
+		time_slice = p->sched_class->get_rr_interval(rq, p);
+	task_rq_unlock(rq, p, &rf);
+
+	rcu_read_unlock();
+	jiffies_to_timespec64(time_slice, t);
+	return 0;
 
-void io_schedule_finish(int token)
-{
-	current->in_iowait = token;
+out_unlock:
+	rcu_read_unlock();
+	return retval;
 }
 
-/*
- * This task is about to go to sleep on IO. Increment rq->nr_iowait so
- * that process accounting knows that this is a task in IO wait state.
+/**
+ * sys_sched_rr_get_interval - return the default timeslice of a process.
+ * @pid: pid of the process.
+ * @interval: userspace pointer to the timeslice value.
+ *
+ * this syscall writes the default timeslice value of a given process
+ * into the user-space timespec buffer. A value of '0' means infinity.
+ *
+ * Return: On success, 0 and the timeslice is in @interval. Otherwise,
+ * an error code.
  */
-long __sched io_schedule_timeout(long timeout)
+SYSCALL_DEFINE2(sched_rr_get_interval, pid_t, pid,
+		struct __kernel_timespec __user *, interval)
 {
-	int token;
-	long ret;
+	struct timespec64 t;
+	int retval = sched_rr_get_interval(pid, &t);
 
-	token = io_schedule_prepare();
-	ret = schedule_timeout(timeout);
-	io_schedule_finish(token);
+	if (retval == 0)
+		retval = put_timespec64(&t, interval);
 
-	return ret;
+	return retval;
 }
 
-void __sched io_schedule(void)
+#ifdef CONFIG_COMPAT_32BIT_TIME
+SYSCALL_DEFINE2(sched_rr_get_interval_time32, pid_t, pid,
+		struct old_timespec32 __user *, interval)
 {
-	int token;
+	struct timespec64 t;
+	int retval = sched_rr_get_interval(pid, &t);
 
-	token = io_schedule_prepare();
-	schedule();
-	io_schedule_finish(token);
+	if (retval == 0)
+		retval = put_old_timespec32(&t, interval);
+	return retval;
 }
-
-///**
-// * sys_sched_get_priority_max - return maximum RT priority.
-// * @policy: scheduling class.
-// *
-// * Return: On success, this syscall returns the maximum
-// * rt_priority that can be used by a given scheduling class.
-// * On failure, a negative error code is returned.
-// */
-//SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
-//{
-//	int ret = -EINVAL;
-//
-//	switch (policy) {
-//	case SCHED_FIFO:
-//	case SCHED_RR:
-//		ret = MAX_USER_RT_PRIO-1;
-//		break;
-//	case SCHED_DEADLINE:
-//	case SCHED_NORMAL:
-//	case SCHED_BATCH:
-//	case SCHED_IDLE:
-//		ret = 0;
-//		break;
-//	}
-//	return ret;
-//}
-//
-///**
-// * sys_sched_get_priority_min - return minimum RT priority.
-// * @policy: scheduling class.
-// *
-// * Return: On success, this syscall returns the minimum
-// * rt_priority that can be used by a given scheduling class.
-// * On failure, a negative error code is returned.
-// */
-//SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
-//{
-//	int ret = -EINVAL;
-//
-//	switch (policy) {
-//	case SCHED_FIFO:
-//	case SCHED_RR:
-//		ret = 1;
-//		break;
-//	case SCHED_DEADLINE:
-//	case SCHED_NORMAL:
-//	case SCHED_BATCH:
-//	case SCHED_IDLE:
-//		ret = 0;
-//	}
-//	return ret;
-//}
-//
-//static int sched_rr_get_interval(pid_t pid, struct timespec64 *t)
-//{
-//	struct task_struct *p;
-//	unsigned int time_slice;
-//	struct rq_flags rf;
-//	struct rq *rq;
-//	int retval;
-//
-//	if (pid < 0)
-//		return -EINVAL;
-//
-//	retval = -ESRCH;
-//	rcu_read_lock();
-//	p = find_process_by_pid(pid);
-//	if (!p)
-//		goto out_unlock;
-//
-//	retval = security_task_getscheduler(p);
-//	if (retval)
-//		goto out_unlock;
-//
-//	rq = task_rq_lock(p, &rf);
-//	time_slice = 0;
-//	if (p->sched_class->get_rr_interval)
-//		time_slice = p->sched_class->get_rr_interval(rq, p);
-//	task_rq_unlock(rq, p, &rf);
-//
-//	rcu_read_unlock();
-//	jiffies_to_timespec64(time_slice, t);
-//	return 0;
-//
-//out_unlock:
-//	rcu_read_unlock();
-//	return retval;
-//}
-//
-///**
-// * sys_sched_rr_get_interval - return the default timeslice of a process.
-// * @pid: pid of the process.
-// * @interval: userspace pointer to the timeslice value.
-// *
-// * this syscall writes the default timeslice value of a given process
-// * into the user-space timespec buffer. A value of '0' means infinity.
-// *
-// * Return: On success, 0 and the timeslice is in @interval. Otherwise,
-// * an error code.
-// */
-//SYSCALL_DEFINE2(sched_rr_get_interval, pid_t, pid,
-//		struct __kernel_timespec __user *, interval)
-//{
-//	struct timespec64 t;
-//	int retval = sched_rr_get_interval(pid, &t);
-//
-//	if (retval == 0)
-//		retval = put_timespec64(&t, interval);
-//
-//	return retval;
-//}
-//
-//#ifdef CONFIG_COMPAT_32BIT_TIME
-//SYSCALL_DEFINE2(sched_rr_get_interval_time32, pid_t, pid,
-//		struct old_timespec32 __user *, interval)
-//{
-//	struct timespec64 t;
-//	int retval = sched_rr_get_interval(pid, &t);
-//
-//	if (retval == 0)
-//		retval = put_old_timespec32(&t, interval);
-//	return retval;
-//}
-//#endif
+#endif
 
 void sched_show_task(struct task_struct *p)
 {
@@ -6571,423 +6583,427 @@ void init_idle(struct task_struct *idle, int cpu)
 #endif
 }
 
-#ifdef CONFIG_SMP
-//
-//int cpuset_cpumask_can_shrink(const struct cpumask *cur,
-//			      const struct cpumask *trial)
-//{
-//	int ret = 1;
-//
-//	if (!cpumask_weight(cur))
-//		return ret;
-//
-//	ret = dl_cpuset_cpumask_can_shrink(cur, trial);
-//
-//	return ret;
-//}
-//
-//int task_can_attach(struct task_struct *p,
-//		    const struct cpumask *cs_cpus_allowed)
-//{
-//	int ret = 0;
-//
-//	/*
-//	 * Kthreads which disallow setaffinity shouldn't be moved
-//	 * to a new cpuset; we don't want to change their CPU
-//	 * affinity and isolating such threads by their set of
-//	 * allowed nodes is unnecessary.  Thus, cpusets are not
-//	 * applicable for such threads.  This prevents checking for
-//	 * success of set_cpus_allowed_ptr() on all attached tasks
-//	 * before cpus_mask may be changed.
-//	 */
-//	if (p->flags & PF_NO_SETAFFINITY) {
-//		ret = -EINVAL;
-//		goto out;
-//	}
-//
-//	if (dl_task(p) && !cpumask_intersects(task_rq(p)->rd->span,
-//					      cs_cpus_allowed))
-//		ret = dl_task_can_attach(p, cs_cpus_allowed);
-//
-//out:
-//	return ret;
-//}
-//
-//bool sched_smp_initialized __read_mostly;
-//
-//#ifdef CONFIG_NUMA_BALANCING
-///* Migrate current task p to target_cpu */
-//int migrate_task_to(struct task_struct *p, int target_cpu)
-//{
-//	struct migration_arg arg = { p, target_cpu };
-//	int curr_cpu = task_cpu(p);
-//
-//	if (curr_cpu == target_cpu)
-//		return 0;
-//
-//	if (!cpumask_test_cpu(target_cpu, p->cpus_ptr))
-//		return -EINVAL;
-//
-//	/* TODO: This is not properly updating schedstats */
-//
-//	trace_sched_move_numa(p, curr_cpu, target_cpu);
-//	return stop_one_cpu(curr_cpu, migration_cpu_stop, &arg);
-//}
-//
-///*
-// * Requeue a task on a given node and accurately track the number of NUMA
-// * tasks on the runqueues
-// */
-//void sched_setnuma(struct task_struct *p, int nid)
-//{
-//	bool queued, running;
-//	struct rq_flags rf;
-//	struct rq *rq;
-//
-//	rq = task_rq_lock(p, &rf);
-//	queued = task_on_rq_queued(p);
-//	running = task_current(rq, p);
-//
-//	if (queued)
-//		dequeue_task(rq, p, DEQUEUE_SAVE);
-//	if (running)
-//		put_prev_task(rq, p);
-//
-//	p->numa_preferred_nid = nid;
-//
-//	if (queued)
-//		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
-//	if (running)
-//		set_next_task(rq, p);
-//	task_rq_unlock(rq, p, &rf);
-//}
-//#endif /* CONFIG_NUMA_BALANCING */
-//
-//#ifdef CONFIG_HOTPLUG_CPU
-///*
-// * Ensure that the idle task is using init_mm right before its CPU goes
-// * offline.
-// */
-//void idle_task_exit(void)
-//{
-//	struct mm_struct *mm = current->active_mm;
-//
-//	BUG_ON(cpu_online(smp_processor_id()));
-//	BUG_ON(current != this_rq()->idle);
-//
-//	if (mm != &init_mm) {
-//		switch_mm(mm, &init_mm, current);
-//		finish_arch_post_lock_switch();
-//	}
-//
-//	/* finish_cpu(), as ran on the BP, will clean up the active_mm state */
-//}
-//
-///*
-// * Since this CPU is going 'away' for a while, fold any nr_active delta
-// * we might have. Assumes we're called after migrate_tasks() so that the
-// * nr_active count is stable. We need to take the teardown thread which
-// * is calling this into account, so we hand in adjust = 1 to the load
-// * calculation.
-// *
-// * Also see the comment "Global load-average calculations".
-// */
-//static void calc_load_migrate(struct rq *rq)
-//{
-//	long delta = calc_load_fold_active(rq, 1);
-//	if (delta)
-//		atomic_long_add(delta, &calc_load_tasks);
-//}
-//
-//static struct task_struct *__pick_migrate_task(struct rq *rq)
-//{
-//	const struct sched_class *class;
-//	struct task_struct *next;
-//
-//	for_each_class(class) {
-//		next = class->pick_next_task(rq);
-//		if (next) {
-//			next->sched_class->put_prev_task(rq, next);
-//			return next;
-//		}
-//	}
-//
-//	/* The idle class should always have a runnable task */
-//	BUG();
-//}
-//
-///*
-// * Migrate all tasks from the rq, sleeping tasks will be migrated by
-// * try_to_wake_up()->select_task_rq().
-// *
-// * Called with rq->lock held even though we'er in stop_machine() and
-// * there's no concurrency possible, we hold the required locks anyway
-// * because of lock validation efforts.
-// */
-//static void migrate_tasks(struct rq *dead_rq, struct rq_flags *rf)
-//{
-//	struct rq *rq = dead_rq;
-//	struct task_struct *next, *stop = rq->stop;
-//	struct rq_flags orf = *rf;
-//	int dest_cpu;
-//
-//	/*
-//	 * Fudge the rq selection such that the below task selection loop
-//	 * doesn't get stuck on the currently eligible stop task.
-//	 *
-//	 * We're currently inside stop_machine() and the rq is either stuck
-//	 * in the stop_machine_cpu_stop() loop, or we're executing this code,
-//	 * either way we should never end up calling schedule() until we're
-//	 * done here.
-//	 */
-//	rq->stop = NULL;
-//
-//	/*
-//	 * put_prev_task() and pick_next_task() sched
-//	 * class method both need to have an up-to-date
-//	 * value of rq->clock[_task]
-//	 */
-//	update_rq_clock(rq);
-//
-//	for (;;) {
-//		/*
-//		 * There's this thread running, bail when that's the only
-//		 * remaining thread:
-//		 */
-//		if (rq->nr_running == 1)
-//			break;
-//
-//		next = __pick_migrate_task(rq);
-//
-//		/*
-//		 * Rules for changing task_struct::cpus_mask are holding
-//		 * both pi_lock and rq->lock, such that holding either
-//		 * stabilizes the mask.
-//		 *
-//		 * Drop rq->lock is not quite as disastrous as it usually is
-//		 * because !cpu_active at this point, which means load-balance
-//		 * will not interfere. Also, stop-machine.
-//		 */
-//		rq_unlock(rq, rf);
-//		raw_spin_lock(&next->pi_lock);
-//		rq_relock(rq, rf);
-//
-//		/*
-//		 * Since we're inside stop-machine, _nothing_ should have
-//		 * changed the task, WARN if weird stuff happened, because in
-//		 * that case the above rq->lock drop is a fail too.
-//		 */
-//		if (WARN_ON(task_rq(next) != rq || !task_on_rq_queued(next))) {
-//			raw_spin_unlock(&next->pi_lock);
-//			continue;
-//		}
-//
-//		/* Find suitable destination for @next, with force if needed. */
-//		dest_cpu = select_fallback_rq(dead_rq->cpu, next);
-//		rq = __migrate_task(rq, rf, next, dest_cpu);
-//		if (rq != dead_rq) {
-//			rq_unlock(rq, rf);
-//			rq = dead_rq;
-//			*rf = orf;
-//			rq_relock(rq, rf);
-//		}
-//		raw_spin_unlock(&next->pi_lock);
-//	}
-//
-//	rq->stop = stop;
-//}
-//#endif /* CONFIG_HOTPLUG_CPU */
-//
-//void set_rq_online(struct rq *rq)
-//{
-//	if (!rq->online) {
-//		const struct sched_class *class;
-//
-//		cpumask_set_cpu(rq->cpu, rq->rd->online);
-//		rq->online = 1;
-//
-//		for_each_class(class) {
-//			if (class->rq_online)
-//				class->rq_online(rq);
-//		}
-//	}
-//}
-//
-//void set_rq_offline(struct rq *rq)
-//{
-//	if (rq->online) {
-//		const struct sched_class *class;
-//
-//		for_each_class(class) {
-//			if (class->rq_offline)
-//				class->rq_offline(rq);
-//		}
-//
-//		cpumask_clear_cpu(rq->cpu, rq->rd->online);
-//		rq->online = 0;
-//	}
-//}
-//
-///*
-// * used to mark begin/end of suspend/resume:
-// */
-//static int num_cpus_frozen;
-//
-///*
-// * Update cpusets according to cpu_active mask.  If cpusets are
-// * disabled, cpuset_update_active_cpus() becomes a simple wrapper
-// * around partition_sched_domains().
-// *
-// * If we come here as part of a suspend/resume, don't touch cpusets because we
-// * want to restore it back to its original state upon resume anyway.
-// */
-//static void cpuset_cpu_active(void)
-//{
-//	if (cpuhp_tasks_frozen) {
-//		/*
-//		 * num_cpus_frozen tracks how many CPUs are involved in suspend
-//		 * resume sequence. As long as this is not the last online
-//		 * operation in the resume sequence, just build a single sched
-//		 * domain, ignoring cpusets.
-//		 */
-//		partition_sched_domains(1, NULL, NULL);
-//		if (--num_cpus_frozen)
-//			return;
-//		/*
-//		 * This is the last CPU online operation. So fall through and
-//		 * restore the original sched domains by considering the
-//		 * cpuset configurations.
-//		 */
-//		cpuset_force_rebuild();
-//	}
-//	cpuset_update_active_cpus();
-//}
+#ifdef CONFIG_SMP
 //
-//static int cpuset_cpu_inactive(unsigned int cpu)
+//int cpuset_cpumask_can_shrink(const struct cpumask *cur,
+//			      const struct cpumask *trial)
 //{
-//	if (!cpuhp_tasks_frozen) {
-//		if (dl_cpu_busy(cpu))
-//			return -EBUSY;
-//		cpuset_update_active_cpus();
-//	} else {
-//		num_cpus_frozen++;
-//		partition_sched_domains(1, NULL, NULL);
-//	}
-//	return 0;
+//	int ret = 1;
+//
+//	if (!cpumask_weight(cur))
+//		return ret;
+//
+//	ret = dl_cpuset_cpumask_can_shrink(cur, trial);
+//
+//	return ret;
 //}
 //
-//int sched_cpu_activate(unsigned int cpu)
+//int task_can_attach(struct task_struct *p,
+//		    const struct cpumask *cs_cpus_allowed)
 //{
-//	struct rq *rq = cpu_rq(cpu);
-//	struct rq_flags rf;
+//	int ret = 0;
 //
-//#ifdef CONFIG_SCHED_SMT
 //	/*
-//	 * When going up, increment the number of cores with SMT present.
+//	 * Kthreads which disallow setaffinity shouldn't be moved
+//	 * to a new cpuset; we don't want to change their CPU
+//	 * affinity and isolating such threads by their set of
+//	 * allowed nodes is unnecessary.  Thus, cpusets are not
+//	 * applicable for such threads.  This prevents checking for
+//	 * success of set_cpus_allowed_ptr() on all attached tasks
+//	 * before cpus_mask may be changed.
 //	 */
-//	if (cpumask_weight(cpu_smt_mask(cpu)) == 2)
-//		static_branch_inc_cpuslocked(&sched_smt_present);
-//#endif
-//	set_cpu_active(cpu, true);
-//
-//	if (sched_smp_initialized) {
-//		sched_domains_numa_masks_set(cpu);
-//		cpuset_cpu_active();
+//	if (p->flags & PF_NO_SETAFFINITY) {
+//		ret = -EINVAL;
+//		goto out;
 //	}
 //
-//	/*
-//	 * Put the rq online, if not already. This happens:
-//	 *
-//	 * 1) In the early boot process, because we build the real domains
-//	 *    after all CPUs have been brought up.
-//	 *
-//	 * 2) At runtime, if cpuset_cpu_active() fails to rebuild the
-//	 *    domains.
-//	 */
-//	rq_lock_irqsave(rq, &rf);
-//	if (rq->rd) {
-//		BUG_ON(!cpumask_test_cpu(cpu, rq->rd->span));
-//		set_rq_online(rq);
-//	}
-//	rq_unlock_irqrestore(rq, &rf);
+//	if (dl_task(p) && !cpumask_intersects(task_rq(p)->rd->span,
+//					      cs_cpus_allowed))
+//		ret = dl_task_can_attach(p, cs_cpus_allowed);
 //
-//	return 0;
+//out:
+//	return ret;
 //}
 //
-//int sched_cpu_deactivate(unsigned int cpu)
-//{
-//	int ret;
-//
-//	set_cpu_active(cpu, false);
-//	/*
-//	 * We've cleared cpu_active_mask, wait for all preempt-disabled and RCU
-//	 * users of this state to go away such that all new such users will
-//	 * observe it.
-//	 *
-//	 * Do sync before park smpboot threads to take care the rcu boost case.
-//	 */
-//	synchronize_rcu();
+//bool sched_smp_initialized __read_mostly;
 //
-//#ifdef CONFIG_SCHED_SMT
-//	/*
-//	 * When going down, decrement the number of cores with SMT present.
-//	 */
-//	if (cpumask_weight(cpu_smt_mask(cpu)) == 2)
-//		static_branch_dec_cpuslocked(&sched_smt_present);
-//#endif
+//#ifdef CONFIG_NUMA_BALANCING
+///* Migrate current task p to target_cpu */
+//int migrate_task_to(struct task_struct *p, int target_cpu)
+//{
+//	struct migration_arg arg = { p, target_cpu };
+//	int curr_cpu = task_cpu(p);
 //
-//	if (!sched_smp_initialized)
+//	if (curr_cpu == target_cpu)
 //		return 0;
 //
-//	ret = cpuset_cpu_inactive(cpu);
-//	if (ret) {
-//		set_cpu_active(cpu, true);
-//		return ret;
-//	}
-//	sched_domains_numa_masks_clear(cpu);
-//	return 0;
-//}
-//
-//static void sched_rq_cpu_starting(unsigned int cpu)
-//{
-//	struct rq *rq = cpu_rq(cpu);
+//	if (!cpumask_test_cpu(target_cpu, p->cpus_ptr))
+//		return -EINVAL;
 //
-//	rq->calc_load_update = calc_load_update;
-//	update_max_interval();
-//}
+//	/* TODO: This is not properly updating schedstats */
 //
-//int sched_cpu_starting(unsigned int cpu)
-//{
-//	sched_rq_cpu_starting(cpu);
-//	sched_tick_start(cpu);
-//	return 0;
+//	trace_sched_move_numa(p, curr_cpu, target_cpu);
+//	return stop_one_cpu(curr_cpu, migration_cpu_stop, &arg);
 //}
 //
-//#ifdef CONFIG_HOTPLUG_CPU
-//int sched_cpu_dying(unsigned int cpu)
+///*
+// * Requeue a task on a given node and accurately track the number of NUMA
+// * tasks on the runqueues
+// */
+//void sched_setnuma(struct task_struct *p, int nid)
 //{
-//	struct rq *rq = cpu_rq(cpu);
+//	bool queued, running;
 //	struct rq_flags rf;
+//	struct rq *rq;
+//
+//	rq = task_rq_lock(p, &rf);
+//	queued = task_on_rq_queued(p);
+//	running = task_current(rq, p);
 //
-//	/* Handle pending wakeups and then migrate everything off */
-//	sched_tick_stop(cpu);
+//	if (queued)
+//		dequeue_task(rq, p, DEQUEUE_SAVE);
+//	if (running)
+//		put_prev_task(rq, p);
 //
-//	rq_lock_irqsave(rq, &rf);
-//	if (rq->rd) {
-//		BUG_ON(!cpumask_test_cpu(cpu, rq->rd->span));
-//		set_rq_offline(rq);
-//	}
-//	migrate_tasks(rq, &rf);
-//	BUG_ON(rq->nr_running != 1);
-//	rq_unlock_irqrestore(rq, &rf);
-//
-//	calc_load_migrate(rq);
-//	update_max_interval();
-//	nohz_balance_exit_idle(rq);
-//	hrtick_clear(rq);
-//	return 0;
+//	p->numa_preferred_nid = nid;
+//
+//	if (queued)
+//		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_NOCLOCK);
+//	if (running)
+//		set_next_task(rq, p);
+//	task_rq_unlock(rq, p, &rf);
 //}
-//#endif
+//#endif /* CONFIG_NUMA_BALANCING */
+//
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+ * Ensure that the idle task is using init_mm right before its CPU goes
+ * offline.
+ */
+void idle_task_exit(void)
+{
+	struct mm_struct *mm = current->active_mm;
+
+	BUG_ON(cpu_online(smp_processor_id()));
+	BUG_ON(current != this_rq()->idle);
+
+	if (mm != &init_mm) {
+		switch_mm(mm, &init_mm, current);
+		finish_arch_post_lock_switch();
+	}
+
+	/* finish_cpu(), as ran on the BP, will clean up the active_mm state */
+}
+
+/*
+ * Since this CPU is going 'away' for a while, fold any nr_active delta
+ * we might have. Assumes we're called after migrate_tasks() so that the
+ * nr_active count is stable. We need to take the teardown thread which
+ * is calling this into account, so we hand in adjust = 1 to the load
+ * calculation.
+ *
+ * Also see the comment "Global load-average calculations".
+ */
+static void calc_load_migrate(struct rq *rq)
+{
+	long delta = calc_load_fold_active(rq, 1);
+	if (delta)
+		atomic_long_add(delta, &calc_load_tasks);
+}
+
+static struct task_struct *__pick_migrate_task(struct rq *rq)
+{
+	const struct sched_class *class;
+	struct task_struct *next;
+
+	for_each_class(class) {
+		next = class->pick_next_task(rq);
+		if (next) {
+			next->sched_class->put_prev_task(rq, next);
+			return next;
+		}
+	}
+
+	/* The idle class should always have a runnable task */
+	BUG();
+}
+
+/*
+ * Migrate all tasks from the rq, sleeping tasks will be migrated by
+ * try_to_wake_up()->select_task_rq().
+ *
+ * Called with rq->lock held even though we'er in stop_machine() and
+ * there's no concurrency possible, we hold the required locks anyway
+ * because of lock validation efforts.
+ */
+static void migrate_tasks(struct rq *dead_rq, struct rq_flags *rf)
+{
+	struct rq *rq = dead_rq;
+	struct task_struct *next, *stop = rq->stop;
+	struct rq_flags orf = *rf;
+	int dest_cpu;
+
+	/*
+	 * Fudge the rq selection such that the below task selection loop
+	 * doesn't get stuck on the currently eligible stop task.
+	 *
+	 * We're currently inside stop_machine() and the rq is either stuck
+	 * in the stop_machine_cpu_stop() loop, or we're executing this code,
+	 * either way we should never end up calling schedule() until we're
+	 * done here.
+	 */
+	rq->stop = NULL;
+
+	/*
+	 * put_prev_task() and pick_next_task() sched
+	 * class method both need to have an up-to-date
+	 * value of rq->clock[_task]
+	 */
+	update_rq_clock(rq);
+
+	for (;;) {
+		/*
+		 * There's this thread running, bail when that's the only
+		 * remaining thread:
+		 */
+		if (rq->nr_running == 1)
+			break;
+
+		next = __pick_migrate_task(rq);
+
+		/*
+		 * Rules for changing task_struct::cpus_mask are holding
+		 * both pi_lock and rq->lock, such that holding either
+		 * stabilizes the mask.
+		 *
+		 * Drop rq->lock is not quite as disastrous as it usually is
+		 * because !cpu_active at this point, which means load-balance
+		 * will not interfere. Also, stop-machine.
+		 */
+		rq_unlock(rq, rf);
+		raw_spin_lock(&next->pi_lock);
+		rq_relock(rq, rf);
+
+		/*
+		 * Since we're inside stop-machine, _nothing_ should have
+		 * changed the task, WARN if weird stuff happened, because in
+		 * that case the above rq->lock drop is a fail too.
+		 */
+		if (WARN_ON(task_rq(next) != rq || !task_on_rq_queued(next))) {
+			raw_spin_unlock(&next->pi_lock);
+			continue;
+		}
+
+		/* Find suitable destination for @next, with force if needed. */
+		dest_cpu = select_fallback_rq(dead_rq->cpu, next);
+		rq = __migrate_task(rq, rf, next, dest_cpu);
+		if (rq != dead_rq) {
+			rq_unlock(rq, rf);
+			rq = dead_rq;
+			*rf = orf;
+			rq_relock(rq, rf);
+		}
+		raw_spin_unlock(&next->pi_lock);
+	}
+
+	rq->stop = stop;
+}
+#endif /* CONFIG_HOTPLUG_CPU */
+
+void set_rq_online(struct rq *rq)
+{
+	if (!rq->online) {
+		const struct sched_class *class;
+
+		cpumask_set_cpu(rq->cpu, rq->rd->online);
+		rq->online = 1;
+
+		for_each_class(class) {
+			if (class->rq_online)
+				class->rq_online(rq);
+		}
+	}
+}
+
+void set_rq_offline(struct rq *rq)
+{
+	if (rq->online) {
+		const struct sched_class *class;
+
+		for_each_class(class) {
+			if (class->rq_offline)
+				class->rq_offline(rq);
+		}
+
+		cpumask_clear_cpu(rq->cpu, rq->rd->online);
+		rq->online = 0;
+	}
+}
+
+/*
+ * used to mark begin/end of suspend/resume:
+ */
+static int num_cpus_frozen;
+
+/*
+ * Update cpusets according to cpu_active mask.  If cpusets are
+ * disabled, cpuset_update_active_cpus() becomes a simple wrapper
+ * around partition_sched_domains().
+ *
+ * If we come here as part of a suspend/resume, don't touch cpusets because we
+ * want to restore it back to its original state upon resume anyway.
+ */
+static void cpuset_cpu_active(void)
+{
+	if (cpuhp_tasks_frozen) {
+		/*
+		 * num_cpus_frozen tracks how many CPUs are involved in suspend
+		 * resume sequence. As long as this is not the last online
+		 * operation in the resume sequence, just build a single sched
+		 * domain, ignoring cpusets.
+		 */
+		partition_sched_domains(1, NULL, NULL);
+		if (--num_cpus_frozen)
+			return;
+		/*
+		 * This is the last CPU online operation. So fall through and
+		 * restore the original sched domains by considering the
+		 * cpuset configurations.
+		 */
+		cpuset_force_rebuild();
+	}
+	cpuset_update_active_cpus();
+}
+
+static int cpuset_cpu_inactive(unsigned int cpu)
+{
+	if (!cpuhp_tasks_frozen) {
+		if (dl_cpu_busy(cpu))
+			return -EBUSY;
+		cpuset_update_active_cpus();
+	} else {
+		num_cpus_frozen++;
+		partition_sched_domains(1, NULL, NULL);
+	}
+	return 0;
+}
+
+int sched_cpu_activate(unsigned int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct rq_flags rf;
+
+#ifdef CONFIG_SCHED_SMT
+	/*
+	 * When going up, increment the number of cores with SMT present.
+	 */
+	if (cpumask_weight(cpu_smt_mask(cpu)) == 2)
+		static_branch_inc_cpuslocked(&sched_smt_present);
+#endif
+	set_cpu_active(cpu, true);
+
+	if (sched_smp_initialized) {
+		sched_domains_numa_masks_set(cpu);
+		cpuset_cpu_active();
+	}
+
+	/*
+	 * Put the rq online, if not already. This happens:
+	 *
+	 * 1) In the early boot process, because we build the real domains
+	 *    after all CPUs have been brought up.
+	 *
+	 * 2) At runtime, if cpuset_cpu_active() fails to rebuild the
+	 *    domains.
+	 */
+	rq_lock_irqsave(rq, &rf);
+	if (rq->rd) {
+		BUG_ON(!cpumask_test_cpu(cpu, rq->rd->span));
+		set_rq_online(rq);
+	}
+	rq_unlock_irqrestore(rq, &rf);
+
+	return 0;
+}
+EXPORT_SYMBOL(sched_cpu_activate);
+
+int sched_cpu_deactivate(unsigned int cpu)
+{
+	int ret;
+
+	set_cpu_active(cpu, false);
+	/*
+	 * We've cleared cpu_active_mask, wait for all preempt-disabled and RCU
+	 * users of this state to go away such that all new such users will
+	 * observe it.
+	 *
+	 * Do sync before park smpboot threads to take care the rcu boost case.
+	 */
+	synchronize_rcu();
+
+#ifdef CONFIG_SCHED_SMT
+	/*
+	 * When going down, decrement the number of cores with SMT present.
+	 */
+	if (cpumask_weight(cpu_smt_mask(cpu)) == 2)
+		static_branch_dec_cpuslocked(&sched_smt_present);
+#endif
+
+	if (!sched_smp_initialized)
+		return 0;
+
+	ret = cpuset_cpu_inactive(cpu);
+	if (ret) {
+		set_cpu_active(cpu, true);
+		return ret;
+	}
+	sched_domains_numa_masks_clear(cpu);
+	return 0;
+}
+EXPORT_SYMBOL(sched_cpu_deactivate);
+
+static void sched_rq_cpu_starting(unsigned int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	rq->calc_load_update = calc_load_update;
+	update_max_interval();
+}
+
+int sched_cpu_starting(unsigned int cpu)
+{
+	sched_rq_cpu_starting(cpu);
+	sched_tick_start(cpu);
+	return 0;
+}
+EXPORT_SYMBOL(sched_cpu_starting);
+
+#ifdef CONFIG_HOTPLUG_CPU
+int sched_cpu_dying(unsigned int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct rq_flags rf;
+
+	/* Handle pending wakeups and then migrate everything off */
+	sched_tick_stop(cpu);
+
+	rq_lock_irqsave(rq, &rf);
+	if (rq->rd) {
+		BUG_ON(!cpumask_test_cpu(cpu, rq->rd->span));
+		set_rq_offline(rq);
+	}
+	migrate_tasks(rq, &rf);
+	BUG_ON(rq->nr_running != 1);
+	rq_unlock_irqrestore(rq, &rf);
+
+	calc_load_migrate(rq);
+	update_max_interval();
+	nohz_balance_exit_idle(rq);
+	hrtick_clear(rq);
+	return 0;
+}
+EXPORT_SYMBOL(sched_cpu_dying);
+#endif
 
 void __init sched_init_smp(void)
 {
@@ -7012,13 +7028,14 @@ void __init sched_init_smp(void)
 
 	sched_smp_initialized = true;
 }
+EXPORT_SYMBOL(sched_init_smp);
 
-//static int __init migration_init(void)
-//{
-//	sched_cpu_starting(smp_processor_id());
-//	return 0;
-//}
-//early_initcall(migration_init);
+static int __init migration_init(void)
+{
+	sched_cpu_starting(smp_processor_id());
+	return 0;
+}
+early_initcall(migration_init);
 //
 #else
 void __init sched_init_smp(void)
@@ -7047,8 +7064,8 @@ EXPORT_SYMBOL(sched_init_smp);
 static struct kmem_cache *task_group_cache __read_mostly;
 #endif
 //
-//DECLARE_PER_CPU(cpumask_var_t, load_balance_mask);
-//DECLARE_PER_CPU(cpumask_var_t, select_idle_mask);
+DECLARE_PER_CPU(cpumask_var_t, load_balance_mask);
+DECLARE_PER_CPU(cpumask_var_t, select_idle_mask);
 
 void __init sched_init(void)
 {
@@ -8425,11 +8442,12 @@ const u64 max_cfs_quota_period = 1 * NSEC_PER_SEC; /* 1s */
 //
 //#endif	/* CONFIG_CGROUP_SCHED */
 //
-//void dump_cpu_task(int cpu)
-//{
-//	pr_info("Task dump for CPU %d:\n", cpu);
-//	sched_show_task(cpu_curr(cpu));
-//}
+void dump_cpu_task(int cpu)
+{
+	pr_info("Task dump for CPU %d:\n", cpu);
+	sched_show_task(cpu_curr(cpu));
+}
+EXPORT_SYMBOL(dump_cpu_task);
 
 /*
  * Nice levels are multiplicative, with a gentle 10% change for every
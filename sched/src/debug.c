@@ -610,6 +610,45 @@ void print_dl_rq(struct seq_file *m, int cpu, struct dl_rq *dl_rq)
 #undef PU
 }
 
+#if defined(CONFIG_SMP) && defined(CONFIG_SCHEDSTATS)
+/*
+ * Per-domain migration counters for @cpu: balance passes run from this
+ * rq (newidle pulls broken out), tasks pushed by active balancing, and
+ * wakeups that were pulled over here by wake_affine().
+ */
+static void print_domain_stats(struct seq_file *m, int cpu)
+{
+	struct sched_domain *sd;
+	enum cpu_idle_type itype;
+
+	rcu_read_lock();
+	for_each_domain(cpu, sd) {
+		unsigned int lb_count = 0, lb_gained = 0, lb_failed = 0;
+
+		for (itype = CPU_IDLE; itype < CPU_MAX_IDLE_TYPES; itype++) {
+			lb_count += sd->lb_count[itype];
+			lb_gained += sd->lb_gained[itype];
+			lb_failed += sd->lb_failed[itype];
+		}
+
+		SEQ_printf(m, "  domain%d %s\n", sd->level, sd->name);
+#define P(n) SEQ_printf(m, "    .%-28s: %u\n", #n, n)
+#define PSD(n) SEQ_printf(m, "    .%-28s: %u\n", #n, sd->n)
+		P(lb_count);
+		P(lb_gained);
+		P(lb_failed);
+		PSD(lb_count[CPU_NEWLY_IDLE]);
+		PSD(lb_gained[CPU_NEWLY_IDLE]);
+		PSD(alb_pushed);
+		PSD(ttwu_wake_remote);
+		PSD(ttwu_move_affine);
+#undef PSD
+#undef P
+	}
+	rcu_read_unlock();
+}
+#endif
+
 static void print_cpu(struct seq_file *m, int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -661,6 +700,9 @@ do {									\
 		P(sched_goidle);
 		P(ttwu_count);
 		P(ttwu_local);
+#if defined(CONFIG_SMP) && defined(CONFIG_SCHEDSTATS)
+		print_domain_stats(m, cpu);
+#endif
 	}
 #undef P
 
@@ -10289,6 +10289,7 @@ out:
 	 */
 	WRITE_ONCE(nohz.has_blocked, 1);
 }
+EXPORT_SYMBOL(nohz_balance_enter_idle);
 
 /*
  * Internal function that runs load balance for all idle cpus. The load balance
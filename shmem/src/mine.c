@@ -3,5 +3,3 @@
 
 CL_MINE(d_rehash)
 CL_MINE(swap_shmem_alloc)
-CL_MINE(user_shm_lock)
-CL_MINE(user_shm_unlock)
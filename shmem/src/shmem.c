@@ -258,6 +258,7 @@ bool vma_is_shmem(struct vm_area_struct *vma)
 {
 	return vma->vm_ops == &shmem_vm_ops;
 }
+EXPORT_SYMBOL(vma_is_shmem);
 
 static LIST_HEAD(shmem_swaplist);
 static DEFINE_MUTEX(shmem_swaplist_mutex);
@@ -407,6 +408,7 @@ void shmem_uncharge(struct inode *inode, long pages)
 
 	shmem_inode_unacct_blocks(inode, pages);
 }
+EXPORT_SYMBOL(shmem_uncharge);
 
 /*
  * Replace item expected in xarray by a new item, while holding xa_lock.
@@ -4067,6 +4069,7 @@ static ssize_t shmem_enabled_store(struct kobject *kobj,
 
 struct kobj_attribute shmem_enabled_attr =
 	__ATTR(shmem_enabled, 0644, shmem_enabled_show, shmem_enabled_store);
+EXPORT_SYMBOL(shmem_enabled_attr);
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE && CONFIG_SYSFS */
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
@@ -4104,6 +4107,7 @@ bool shmem_huge_enabled(struct vm_area_struct *vma)
 			return false;
 	}
 }
+EXPORT_SYMBOL(shmem_huge_enabled);
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
 #else /* !CONFIG_SHMEM */
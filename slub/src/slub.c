@@ -2094,6 +2094,16 @@ static inline unsigned long next_tid(unsigned long tid)
 	return tid + TID_STEP;
 }
 
+/*
+ * The fastpaths swap the per cpu freelist and tid as a pair. Since the
+ * tid only ever moves forward an architecture may be able to do that
+ * without disabling interrupts; otherwise use the full cmpxchg_double.
+ */
+#ifndef this_cpu_cmpxchg_double_tid
+#define this_cpu_cmpxchg_double_tid(pcp, tid, oval, otid, nval, ntid)	\
+	this_cpu_cmpxchg_double(pcp, tid, oval, otid, nval, ntid)
+#endif
+
 //#ifdef SLUB_DEBUG_CMPXCHG
 //static inline unsigned int tid_to_cpu(unsigned long tid)
 //{
@@ -2868,7 +2878,7 @@ redo:
 		 * against code executing on this cpu *not* from access by
 		 * other cpus.
 		 */
-		if (unlikely(!this_cpu_cmpxchg_double(
+		if (unlikely(!this_cpu_cmpxchg_double_tid(
 				s->cpu_slab->freelist, s->cpu_slab->tid,
 				object, tid,
 				next_object, next_tid(tid)))) {
@@ -3112,7 +3122,7 @@ redo:
 
 		set_freepointer(s, tail_obj, freelist);
 
-		if (unlikely(!this_cpu_cmpxchg_double(
+		if (unlikely(!this_cpu_cmpxchg_double_tid(
 				s->cpu_slab->freelist, s->cpu_slab->tid,
 				freelist, tid,
 				head, next_tid(tid)))) {
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * SMP initialisation and IPI support
+ * Based on arch/arm64/kernel/smp.c
+ *
+ * Copyright (C) 2012 ARM Ltd.
+ * Copyright (C) 2015 Regents of the University of California
+ * Copyright (C) 2017 SiFive
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/kernel_stat.h>
+#include <linux/notifier.h>
+#include <linux/cpu.h>
+#include <linux/percpu.h>
+#include <linux/delay.h>
+#include <linux/err.h>
+#include <linux/irq.h>
+#include <linux/of.h>
+#include <linux/sched/task_stack.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/topology.h>
+#include <asm/cpu_ops.h>
+#include <asm/irq.h>
+#include <asm/mmu_context.h>
+#include <asm/tlbflush.h>
+#include <asm/sections.h>
+#include <asm/sbi.h>
+#include <asm/smp.h>
+
+static DECLARE_COMPLETION(cpu_running);
+
+/*
+ * There is no GENERIC_ARCH_TOPOLOGY in this tree.  QEMU virt harts share
+ * one memory system with no modelled cache hierarchy, so describe them as
+ * a single cache-sharing level.  That gives every hart an sd_llc covering
+ * all of them, which is what select_idle_sibling() and wake_affine() key
+ * off; the default DIE-only table leaves sd_llc NULL.
+ */
+static int riscv_flat_flags(void)
+{
+	return SD_SHARE_PKG_RESOURCES;
+}
+
+static struct sched_domain_topology_level riscv_flat_topology[] = {
+	{ cpu_cpu_mask, riscv_flat_flags, SD_INIT_NAME(MC) },
+	{ NULL, },
+};
+
+void __init smp_prepare_boot_cpu(void)
+{
+}
+EXPORT_SYMBOL(smp_prepare_boot_cpu);
+
+void __init smp_prepare_cpus(unsigned int max_cpus)
+{
+	int cpuid;
+	int ret;
+
+	set_sched_topology(riscv_flat_topology);
+
+	/* This covers non-smp usecase mandated by "nosmp" option */
+	if (max_cpus == 0)
+		return;
+
+	for_each_possible_cpu(cpuid) {
+		if (cpuid == smp_processor_id())
+			continue;
+		if (cpu_ops[cpuid]->cpu_prepare) {
+			ret = cpu_ops[cpuid]->cpu_prepare(cpuid);
+			if (ret)
+				continue;
+		}
+		set_cpu_present(cpuid, true);
+	}
+}
+EXPORT_SYMBOL(smp_prepare_cpus);
+
+void __init setup_smp(void)
+{
+	struct device_node *dn;
+	int hart;
+	bool found_boot_cpu = false;
+	int cpuid = 1;
+
+	cpu_set_ops(0);
+
+	for_each_of_cpu_node(dn) {
+		hart = riscv_of_processor_hartid(dn);
+		if (hart < 0)
+			continue;
+
+		if (hart == cpuid_to_hartid_map(0)) {
+			BUG_ON(found_boot_cpu);
+			found_boot_cpu = 1;
+			continue;
+		}
+		if (cpuid >= NR_CPUS) {
+			pr_warn("Invalid cpuid [%d] for hartid [%d]\n",
+				cpuid, hart);
+			break;
+		}
+
+		cpuid_to_hartid_map(cpuid) = hart;
+		cpuid++;
+	}
+
+	BUG_ON(!found_boot_cpu);
+
+	if (cpuid > nr_cpu_ids)
+		pr_warn("Total number of cpus [%d] is greater than nr_cpus option value [%d]\n",
+			cpuid, nr_cpu_ids);
+
+	for (cpuid = 1; cpuid < nr_cpu_ids; cpuid++) {
+		if (cpuid_to_hartid_map(cpuid) != INVALID_HARTID) {
+			cpu_set_ops(cpuid);
+			set_cpu_possible(cpuid, true);
+		}
+	}
+}
+EXPORT_SYMBOL(setup_smp);
+
+static int start_secondary_cpu(int cpu, struct task_struct *tidle)
+{
+	if (cpu_ops[cpu]->cpu_start)
+		return cpu_ops[cpu]->cpu_start(cpu, tidle);
+
+	return -EOPNOTSUPP;
+}
+
+int __cpu_up(unsigned int cpu, struct task_struct *tidle)
+{
+	int ret = 0;
+	tidle->thread_info.cpu = cpu;
+
+	ret = start_secondary_cpu(cpu, tidle);
+	if (!ret) {
+		wait_for_completion_timeout(&cpu_running,
+					    msecs_to_jiffies(1000));
+
+		if (!cpu_online(cpu)) {
+			pr_crit("CPU%u: failed to come online\n", cpu);
+			ret = -EIO;
+		}
+	} else {
+		pr_crit("CPU%u: failed to start\n", cpu);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(__cpu_up);
+
+void __init smp_cpus_done(unsigned int max_cpus)
+{
+}
+
+/*
+ * C entry point for a secondary processor.
+ */
+asmlinkage __visible void smp_callin(void)
+{
+	struct mm_struct *mm = &init_mm;
+	unsigned int curr_cpuid = smp_processor_id();
+
+	riscv_clear_ipi();
+
+	/* All kernel threads share the same mm context.  */
+	mmgrab(mm);
+	current->active_mm = mm;
+
+	/*
+	 * Runs the STARTING hotplug callbacks on this hart, which is where
+	 * timer_riscv arms its per-hart clockevent and enables STIE.
+	 */
+	notify_cpu_starting(curr_cpuid);
+	set_cpu_online(curr_cpuid, 1);
+
+	/*
+	 * Remote TLB flushes are ignored while the CPU is offline, so emit
+	 * a local TLB flush right now just in case.
+	 */
+	local_flush_tlb_all();
+	complete(&cpu_running);
+	/*
+	 * Disable preemption before enabling interrupts, so we don't try to
+	 * schedule a CPU that hasn't actually started yet.
+	 */
+	preempt_disable();
+	local_irq_enable();
+	cpu_startup_entry(CPUHP_AP_ONLINE_IDLE);
+}
+EXPORT_SYMBOL(smp_callin);
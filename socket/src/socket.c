@@ -1780,6 +1780,7 @@ out_fd:
 	goto out;
 
 }
+EXPORT_SYMBOL(__sys_accept4_file);
 
 /*
  *	For accept, we attempt to create a new socket, set up the link
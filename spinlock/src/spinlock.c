@@ -22,6 +22,8 @@
 #include <linux/debug_locks.h>
 #include <linux/export.h>
 
+#include "spinlock_stat.h"
+
 #ifdef CONFIG_MMIOWB
 #ifndef arch_mmiowb_state
 DEFINE_PER_CPU(struct mmiowb_state, __mmiowb_state);
@@ -132,6 +134,7 @@ BUILD_LOCK_OPS(write, rwlock);
 #ifndef CONFIG_INLINE_SPIN_TRYLOCK
 int __lockfunc _raw_spin_trylock(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	return __raw_spin_trylock(lock);
 }
 EXPORT_SYMBOL(_raw_spin_trylock);
@@ -140,6 +143,7 @@ EXPORT_SYMBOL(_raw_spin_trylock);
 #ifndef CONFIG_INLINE_SPIN_TRYLOCK_BH
 int __lockfunc _raw_spin_trylock_bh(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	return __raw_spin_trylock_bh(lock);
 }
 EXPORT_SYMBOL(_raw_spin_trylock_bh);
@@ -148,6 +152,7 @@ EXPORT_SYMBOL(_raw_spin_trylock_bh);
 #ifndef CONFIG_INLINE_SPIN_LOCK
 void __lockfunc _raw_spin_lock(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	__raw_spin_lock(lock);
 }
 EXPORT_SYMBOL(_raw_spin_lock);
@@ -156,6 +161,7 @@ EXPORT_SYMBOL(_raw_spin_lock);
 #ifndef CONFIG_INLINE_SPIN_LOCK_IRQSAVE
 unsigned long __lockfunc _raw_spin_lock_irqsave(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	return __raw_spin_lock_irqsave(lock);
 }
 EXPORT_SYMBOL(_raw_spin_lock_irqsave);
@@ -164,6 +170,7 @@ EXPORT_SYMBOL(_raw_spin_lock_irqsave);
 #ifndef CONFIG_INLINE_SPIN_LOCK_IRQ
 void __lockfunc _raw_spin_lock_irq(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	__raw_spin_lock_irq(lock);
 }
 EXPORT_SYMBOL(_raw_spin_lock_irq);
@@ -172,6 +179,7 @@ EXPORT_SYMBOL(_raw_spin_lock_irq);
 #ifndef CONFIG_INLINE_SPIN_LOCK_BH
 void __lockfunc _raw_spin_lock_bh(raw_spinlock_t *lock)
 {
+	spin_stat_site(lock, _RET_IP_);
 	__raw_spin_lock_bh(lock);
 }
 EXPORT_SYMBOL(_raw_spin_lock_bh);
@@ -358,6 +366,7 @@ EXPORT_SYMBOL(_raw_write_unlock_bh);
 void __lockfunc _raw_spin_lock_nested(raw_spinlock_t *lock, int subclass)
 {
 	preempt_disable();
+	spin_stat_site(lock, _RET_IP_);
 	spin_acquire(&lock->dep_map, subclass, 0, _RET_IP_);
 	LOCK_CONTENDED(lock, do_raw_spin_trylock, do_raw_spin_lock);
 }
@@ -370,6 +379,7 @@ unsigned long __lockfunc _raw_spin_lock_irqsave_nested(raw_spinlock_t *lock,
 
 	local_irq_save(flags);
 	preempt_disable();
+	spin_stat_site(lock, _RET_IP_);
 	spin_acquire(&lock->dep_map, subclass, 0, _RET_IP_);
 	LOCK_CONTENDED_FLAGS(lock, do_raw_spin_trylock, do_raw_spin_lock,
 				do_raw_spin_lock_flags, &flags);
@@ -381,6 +391,7 @@ void __lockfunc _raw_spin_lock_nest_lock(raw_spinlock_t *lock,
 				     struct lockdep_map *nest_lock)
 {
 	preempt_disable();
+	spin_stat_site(lock, _RET_IP_);
 	spin_acquire_nest(&lock->dep_map, 0, 0, nest_lock, _RET_IP_);
 	LOCK_CONTENDED(lock, do_raw_spin_trylock, do_raw_spin_lock);
 }
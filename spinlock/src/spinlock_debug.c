@@ -12,7 +12,9 @@
 #include <linux/debug_locks.h>
 #include <linux/delay.h>
 #include <linux/export.h>
+#include <linux/sched/clock.h>
 #include "../../booter/src/booter.h"
+#include "spinlock_stat.h"
 
 void __raw_spin_lock_init(raw_spinlock_t *lock, const char *name,
 			  struct lock_class_key *key, short inner)
@@ -28,6 +30,7 @@ void __raw_spin_lock_init(raw_spinlock_t *lock, const char *name,
 	lock->magic = SPINLOCK_MAGIC;
 	lock->owner = SPINLOCK_OWNER_INIT;
 	lock->owner_cpu = -1;
+	spin_stat_init(lock, name, key);
 }
 
 EXPORT_SYMBOL(__raw_spin_lock_init);
@@ -116,7 +119,22 @@ static inline void debug_spin_unlock(raw_spinlock_t *lock)
 void do_raw_spin_lock(raw_spinlock_t *lock)
 {
 	debug_spin_lock_before(lock);
+#ifdef CONFIG_DEBUG_SPINLOCK_STAT
+	/*
+	 * Only a failed trylock counts as contention; the wait is timed
+	 * from there until we own the lock.
+	 */
+	if (!arch_spin_trylock(&lock->raw_lock)) {
+		u64 start = local_clock();
+
+		arch_spin_lock(&lock->raw_lock);
+		spin_stat_acquired(lock, true, local_clock() - start);
+	} else {
+		spin_stat_acquired(lock, false, 0);
+	}
+#else
 	arch_spin_lock(&lock->raw_lock);
+#endif
 	mmiowb_spin_lock();
 	debug_spin_lock_after(lock);
 }
@@ -126,6 +144,7 @@ int do_raw_spin_trylock(raw_spinlock_t *lock)
 	int ret = arch_spin_trylock(&lock->raw_lock);
 
 	if (ret) {
+		spin_stat_acquired(lock, false, 0);
 		mmiowb_spin_lock();
 		debug_spin_lock_after(lock);
 	}
@@ -142,6 +161,7 @@ void do_raw_spin_unlock(raw_spinlock_t *lock)
 {
 	mmiowb_spin_unlock();
 	debug_spin_unlock(lock);
+	spin_stat_release(lock);
 	arch_spin_unlock(&lock->raw_lock);
 }
 
@@ -0,0 +1,463 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Spinlock contention statistics
+ *
+ * A cut-down /proc/lock_stat for kernels built with DEBUG_SPINLOCK but
+ * without lockdep.  Locks are grouped into classes by the lock_class_key
+ * and name handed to __raw_spin_lock_init(); statically initialised locks
+ * never pass through there and are classed by the call site that takes
+ * them first, so each such lock does not get a class of its own.
+ * Classes are looked up through a hash of the key/name pair.
+ *
+ * Counters are per-CPU so the lock paths never write a shared cacheline:
+ * for every class we keep the number of contended acquisitions, the time
+ * spent waiting when contended and the time the lock was held.  Writing
+ * '0' to /proc/lock_stat clears them.
+ */
+
+#include <linux/spinlock.h>
+#include <linux/percpu.h>
+#include <linux/hash.h>
+#include <linux/rculist.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/math64.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/sched/clock.h>
+
+#include "spinlock_stat.h"
+
+#define MAX_SPIN_STAT_CLASSES	1024
+#define SPIN_STAT_HASH_BITS	9
+#define SPIN_STAT_HASH_SIZE	(1UL << SPIN_STAT_HASH_BITS)
+
+struct spin_stat_class {
+	struct hlist_node	hash_entry;
+	const void		*key;
+	const char		*name;
+};
+
+struct spin_stat_time {
+	s64			min;
+	s64			max;
+	s64			total;
+	unsigned long		nr;
+};
+
+struct spin_class_stats {
+	unsigned long		contentions;
+	struct spin_stat_time	waittime;
+	struct spin_stat_time	holdtime;
+};
+
+/*
+ * Slot 0 collects every lock that did not get a class of its own because
+ * the table was full.
+ */
+static struct spin_stat_class spin_stat_classes[MAX_SPIN_STAT_CLASSES] = {
+	[0] = { .name = "(overflow)" },
+};
+static unsigned long nr_spin_stat_classes = 1;
+
+/*
+ * Classes are never freed, so the hash chains can be walked without
+ * spin_stat_lock; new entries are published with hlist_add_head_rcu().
+ */
+static struct hlist_head spin_stat_hash[SPIN_STAT_HASH_SIZE];
+
+static inline struct hlist_head *spin_stat_hashentry(const void *key,
+						     const char *name)
+{
+	unsigned long h = (unsigned long)key ^ (unsigned long)name;
+
+	return spin_stat_hash + hash_long(h, SPIN_STAT_HASH_BITS);
+}
+
+static DEFINE_PER_CPU(struct spin_class_stats [MAX_SPIN_STAT_CLASSES],
+		      spin_class_stats);
+
+/*
+ * Serializes class registration.  It has to be an arch lock, taking a
+ * raw_spinlock_t here would recurse straight back into us.
+ */
+static arch_spinlock_t spin_stat_lock = __ARCH_SPIN_LOCK_UNLOCKED;
+
+/*
+ * lock_class_key is empty without lockdep, so distinct keys may share an
+ * address; the name tells those apart.
+ */
+static struct spin_stat_class *
+spin_stat_find(struct hlist_head *head, const void *key, const char *name)
+{
+	struct spin_stat_class *class;
+
+	hlist_for_each_entry_rcu(class, head, hash_entry) {
+		if (class->key == key && class->name == name)
+			return class;
+	}
+
+	return NULL;
+}
+
+static struct spin_stat_class *
+spin_stat_lookup(const void *key, const char *name)
+{
+	struct hlist_head *head = spin_stat_hashentry(key, name);
+	struct spin_stat_class *class;
+	unsigned long flags;
+
+	class = spin_stat_find(head, key, name);
+	if (class)
+		return class;
+
+	raw_local_irq_save(flags);
+	arch_spin_lock(&spin_stat_lock);
+
+	class = spin_stat_find(head, key, name);
+	if (class)
+		goto out;
+
+	if (nr_spin_stat_classes < MAX_SPIN_STAT_CLASSES) {
+		class = &spin_stat_classes[nr_spin_stat_classes];
+		class->key = key;
+		class->name = name;
+		hlist_add_head_rcu(&class->hash_entry, head);
+		/* /proc/lock_stat walks the table without spin_stat_lock */
+		smp_store_release(&nr_spin_stat_classes,
+				  nr_spin_stat_classes + 1);
+	} else {
+		class = &spin_stat_classes[0];
+	}
+out:
+	arch_spin_unlock(&spin_stat_lock);
+	raw_local_irq_restore(flags);
+
+	return class;
+}
+
+void spin_stat_init(raw_spinlock_t *lock, const char *name,
+		    struct lock_class_key *key)
+{
+	lock->stat_class = spin_stat_lookup(key, name);
+	lock->stat_acquired = 0;
+}
+
+/*
+ * Class a statically initialised lock by @ip, the caller of the first
+ * _raw_spin_*() that takes it.  Racing first takers may come from
+ * different sites; whichever installs its class first wins.
+ */
+void spin_stat_init_site(raw_spinlock_t *lock, unsigned long ip)
+{
+	cmpxchg(&lock->stat_class, NULL, spin_stat_lookup((void *)ip, NULL));
+}
+
+/*
+ * Must be called with @lock held and interrupts disabled.  Every taker
+ * goes through spin_stat_site() first, so the class is set by now.
+ */
+static struct spin_class_stats *spin_stats(raw_spinlock_t *lock)
+{
+	struct spin_stat_class *class = lock->stat_class;
+
+	return raw_cpu_ptr(&spin_class_stats[class - spin_stat_classes]);
+}
+
+static void spin_stat_time_inc(struct spin_stat_time *lt, s64 time)
+{
+	if (time > lt->max)
+		lt->max = time;
+
+	if (time < lt->min || !lt->nr)
+		lt->min = time;
+
+	lt->total += time;
+	lt->nr++;
+}
+
+void spin_stat_acquired(raw_spinlock_t *lock, bool contended, u64 waittime)
+{
+	struct spin_class_stats *stats;
+	unsigned long flags;
+
+	raw_local_irq_save(flags);
+	stats = spin_stats(lock);
+	if (contended) {
+		stats->contentions++;
+		spin_stat_time_inc(&stats->waittime, waittime);
+	}
+	raw_local_irq_restore(flags);
+
+	lock->stat_acquired = local_clock();
+}
+
+void spin_stat_release(raw_spinlock_t *lock)
+{
+	struct spin_class_stats *stats;
+	u64 acquired = lock->stat_acquired;
+	unsigned long flags;
+
+	if (!acquired)
+		return;
+	lock->stat_acquired = 0;
+
+	raw_local_irq_save(flags);
+	stats = spin_stats(lock);
+	spin_stat_time_inc(&stats->holdtime, local_clock() - acquired);
+	raw_local_irq_restore(flags);
+}
+
+struct spin_stat_data {
+	struct spin_stat_class	*class;
+	struct spin_class_stats	stats;
+};
+
+struct spin_stat_seq {
+	struct spin_stat_data	*iter_end;
+	struct spin_stat_data	data[MAX_SPIN_STAT_CLASSES];
+};
+
+static void spin_stat_time_add(struct spin_stat_time *dst,
+			       struct spin_stat_time *src)
+{
+	if (!src->nr)
+		return;
+
+	if (src->max > dst->max)
+		dst->max = src->max;
+
+	if (src->min < dst->min || !dst->nr)
+		dst->min = src->min;
+
+	dst->total += src->total;
+	dst->nr += src->nr;
+}
+
+static void spin_stat_sum(unsigned long idx, struct spin_class_stats *sum)
+{
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		struct spin_class_stats *pcs =
+			&per_cpu(spin_class_stats, cpu)[idx];
+
+		sum->contentions += pcs->contentions;
+		spin_stat_time_add(&sum->waittime, &pcs->waittime);
+		spin_stat_time_add(&sum->holdtime, &pcs->holdtime);
+	}
+}
+
+static void snprint_time(char *buf, size_t bufsiz, s64 nr)
+{
+	s64 div;
+	s32 rem;
+
+	nr += 5; /* for display rounding */
+	div = div_s64_rem(nr, 1000, &rem);
+	snprintf(buf, bufsiz, "%lld.%02d", (long long)div, (int)rem/10);
+}
+
+static void seq_time(struct seq_file *m, s64 time)
+{
+	char num[22];
+
+	snprint_time(num, sizeof(num), time);
+	seq_printf(m, " %14s", num);
+}
+
+static void seq_spin_time(struct seq_file *m, struct spin_stat_time *lt)
+{
+	seq_time(m, lt->min);
+	seq_time(m, lt->max);
+	seq_time(m, lt->total);
+	seq_time(m, lt->nr ? div_s64(lt->total, lt->nr) : 0);
+}
+
+static void seq_line(struct seq_file *m, char c, int offset, int length)
+{
+	int i;
+
+	for (i = 0; i < offset; i++)
+		seq_puts(m, " ");
+	for (i = 0; i < length; i++)
+		seq_printf(m, "%c", c);
+	seq_puts(m, "\n");
+}
+
+static void seq_header(struct seq_file *m)
+{
+	seq_puts(m, "spin_lock_stat version 0.1\n");
+	seq_printf(m, "* times are in us, %lu of %d classes in use\n",
+		   READ_ONCE(nr_spin_stat_classes), MAX_SPIN_STAT_CLASSES);
+	seq_line(m, '-', 0, 40 + 1 + 10 * (14 + 1));
+	seq_printf(m, "%40s %14s %14s %14s %14s %14s %14s %14s %14s %14s %14s\n",
+			"class name",
+			"contentions",
+			"waittime-min",
+			"waittime-max",
+			"waittime-total",
+			"waittime-avg",
+			"acquisitions",
+			"holdtime-min",
+			"holdtime-max",
+			"holdtime-total",
+			"holdtime-avg");
+	seq_line(m, '-', 0, 40 + 1 + 10 * (14 + 1));
+	seq_printf(m, "\n");
+}
+
+static void seq_stats(struct seq_file *m, struct spin_stat_data *data)
+{
+	struct spin_stat_class *class = data->class;
+	struct spin_class_stats *stats = &data->stats;
+	char name[39];
+
+	if (class->name)
+		snprintf(name, sizeof(name), "%s", class->name);
+	else
+		snprintf(name, sizeof(name), "%pS", class->key);
+
+	seq_printf(m, "%40s: %14lu", name, stats->contentions);
+	seq_spin_time(m, &stats->waittime);
+	seq_printf(m, " %14lu", stats->holdtime.nr);
+	seq_spin_time(m, &stats->holdtime);
+	seq_puts(m, "\n");
+}
+
+static void *ss_start(struct seq_file *m, loff_t *pos)
+{
+	struct spin_stat_seq *data = m->private;
+	struct spin_stat_data *iter;
+
+	if (*pos == 0)
+		return SEQ_START_TOKEN;
+
+	iter = data->data + (*pos - 1);
+	if (iter >= data->iter_end)
+		iter = NULL;
+
+	return iter;
+}
+
+static void *ss_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	(*pos)++;
+	return ss_start(m, pos);
+}
+
+static void ss_stop(struct seq_file *m, void *v)
+{
+}
+
+static int ss_show(struct seq_file *m, void *v)
+{
+	if (v == SEQ_START_TOKEN)
+		seq_header(m);
+	else
+		seq_stats(m, v);
+
+	return 0;
+}
+
+static const struct seq_operations spin_stat_seq_ops = {
+	.start	= ss_start,
+	.next	= ss_next,
+	.stop	= ss_stop,
+	.show	= ss_show,
+};
+
+/*
+ * Most contended classes first.
+ */
+static int spin_stat_cmp(const void *l, const void *r)
+{
+	const struct spin_stat_data *dl = l, *dr = r;
+	unsigned long nl = dl->stats.contentions;
+	unsigned long nr = dr->stats.contentions;
+
+	if (nl == nr)
+		return 0;
+	return nr > nl ? 1 : -1;
+}
+
+static int spin_stat_open(struct inode *inode, struct file *file)
+{
+	int res;
+	struct spin_stat_data *iter;
+	struct spin_stat_seq *data = vmalloc(sizeof(struct spin_stat_seq));
+
+	if (!data)
+		return -ENOMEM;
+
+	res = seq_open(file, &spin_stat_seq_ops);
+	if (!res) {
+		struct seq_file *m = file->private_data;
+		unsigned long i, nr = smp_load_acquire(&nr_spin_stat_classes);
+
+		iter = data->data;
+		for (i = 0; i < nr; i++) {
+			iter->class = &spin_stat_classes[i];
+			spin_stat_sum(i, &iter->stats);
+			/* Skip classes that were never taken */
+			if (iter->stats.holdtime.nr || iter->stats.contentions)
+				iter++;
+		}
+		data->iter_end = iter;
+
+		sort(data->data, data->iter_end - data->data,
+		     sizeof(struct spin_stat_data),
+		     spin_stat_cmp, NULL);
+
+		m->private = data;
+	} else
+		vfree(data);
+
+	return res;
+}
+
+static ssize_t spin_stat_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	int cpu;
+	char c;
+
+	if (count) {
+		if (get_user(c, buf))
+			return -EFAULT;
+
+		if (c != '0')
+			return count;
+
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(&spin_class_stats, cpu), 0,
+			       sizeof(struct spin_class_stats [MAX_SPIN_STAT_CLASSES]));
+	}
+	return count;
+}
+
+static int spin_stat_close(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+
+	vfree(seq->private);
+	return seq_release(inode, file);
+}
+
+static const struct proc_ops spin_stat_proc_ops = {
+	.proc_open	= spin_stat_open,
+	.proc_write	= spin_stat_write,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= spin_stat_close,
+};
+
+static int __init spin_stat_proc_init(void)
+{
+	proc_create("lock_stat", S_IRUSR | S_IWUSR, NULL, &spin_stat_proc_ops);
+	return 0;
+}
+__initcall(spin_stat_proc_init);
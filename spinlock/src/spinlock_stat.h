@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Per-class spinlock statistics for DEBUG_SPINLOCK kernels that do not
+ * carry lockdep.  See spinlock_stat.c.
+ */
+#ifndef __SPINLOCK_STAT_H
+#define __SPINLOCK_STAT_H
+
+#include <linux/spinlock.h>
+
+#ifdef CONFIG_DEBUG_SPINLOCK_STAT
+
+extern void spin_stat_init(raw_spinlock_t *lock, const char *name,
+			   struct lock_class_key *key);
+extern void spin_stat_acquired(raw_spinlock_t *lock, bool contended,
+			       u64 waittime);
+extern void spin_stat_release(raw_spinlock_t *lock);
+extern void spin_stat_init_site(raw_spinlock_t *lock, unsigned long ip);
+
+static inline void spin_stat_site(raw_spinlock_t *lock, unsigned long ip)
+{
+	if (unlikely(!READ_ONCE(lock->stat_class)))
+		spin_stat_init_site(lock, ip);
+}
+
+#else
+
+static inline void spin_stat_init(raw_spinlock_t *lock, const char *name,
+				  struct lock_class_key *key) { }
+static inline void spin_stat_acquired(raw_spinlock_t *lock, bool contended,
+				      u64 waittime) { }
+static inline void spin_stat_release(raw_spinlock_t *lock) { }
+static inline void spin_stat_site(raw_spinlock_t *lock, unsigned long ip) { }
+
+#endif /* CONFIG_DEBUG_SPINLOCK_STAT */
+
+#endif /* __SPINLOCK_STAT_H */
@@ -345,6 +345,7 @@ void free_page_and_swap_cache(struct page *page)
 	if (!is_huge_zero_page(page))
 		put_page(page);
 }
+EXPORT_SYMBOL(free_page_and_swap_cache);
 
 /*
  * Passed an array of pages, drop them all from swapcache and then release
@@ -540,6 +541,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 
 	return retpage;
 }
+EXPORT_SYMBOL(read_swap_cache_async);
 
 static unsigned int __swapin_nr_pages(unsigned long prev_offset,
 				      unsigned long offset,
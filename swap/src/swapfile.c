@@ -1317,6 +1317,7 @@ unlock_out:
 	rcu_read_unlock();
 	return NULL;
 }
+EXPORT_SYMBOL(get_swap_device);
 
 static unsigned char __swap_entry_free(struct swap_info_struct *p,
 				       swp_entry_t entry)
@@ -1,6 +1,5 @@
 #include <linux/types.h>
 #include "../../booter/src/booter.h"
 
-CL_MINE(can_nice)
 CL_MINE(si_swapinfo)
 CL_MINE(uts_proc_notify)
@@ -144,10 +144,10 @@ static struct hrtimer_cpu_base migration_cpu_base = {
 
 #define migration_base	migration_cpu_base.clock_base[0]
 
-//static inline bool is_migration_base(struct hrtimer_clock_base *base)
-//{
-//	return base == &migration_base;
-//}
+static inline bool is_migration_base(struct hrtimer_clock_base *base)
+{
+	return base == &migration_base;
+}
 
 /*
  * We are using hashed locking: holding per_cpu(hrtimer_bases)[n].lock
@@ -180,97 +180,97 @@ struct hrtimer_clock_base *lock_hrtimer_base(const struct hrtimer *timer,
 	}
 }
 
-///*
-// * We do not migrate the timer when it is expiring before the next
-// * event on the target cpu. When high resolution is enabled, we cannot
-// * reprogram the target cpu hardware and we would cause it to fire
-// * late. To keep it simple, we handle the high resolution enabled and
-// * disabled case similar.
-// *
-// * Called with cpu_base->lock of target cpu held.
-// */
-//static int
-//hrtimer_check_target(struct hrtimer *timer, struct hrtimer_clock_base *new_base)
-//{
-//	ktime_t expires;
-//
-//	expires = ktime_sub(hrtimer_get_expires(timer), new_base->offset);
-//	return expires < new_base->cpu_base->expires_next;
-//}
-//
-//static inline
-//struct hrtimer_cpu_base *get_target_base(struct hrtimer_cpu_base *base,
-//					 int pinned)
-//{
-//#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
-//	if (static_branch_likely(&timers_migration_enabled) && !pinned)
-//		return &per_cpu(hrtimer_bases, get_nohz_timer_target());
-//#endif
-//	return base;
-//}
-//
-///*
-// * We switch the timer base to a power-optimized selected CPU target,
-// * if:
-// *	- NO_HZ_COMMON is enabled
-// *	- timer migration is enabled
-// *	- the timer callback is not running
-// *	- the timer is not the first expiring timer on the new target
-// *
-// * If one of the above requirements is not fulfilled we move the timer
-// * to the current CPU or leave it on the previously assigned CPU if
-// * the timer callback is currently running.
-// */
-//static inline struct hrtimer_clock_base *
-//switch_hrtimer_base(struct hrtimer *timer, struct hrtimer_clock_base *base,
-//		    int pinned)
-//{
-//	struct hrtimer_cpu_base *new_cpu_base, *this_cpu_base;
-//	struct hrtimer_clock_base *new_base;
-//	int basenum = base->index;
-//
-//	this_cpu_base = this_cpu_ptr(&hrtimer_bases);
-//	new_cpu_base = get_target_base(this_cpu_base, pinned);
-//again:
-//	new_base = &new_cpu_base->clock_base[basenum];
-//
-//	if (base != new_base) {
-//		/*
-//		 * We are trying to move timer to new_base.
-//		 * However we can't change timer's base while it is running,
-//		 * so we keep it on the same CPU. No hassle vs. reprogramming
-//		 * the event source in the high resolution case. The softirq
-//		 * code will take care of this when the timer function has
-//		 * completed. There is no conflict as we hold the lock until
-//		 * the timer is enqueued.
-//		 */
-//		if (unlikely(hrtimer_callback_running(timer)))
-//			return base;
-//
-//		/* See the comment in lock_hrtimer_base() */
-//		WRITE_ONCE(timer->base, &migration_base);
-//		raw_spin_unlock(&base->cpu_base->lock);
-//		raw_spin_lock(&new_base->cpu_base->lock);
-//
-//		if (new_cpu_base != this_cpu_base &&
-//		    hrtimer_check_target(timer, new_base)) {
-//			raw_spin_unlock(&new_base->cpu_base->lock);
-//			raw_spin_lock(&base->cpu_base->lock);
-//			new_cpu_base = this_cpu_base;
-//			WRITE_ONCE(timer->base, base);
-//			goto again;
-//		}
-//		WRITE_ONCE(timer->base, new_base);
-//	} else {
-//		if (new_cpu_base != this_cpu_base &&
-//		    hrtimer_check_target(timer, new_base)) {
-//			new_cpu_base = this_cpu_base;
-//			goto again;
-//		}
-//	}
-//	return new_base;
-//}
-//
+/*
+ * We do not migrate the timer when it is expiring before the next
+ * event on the target cpu. When high resolution is enabled, we cannot
+ * reprogram the target cpu hardware and we would cause it to fire
+ * late. To keep it simple, we handle the high resolution enabled and
+ * disabled case similar.
+ *
+ * Called with cpu_base->lock of target cpu held.
+ */
+static int
+hrtimer_check_target(struct hrtimer *timer, struct hrtimer_clock_base *new_base)
+{
+	ktime_t expires;
+
+	expires = ktime_sub(hrtimer_get_expires(timer), new_base->offset);
+	return expires < new_base->cpu_base->expires_next;
+}
+
+static inline
+struct hrtimer_cpu_base *get_target_base(struct hrtimer_cpu_base *base,
+					 int pinned)
+{
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+	if (static_branch_likely(&timers_migration_enabled) && !pinned)
+		return &per_cpu(hrtimer_bases, get_nohz_timer_target());
+#endif
+	return base;
+}
+
+/*
+ * We switch the timer base to a power-optimized selected CPU target,
+ * if:
+ *	- NO_HZ_COMMON is enabled
+ *	- timer migration is enabled
+ *	- the timer callback is not running
+ *	- the timer is not the first expiring timer on the new target
+ *
+ * If one of the above requirements is not fulfilled we move the timer
+ * to the current CPU or leave it on the previously assigned CPU if
+ * the timer callback is currently running.
+ */
+static inline struct hrtimer_clock_base *
+switch_hrtimer_base(struct hrtimer *timer, struct hrtimer_clock_base *base,
+		    int pinned)
+{
+	struct hrtimer_cpu_base *new_cpu_base, *this_cpu_base;
+	struct hrtimer_clock_base *new_base;
+	int basenum = base->index;
+
+	this_cpu_base = this_cpu_ptr(&hrtimer_bases);
+	new_cpu_base = get_target_base(this_cpu_base, pinned);
+again:
+	new_base = &new_cpu_base->clock_base[basenum];
+
+	if (base != new_base) {
+		/*
+		 * We are trying to move timer to new_base.
+		 * However we can't change timer's base while it is running,
+		 * so we keep it on the same CPU. No hassle vs. reprogramming
+		 * the event source in the high resolution case. The softirq
+		 * code will take care of this when the timer function has
+		 * completed. There is no conflict as we hold the lock until
+		 * the timer is enqueued.
+		 */
+		if (unlikely(hrtimer_callback_running(timer)))
+			return base;
+
+		/* See the comment in lock_hrtimer_base() */
+		WRITE_ONCE(timer->base, &migration_base);
+		raw_spin_unlock(&base->cpu_base->lock);
+		raw_spin_lock(&new_base->cpu_base->lock);
+
+		if (new_cpu_base != this_cpu_base &&
+		    hrtimer_check_target(timer, new_base)) {
+			raw_spin_unlock(&new_base->cpu_base->lock);
+			raw_spin_lock(&base->cpu_base->lock);
+			new_cpu_base = this_cpu_base;
+			WRITE_ONCE(timer->base, base);
+			goto again;
+		}
+		WRITE_ONCE(timer->base, new_base);
+	} else {
+		if (new_cpu_base != this_cpu_base &&
+		    hrtimer_check_target(timer, new_base)) {
+			new_cpu_base = this_cpu_base;
+			goto again;
+		}
+	}
+	return new_base;
+}
+
 #else /* CONFIG_SMP */
 
 static inline bool is_migration_base(struct hrtimer_clock_base *base)
@@ -1852,146 +1852,146 @@ void hrtimer_init_sleeper(struct hrtimer_sleeper *sl, clockid_t clock_id,
 }
 EXPORT_SYMBOL_GPL(hrtimer_init_sleeper);
 
-//int nanosleep_copyout(struct restart_block *restart, struct timespec64 *ts)
-//{
-//	switch(restart->nanosleep.type) {
-//#ifdef CONFIG_COMPAT_32BIT_TIME
-//	case TT_COMPAT:
-//		if (put_old_timespec32(ts, restart->nanosleep.compat_rmtp))
-//			return -EFAULT;
-//		break;
-//#endif
-//	case TT_NATIVE:
-//		if (put_timespec64(ts, restart->nanosleep.rmtp))
-//			return -EFAULT;
-//		break;
-//	default:
-//		BUG();
-//	}
-//	return -ERESTART_RESTARTBLOCK;
-//}
-//
-//static int __sched do_nanosleep(struct hrtimer_sleeper *t, enum hrtimer_mode mode)
-//{
-//	struct restart_block *restart;
-//
-//	do {
-//		set_current_state(TASK_INTERRUPTIBLE);
-//		hrtimer_sleeper_start_expires(t, mode);
-//
-//		if (likely(t->task))
-//			freezable_schedule();
-//
-//		hrtimer_cancel(&t->timer);
-//		mode = HRTIMER_MODE_ABS;
-//
-//	} while (t->task && !signal_pending(current));
-//
-//	__set_current_state(TASK_RUNNING);
-//
-//	if (!t->task)
-//		return 0;
-//
-//	restart = &current->restart_block;
-//	if (restart->nanosleep.type != TT_NONE) {
-//		ktime_t rem = hrtimer_expires_remaining(&t->timer);
-//		struct timespec64 rmt;
-//
-//		if (rem <= 0)
-//			return 0;
-//		rmt = ktime_to_timespec64(rem);
-//
-//		return nanosleep_copyout(restart, &rmt);
-//	}
-//	return -ERESTART_RESTARTBLOCK;
-//}
-//
-//static long __sched hrtimer_nanosleep_restart(struct restart_block *restart)
-//{
-//	struct hrtimer_sleeper t;
-//	int ret;
-//
-//	hrtimer_init_sleeper_on_stack(&t, restart->nanosleep.clockid,
-//				      HRTIMER_MODE_ABS);
-//	hrtimer_set_expires_tv64(&t.timer, restart->nanosleep.expires);
-//	ret = do_nanosleep(&t, HRTIMER_MODE_ABS);
-//	destroy_hrtimer_on_stack(&t.timer);
-//	return ret;
-//}
-//
-//long hrtimer_nanosleep(ktime_t rqtp, const enum hrtimer_mode mode,
-//		       const clockid_t clockid)
-//{
-//	struct restart_block *restart;
-//	struct hrtimer_sleeper t;
-//	int ret = 0;
-//	u64 slack;
-//
-//	slack = current->timer_slack_ns;
-//	if (dl_task(current) || rt_task(current))
-//		slack = 0;
-//
-//	hrtimer_init_sleeper_on_stack(&t, clockid, mode);
-//	hrtimer_set_expires_range_ns(&t.timer, rqtp, slack);
-//	ret = do_nanosleep(&t, mode);
-//	if (ret != -ERESTART_RESTARTBLOCK)
-//		goto out;
-//
-//	/* Absolute timers do not update the rmtp value and restart: */
-//	if (mode == HRTIMER_MODE_ABS) {
-//		ret = -ERESTARTNOHAND;
-//		goto out;
-//	}
-//
-//	restart = &current->restart_block;
-//	restart->fn = hrtimer_nanosleep_restart;
-//	restart->nanosleep.clockid = t.timer.base->clockid;
-//	restart->nanosleep.expires = hrtimer_get_expires_tv64(&t.timer);
-//out:
-//	destroy_hrtimer_on_stack(&t.timer);
-//	return ret;
-//}
-//
-//#ifdef CONFIG_64BIT
-//
-//SYSCALL_DEFINE2(nanosleep, struct __kernel_timespec __user *, rqtp,
-//		struct __kernel_timespec __user *, rmtp)
-//{
-//	struct timespec64 tu;
-//
-//	if (get_timespec64(&tu, rqtp))
-//		return -EFAULT;
-//
-//	if (!timespec64_valid(&tu))
-//		return -EINVAL;
-//
-//	current->restart_block.nanosleep.type = rmtp ? TT_NATIVE : TT_NONE;
-//	current->restart_block.nanosleep.rmtp = rmtp;
-//	return hrtimer_nanosleep(timespec64_to_ktime(tu), HRTIMER_MODE_REL,
-//				 CLOCK_MONOTONIC);
-//}
-//
-//#endif
-//
-//#ifdef CONFIG_COMPAT_32BIT_TIME
-//
-//SYSCALL_DEFINE2(nanosleep_time32, struct old_timespec32 __user *, rqtp,
-//		       struct old_timespec32 __user *, rmtp)
-//{
-//	struct timespec64 tu;
-//
-//	if (get_old_timespec32(&tu, rqtp))
-//		return -EFAULT;
-//
-//	if (!timespec64_valid(&tu))
-//		return -EINVAL;
-//
-//	current->restart_block.nanosleep.type = rmtp ? TT_COMPAT : TT_NONE;
-//	current->restart_block.nanosleep.compat_rmtp = rmtp;
-//	return hrtimer_nanosleep(timespec64_to_ktime(tu), HRTIMER_MODE_REL,
-//				 CLOCK_MONOTONIC);
-//}
-//#endif
+int nanosleep_copyout(struct restart_block *restart, struct timespec64 *ts)
+{
+	switch(restart->nanosleep.type) {
+#ifdef CONFIG_COMPAT_32BIT_TIME
+	case TT_COMPAT:
+		if (put_old_timespec32(ts, restart->nanosleep.compat_rmtp))
+			return -EFAULT;
+		break;
+#endif
+	case TT_NATIVE:
+		if (put_timespec64(ts, restart->nanosleep.rmtp))
+			return -EFAULT;
+		break;
+	default:
+		BUG();
+	}
+	return -ERESTART_RESTARTBLOCK;
+}
+
+static int __sched do_nanosleep(struct hrtimer_sleeper *t, enum hrtimer_mode mode)
+{
+	struct restart_block *restart;
+
+	do {
+		set_current_state(TASK_INTERRUPTIBLE);
+		hrtimer_sleeper_start_expires(t, mode);
+
+		if (likely(t->task))
+			freezable_schedule();
+
+		hrtimer_cancel(&t->timer);
+		mode = HRTIMER_MODE_ABS;
+
+	} while (t->task && !signal_pending(current));
+
+	__set_current_state(TASK_RUNNING);
+
+	if (!t->task)
+		return 0;
+
+	restart = &current->restart_block;
+	if (restart->nanosleep.type != TT_NONE) {
+		ktime_t rem = hrtimer_expires_remaining(&t->timer);
+		struct timespec64 rmt;
+
+		if (rem <= 0)
+			return 0;
+		rmt = ktime_to_timespec64(rem);
+
+		return nanosleep_copyout(restart, &rmt);
+	}
+	return -ERESTART_RESTARTBLOCK;
+}
+
+static long __sched hrtimer_nanosleep_restart(struct restart_block *restart)
+{
+	struct hrtimer_sleeper t;
+	int ret;
+
+	hrtimer_init_sleeper_on_stack(&t, restart->nanosleep.clockid,
+				      HRTIMER_MODE_ABS);
+	hrtimer_set_expires_tv64(&t.timer, restart->nanosleep.expires);
+	ret = do_nanosleep(&t, HRTIMER_MODE_ABS);
+	destroy_hrtimer_on_stack(&t.timer);
+	return ret;
+}
+
+long hrtimer_nanosleep(ktime_t rqtp, const enum hrtimer_mode mode,
+		       const clockid_t clockid)
+{
+	struct restart_block *restart;
+	struct hrtimer_sleeper t;
+	int ret = 0;
+	u64 slack;
+
+	slack = current->timer_slack_ns;
+	if (dl_task(current) || rt_task(current))
+		slack = 0;
+
+	hrtimer_init_sleeper_on_stack(&t, clockid, mode);
+	hrtimer_set_expires_range_ns(&t.timer, rqtp, slack);
+	ret = do_nanosleep(&t, mode);
+	if (ret != -ERESTART_RESTARTBLOCK)
+		goto out;
+
+	/* Absolute timers do not update the rmtp value and restart: */
+	if (mode == HRTIMER_MODE_ABS) {
+		ret = -ERESTARTNOHAND;
+		goto out;
+	}
+
+	restart = &current->restart_block;
+	restart->fn = hrtimer_nanosleep_restart;
+	restart->nanosleep.clockid = t.timer.base->clockid;
+	restart->nanosleep.expires = hrtimer_get_expires_tv64(&t.timer);
+out:
+	destroy_hrtimer_on_stack(&t.timer);
+	return ret;
+}
+
+#ifdef CONFIG_64BIT
+
+SYSCALL_DEFINE2(nanosleep, struct __kernel_timespec __user *, rqtp,
+		struct __kernel_timespec __user *, rmtp)
+{
+	struct timespec64 tu;
+
+	if (get_timespec64(&tu, rqtp))
+		return -EFAULT;
+
+	if (!timespec64_valid(&tu))
+		return -EINVAL;
+
+	current->restart_block.nanosleep.type = rmtp ? TT_NATIVE : TT_NONE;
+	current->restart_block.nanosleep.rmtp = rmtp;
+	return hrtimer_nanosleep(timespec64_to_ktime(tu), HRTIMER_MODE_REL,
+				 CLOCK_MONOTONIC);
+}
+
+#endif
+
+#ifdef CONFIG_COMPAT_32BIT_TIME
+
+SYSCALL_DEFINE2(nanosleep_time32, struct old_timespec32 __user *, rqtp,
+		       struct old_timespec32 __user *, rmtp)
+{
+	struct timespec64 tu;
+
+	if (get_old_timespec32(&tu, rqtp))
+		return -EFAULT;
+
+	if (!timespec64_valid(&tu))
+		return -EINVAL;
+
+	current->restart_block.nanosleep.type = rmtp ? TT_COMPAT : TT_NONE;
+	current->restart_block.nanosleep.compat_rmtp = rmtp;
+	return hrtimer_nanosleep(timespec64_to_ktime(tu), HRTIMER_MODE_REL,
+				 CLOCK_MONOTONIC);
+}
+#endif
 
 /*
  * Functions related to boot-time initialization:
@@ -2020,6 +2020,7 @@ int hrtimers_prepare_cpu(unsigned int cpu)
 	hrtimer_cpu_base_init_expiry_lock(cpu_base);
 	return 0;
 }
+EXPORT_SYMBOL(hrtimers_prepare_cpu);
 
 //#ifdef CONFIG_HOTPLUG_CPU
 //
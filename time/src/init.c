@@ -78,22 +78,12 @@ int proc_dointvec_minmax(struct ctl_table *table, int write,
 }
 EXPORT_SYMBOL(proc_dointvec_minmax);
 
-void timerfd_clock_was_set(void)
-{
-    booter_panic("No impl in 'time'.");
-}
-
 void __weak thread_group_cputime(struct task_struct *tsk, struct task_cputime *times)
 {
     booter_panic("No impl in 'time'.");
 }
 EXPORT_SYMBOL(thread_group_cputime);
 
-int nanosleep_copyout(struct restart_block *restart, struct timespec64 *ts)
-{
-    booter_panic("No impl in 'time'.");
-}
-
 unsigned long long task_sched_runtime(struct task_struct *p)
 {
     booter_panic("No impl in 'time'.");
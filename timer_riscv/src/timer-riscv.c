@@ -29,12 +29,26 @@ static int riscv_clock_next_event(unsigned long delta,
 	return 0;
 }
 
+/*
+ * Called when the tick is stopped with nothing queued (NO_HZ idle with an
+ * empty timer wheel and hrtimer queue) and on shutdown.  Push the SBI
+ * deadline out to infinity so a stale tick deadline does not wake the hart.
+ */
+static int riscv_clock_shutdown(struct clock_event_device *ce)
+{
+	csr_clear(CSR_IE, IE_TIE);
+	sbi_set_timer(U64_MAX);
+	return 0;
+}
+
 static unsigned int riscv_clock_event_irq;
 static DEFINE_PER_CPU(struct clock_event_device, riscv_clock_event) = {
 	.name			= "riscv_timer_clockevent",
 	.features		= CLOCK_EVT_FEAT_ONESHOT,
 	.rating			= 100,
 	.set_next_event		= riscv_clock_next_event,
+	.set_state_shutdown	= riscv_clock_shutdown,
+	.set_state_oneshot_stopped = riscv_clock_shutdown,
 };
 
 /*
@@ -5,21 +5,14 @@ CL_MINE(sys_acct)
 CL_MINE(sys_add_key)
 CL_MINE(sys_bpf)
 CL_MINE(sys_delete_module)
-CL_MINE(sys_epoll_create1)
-CL_MINE(sys_epoll_ctl)
-CL_MINE(sys_epoll_pwait)
-CL_MINE(sys_eventfd2)
-CL_MINE(sys_fadvise64_64)
 CL_MINE(sys_fanotify_init)
 CL_MINE(sys_fanotify_mark)
-CL_MINE(sys_fdatasync)
 CL_MINE(sys_finit_module)
 CL_MINE(sys_fsconfig)
 CL_MINE(sys_fsmount)
 CL_MINE(sys_fsopen)
 CL_MINE(sys_fspick)
 CL_MINE(sys_fstatfs)
-CL_MINE(sys_fsync)
 CL_MINE(sys_get_mempolicy)
 CL_MINE(sys_init_module)
 CL_MINE(sys_inotify_add_watch)
@@ -27,19 +20,13 @@ CL_MINE(sys_inotify_init1)
 CL_MINE(sys_inotify_rm_watch)
 CL_MINE(sys_ioprio_get)
 CL_MINE(sys_ioprio_set)
-CL_MINE(sys_io_uring_enter)
-CL_MINE(sys_io_uring_register)
-CL_MINE(sys_io_uring_setup)
 CL_MINE(sys_kcmp)
 CL_MINE(sys_kexec_file_load)
 CL_MINE(sys_kexec_load)
 CL_MINE(sys_keyctl)
 CL_MINE(sys_lookup_dcookie)
-CL_MINE(sys_madvise)
 CL_MINE(sys_mbind)
-CL_MINE(sys_memfd_create)
 CL_MINE(sys_migrate_pages)
-CL_MINE(sys_mincore)
 CL_MINE(sys_mlock)
 CL_MINE(sys_mlock2)
 CL_MINE(sys_mlockall)
@@ -55,54 +42,26 @@ CL_MINE(sys_msync)
 CL_MINE(sys_munlock)
 CL_MINE(sys_munlockall)
 CL_MINE(sys_name_to_handle_at)
-CL_MINE(sys_nanosleep)
 CL_MINE(sys_open_by_handle_at)
 CL_MINE(sys_open_tree)
 CL_MINE(sys_perf_event_open)
 CL_MINE(sys_personality)
-CL_MINE(sys_pipe2)
 CL_MINE(sys_pivot_root)
 CL_MINE(sys_pkey_alloc)
 CL_MINE(sys_pkey_free)
 CL_MINE(sys_pkey_mprotect)
-CL_MINE(sys_ppoll)
-CL_MINE(sys_process_vm_readv)
-CL_MINE(sys_process_vm_writev)
-CL_MINE(sys_pselect6)
 CL_MINE(sys_ptrace)
 CL_MINE(sys_quotactl)
 CL_MINE(sys_reboot)
 CL_MINE(sys_remap_file_pages)
 CL_MINE(sys_request_key)
-CL_MINE(sys_rseq)
-CL_MINE(sys_sched_getaffinity)
-CL_MINE(sys_sched_getattr)
-CL_MINE(sys_sched_getparam)
-CL_MINE(sys_sched_get_priority_max)
-CL_MINE(sys_sched_get_priority_min)
-CL_MINE(sys_sched_getscheduler)
-CL_MINE(sys_sched_rr_get_interval)
-CL_MINE(sys_sched_setaffinity)
-CL_MINE(sys_sched_setattr)
-CL_MINE(sys_sched_setparam)
-CL_MINE(sys_sched_setscheduler)
-CL_MINE(sys_sched_yield)
 CL_MINE(sys_seccomp)
 CL_MINE(sys_set_mempolicy)
 CL_MINE(sys_setns)
-CL_MINE(sys_splice)
 CL_MINE(sys_statfs)
 CL_MINE(sys_swapoff)
 CL_MINE(sys_swapon)
-CL_MINE(sys_sync)
-CL_MINE(sys_sync_file_range)
-CL_MINE(sys_syncfs)
 CL_MINE(sys_syslog)
-CL_MINE(sys_tee)
-CL_MINE(sys_timerfd_create)
-CL_MINE(sys_timerfd_gettime)
-CL_MINE(sys_timerfd_settime)
 CL_MINE(sys_umount)
 CL_MINE(sys_userfaultfd)
 CL_MINE(sys_utimensat)
-CL_MINE(sys_vmsplice)
@@ -303,16 +303,36 @@ static void give_pages(struct receive_queue *rq, struct page *page)
 	rq->pages = page;
 }
 
+/*
+ * Restock rq->pages with the MAX_SKB_FRAGS + 2 pages one big packet buffer
+ * needs, taken from the page allocator in a single bulk call.
+ */
+static void refill_pages(struct receive_queue *rq, gfp_t gfp_mask)
+{
+	struct page *pages[MAX_SKB_FRAGS + 2] = { };
+	unsigned long i, nr;
+
+	nr = alloc_pages_bulk_array(gfp_mask, ARRAY_SIZE(pages), pages);
+	for (i = 0; i < nr; i++) {
+		pages[i]->private = (unsigned long)rq->pages;
+		rq->pages = pages[i];
+	}
+}
+
 static struct page *get_a_page(struct receive_queue *rq, gfp_t gfp_mask)
 {
 	struct page *p = rq->pages;
 
-	if (p) {
-		rq->pages = (struct page *)p->private;
-		/* clear private here, it is used to chain pages */
-		p->private = 0;
-	} else
-		p = alloc_page(gfp_mask);
+	if (!p) {
+		refill_pages(rq, gfp_mask);
+		p = rq->pages;
+		if (!p)
+			return NULL;
+	}
+
+	rq->pages = (struct page *)p->private;
+	/* clear private here, it is used to chain pages */
+	p->private = 0;
 	return p;
 }
 
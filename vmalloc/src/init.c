@@ -23,11 +23,6 @@ int set_direct_map_invalid_noflush(struct page *page)
 }
 */
 
-int __cond_resched_lock(spinlock_t *lock)
-{
-    booter_panic("No impl 'slub'.");
-}
-
 /*
 int set_direct_map_default_noflush(struct page *page)
 {
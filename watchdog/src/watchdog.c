@@ -521,6 +521,7 @@ int lockup_detector_online_cpu(unsigned int cpu)
 		watchdog_enable(cpu);
 	return 0;
 }
+EXPORT_SYMBOL(lockup_detector_online_cpu);
 
 int lockup_detector_offline_cpu(unsigned int cpu)
 {
@@ -528,6 +529,7 @@ int lockup_detector_offline_cpu(unsigned int cpu)
 		watchdog_disable(cpu);
 	return 0;
 }
+EXPORT_SYMBOL(lockup_detector_offline_cpu);
 
 static void lockup_detector_reconfigure(void)
 {
@@ -3262,43 +3262,44 @@ bool cancel_delayed_work_sync(struct delayed_work *dwork)
 }
 EXPORT_SYMBOL(cancel_delayed_work_sync);
 
-///**
-// * schedule_on_each_cpu - execute a function synchronously on each online CPU
-// * @func: the function to call
-// *
-// * schedule_on_each_cpu() executes @func on each online CPU using the
-// * system workqueue and blocks until all CPUs have completed.
-// * schedule_on_each_cpu() is very slow.
-// *
-// * Return:
-// * 0 on success, -errno on failure.
-// */
-//int schedule_on_each_cpu(work_func_t func)
-//{
-//	int cpu;
-//	struct work_struct __percpu *works;
-//
-//	works = alloc_percpu(struct work_struct);
-//	if (!works)
-//		return -ENOMEM;
-//
-//	get_online_cpus();
-//
-//	for_each_online_cpu(cpu) {
-//		struct work_struct *work = per_cpu_ptr(works, cpu);
-//
-//		INIT_WORK(work, func);
-//		schedule_work_on(cpu, work);
-//	}
-//
-//	for_each_online_cpu(cpu)
-//		flush_work(per_cpu_ptr(works, cpu));
-//
-//	put_online_cpus();
-//	free_percpu(works);
-//	return 0;
-//}
-//
+/**
+ * schedule_on_each_cpu - execute a function synchronously on each online CPU
+ * @func: the function to call
+ *
+ * schedule_on_each_cpu() executes @func on each online CPU using the
+ * system workqueue and blocks until all CPUs have completed.
+ * schedule_on_each_cpu() is very slow.
+ *
+ * Return:
+ * 0 on success, -errno on failure.
+ */
+int schedule_on_each_cpu(work_func_t func)
+{
+	int cpu;
+	struct work_struct __percpu *works;
+
+	works = alloc_percpu(struct work_struct);
+	if (!works)
+		return -ENOMEM;
+
+	get_online_cpus();
+
+	for_each_online_cpu(cpu) {
+		struct work_struct *work = per_cpu_ptr(works, cpu);
+
+		INIT_WORK(work, func);
+		schedule_work_on(cpu, work);
+	}
+
+	for_each_online_cpu(cpu)
+		flush_work(per_cpu_ptr(works, cpu));
+
+	put_online_cpus();
+	free_percpu(works);
+	return 0;
+}
+EXPORT_SYMBOL(schedule_on_each_cpu);
+
 ///**
 // * execute_in_process_context - reliably execute the routine with user context
 // * @fn:		the function to execute
@@ -4860,229 +4861,234 @@ void show_workqueue_state(void)
 //
 //	mutex_unlock(&wq_pool_attach_mutex);
 //}
-//
-//#ifdef CONFIG_SMP
-//
-///*
-// * CPU hotplug.
-// *
-// * There are two challenges in supporting CPU hotplug.  Firstly, there
-// * are a lot of assumptions on strong associations among work, pwq and
-// * pool which make migrating pending and scheduled works very
-// * difficult to implement without impacting hot paths.  Secondly,
-// * worker pools serve mix of short, long and very long running works making
-// * blocked draining impractical.
-// *
-// * This is solved by allowing the pools to be disassociated from the CPU
-// * running as an unbound one and allowing it to be reattached later if the
-// * cpu comes back online.
-// */
-//
-//static void unbind_workers(int cpu)
-//{
-//	struct worker_pool *pool;
-//	struct worker *worker;
-//
-//	for_each_cpu_worker_pool(pool, cpu) {
-//		mutex_lock(&wq_pool_attach_mutex);
-//		raw_spin_lock_irq(&pool->lock);
-//
-//		/*
-//		 * We've blocked all attach/detach operations. Make all workers
-//		 * unbound and set DISASSOCIATED.  Before this, all workers
-//		 * except for the ones which are still executing works from
-//		 * before the last CPU down must be on the cpu.  After
-//		 * this, they may become diasporas.
-//		 */
-//		for_each_pool_worker(worker, pool)
-//			worker->flags |= WORKER_UNBOUND;
-//
-//		pool->flags |= POOL_DISASSOCIATED;
-//
-//		raw_spin_unlock_irq(&pool->lock);
-//		mutex_unlock(&wq_pool_attach_mutex);
-//
-//		/*
-//		 * Call schedule() so that we cross rq->lock and thus can
-//		 * guarantee sched callbacks see the %WORKER_UNBOUND flag.
-//		 * This is necessary as scheduler callbacks may be invoked
-//		 * from other cpus.
-//		 */
-//		schedule();
-//
-//		/*
-//		 * Sched callbacks are disabled now.  Zap nr_running.
-//		 * After this, nr_running stays zero and need_more_worker()
-//		 * and keep_working() are always true as long as the
-//		 * worklist is not empty.  This pool now behaves as an
-//		 * unbound (in terms of concurrency management) pool which
-//		 * are served by workers tied to the pool.
-//		 */
-//		atomic_set(&pool->nr_running, 0);
-//
-//		/*
-//		 * With concurrency management just turned off, a busy
-//		 * worker blocking could lead to lengthy stalls.  Kick off
-//		 * unbound chain execution of currently pending work items.
-//		 */
-//		raw_spin_lock_irq(&pool->lock);
-//		wake_up_worker(pool);
-//		raw_spin_unlock_irq(&pool->lock);
-//	}
-//}
-//
-///**
-// * rebind_workers - rebind all workers of a pool to the associated CPU
-// * @pool: pool of interest
-// *
-// * @pool->cpu is coming online.  Rebind all workers to the CPU.
-// */
-//static void rebind_workers(struct worker_pool *pool)
-//{
-//	struct worker *worker;
-//
-//	lockdep_assert_held(&wq_pool_attach_mutex);
-//
-//	/*
-//	 * Restore CPU affinity of all workers.  As all idle workers should
-//	 * be on the run-queue of the associated CPU before any local
-//	 * wake-ups for concurrency management happen, restore CPU affinity
-//	 * of all workers first and then clear UNBOUND.  As we're called
-//	 * from CPU_ONLINE, the following shouldn't fail.
-//	 */
-//	for_each_pool_worker(worker, pool)
-//		WARN_ON_ONCE(set_cpus_allowed_ptr(worker->task,
-//						  pool->attrs->cpumask) < 0);
-//
-//	raw_spin_lock_irq(&pool->lock);
-//
-//	pool->flags &= ~POOL_DISASSOCIATED;
-//
-//	for_each_pool_worker(worker, pool) {
-//		unsigned int worker_flags = worker->flags;
-//
-//		/*
-//		 * A bound idle worker should actually be on the runqueue
-//		 * of the associated CPU for local wake-ups targeting it to
-//		 * work.  Kick all idle workers so that they migrate to the
-//		 * associated CPU.  Doing this in the same loop as
-//		 * replacing UNBOUND with REBOUND is safe as no worker will
-//		 * be bound before @pool->lock is released.
-//		 */
-//		if (worker_flags & WORKER_IDLE)
-//			wake_up_process(worker->task);
-//
-//		/*
-//		 * We want to clear UNBOUND but can't directly call
-//		 * worker_clr_flags() or adjust nr_running.  Atomically
-//		 * replace UNBOUND with another NOT_RUNNING flag REBOUND.
-//		 * @worker will clear REBOUND using worker_clr_flags() when
-//		 * it initiates the next execution cycle thus restoring
-//		 * concurrency management.  Note that when or whether
-//		 * @worker clears REBOUND doesn't affect correctness.
-//		 *
-//		 * WRITE_ONCE() is necessary because @worker->flags may be
-//		 * tested without holding any lock in
-//		 * wq_worker_running().  Without it, NOT_RUNNING test may
-//		 * fail incorrectly leading to premature concurrency
-//		 * management operations.
-//		 */
-//		WARN_ON_ONCE(!(worker_flags & WORKER_UNBOUND));
-//		worker_flags |= WORKER_REBOUND;
-//		worker_flags &= ~WORKER_UNBOUND;
-//		WRITE_ONCE(worker->flags, worker_flags);
-//	}
-//
-//	raw_spin_unlock_irq(&pool->lock);
-//}
-//
-///**
-// * restore_unbound_workers_cpumask - restore cpumask of unbound workers
-// * @pool: unbound pool of interest
-// * @cpu: the CPU which is coming up
-// *
-// * An unbound pool may end up with a cpumask which doesn't have any online
-// * CPUs.  When a worker of such pool get scheduled, the scheduler resets
-// * its cpus_allowed.  If @cpu is in @pool's cpumask which didn't have any
-// * online CPU before, cpus_allowed of all its workers should be restored.
-// */
-//static void restore_unbound_workers_cpumask(struct worker_pool *pool, int cpu)
-//{
-//	static cpumask_t cpumask;
-//	struct worker *worker;
-//
-//	lockdep_assert_held(&wq_pool_attach_mutex);
-//
-//	/* is @cpu allowed for @pool? */
-//	if (!cpumask_test_cpu(cpu, pool->attrs->cpumask))
-//		return;
-//
-//	cpumask_and(&cpumask, pool->attrs->cpumask, cpu_online_mask);
-//
-//	/* as we're called from CPU_ONLINE, the following shouldn't fail */
-//	for_each_pool_worker(worker, pool)
-//		WARN_ON_ONCE(set_cpus_allowed_ptr(worker->task, &cpumask) < 0);
-//}
-//
-//int workqueue_prepare_cpu(unsigned int cpu)
-//{
-//	struct worker_pool *pool;
-//
-//	for_each_cpu_worker_pool(pool, cpu) {
-//		if (pool->nr_workers)
-//			continue;
-//		if (!create_worker(pool))
-//			return -ENOMEM;
-//	}
-//	return 0;
-//}
-//
-//int workqueue_online_cpu(unsigned int cpu)
-//{
-//	struct worker_pool *pool;
-//	struct workqueue_struct *wq;
-//	int pi;
-//
-//	mutex_lock(&wq_pool_mutex);
-//
-//	for_each_pool(pool, pi) {
-//		mutex_lock(&wq_pool_attach_mutex);
-//
-//		if (pool->cpu == cpu)
-//			rebind_workers(pool);
-//		else if (pool->cpu < 0)
-//			restore_unbound_workers_cpumask(pool, cpu);
-//
-//		mutex_unlock(&wq_pool_attach_mutex);
-//	}
-//
-//	/* update NUMA affinity of unbound workqueues */
-//	list_for_each_entry(wq, &workqueues, list)
-//		wq_update_unbound_numa(wq, cpu, true);
-//
-//	mutex_unlock(&wq_pool_mutex);
-//	return 0;
-//}
-//
-//int workqueue_offline_cpu(unsigned int cpu)
-//{
-//	struct workqueue_struct *wq;
-//
-//	/* unbinding per-cpu workers should happen on the local CPU */
-//	if (WARN_ON(cpu != smp_processor_id()))
-//		return -1;
-//
-//	unbind_workers(cpu);
-//
-//	/* update NUMA affinity of unbound workqueues */
-//	mutex_lock(&wq_pool_mutex);
-//	list_for_each_entry(wq, &workqueues, list)
-//		wq_update_unbound_numa(wq, cpu, false);
-//	mutex_unlock(&wq_pool_mutex);
-//
-//	return 0;
-//}
-//
+
+#ifdef CONFIG_SMP
+
+/*
+ * CPU hotplug.
+ *
+ * There are two challenges in supporting CPU hotplug.  Firstly, there
+ * are a lot of assumptions on strong associations among work, pwq and
+ * pool which make migrating pending and scheduled works very
+ * difficult to implement without impacting hot paths.  Secondly,
+ * worker pools serve mix of short, long and very long running works making
+ * blocked draining impractical.
+ *
+ * This is solved by allowing the pools to be disassociated from the CPU
+ * running as an unbound one and allowing it to be reattached later if the
+ * cpu comes back online.
+ */
+
+static void unbind_workers(int cpu)
+{
+	struct worker_pool *pool;
+	struct worker *worker;
+
+	for_each_cpu_worker_pool(pool, cpu) {
+		mutex_lock(&wq_pool_attach_mutex);
+		raw_spin_lock_irq(&pool->lock);
+
+		/*
+		 * We've blocked all attach/detach operations. Make all workers
+		 * unbound and set DISASSOCIATED.  Before this, all workers
+		 * except for the ones which are still executing works from
+		 * before the last CPU down must be on the cpu.  After
+		 * this, they may become diasporas.
+		 */
+		for_each_pool_worker(worker, pool)
+			worker->flags |= WORKER_UNBOUND;
+
+		pool->flags |= POOL_DISASSOCIATED;
+
+		raw_spin_unlock_irq(&pool->lock);
+		mutex_unlock(&wq_pool_attach_mutex);
+
+		/*
+		 * Call schedule() so that we cross rq->lock and thus can
+		 * guarantee sched callbacks see the %WORKER_UNBOUND flag.
+		 * This is necessary as scheduler callbacks may be invoked
+		 * from other cpus.
+		 */
+		schedule();
+
+		/*
+		 * Sched callbacks are disabled now.  Zap nr_running.
+		 * After this, nr_running stays zero and need_more_worker()
+		 * and keep_working() are always true as long as the
+		 * worklist is not empty.  This pool now behaves as an
+		 * unbound (in terms of concurrency management) pool which
+		 * are served by workers tied to the pool.
+		 */
+		atomic_set(&pool->nr_running, 0);
+
+		/*
+		 * With concurrency management just turned off, a busy
+		 * worker blocking could lead to lengthy stalls.  Kick off
+		 * unbound chain execution of currently pending work items.
+		 */
+		raw_spin_lock_irq(&pool->lock);
+		wake_up_worker(pool);
+		raw_spin_unlock_irq(&pool->lock);
+	}
+}
+
+/**
+ * rebind_workers - rebind all workers of a pool to the associated CPU
+ * @pool: pool of interest
+ *
+ * @pool->cpu is coming online.  Rebind all workers to the CPU.
+ */
+static void rebind_workers(struct worker_pool *pool)
+{
+	struct worker *worker;
+
+	lockdep_assert_held(&wq_pool_attach_mutex);
+
+	/*
+	 * Restore CPU affinity of all workers.  As all idle workers should
+	 * be on the run-queue of the associated CPU before any local
+	 * wake-ups for concurrency management happen, restore CPU affinity
+	 * of all workers first and then clear UNBOUND.  As we're called
+	 * from CPU_ONLINE, the following shouldn't fail.
+	 */
+	for_each_pool_worker(worker, pool)
+		WARN_ON_ONCE(set_cpus_allowed_ptr(worker->task,
+						  pool->attrs->cpumask) < 0);
+
+	raw_spin_lock_irq(&pool->lock);
+
+	pool->flags &= ~POOL_DISASSOCIATED;
+
+	for_each_pool_worker(worker, pool) {
+		unsigned int worker_flags = worker->flags;
+
+		/*
+		 * A bound idle worker should actually be on the runqueue
+		 * of the associated CPU for local wake-ups targeting it to
+		 * work.  Kick all idle workers so that they migrate to the
+		 * associated CPU.  Doing this in the same loop as
+		 * replacing UNBOUND with REBOUND is safe as no worker will
+		 * be bound before @pool->lock is released.
+		 */
+		if (worker_flags & WORKER_IDLE)
+			wake_up_process(worker->task);
+
+		/*
+		 * We want to clear UNBOUND but can't directly call
+		 * worker_clr_flags() or adjust nr_running.  Atomically
+		 * replace UNBOUND with another NOT_RUNNING flag REBOUND.
+		 * @worker will clear REBOUND using worker_clr_flags() when
+		 * it initiates the next execution cycle thus restoring
+		 * concurrency management.  Note that when or whether
+		 * @worker clears REBOUND doesn't affect correctness.
+		 *
+		 * WRITE_ONCE() is necessary because @worker->flags may be
+		 * tested without holding any lock in
+		 * wq_worker_running().  Without it, NOT_RUNNING test may
+		 * fail incorrectly leading to premature concurrency
+		 * management operations.
+		 */
+		WARN_ON_ONCE(!(worker_flags & WORKER_UNBOUND));
+		worker_flags |= WORKER_REBOUND;
+		worker_flags &= ~WORKER_UNBOUND;
+		WRITE_ONCE(worker->flags, worker_flags);
+	}
+
+	raw_spin_unlock_irq(&pool->lock);
+}
+
+/**
+ * restore_unbound_workers_cpumask - restore cpumask of unbound workers
+ * @pool: unbound pool of interest
+ * @cpu: the CPU which is coming up
+ *
+ * An unbound pool may end up with a cpumask which doesn't have any online
+ * CPUs.  When a worker of such pool get scheduled, the scheduler resets
+ * its cpus_allowed.  If @cpu is in @pool's cpumask which didn't have any
+ * online CPU before, cpus_allowed of all its workers should be restored.
+ */
+static void restore_unbound_workers_cpumask(struct worker_pool *pool, int cpu)
+{
+	static cpumask_t cpumask;
+	struct worker *worker;
+
+	lockdep_assert_held(&wq_pool_attach_mutex);
+
+	/* is @cpu allowed for @pool? */
+	if (!cpumask_test_cpu(cpu, pool->attrs->cpumask))
+		return;
+
+	cpumask_and(&cpumask, pool->attrs->cpumask, cpu_online_mask);
+
+	/* as we're called from CPU_ONLINE, the following shouldn't fail */
+	for_each_pool_worker(worker, pool)
+		WARN_ON_ONCE(set_cpus_allowed_ptr(worker->task, &cpumask) < 0);
+}
+
+int workqueue_prepare_cpu(unsigned int cpu)
+{
+	struct worker_pool *pool;
+
+	for_each_cpu_worker_pool(pool, cpu) {
+		if (pool->nr_workers)
+			continue;
+		if (!create_worker(pool))
+			return -ENOMEM;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(workqueue_prepare_cpu);
+
+int workqueue_online_cpu(unsigned int cpu)
+{
+	struct worker_pool *pool;
+	struct workqueue_struct *wq;
+	int pi;
+
+	mutex_lock(&wq_pool_mutex);
+
+	for_each_pool(pool, pi) {
+		mutex_lock(&wq_pool_attach_mutex);
+
+		if (pool->cpu == cpu)
+			rebind_workers(pool);
+		else if (pool->cpu < 0)
+			restore_unbound_workers_cpumask(pool, cpu);
+
+		mutex_unlock(&wq_pool_attach_mutex);
+	}
+
+	/* update NUMA affinity of unbound workqueues */
+	list_for_each_entry(wq, &workqueues, list)
+		wq_update_unbound_numa(wq, cpu, true);
+
+	mutex_unlock(&wq_pool_mutex);
+	return 0;
+}
+EXPORT_SYMBOL(workqueue_online_cpu);
+
+int workqueue_offline_cpu(unsigned int cpu)
+{
+	struct workqueue_struct *wq;
+
+	/* unbinding per-cpu workers should happen on the local CPU */
+	if (WARN_ON(cpu != smp_processor_id()))
+		return -1;
+
+	unbind_workers(cpu);
+
+	/* update NUMA affinity of unbound workqueues */
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list)
+		wq_update_unbound_numa(wq, cpu, false);
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(workqueue_offline_cpu);
+
+#endif /* CONFIG_SMP */
+
 //struct work_for_cpu {
 //	struct work_struct work;
 //	long (*fn)(void *);